@@ -21,21 +21,42 @@
  */
 
 /*如果需要新增SOC "XXX"，根据以下步骤：
- * 1. 在 acoralSOCEnum 中添加 SOC_XXX
- * 2. #define CFG_SOC XXX
+ * 1. 在下面的SOC列表中添加 #define SOC_XXX n（要在预处理阶段比较，所以不能用enum）
+ * 2. #define CFG_SOC XXX，或者编译时传入 -DCFG_SOC=SOC_XXX
  * 3. 在hal文件夹中新增XXX文件夹
  * 4. 在XXX文件夹中实现hal层接口
  * 5. 在hal.h中新增头文件目录
  */
-typedef enum{
-  SOC_K210,
-  SOC_S3C2440
-}acoralSOCEnum;
+#define SOC_K210     1
+#define SOC_S3C2440  2
+#define SOC_LINUX    3 ///<Linux主机，aCoral作为一个普通进程运行，用于调试、性能分析和回归测试
+
+#ifndef CFG_SOC
 #define CFG_SOC SOC_K210
+#endif
 
 //K210
 #if CFG_SOC==SOC_K210
-#define CFG_SMP 
+#define CFG_SMP 1
+#define CFG_MAX_CPU 2 ///<K210有两个hart，每个hart都跑aCoral的调度
+#define CFG_FPU 1 ///<K210有双精度FPU，线程切换时按mstatus.FS惰性保存浮点寄存器
+#endif
+
+//Linux主机，每个核用一个pthread模拟，可以编译时传入-DCFG_MAX_CPU=n
+//浮点现场由ucontext和信号帧保存，不需要CFG_FPU
+#if CFG_SOC==SOC_LINUX
+#define CFG_SMP 1
+#ifndef CFG_MAX_CPU
+#define CFG_MAX_CPU 2
+#endif
+#endif
+
+#ifndef CFG_MAX_CPU
+#define CFG_MAX_CPU 1 ///<单核
+#endif
+
+#ifndef CFG_FPU
+#define CFG_FPU 0 ///<线程切换时不单独处理浮点寄存器
 #endif
 
 
@@ -50,6 +71,9 @@ typedef enum{
 #define CFG_MEM2_SIZE (102400) ///<任意大小内存分配系统的大小，是从伙伴系统管理的堆内存中拿出一部分
 
 #define CFG_THRD_PERIOD 1
+#define CFG_THRD_EDF 1 ///<启用最早截止期优先（EDF）调度策略
+#define CFG_THRD_SLICE 1 ///<普通线程可以设置时间片，同优先级的线程轮转
+#define CFG_THRD_STATS 1 ///<统计每个线程的运行周期、切换次数和唤醒延迟，shell的top命令要用
 
 #define CFG_THRD_DAG 1 ///<启用DAG调度
 #define CFG_DAG_SIZE 10 ///<全局DAG图节点数量上限
@@ -57,16 +81,44 @@ typedef enum{
 
 #define CFG_HARD_RT_PRIO_NUM (0) ///<硬实时任务的专属优先级个数
 
-#define CFG_MAX_THREAD (40) ///<///最多40个线程
+#ifndef CFG_MAX_THREAD
+#define CFG_MAX_THREAD (40) ///<最多40个线程，可以编译时传入-DCFG_MAX_THREAD=n，最多1023
+#endif
 
-#define CFG_MIN_STACK_SIZE (10240) ///<线程最小拥有10240字节的栈
+#if CFG_SOC==SOC_LINUX
+#define CFG_MIN_STACK_SIZE (65536) ///<Linux主机上信号处理函数（模拟中断）和printf都跑在线程栈上，需要更大的栈
+#define CFG_DEFAULT_STACK_SIZE (65536) ///<创建线程时栈大小传0就用这个
+#else
+#define CFG_MIN_STACK_SIZE (1024) ///<线程栈的下限，要放得下中断现场和中断服务函数的调用链
+#define CFG_DEFAULT_STACK_SIZE (10240) ///<创建线程时栈大小传0就用这个
+#endif
+#define CFG_STACK_CHECK 1 ///<创建线程时给栈涂色，可以查出每个线程的栈用到过多深
+#define CFG_STACK_LEARN 0 ///<学习模式：线程退出时记下栈用到的最深处，按线程名汇总，给出推荐的栈大小
+#define CFG_STACK_LEARN_ENTRIES 32 ///<学习模式最多记录多少个线程名
+#define CFG_THRD_CACHE 4 ///<每档栈大小最多缓存几个退出线程的TCB和栈，创建线程时直接复用，0：不缓存
 
 #define CFG_EVT_SEM 1
 #define CFG_EVT_MUTEX 1
 
 #define CFG_MSG 1 ///<1：启用消息队列 ，0：关闭消息队列
+#define CFG_MSGQ 1 ///<启用定长消息队列，消息按值拷进环形缓冲区，收发不用分配
+
+#define CFG_WORKQ 1 ///<启用工作队列，短小的活交给固定的工作线程去做
+#define CFG_WORKQ_WORKERS 2 ///<每档优先级几个工作线程
+#define CFG_WORKQ_PRIO_HIGH 5 ///<高档工作线程的优先级
+#define CFG_WORKQ_PRIO_LOW 30 ///<低档工作线程的优先级
+#define CFG_WORKQ_ITEMS 32 ///<acoral_workq_submit用的内部工作项个数
+
+#define CFG_APPTIMER 1 ///<启用应用定时器，到期时调用户给的函数，不用专门开一个线程轮询
+#define CFG_APPTIMER_PRIO 4 ///<应用定时器服务线程的优先级，回调都在它上面跑
 
 #define CFG_TICKS_PER_SEC (100) ///<acoral每秒的ticks数
+#define CFG_TICKLESS 1 ///<所有核都空闲时停掉周期ticks，用单次定时睡到下一个到期事件
+#define CFG_TICKLESS_MAX_TICKS (60 * CFG_TICKS_PER_SEC) ///<停ticks一次最多停多少个tick
+#define CFG_HRTIMER 1 ///<启用高精度定时器，微秒延时和纳秒超时不按tick取整，直接用硬件比较器定时
+
+#define CFG_TRACE 1 ///<启用调度事件跟踪，每个核一个跟踪环
+#define CFG_TRACE_ENTRIES (1024) ///<每个核的跟踪环能存多少条记录，必须是2的幂
 
 
 
@@ -81,6 +133,4 @@ typedef enum{
 #define CFG_BAUD_RATE (115200)
 #define CFG_DEBUG_INFO 1
 
-#undef ARCH_ACORAL_FPU /*//SPG中断保护现场那里*/
-
 #endif
\ No newline at end of file
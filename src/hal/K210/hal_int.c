@@ -15,26 +15,75 @@
 
 #include "./include/hal_int.h"
 #include "thread.h"
+#include "spinlock.h"
+#include "trace.h"
 #include <stdint.h>
 
 #include "sysctl.h"
+#include "clint.h"
+#include "entry.h"
 
-///中断嵌套数。大于0表示正在中断中。大于1表示中断层数不止一层，即中断嵌套。
-int acoral_intr_nesting = 0;
-unsigned long pre_mstatus_MIE; //SPG 多核的话要扩展成数组，因为每个核有自己的mstatus
+///每个hart的中断嵌套数。大于0表示正在中断中。大于1表示中断层数不止一层，即中断嵌套。
+int acoral_intr_nestings[CFG_MAX_CPU];
+
+///每个hart有自己的mstatus，所以进入临界区前的MIE也是每个hart一份
+static unsigned long pre_mstatus_MIE[CFG_MAX_CPU];
+
+///每个hart的临界区嵌套数，只有最外层的进入和退出才去碰内核大锁
+static int hal_lock_nest[CFG_MAX_CPU];
+
+///内核大锁，所有内核数据结构（就绪队列、延时队列、ipc等待队列……）都由它保护
+static acoral_spinlock_t hal_kernel_lock;
+
+///hart是否正在中断退出时切换线程，这时被切走的线程是被中断打断的，不在临界区中
+static int hal_in_intr_exit[CFG_MAX_CPU];
+
+static void (*hal_ipi_entry[CFG_MAX_CPU])(void *args);
+static void *hal_ipi_args[CFG_MAX_CPU];
 
 void hal_intr_init(){
     plic_init();
 }
 
-void hal_intr_unmask(int vector)
+int hal_intr_unmask(int vector)
 {
-	// TODO riscv-加上
+	return plic_irq_enable(vector);
 }
 
-void hal_intr_mask(int vector)
+int hal_intr_mask(int vector)
 {
-	// TODO riscv-加上
+	return plic_irq_disable(vector);
+}
+
+#if CFG_TRACE
+static void (*hal_isr_table[PLIC_NUM_SOURCES])(int); ///<跟踪打开时PLIC回调统一进hal_plic_isr，由它记下中断进出再调真正的服务函数
+
+static int hal_plic_isr(void *ctx)
+{
+	int vector = (int)(long)ctx;
+	ACORAL_TRACE(ACORAL_TRACE_IRQ_ENTER, acoral_cur_thread ? acoral_cur_thread->res.id : -1, vector);
+	hal_isr_table[vector](vector);
+	ACORAL_TRACE(ACORAL_TRACE_IRQ_EXIT, acoral_cur_thread ? acoral_cur_thread->res.id : -1, vector);
+	return 0;
+}
+#endif
+
+int hal_intr_attach(int vector, void (*isr)(int))
+{
+#if CFG_TRACE
+	if (vector <= 0 || vector >= PLIC_NUM_SOURCES)
+		return -1;
+	hal_isr_table[vector] = isr;
+	plic_irq_register(vector, hal_plic_isr, (void *)(long)vector);
+#else
+	plic_irq_register(vector, (plic_irq_callback_t)isr, NULL);
+#endif
+	return 0;
+}
+
+void hal_intr_detach(int vector)
+{
+	plic_irq_deregister(vector);
 }
 
 
@@ -61,9 +110,12 @@ void hal_sched_bridge_comm()
 
 unsigned long hal_intr_exit_bridge_comm(unsigned long old_sp)
 {
-
+	int cpu;
 	HAL_ENTER_CRITICAL();
+	cpu = HAL_GET_CORE_ID();
+	hal_in_intr_exit[cpu] = 1;
 	unsigned long next_sp = acoral_real_intr_sched(old_sp);
+	hal_in_intr_exit[cpu] = 0;
 	HAL_EXIT_CRITICAL();
 	return next_sp;
 }
@@ -77,10 +129,88 @@ void hal_intr_disable(){
 }
 
 void hal_enter_critical(){
-    pre_mstatus_MIE = read_csr(mstatus) & MSTATUS_MIE; 
-    hal_intr_disable();                          
+    unsigned long mie = read_csr(mstatus) & MSTATUS_MIE;
+    int cpu;
+    hal_intr_disable();
+    cpu = HAL_GET_CORE_ID();
+    if (hal_lock_nest[cpu]++ == 0)
+    {
+        pre_mstatus_MIE[cpu] = mie;
+        acoral_spin_lock(&hal_kernel_lock);
+    }
 }
 
 void hal_exit_critical(){
-	write_csr(mstatus,read_csr(mstatus) | pre_mstatus_MIE); 
+    int cpu = HAL_GET_CORE_ID();
+    if (hal_lock_nest[cpu] == 0)
+        return;
+    if (--hal_lock_nest[cpu] == 0)
+    {
+        acoral_spin_unlock(&hal_kernel_lock);
+        write_csr(mstatus,read_csr(mstatus) | pre_mstatus_MIE[cpu]);
+    }
+}
+
+void hal_lock_status_switch(hal_lock_status_t *prev, hal_lock_status_t *next)
+{
+    int cpu = HAL_GET_CORE_ID();
+    if (hal_in_intr_exit[cpu])
+    {
+        /* 被中断打断的线程不在临界区中；切回来时由trap返回代码恢复上下文，不会经过hal_cpus_lock_status_restore，
+         * 所以多加一层嵌套，抵掉hal_intr_exit_bridge_comm自己的HAL_EXIT_CRITICAL */
+        prev->nest = 0;
+        hal_lock_nest[cpu] = next->nest + 1;
+        if (next->nest)
+            pre_mstatus_MIE[cpu] = next->pre;
+        return;
+    }
+    prev->nest = hal_lock_nest[cpu];
+    prev->pre = pre_mstatus_MIE[cpu];
+    hal_lock_nest[cpu] = next->nest;
+    pre_mstatus_MIE[cpu] = next->pre;
+}
+
+void hal_cpus_lock_status_restore()
+{
+    if (hal_lock_nest[HAL_GET_CORE_ID()] == 0)
+        acoral_spin_unlock(&hal_kernel_lock);
+}
+
+static int hal_ipi_isr(void *ctx)
+{
+    int cpu = HAL_GET_CORE_ID();
+    clint_ipi_clear(cpu);
+    if (hal_ipi_entry[cpu] != NULL)
+        hal_ipi_entry[cpu](hal_ipi_args[cpu]);
+    return 0;
+}
+
+int hal_ipi_init(void (*ipi_entry)(void *args), void *args)
+{
+    int cpu = HAL_GET_CORE_ID();
+    hal_ipi_entry[cpu] = ipi_entry;
+    hal_ipi_args[cpu] = args;
+    clint_ipi_init();
+    clint_ipi_register(hal_ipi_isr, NULL);
+    return clint_ipi_enable();
+}
+
+void hal_ipi_send(int cpu)
+{
+    clint_ipi_send(cpu);
+}
+
+static void (*hal_other_cpu_entry)(void);
+
+static int hal_core1_entry(void *ctx)
+{
+    hal_other_cpu_entry();
+    return 0;
+}
+
+void hal_start_other_cpus(void (*entry)(void))
+{
+    hal_other_cpu_entry = entry;
+    /* hart1上电后停在SDK的启动代码里，注册入口之后才往下跑 */
+    register_core1(hal_core1_entry, NULL);
 }
\ No newline at end of file
@@ -14,6 +14,7 @@
  */
 
 #include "./include/hal_thread.h"
+#include "./include/hal_int.h"
 #include <stdio.h>
 /**
  * @brief 线程上下文初始化，用于线程被切换到cpu上运行后，替换之前的线程的上下文
@@ -51,7 +52,49 @@ unsigned int* hal_stack_init(unsigned int *stack, void *route, void *exit, void
 
     /* force to machine mode(MPP=11) and set MPIE to 1 ，在线程切换时，会使用mret指令，将MPIE赋给MIE，即打开中断 */
     //SPG 这里有一个问题，就是对于init线程，切换init上下文到init第一行代码关中断，这中间中断是打开的，虽然很短，但如果发生中断，可能会发生问题
-    frame->mstatus = 0x00007880;
+    /* FS不放在上下文里，由hal_fpu_switch按线程设置 */
+    frame->mstatus = 0x00001880;
     
     return stk;
 }
+
+#if CFG_FPU
+#define HAL_MSTATUS_FS          0x6000
+#define HAL_MSTATUS_FS_INITIAL  0x2000
+#define HAL_MSTATUS_FS_CLEAN    0x4000
+#define HAL_MSTATUS_FS_DIRTY    0x6000
+
+///每个hart的浮点寄存器里现在是谁的现场
+static hal_fpu_ctx_t *hal_fpu_owner[CFG_MAX_CPU];
+
+void hal_fpu_switch(hal_fpu_ctx_t *prev, hal_fpu_ctx_t *next)
+{
+    int cpu = HAL_GET_CORE_ID();
+
+    /* 旧线程改过浮点寄存器才保存，这之后它的现场在内存和这个hart的寄存器里各有一份 */
+    if ((read_csr(mstatus) & HAL_MSTATUS_FS) == HAL_MSTATUS_FS_DIRTY)
+    {
+        hal_fpu_save(prev);
+        prev->valid = 1;
+        prev->cpu = cpu;
+        hal_fpu_owner[cpu] = prev;
+    }
+    clear_csr(mstatus, HAL_MSTATUS_FS);
+    if (!next->valid)
+    {
+        /* 没用过浮点的线程，寄存器里留着别人的现场也不要紧，它一写就会变成Dirty，切走时再保存 */
+        set_csr(mstatus, HAL_MSTATUS_FS_INITIAL);
+        return;
+    }
+    /* 现场还留在这个hart上（中间没被别的线程改过，也没在别的hart上跑过）就不用恢复 */
+    if (hal_fpu_owner[cpu] != next || next->cpu != cpu)
+    {
+        set_csr(mstatus, HAL_MSTATUS_FS_INITIAL);
+        hal_fpu_restore(next);
+        hal_fpu_owner[cpu] = next;
+        next->cpu = cpu;
+        clear_csr(mstatus, HAL_MSTATUS_FS);
+    }
+    set_csr(mstatus, HAL_MSTATUS_FS_CLEAN);
+}
+#endif
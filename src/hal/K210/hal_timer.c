@@ -2,11 +2,45 @@
 #include "autocfg.h"
 
 #include "clint.h"
+#include "timer.h"
+
+#define HAL_HRTIMER_DEVICE TIMER_DEVICE_0
+#define HAL_HRTIMER_CHANNEL TIMER_CHANNEL_0
+#define HAL_HRTIMER_MIN_NS 1000ull			///<比较器最少设多远，太近的话设完之前就过了
+#define HAL_HRTIMER_MAX_NS 1000000000ull	///<比较器最多设多远，TIMER是32位计数，更远的先到这里，中断里找不到到期的再设一次
+
+static void (*hal_ticks_entry)(void *args);
+static unsigned long long hal_tick_cycles;		///<一个tick周期的mtime计数
+static unsigned long long hal_tickless_boundary;	///<停ticks之后第一个tick边界的mtime
+static int hal_in_ticks_isr;					///<正在ticks中断回调里，SDK返回之后还会给mtimecmp加一个周期
+
+static void (*hal_hrtimer_entry)(void *args);
+static void *hal_hrtimer_args;
+static unsigned long long hal_mtime_freq;		///<mtime每秒的计数，第一次要用时从时钟配置读出来
+
+/* mtime每秒的计数。64位时钟不管开没开CFG_HRTIMER都要用，ticks初始化之前也可能被调到，所以不靠哪个init来设 */
+static unsigned long long hal_mtime_get_freq(void)
+{
+	if(hal_mtime_freq == 0)
+		hal_mtime_freq = clint_timer_get_freq();
+	return hal_mtime_freq;
+}
+
+/* SDK的周期定时在回调返回之后才把mtimecmp加一个周期，包一层记下现在是不是在回调里 */
+static int hal_ticks_isr(void *args)
+{
+	hal_in_ticks_isr = 1;
+	hal_ticks_entry(args);
+	hal_in_ticks_isr = 0;
+	return 0;
+}
 
 int hal_timer_init(int ticks_per_sec, void (*ticks_entry)(void *args), void *args){
 	int result = -1;
+	hal_ticks_entry = ticks_entry;
+	hal_tick_cycles = hal_mtime_get_freq() / ticks_per_sec;
 	clint_timer_init();                           	/*这个主要用于将用于ticks的时钟初始化*/
-	result = clint_timer_register(ticks_entry,args);	//SPG 这里不应该直接使用acoral_ticks_entry，因为这是kernel层函数，应该将其作为参数传进来
+	result = clint_timer_register(hal_ticks_isr,args);	//SPG 这里不应该直接使用acoral_ticks_entry，因为这是kernel层函数，应该将其作为参数传进来
 	if(result){
 		return -1;
 	}
@@ -16,3 +50,66 @@ int hal_timer_init(int ticks_per_sec, void (*ticks_entry)(void *args), void *arg
 	}
 	return 0;
 }
+
+int hal_timer_tickless_enter(unsigned int ticks){
+	/* mtimecmp就是下一个tick边界，已经过了说明有一个tick挂着没处理 */
+	hal_tickless_boundary = clint->mtimecmp[0];
+	if(clint->mtime >= hal_tickless_boundary)
+		return -1;
+	clint->mtimecmp[0] = hal_tickless_boundary + (unsigned long long)(ticks - 1) * hal_tick_cycles;
+	return 0;
+}
+
+unsigned int hal_timer_tickless_exit(void){
+	unsigned long long now = clint->mtime;
+	unsigned int passed = 0;
+
+	if(now >= hal_tickless_boundary)
+		passed = (now - hal_tickless_boundary) / hal_tick_cycles + 1;
+	clint->mtimecmp[0] = hal_tickless_boundary + (unsigned long long)passed * hal_tick_cycles;
+	if(hal_in_ticks_isr)
+		clint->mtimecmp[0] -= hal_tick_cycles;
+	return passed;
+}
+
+/* 单次定时：到期先停掉通道，再交给内核，内核会把下一个到期时间设回来 */
+static int hal_hrtimer_isr(void *ctx)
+{
+	timer_set_enable(HAL_HRTIMER_DEVICE, HAL_HRTIMER_CHANNEL, 0);
+	hal_hrtimer_entry(hal_hrtimer_args);
+	return 0;
+}
+
+int hal_hrtimer_init(void (*hrtimer_entry)(void *args), void *args){
+	hal_hrtimer_entry = hrtimer_entry;
+	hal_hrtimer_args = args;
+	timer_init(HAL_HRTIMER_DEVICE);
+	timer_set_enable(HAL_HRTIMER_DEVICE, HAL_HRTIMER_CHANNEL, 0);
+	/* 不用SDK的单次模式，自己在回调里停通道 */
+	return timer_irq_register(HAL_HRTIMER_DEVICE, HAL_HRTIMER_CHANNEL, 0, 1, hal_hrtimer_isr, NULL);
+}
+
+unsigned long long hal_hrtimer_now(void){
+	unsigned long long mtime = clint->mtime;
+	unsigned long long freq = hal_mtime_get_freq();
+
+	/* 拆成整秒和零头，直接乘1e9的话mtime几分钟就溢出了 */
+	return mtime / freq * 1000000000ull + mtime % freq * 1000000000ull / freq;
+}
+
+void hal_hrtimer_set(unsigned long long deadline){
+	unsigned long long now = hal_hrtimer_now();
+	unsigned long long delta = deadline > now ? deadline - now : 0;
+
+	if(delta < HAL_HRTIMER_MIN_NS)
+		delta = HAL_HRTIMER_MIN_NS;
+	if(delta > HAL_HRTIMER_MAX_NS)
+		delta = HAL_HRTIMER_MAX_NS;
+	timer_set_enable(HAL_HRTIMER_DEVICE, HAL_HRTIMER_CHANNEL, 0);
+	timer_set_interval(HAL_HRTIMER_DEVICE, HAL_HRTIMER_CHANNEL, delta);
+	timer_set_enable(HAL_HRTIMER_DEVICE, HAL_HRTIMER_CHANNEL, 1);
+}
+
+void hal_hrtimer_cancel(void){
+	timer_set_enable(HAL_HRTIMER_DEVICE, HAL_HRTIMER_CHANNEL, 0);
+}
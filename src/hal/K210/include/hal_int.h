@@ -16,12 +16,29 @@
 #ifndef HAL_INT_H
 #define HAL_INT_H
 
+#include "autocfg.h"
 #include "encoding.h"
+#include "plic.h"
 
 #define HAL_INTR_ENABLE()     hal_intr_enable()
 #define HAL_INTR_DISABLE()    hal_intr_disable()
 
-extern int acoral_intr_nesting;
+///当前hart的编号
+#define HAL_GET_CORE_ID() ((int)read_csr(mhartid))
+
+///每个hart有自己的中断嵌套数
+extern int acoral_intr_nestings[CFG_MAX_CPU];
+#define acoral_intr_nesting (acoral_intr_nestings[HAL_GET_CORE_ID()])
+
+/**
+ * @brief 线程被切换走时所在hart的临界区状态，随线程一起保存和恢复
+ * @note 线程可能在临界区里被切走（比如在调度桥接函数里），等它在某个hart上被切回来时，
+ *       这个hart的临界区嵌套数和进入临界区之前的MIE都要换成这个线程自己的
+ */
+typedef struct {
+	int nest;           ///<临界区嵌套数
+	unsigned long pre;  ///<进入最外层临界区之前的MIE
+}hal_lock_status_t;
 
 void hal_intr_init();
 
@@ -38,18 +55,36 @@ void hal_intr_enable();
 void hal_intr_disable();
 
 /**
- * @brief 使能中断。通过向中断屏蔽（INTMSK）寄存器某位写入0来打开相应中断，对中断复用进行了合并处理
+ * @brief 使能中断。打开plic中相应的外部中断
  *
- * @param vector 中断向量号（中断复用展开后）
+ * @param vector 中断向量号（plic中断号）
+ * @return int 0成功
  */
-void hal_intr_unmask(int vector);
+int hal_intr_unmask(int vector);
 
 /**
- * @brief 除能中断。通过向中断屏蔽（INTMSK）寄存器某位写入1来屏蔽相应中断，对中断复用进行了合并处理
+ * @brief 除能中断。关闭plic中相应的外部中断
  *
- * @param vector 中断向量号（中断复用展开后）
+ * @param vector 中断向量号（plic中断号）
+ * @return int 0成功
  */
-void hal_intr_mask(int vector);
+int hal_intr_mask(int vector);
+
+/**
+ * @brief 给plic中断绑定中断服务函数
+ *
+ * @param vector 中断向量号（plic中断号）
+ * @param isr 中断服务函数
+ * @return int 0成功
+ */
+int hal_intr_attach(int vector, void (*isr)(int));
+
+/**
+ * @brief 解绑plic中断的中断服务函数
+ *
+ * @param vector 中断向量号（plic中断号）
+ */
+void hal_intr_detach(int vector);
 
 void hal_intr_ack(unsigned int vector);
 
@@ -72,6 +107,56 @@ void hal_intr_nesting_dec_comm();
  */
 void hal_intr_nesting_inc_comm();
 
+/**
+ * @brief 进入临界区：关本hart的中断，最外层还要获取内核大锁，挡住另一个hart
+ *
+ */
+void hal_enter_critical();
+
+/**
+ * @brief 退出临界区：退出最外层时释放内核大锁，恢复进入之前的中断状态
+ *
+ */
+void hal_exit_critical();
+
+/**
+ * @brief 线程切换时交换临界区状态：当前hart的状态存入prev，next的状态装入当前hart
+ *
+ * @param prev 被切走的线程的临界区状态
+ * @param next 将要运行的线程的临界区状态
+ */
+void hal_lock_status_switch(hal_lock_status_t *prev, hal_lock_status_t *next);
+
+/**
+ * @brief 切换到新线程的栈之后、恢复它的寄存器之前调用（见hal_thread_s.S），
+ *        如果新线程不在临界区中（新建的线程），替它释放内核大锁
+ *
+ */
+void hal_cpus_lock_status_restore();
+
+/**
+ * @brief 初始化本hart的核间中断，每个hart启动时都要调用
+ *
+ * @param ipi_entry 核间中断服务函数
+ * @param args 核间中断服务函数参数
+ * @return int 0成功
+ */
+int hal_ipi_init(void (*ipi_entry)(void *args), void *args);
+
+/**
+ * @brief 给某个hart发核间中断，让它重新调度
+ *
+ * @param cpu 目标hart
+ */
+void hal_ipi_send(int cpu);
+
+/**
+ * @brief 启动其它hart，它们从entry开始执行，entry不返回
+ *
+ * @param entry 从核入口
+ */
+void hal_start_other_cpus(void (*entry)(void));
+
 /**
  * @brief 保证调度的原子性
  *
@@ -92,12 +177,22 @@ unsigned long hal_intr_exit_bridge_comm(unsigned long old_sp);
 #define HAL_INTR_NESTING_DEC()    hal_intr_nesting_dec_comm()
 #define HAL_INTR_NESTING_INC()    hal_intr_nesting_inc_comm()
 
-#define HAL_INTR_ATTACH(vecotr,isr) //TODO 该写什么？
+#define HAL_INTR_ATTACH(vector,isr) hal_intr_attach(vector,isr)
+#define HAL_INTR_DETACH(vector) hal_intr_detach(vector)
+#define HAL_INTR_UNMASK(vector) hal_intr_unmask(vector)
+#define HAL_INTR_MASK(vector) hal_intr_mask(vector)
 #define HAL_SCHED_BRIDGE() hal_sched_bridge_comm() //SPGcommon指的是老版本的acoral中，有stm32的版本，但是stm32的调度被放在pendsv中，比较特殊，所有这里封装了一层接口，除了stm32其他的实现称为common
 #define HAL_INTR_EXIT_BRIDGE(sp) hal_intr_exit_bridge_comm(sp)
 
 #define HAL_ENTER_CRITICAL() hal_enter_critical()
 #define HAL_EXIT_CRITICAL() hal_exit_critical()
 
+#define HAL_LOCK_STATUS_INIT(status) ((status)->nest = 0, (status)->pre = 0)
+#define HAL_LOCK_STATUS_SWITCH(prev,next) hal_lock_status_switch(prev,next)
+#define HAL_IPI_INIT(ipi_entry,args) hal_ipi_init(ipi_entry,args)
+#define HAL_IPI_SEND(cpu) hal_ipi_send(cpu)
+#define HAL_START_OTHER_CPUS(entry) hal_start_other_cpus(entry)
+#define HAL_CPU_SLEEP() __asm__ volatile("wfi") ///<等中断，中断来了之后处理完再从这里往下走
+
 
 #endif
\ No newline at end of file
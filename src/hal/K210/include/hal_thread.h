@@ -17,6 +17,8 @@
 #ifndef HAL_THREAD_H
 #define HAL_THREAD_H
 
+#include "autocfg.h"
+
 /**
  * @brief aCoral线程上下文context在硬件层面的描述
  */
@@ -53,42 +55,36 @@ typedef struct {
     unsigned long t4;         /* x29 - t4     - temporary register 4                */
     unsigned long t5;         /* x30 - t5     - temporary register 5                */
     unsigned long t6;         /* x31 - t6     - temporary register 6                */
-#ifdef ARCH_ACORAL_FPU
-    unsigned int f0;      /* f0  */
-    unsigned int f1;      /* f1  */
-    unsigned int f2;      /* f2  */
-    unsigned int f3;      /* f3  */
-    unsigned int f4;      /* f4  */
-    unsigned int f5;      /* f5  */
-    unsigned int f6;      /* f6  */
-    unsigned int f7;      /* f7  */
-    unsigned int f8;      /* f8  */
-    unsigned int f9;      /* f9  */
-    unsigned int f10;     /* f10 */
-    unsigned int f11;     /* f11 */
-    unsigned int f12;     /* f12 */
-    unsigned int f13;     /* f13 */
-    unsigned int f14;     /* f14 */
-    unsigned int f15;     /* f15 */
-    unsigned int f16;     /* f16 */
-    unsigned int f17;     /* f17 */
-    unsigned int f18;     /* f18 */
-    unsigned int f19;     /* f19 */
-    unsigned int f20;     /* f20 */
-    unsigned int f21;     /* f21 */
-    unsigned int f22;     /* f22 */
-    unsigned int f23;     /* f23 */
-    unsigned int f24;     /* f24 */
-    unsigned int f25;     /* f25 */
-    unsigned int f26;     /* f26 */
-    unsigned int f27;     /* f27 */
-    unsigned int f28;     /* f28 */
-    unsigned int f29;     /* f29 */
-    unsigned int f30;     /* f30 */
-    unsigned int f31;     /* f31 */
-#endif
 }hal_ctx_t;
 
+#if CFG_FPU
+/**
+ * @brief 线程的浮点现场，放在TCB里，不随上下文压栈
+ * @note 惰性保存：线程被切走时mstatus.FS是Dirty（它改过浮点寄存器）才保存；
+ *       切回来时如果它的现场还留在这个hart的寄存器里，就不用恢复。从来没用过浮点的线程没有任何开销
+ */
+typedef struct {
+    unsigned long long f[32]; ///<f0~f31，双精度
+    unsigned long fcsr;       ///<浮点控制和状态寄存器
+    int valid;                ///<线程用过浮点，f和fcsr里是它的浮点现场
+    int cpu;                  ///<浮点现场还留在哪个hart的寄存器里，-1表示不在任何hart上
+}hal_fpu_ctx_t;
+
+void hal_fpu_save(hal_fpu_ctx_t *ctx);
+void hal_fpu_restore(hal_fpu_ctx_t *ctx);
+
+/**
+ * @brief 线程切换时处理浮点现场，在切换上下文之前、临界区中调用
+ *
+ * @param prev 被切走的线程的浮点现场
+ * @param next 将要运行的线程的浮点现场
+ */
+void hal_fpu_switch(hal_fpu_ctx_t *prev, hal_fpu_ctx_t *next);
+
+#define HAL_FPU_INIT(ctx) ((ctx)->valid = 0, (ctx)->cpu = -1)
+#define HAL_FPU_SWITCH(prev,next) hal_fpu_switch(prev,next)
+#endif
+
 void HAL_SWITCH_TO(unsigned int** next);
 void HAL_CONTEXT_SWITCH(unsigned int **prev , unsigned int **next);
 unsigned int* hal_stack_init(unsigned int *stack, void *route, void *exit, void *args);
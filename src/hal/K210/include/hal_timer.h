@@ -15,6 +15,13 @@
 #ifndef HAL_TIMER_H
 #define HAL_TIMER_H
 
+#include "encoding.h"
+
+/**
+ * @brief 读取当前核的周期计数器mcycle，用于性能测量
+ */
+#define HAL_GET_CYCLES() ((unsigned long long)read_csr(mcycle))
+
 /**
  * @brief 配置ticks定时器的频率,打开其中断，并为其注册中断服务函数acoral_ticks_entry
  * 
@@ -25,4 +32,56 @@
  */
 int hal_timer_init(int ticks_per_sec, void (*ticks_entry)(void *args), void* args);
 
+/**
+ * @brief 停掉周期性的ticks，改成ticks个tick周期之后只来一次的单次定时，到期时间和原来的tick边界对齐
+ * @note 在临界区中调用
+ *
+ * @param ticks 多少个tick周期之后中断，至少为1
+ * @return int 0成功；-1已经有一个tick到期还没处理，不能停ticks
+ */
+int hal_timer_tickless_enter(unsigned int ticks);
+
+/**
+ * @brief 恢复周期性的ticks，下一次中断落在原来的tick边界上
+ * @note 在临界区中调用
+ *
+ * @return unsigned int 从hal_timer_tickless_enter到现在经过了多少个tick边界
+ */
+unsigned int hal_timer_tickless_exit(void);
+
+#define HAL_TICKLESS_ENTER(ticks) hal_timer_tickless_enter(ticks)
+#define HAL_TICKLESS_EXIT() hal_timer_tickless_exit()
+
+/**
+ * @brief 配置高精度定时器：CLINT的mtimecmp[0]被SDK的周期ticks占着，单次定时用TIMER0的0通道，中断走PLIC
+ *
+ * @param hrtimer_entry 到期时调用的中断服务函数
+ * @return int 0成功
+ */
+int hal_hrtimer_init(void (*hrtimer_entry)(void *args), void *args);
+
+/**
+ * @brief 得到高精度定时器的时间，由CLINT的mtime换算成纳秒
+ * @note 不依赖hal_hrtimer_init，没开CFG_HRTIMER或者ticks初始化之前也能调
+ */
+unsigned long long hal_hrtimer_now(void);
+
+/**
+ * @brief 把高精度定时器设到deadline，已经过了的马上到期，之前设的作废
+ * @note 在临界区中调用
+ *
+ * @param deadline 到期时间，hal_hrtimer_now的纳秒数
+ */
+void hal_hrtimer_set(unsigned long long deadline);
+
+/**
+ * @brief 停掉高精度定时器
+ * @note 在临界区中调用
+ */
+void hal_hrtimer_cancel(void);
+
+#define HAL_HRTIMER_NOW() hal_hrtimer_now()
+#define HAL_HRTIMER_SET(deadline) hal_hrtimer_set(deadline)
+#define HAL_HRTIMER_CANCEL() hal_hrtimer_cancel()
+
 #endif
\ No newline at end of file
@@ -0,0 +1,281 @@
+/**
+ * @file hal_int.c
+ * @brief hal层，Linux主机上用信号模拟的中断开关、中断入口以及一个简单的中断控制器
+ * @version 1.0
+ * @date 2024-05-06
+ * @copyright Copyright (c) 2024
+ */
+
+#include "./include/hal_int.h"
+#include "thread.h"
+#include "int.h"
+#include "spinlock.h"
+#include "trace.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+///每个核的中断嵌套数。大于0表示正在中断中。大于1表示中断层数不止一层，即中断嵌套。
+int acoral_intr_nestings[CFG_MAX_CPU];
+
+///每个核进入临界区之前中断是否是打开的，和K210的pre_mstatus_MIE作用一样
+static unsigned long pre_intr_enabled[CFG_MAX_CPU];
+
+///每个核的临界区嵌套数，只有最外层的进入和退出才去碰内核大锁
+static int hal_lock_nest[CFG_MAX_CPU];
+
+///内核大锁，所有内核数据结构（就绪队列、延时队列、ipc等待队列……）都由它保护
+static acoral_spinlock_t hal_kernel_lock;
+
+///当前pthread模拟的核号，volatile保证每次都从当前pthread的TLS里重新读
+static __thread volatile int hal_core_id;
+
+static pthread_t hal_cpu_pthreads[CFG_MAX_CPU]; ///<模拟每个核的pthread，用于发核间中断
+int hal_main_cpu_tid;
+
+static void (*hal_ipi_entry[CFG_MAX_CPU])(void *args);
+static void *hal_ipi_args[CFG_MAX_CPU];
+static void (*hal_other_cpu_entry)(void);
+
+sigset_t hal_intr_sigset;
+
+static void (*hal_isr_table[HAL_INTR_NUM])(int); ///<模拟中断控制器的中断向量表
+static volatile unsigned int hal_intr_pending;   ///<已触发但还没有服务的中断，每一位对应一个向量
+static volatile unsigned int hal_intr_enabled;   ///<被使能的中断，每一位对应一个向量
+
+/**
+ * @brief 外部中断服务：逐个处理已使能且挂起的向量
+ */
+static void hal_extern_isr(void *args)
+{
+	unsigned int pending;
+	int vector;
+	while ((pending = __atomic_load_n(&hal_intr_pending, __ATOMIC_ACQUIRE) & hal_intr_enabled) != 0)
+	{
+		vector = __builtin_ctz(pending);
+		__atomic_fetch_and(&hal_intr_pending, ~(1u << vector), __ATOMIC_ACQ_REL);
+		if (hal_isr_table[vector] == NULL)
+			continue;
+		ACORAL_TRACE(ACORAL_TRACE_IRQ_ENTER, acoral_cur_thread ? acoral_cur_thread->res.id : -1, vector);
+		hal_isr_table[vector](vector);
+		ACORAL_TRACE(ACORAL_TRACE_IRQ_EXIT, acoral_cur_thread ? acoral_cur_thread->res.id : -1, vector);
+	}
+}
+
+static void hal_extern_signal_handler(int signo)
+{
+	hal_intr_common_entry(hal_extern_isr, NULL);
+}
+
+void hal_intr_init(){
+	struct sigaction sa;
+
+	sigemptyset(&hal_intr_sigset);
+	sigaddset(&hal_intr_sigset, HAL_TIMER_SIGNAL);
+	sigaddset(&hal_intr_sigset, HAL_HRTIMER_SIGNAL);
+	sigaddset(&hal_intr_sigset, HAL_EXTERN_SIGNAL);
+	sigaddset(&hal_intr_sigset, HAL_IPI_SIGNAL);
+
+	/* hal_intr_init在0号核（进程主线程）上调用 */
+	hal_cpu_pthreads[0] = pthread_self();
+	hal_main_cpu_tid = (int)syscall(SYS_gettid);
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = hal_extern_signal_handler;
+	sa.sa_mask = hal_intr_sigset; /* 中断服务期间屏蔽所有模拟中断，和硬件一样不嵌套 */
+	sa.sa_flags = SA_RESTART;
+	sigaction(HAL_EXTERN_SIGNAL, &sa, NULL);
+}
+
+int hal_intr_unmask(int vector)
+{
+	if (vector < 0 || vector >= HAL_INTR_NUM)
+		return -1;
+	__atomic_fetch_or(&hal_intr_enabled, 1u << vector, __ATOMIC_ACQ_REL);
+	return 0;
+}
+
+int hal_intr_mask(int vector)
+{
+	if (vector < 0 || vector >= HAL_INTR_NUM)
+		return -1;
+	__atomic_fetch_and(&hal_intr_enabled, ~(1u << vector), __ATOMIC_ACQ_REL);
+	return 0;
+}
+
+int hal_intr_attach(int vector, void (*isr)(int))
+{
+	if (vector < 0 || vector >= HAL_INTR_NUM)
+		return -1;
+	hal_isr_table[vector] = isr;
+	return 0;
+}
+
+void hal_intr_detach(int vector)
+{
+	if (vector < 0 || vector >= HAL_INTR_NUM)
+		return;
+	hal_isr_table[vector] = NULL;
+}
+
+void hal_intr_raise(int vector)
+{
+	if (vector < 0 || vector >= HAL_INTR_NUM)
+		return;
+	__atomic_fetch_or(&hal_intr_pending, 1u << vector, __ATOMIC_ACQ_REL);
+	pthread_kill(pthread_self(), HAL_EXTERN_SIGNAL);
+}
+
+void hal_intr_common_entry(void (*isr)(void *args), void *args)
+{
+	hal_intr_nesting_inc_comm();
+	isr(args);
+	hal_intr_nesting_dec_comm();
+	acoral_intr_exit(0);
+}
+
+void hal_intr_nesting_dec_comm()
+{
+	if (acoral_intr_nesting > 0)
+		acoral_intr_nesting--;
+}
+
+void hal_intr_nesting_inc_comm()
+{
+	acoral_intr_nesting++;
+}
+
+void hal_sched_bridge_comm()
+{
+	HAL_ENTER_CRITICAL();
+	acoral_real_sched();
+	HAL_EXIT_CRITICAL();
+}
+
+unsigned long hal_intr_exit_bridge_comm(unsigned long old_sp)
+{
+	/* 信号处理函数执行期间中断本来就是屏蔽的，但还要拿内核大锁，所以和线程里的调度一样进出临界区。
+	 * 被切走的线程下次被调度时从这里返回，再经过sigreturn回到它被中断的地方 */
+	HAL_ENTER_CRITICAL();
+	acoral_real_sched();
+	HAL_EXIT_CRITICAL();
+	return old_sp;
+}
+
+void hal_intr_enable(){
+	pthread_sigmask(SIG_UNBLOCK, &hal_intr_sigset, NULL);
+}
+
+void hal_intr_disable(){
+	pthread_sigmask(SIG_BLOCK, &hal_intr_sigset, NULL);
+}
+
+void hal_enter_critical(){
+	sigset_t old;
+	int cpu;
+	pthread_sigmask(SIG_BLOCK, &hal_intr_sigset, &old);
+	cpu = hal_core_id;
+	if (hal_lock_nest[cpu]++ == 0)
+	{
+		pre_intr_enabled[cpu] = !sigismember(&old, HAL_TIMER_SIGNAL);
+		acoral_spin_lock(&hal_kernel_lock);
+	}
+}
+
+void hal_exit_critical(){
+	int cpu = hal_core_id;
+	if (hal_lock_nest[cpu] == 0)
+		return;
+	if (--hal_lock_nest[cpu] == 0)
+	{
+		acoral_spin_unlock(&hal_kernel_lock);
+		if (pre_intr_enabled[cpu])
+			pthread_sigmask(SIG_UNBLOCK, &hal_intr_sigset, NULL);
+	}
+}
+
+void hal_lock_status_switch(hal_lock_status_t *prev, hal_lock_status_t *next)
+{
+	int cpu = hal_core_id;
+	prev->nest = hal_lock_nest[cpu];
+	prev->pre = pre_intr_enabled[cpu];
+	hal_lock_nest[cpu] = next->nest;
+	pre_intr_enabled[cpu] = next->pre;
+}
+
+void hal_cpus_lock_status_restore()
+{
+	if (hal_lock_nest[hal_core_id] == 0)
+		acoral_spin_unlock(&hal_kernel_lock);
+}
+
+int hal_get_core_id(void)
+{
+	return hal_core_id;
+}
+
+static void hal_ipi_signal_handler(int signo)
+{
+	int cpu = hal_core_id;
+	if (hal_ipi_entry[cpu] != NULL)
+		hal_intr_common_entry(hal_ipi_entry[cpu], hal_ipi_args[cpu]);
+}
+
+int hal_ipi_init(void (*ipi_entry)(void *args), void *args)
+{
+	struct sigaction sa;
+	int cpu = hal_core_id;
+
+	hal_ipi_entry[cpu] = ipi_entry;
+	hal_ipi_args[cpu] = args;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = hal_ipi_signal_handler;
+	sa.sa_mask = hal_intr_sigset;
+	sa.sa_flags = SA_RESTART;
+	return sigaction(HAL_IPI_SIGNAL, &sa, NULL);
+}
+
+void hal_ipi_send(int cpu)
+{
+	pthread_kill(hal_cpu_pthreads[cpu], HAL_IPI_SIGNAL);
+}
+
+void hal_cpu_sleep(void)
+{
+	sigset_t mask;
+	pthread_sigmask(SIG_BLOCK, NULL, &mask);
+	sigdelset(&mask, HAL_TIMER_SIGNAL);
+	sigdelset(&mask, HAL_HRTIMER_SIGNAL);
+	sigdelset(&mask, HAL_EXTERN_SIGNAL);
+	sigdelset(&mask, HAL_IPI_SIGNAL);
+	sigsuspend(&mask);
+}
+
+static void *hal_cpu_thread(void *arg)
+{
+	hal_core_id = (int)(intptr_t)arg;
+	hal_cpu_pthreads[hal_core_id] = pthread_self();
+	hal_other_cpu_entry();
+	return NULL;
+}
+
+void hal_start_other_cpus(void (*entry)(void))
+{
+	sigset_t old;
+	pthread_t tid;
+	int cpu;
+
+	hal_other_cpu_entry = entry;
+	/* 新的pthread继承创建者的信号屏蔽字，先屏蔽模拟中断，让从核关着中断启动 */
+	pthread_sigmask(SIG_BLOCK, &hal_intr_sigset, &old);
+	for (cpu = 1; cpu < CFG_MAX_CPU; cpu++)
+	{
+		pthread_create(&tid, NULL, hal_cpu_thread, (void *)(intptr_t)cpu);
+		pthread_detach(tid);
+	}
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
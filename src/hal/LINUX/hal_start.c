@@ -0,0 +1,42 @@
+/**
+ * @file hal_start.c
+ * @brief hal层，Linux主机进程入口以及aCoral堆内存
+ * @version 1.0
+ * @date 2024-05-06
+ * @copyright Copyright (c) 2024
+ * @note 伙伴系统和资源池用unsigned int保存地址，所以整个程序必须以-no-pie链接，
+ *       保证堆（.bss中）和全局变量都在低4G地址空间内
+ */
+
+#include "autocfg.h"
+#include "core.h"
+
+#include <stdio.h>
+
+#define HAL_HEAP_SIZE 0x800000 ///<aCoral堆大小8MB，和K210的SRAM大小相当
+
+#define HAL_STR(x) #x
+#define HAL_XSTR(x) HAL_STR(x)
+
+/* 链接脚本在主机上不可用，用汇编在.bss中定义mem.c需要的堆起止符号 */
+__asm__(
+    "  .section .bss\n"
+    "  .balign 4096\n"
+    "  .globl _heap_start\n"
+    "_heap_start:\n"
+    "  .skip " HAL_XSTR(HAL_HEAP_SIZE) "\n"
+    "  .globl _heap_end\n"
+    "_heap_end:\n"
+    "  .globl _sdk_heap_start\n"
+    "_sdk_heap_start:\n"
+    "  .globl _sdk_heap_end\n"
+    "_sdk_heap_end:\n"
+    "  .previous\n"
+);
+
+int main(void)
+{
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    system_start();
+    return 0;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file hal_thread_c.c
+ * @brief hal层，Linux主机上基于ucontext的线程上下文初始化与切换
+ * @version 1.0
+ * @date 2024-05-06
+ * @copyright Copyright (c) 2024
+ */
+
+#include "./include/hal_thread.h"
+#include "./include/hal_int.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+#define ACORAL_ALIGN_DOWN(size, align)      ((size) & ~((align) - 1))
+
+/**
+ * @brief 所有线程的真正入口，makecontext只能传int参数，所以hal_ctx_t的地址被拆成高低两半传进来
+ */
+static void hal_thread_entry(unsigned int ctx_hi, unsigned int ctx_lo)
+{
+    hal_ctx_t *ctx = (hal_ctx_t *)(((uintptr_t)ctx_hi << 32) | (uintptr_t)ctx_lo);
+    hal_cpus_lock_status_restore(); /* 切换过来时内核大锁还被持有，新线程不在临界区中，替它释放 */
+    ctx->route(ctx->args);
+    ctx->exit();
+    abort(); /* exit不会返回，走到这里说明线程退出出错 */
+}
+
+/**
+ * @brief 线程上下文初始化，在栈顶放一个hal_ctx_t，其下方作为线程真正使用的栈
+ * 
+ * @param stack 栈顶指针
+ * @param route 线程运行函数指针
+ * @param exit 线程退出函数指针
+ * @param args 线程运行函数参数
+ * @return unsigned int* 上下文指针，保存在TCB的stack中
+ */
+unsigned int* hal_stack_init(unsigned int *stack, void *route, void *exit, void *args)
+{
+    hal_ctx_t *ctx;
+
+    ctx = (hal_ctx_t *)ACORAL_ALIGN_DOWN((uintptr_t)stack - sizeof(hal_ctx_t), 16);
+    ctx->route = (void (*)(void *))route;
+    ctx->exit = (void (*)(void))exit;
+    ctx->args = args;
+
+    getcontext(&ctx->uc);
+    /* makecontext只用ss_sp+ss_size作为初始sp，栈的真实下界由线程自己的stack_buttom决定 */
+    ctx->uc.uc_stack.ss_size = 4096;
+    ctx->uc.uc_stack.ss_sp = (char *)ctx - ctx->uc.uc_stack.ss_size;
+    ctx->uc.uc_link = NULL;
+
+    /* 新线程开中断运行，和K210上MPIE置1是一个意思 */
+    sigdelset(&ctx->uc.uc_sigmask, HAL_TIMER_SIGNAL);
+    sigdelset(&ctx->uc.uc_sigmask, HAL_EXTERN_SIGNAL);
+    sigdelset(&ctx->uc.uc_sigmask, HAL_IPI_SIGNAL);
+
+    makecontext(&ctx->uc, (void (*)(void))hal_thread_entry, 2,
+                (unsigned int)((uintptr_t)ctx >> 32), (unsigned int)(uintptr_t)ctx);
+
+    return (unsigned int *)ctx;
+}
+
+void HAL_CONTEXT_SWITCH(unsigned int **prev, unsigned int **next)
+{
+    swapcontext(&((hal_ctx_t *)*prev)->uc, &((hal_ctx_t *)*next)->uc);
+}
+
+void HAL_SWITCH_TO(unsigned int **next)
+{
+    setcontext(&((hal_ctx_t *)*next)->uc);
+}
@@ -0,0 +1,181 @@
+/**
+ * @file hal_timer.c
+ * @brief hal层，Linux主机上的ticks定时器
+ * @version 1.0
+ * @date 2024-05-06
+ * @copyright Copyright (c) 2024
+ */
+
+#include "./include/hal_timer.h"
+#include "./include/hal_int.h"
+#include "autocfg.h"
+
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+static void (*hal_ticks_entry)(void *args);
+static void *hal_ticks_args;
+static timer_t hal_ticks_timer;
+static long long hal_tick_ns;				///<一个tick周期的纳秒数
+static long long hal_tickless_boundary;	///<停ticks之后第一个tick边界的时间，纳秒
+
+static long long hal_timespec_ns(const struct timespec *ts)
+{
+	return (long long)ts->tv_sec * 1000000000ll + ts->tv_nsec;
+}
+
+static void hal_ns_timespec(long long ns, struct timespec *ts)
+{
+	ts->tv_sec = ns / 1000000000ll;
+	ts->tv_nsec = ns % 1000000000ll;
+}
+
+static long long hal_now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return hal_timespec_ns(&ts);
+}
+
+static void hal_timer_signal_handler(int signo)
+{
+	hal_intr_common_entry(hal_ticks_entry, hal_ticks_args);
+}
+
+int hal_timer_init(int ticks_per_sec, void (*ticks_entry)(void *args), void *args){
+	struct sigaction sa;
+	struct sigevent sev;
+	struct itimerspec its;
+
+	hal_ticks_entry = ticks_entry;
+	hal_ticks_args = args;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = hal_timer_signal_handler;
+	sa.sa_mask = hal_intr_sigset;
+	sa.sa_flags = SA_RESTART;
+	if (sigaction(HAL_TIMER_SIGNAL, &sa, NULL)) {
+		return -1;
+	}
+
+	/* 和K210一样只有0号核处理ticks，信号定向发给0号核的pthread，而不是进程里任意一个没屏蔽它的线程 */
+	memset(&sev, 0, sizeof(sev));
+	sev.sigev_notify = SIGEV_THREAD_ID;
+	sev.sigev_signo = HAL_TIMER_SIGNAL;
+	sev.sigev_notify_thread_id = hal_main_cpu_tid;
+	if (timer_create(CLOCK_MONOTONIC, &sev, &hal_ticks_timer)) {
+		return -1;
+	}
+
+	hal_tick_ns = 1000000000ll / ticks_per_sec;
+	hal_ns_timespec(hal_tick_ns, &its.it_interval);
+	its.it_value = its.it_interval;
+	if (timer_settime(hal_ticks_timer, 0, &its, NULL)) {
+		return -1;
+	}
+	return 0;
+}
+
+int hal_timer_tickless_enter(unsigned int ticks)
+{
+	struct itimerspec its;
+	sigset_t pending;
+
+	/* 已经到期的tick信号还挂着，这时候停ticks会把它和后面的边界算重 */
+	sigpending(&pending);
+	if (sigismember(&pending, HAL_TIMER_SIGNAL))
+		return -1;
+	/* 离下一个tick边界还有多久，单次定时从那个边界再往后数ticks-1个周期 */
+	timer_gettime(hal_ticks_timer, &its);
+	hal_tickless_boundary = hal_now_ns() + hal_timespec_ns(&its.it_value);
+	hal_ns_timespec(0, &its.it_interval);
+	hal_ns_timespec(hal_timespec_ns(&its.it_value) + (long long)(ticks - 1) * hal_tick_ns, &its.it_value);
+	timer_settime(hal_ticks_timer, 0, &its, NULL);
+	return 0;
+}
+
+unsigned int hal_timer_tickless_exit(void)
+{
+	struct itimerspec its;
+	long long now = hal_now_ns();
+	unsigned int passed = 0;
+
+	if (now >= hal_tickless_boundary)
+		passed = (now - hal_tickless_boundary) / hal_tick_ns + 1;
+	hal_ns_timespec(hal_tick_ns, &its.it_interval);
+	hal_ns_timespec(hal_tickless_boundary + (long long)passed * hal_tick_ns - now, &its.it_value);
+	timer_settime(hal_ticks_timer, 0, &its, NULL);
+	return passed;
+}
+
+static void (*hal_hrtimer_entry)(void *args);
+static void *hal_hrtimer_args;
+static timer_t hal_hrtimer_timer;
+
+static void hal_hrtimer_signal_handler(int signo)
+{
+	hal_intr_common_entry(hal_hrtimer_entry, hal_hrtimer_args);
+}
+
+int hal_hrtimer_init(void (*hrtimer_entry)(void *args), void *args)
+{
+	struct sigaction sa;
+	struct sigevent sev;
+
+	hal_hrtimer_entry = hrtimer_entry;
+	hal_hrtimer_args = args;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = hal_hrtimer_signal_handler;
+	sa.sa_mask = hal_intr_sigset;
+	sa.sa_flags = SA_RESTART;
+	if (sigaction(HAL_HRTIMER_SIGNAL, &sa, NULL)) {
+		return -1;
+	}
+
+	memset(&sev, 0, sizeof(sev));
+	sev.sigev_notify = SIGEV_THREAD_ID;
+	sev.sigev_signo = HAL_HRTIMER_SIGNAL;
+	sev.sigev_notify_thread_id = hal_main_cpu_tid;
+	if (timer_create(CLOCK_MONOTONIC, &sev, &hal_hrtimer_timer)) {
+		return -1;
+	}
+	return 0;
+}
+
+unsigned long long hal_hrtimer_now(void)
+{
+	return hal_now_ns();
+}
+
+void hal_hrtimer_set(unsigned long long deadline)
+{
+	struct itimerspec its;
+
+	/* 绝对时间，已经过了的马上到期；it_value全0是停掉，不会有0纳秒的到期时间 */
+	hal_ns_timespec(0, &its.it_interval);
+	hal_ns_timespec(deadline, &its.it_value);
+	timer_settime(hal_hrtimer_timer, TIMER_ABSTIME, &its, NULL);
+}
+
+void hal_hrtimer_cancel(void)
+{
+	struct itimerspec its;
+
+	memset(&its, 0, sizeof(its));
+	timer_settime(hal_hrtimer_timer, 0, &its, NULL);
+}
+
+#if !defined(__x86_64__) && !defined(__i386__)
+unsigned long long hal_get_cycles(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+#endif
@@ -0,0 +1,221 @@
+/**
+ * @file hal_int.h
+ * @brief hal层，Linux主机中断相关头文件
+ * @version 1.0
+ * @date 2024-05-06
+ * @copyright Copyright (c) 2024
+ * @note 用信号模拟中断：SIGALRM作为ticks定时器中断，SIGRTMIN作为高精度定时器中断，SIGUSR1作为外部中断（模拟的中断控制器见hal_int.c），
+ *       SIGUSR2作为核间中断，屏蔽信号即关中断。信号处理函数就是中断服务程序，运行在被中断线程的栈上。
+ *       每个核是一个pthread，0号核就是进程的主线程。
+ */
+#ifndef HAL_INT_H
+#define HAL_INT_H
+
+#include "autocfg.h"
+#include <signal.h>
+
+#define HAL_INTR_ENABLE()     hal_intr_enable()
+#define HAL_INTR_DISABLE()    hal_intr_disable()
+
+#define HAL_TIMER_SIGNAL SIGALRM ///<ticks定时器中断，只发给0号核
+#define HAL_HRTIMER_SIGNAL SIGRTMIN ///<高精度定时器中断，也只发给0号核
+#define HAL_EXTERN_SIGNAL SIGUSR1 ///<外部中断，所有向量共用，由hal_intr_raise触发
+#define HAL_IPI_SIGNAL SIGUSR2 ///<核间中断
+#define HAL_INTR_NUM 32 ///<模拟中断控制器的中断向量数
+
+/**
+ * @brief 当前核的编号，即当前pthread模拟的是哪个核
+ * @note aCoral线程会在pthread之间迁移，所以不能把核号缓存在线程的局部变量里，每次都要重新读
+ */
+int hal_get_core_id(void);
+#define HAL_GET_CORE_ID() hal_get_core_id()
+
+///每个核有自己的中断嵌套数
+extern int acoral_intr_nestings[CFG_MAX_CPU];
+#define acoral_intr_nesting (acoral_intr_nestings[HAL_GET_CORE_ID()])
+
+/**
+ * @brief 线程被切换走时所在核的临界区状态，随线程一起保存和恢复
+ */
+typedef struct {
+	int nest;           ///<临界区嵌套数
+	unsigned long pre;  ///<进入最外层临界区之前中断是否是打开的
+}hal_lock_status_t;
+
+/**
+ * @brief 所有模拟中断对应的信号集合，关中断就是屏蔽这个集合
+ */
+extern sigset_t hal_intr_sigset;
+
+void hal_intr_init();
+
+/**
+ * @brief 开启全局中断
+ * 
+ */
+void hal_intr_enable();
+
+/**
+ * @brief 关闭全局中断
+ * 
+ */
+void hal_intr_disable();
+
+/**
+ * @brief 使能模拟中断控制器中的某个中断
+ *
+ * @param vector 中断向量号
+ * @return int 0成功
+ */
+int hal_intr_unmask(int vector);
+
+/**
+ * @brief 除能模拟中断控制器中的某个中断
+ *
+ * @param vector 中断向量号
+ * @return int 0成功
+ */
+int hal_intr_mask(int vector);
+
+/**
+ * @brief 给某个中断向量绑定中断服务函数
+ *
+ * @param vector 中断向量号
+ * @param isr 中断服务函数
+ * @return int 0成功
+ */
+int hal_intr_attach(int vector, void (*isr)(int));
+
+/**
+ * @brief 解绑某个中断向量的中断服务函数
+ *
+ * @param vector 中断向量号
+ */
+void hal_intr_detach(int vector);
+
+/**
+ * @brief 触发一个外部中断，相当于外设拉高了中断线，可在线程或中断中调用
+ *
+ * @param vector 中断向量号
+ */
+void hal_intr_raise(int vector);
+
+/**
+ * @brief 所有模拟中断的公共入口：嵌套数加一，执行中断服务函数，嵌套数减一，最后走中断退出调度
+ *
+ * @param isr 中断服务函数
+ * @param args 中断服务函数参数
+ */
+void hal_intr_common_entry(void (*isr)(void *args), void *args);
+
+/**
+ * @brief 减少系统当前中断嵌套数
+ *
+ */
+void hal_intr_nesting_dec_comm();
+
+/**
+ * @brief 增加系统当前中断嵌套数
+ *
+ */
+void hal_intr_nesting_inc_comm();
+
+/**
+ * @brief 保证调度的原子性
+ *
+ */
+void hal_sched_bridge_comm();
+
+/**
+ * @brief 保证调度（中断引起）的原子性
+ * @note 主机上直接在信号处理函数里切换上下文，和线程里调度走的是同一条路径，所以返回值没有意义
+ */
+unsigned long hal_intr_exit_bridge_comm(unsigned long old_sp);
+
+/**
+ * @brief 进入临界区：屏蔽本核的模拟中断，最外层还要获取内核大锁，挡住其它核
+ *
+ */
+void hal_enter_critical();
+
+/**
+ * @brief 退出临界区：退出最外层时释放内核大锁，恢复进入之前的中断状态
+ *
+ */
+void hal_exit_critical();
+
+/**
+ * @brief 线程切换时交换临界区状态：当前核的状态存入prev，next的状态装入当前核
+ *
+ * @param prev 被切走的线程的临界区状态
+ * @param next 将要运行的线程的临界区状态
+ */
+void hal_lock_status_switch(hal_lock_status_t *prev, hal_lock_status_t *next);
+
+/**
+ * @brief 新线程第一次运行时调用，新线程不在临界区中，替它释放内核大锁
+ *
+ */
+void hal_cpus_lock_status_restore();
+
+/**
+ * @brief 初始化本核的核间中断，每个核启动时都要调用
+ *
+ * @param ipi_entry 核间中断服务函数
+ * @param args 核间中断服务函数参数
+ * @return int 0成功
+ */
+int hal_ipi_init(void (*ipi_entry)(void *args), void *args);
+
+/**
+ * @brief 给某个核发核间中断，让它重新调度
+ *
+ * @param cpu 目标核
+ */
+void hal_ipi_send(int cpu);
+
+/**
+ * @brief 为0号以外的每个核创建一个pthread，它们从entry开始执行，entry不返回
+ *
+ * @param entry 从核入口
+ */
+void hal_start_other_cpus(void (*entry)(void));
+
+/**
+ * @brief 本核休眠，直到来了一个中断（ticks、核间中断或外部中断）并处理完，相当于WFI。用sigsuspend原子地等待，不会丢信号
+ *
+ */
+void hal_cpu_sleep(void);
+
+/**
+ * @brief 0号核（主线程）在主机上的线程号，ticks定时器的信号只发给它
+ */
+extern int hal_main_cpu_tid;
+
+/****************************                                                                                                                 
+* the comm interrupt interface of hal     
+*  hal层中断部分通用接口
+*****************************/
+
+#define HAL_INTR_NESTING_DEC()    hal_intr_nesting_dec_comm()
+#define HAL_INTR_NESTING_INC()    hal_intr_nesting_inc_comm()
+
+#define HAL_INTR_ATTACH(vector,isr) hal_intr_attach(vector,isr)
+#define HAL_INTR_DETACH(vector) hal_intr_detach(vector)
+#define HAL_INTR_UNMASK(vector) hal_intr_unmask(vector)
+#define HAL_INTR_MASK(vector) hal_intr_mask(vector)
+#define HAL_INTR_RAISE(vector) hal_intr_raise(vector) ///<软件触发外部中断，没有这个宏的平台不能用软件模拟外设中断
+#define HAL_SCHED_BRIDGE() hal_sched_bridge_comm()
+#define HAL_INTR_EXIT_BRIDGE(sp) hal_intr_exit_bridge_comm(sp)
+
+#define HAL_ENTER_CRITICAL() hal_enter_critical()
+#define HAL_EXIT_CRITICAL() hal_exit_critical()
+
+#define HAL_LOCK_STATUS_INIT(status) ((status)->nest = 0, (status)->pre = 0)
+#define HAL_LOCK_STATUS_SWITCH(prev,next) hal_lock_status_switch(prev,next)
+#define HAL_IPI_INIT(ipi_entry,args) hal_ipi_init(ipi_entry,args)
+#define HAL_IPI_SEND(cpu) hal_ipi_send(cpu)
+#define HAL_START_OTHER_CPUS(entry) hal_start_other_cpus(entry)
+#define HAL_CPU_SLEEP() hal_cpu_sleep()
+
+#endif
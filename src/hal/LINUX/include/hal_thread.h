@@ -0,0 +1,33 @@
+/**
+ * @file hal_thread.h
+ * @brief hal层，Linux主机线程相关头文件
+ * @version 1.0
+ * @date 2024-05-06
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef HAL_THREAD_H
+#define HAL_THREAD_H
+
+#include <ucontext.h>
+
+/**
+ * @brief aCoral线程上下文context在主机上的描述
+ * @note hal_ctx_t放在线程栈的最高处，线程真正使用的栈在它下面。
+ *       线程控制块中的stack指针始终指向这个结构体，切换时由swapcontext保存和恢复uc
+ */
+typedef struct {
+    ucontext_t uc;                  ///<寄存器、信号屏蔽字（即中断开关状态）
+    void (*route)(void *args);      ///<线程函数
+    void (*exit)(void);             ///<线程函数返回后调用的退出函数
+    void *args;                     ///<线程函数参数
+}hal_ctx_t;
+
+void HAL_SWITCH_TO(unsigned int** next);
+void HAL_CONTEXT_SWITCH(unsigned int **prev , unsigned int **next);
+unsigned int* hal_stack_init(unsigned int *stack, void *route, void *exit, void *args);
+
+//线程相关的硬件抽象接口 //TODO 全大写为了和汇编接口统一
+#define HAL_STACK_INIT(stack,route,exit,args) hal_stack_init(stack, route,exit, args)
+
+#endif
@@ -0,0 +1,84 @@
+/**
+ * @file hal_timer.h
+ * @brief hal层，Linux主机定时器相关头文件
+ * @version 1.0
+ * @date 2024-05-06
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef HAL_TIMER_H
+#define HAL_TIMER_H
+
+/**
+ * @brief 读取周期计数器，用于性能测量。x86上是TSC，其他架构用CLOCK_MONOTONIC的纳秒数代替
+ */
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAL_GET_CYCLES() ((unsigned long long)__rdtsc())
+#else
+unsigned long long hal_get_cycles(void);
+#define HAL_GET_CYCLES() hal_get_cycles()
+#endif
+
+/**
+ * @brief 配置ticks定时器的频率（POSIX定时器，到期给0号核发送SIGALRM），并为其注册中断服务函数acoral_ticks_entry
+ * 
+ * @param ticks_per_sec 每秒的ticks中断数
+ * @return result
+ *     - 0      Success
+ *     - Other  Fail 
+ */
+int hal_timer_init(int ticks_per_sec, void (*ticks_entry)(void *args), void* args);
+
+/**
+ * @brief 停掉周期性的ticks，改成ticks个tick周期之后只来一次的单次定时，到期时间和原来的tick边界对齐
+ * @note 在临界区中调用
+ *
+ * @param ticks 多少个tick周期之后中断，至少为1
+ * @return int 0成功；-1已经有一个tick到期还没处理，不能停ticks
+ */
+int hal_timer_tickless_enter(unsigned int ticks);
+
+/**
+ * @brief 恢复周期性的ticks，下一次中断落在原来的tick边界上
+ * @note 在临界区中调用
+ *
+ * @return unsigned int 从hal_timer_tickless_enter到现在经过了多少个tick边界
+ */
+unsigned int hal_timer_tickless_exit(void);
+
+#define HAL_TICKLESS_ENTER(ticks) hal_timer_tickless_enter(ticks)
+#define HAL_TICKLESS_EXIT() hal_timer_tickless_exit()
+
+/**
+ * @brief 配置高精度定时器：另一个单次的POSIX定时器，到期给0号核发送HAL_HRTIMER_SIGNAL
+ *
+ * @param hrtimer_entry 到期时调用的中断服务函数
+ * @return int 0成功
+ */
+int hal_hrtimer_init(void (*hrtimer_entry)(void *args), void *args);
+
+/**
+ * @brief 得到高精度定时器的时间，CLOCK_MONOTONIC的纳秒数
+ */
+unsigned long long hal_hrtimer_now(void);
+
+/**
+ * @brief 把高精度定时器设到deadline，已经过了的马上到期，之前设的作废
+ * @note 在临界区中调用
+ *
+ * @param deadline 到期时间，hal_hrtimer_now的纳秒数
+ */
+void hal_hrtimer_set(unsigned long long deadline);
+
+/**
+ * @brief 停掉高精度定时器
+ * @note 在临界区中调用
+ */
+void hal_hrtimer_cancel(void);
+
+#define HAL_HRTIMER_NOW() hal_hrtimer_now()
+#define HAL_HRTIMER_SET(deadline) hal_hrtimer_set(deadline)
+#define HAL_HRTIMER_CANCEL() hal_hrtimer_cancel()
+
+#endif
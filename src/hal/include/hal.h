@@ -28,6 +28,16 @@
 #define hal_sp_align 16 
 
 #elif CFG_SOC == SOC_S3C2440 
+
+/* Linux主机，用ucontext和信号模拟线程切换和中断 */
+#elif CFG_SOC == SOC_LINUX
+#include "../LINUX/include/hal_int.h"
+#include "../LINUX/include/hal_thread.h"
+#include "../LINUX/include/hal_timer.h"
+
+///x86-64和aarch64的ABI都要求sp16字节对齐
+#define hal_sp_align 16 
+
 #endif
 
 
@@ -0,0 +1,157 @@
+/**
+ * @file apptimer.c
+ * @brief kernel层，应用定时器：挂在系统时间轮上，到期后把回调交给服务线程去调，或者直接在ticks中断里调
+ * @version 1.0
+ * @date 2024-07-01
+ * @copyright Copyright (c) 2024
+ * @note 服务线程和工作队列的工作线程一样，没活干就在临界区里挂起自己，到期处理在临界区里把它就绪，不会丢唤醒
+ */
+
+#include "apptimer.h"
+#include "thread.h"
+#include "int.h"
+#include "soft_timer.h"
+#include "resource.h"
+#include "log.h"
+
+#if CFG_APPTIMER
+
+static acoral_list_t apptimer_queue;		///<到期了、等服务线程调回调的定时器，先进先出
+static acoral_thread_t *apptimer_thread;	///<服务线程
+static unsigned char apptimer_idle;		///<服务线程挂起等活，只在临界区里访问
+
+/* 在ticks中断里、临界区中调用。周期定时器先重新启动，下一次到期时间按这次到期的tick算，不受回调影响 */
+static void apptimer_expire(acoral_timer_t *timer)
+{
+	timer->fired = timer->expires;
+	if (timer->flags & ACORAL_APPTIMER_PERIODIC)
+		acoral_timer_start(timer, timer->period, apptimer_expire);
+	if (timer->flags & ACORAL_APPTIMER_IN_TICK)
+	{
+		timer->fn(timer->arg);
+		return;
+	}
+	/* 上一次的回调还没调到，这次就并进去，不重复排队 */
+	if (!acoral_list_empty(&timer->service_hook))
+		return;
+	acoral_list_add2_tail(&timer->service_hook, &apptimer_queue);
+	if (apptimer_idle)
+	{
+		apptimer_idle = 0;
+		ready_thread(apptimer_thread);
+	}
+}
+
+static void apptimer_service(void *args)
+{
+	acoral_timer_t *timer;
+	void (*fn)(void *arg);
+	void *arg;
+
+	while (1)
+	{
+		acoral_enter_critical();
+		while (!acoral_list_empty(&apptimer_queue))
+		{
+			timer = list_entry(apptimer_queue.next, acoral_timer_t, service_hook);
+			acoral_list_del(&timer->service_hook);
+			/* 回调里可能把这个定时器删掉，先把要用的取出来 */
+			fn = timer->fn;
+			arg = timer->arg;
+			acoral_exit_critical();
+
+			fn(arg);
+
+			acoral_enter_critical();
+		}
+		apptimer_idle = 1;
+		acoral_suspend_self();
+		acoral_exit_critical();
+	}
+}
+
+acoral_timer_t *acoral_apptimer_create(void (*fn)(void *arg), void *arg, unsigned int period_mm, unsigned char flags)
+{
+	acoral_timer_t *timer;
+
+	if (fn == NULL)
+		return NULL;
+	acoral_enter_critical();
+	timer = (acoral_timer_t *)acoral_get_res(ACORAL_RES_TIMER);
+	acoral_exit_critical();
+	if (timer == NULL)
+		return NULL;
+	acoral_init_list(&timer->delay_queue_hook);
+	acoral_init_list(&timer->service_hook);
+	timer->fn = fn;
+	timer->arg = arg;
+	timer->period = time_to_ticks(period_mm);
+	timer->flags = flags;
+	return timer;
+}
+
+int acoral_apptimer_del(acoral_timer_t *timer)
+{
+	if (timer == NULL)
+		return -1;
+	acoral_enter_critical();
+	acoral_timer_stop(timer);
+	acoral_list_del(&timer->service_hook);
+	acoral_release_res((acoral_res_t *)timer);
+	acoral_exit_critical();
+	return 0;
+}
+
+int acoral_apptimer_start(acoral_timer_t *timer)
+{
+	if (timer == NULL)
+		return -1;
+	acoral_enter_critical();
+	acoral_timer_start(timer, timer->period, apptimer_expire);
+	acoral_exit_critical();
+	return 0;
+}
+
+int acoral_apptimer_stop(acoral_timer_t *timer)
+{
+	if (timer == NULL)
+		return -1;
+	acoral_enter_critical();
+	acoral_timer_stop(timer);
+	acoral_list_del(&timer->service_hook);
+	acoral_exit_critical();
+	return 0;
+}
+
+int acoral_apptimer_set_period(acoral_timer_t *timer, unsigned int period_mm)
+{
+	if (timer == NULL)
+		return -1;
+	acoral_enter_critical();
+	timer->period = time_to_ticks(period_mm);
+	if (acoral_timer_pending(timer))
+		acoral_timer_start(timer, timer->period, apptimer_expire);
+	acoral_exit_critical();
+	return 0;
+}
+
+unsigned int acoral_apptimer_fired(acoral_timer_t *timer)
+{
+	return timer->fired;
+}
+
+void system_apptimer_init(void)
+{
+	int id;
+
+	acoral_init_list(&apptimer_queue);
+	id = acoral_create_thread("apptimer", apptimer_service, NULL, APPTIMER_STACK_SIZE, ACORAL_SCHED_POLICY_COMM, CFG_APPTIMER_PRIO, ACORAL_HARD_PRIO, NULL);
+	if (id == -1)
+	{
+		ACORAL_LOG_ERROR("Create Apptimer Thread Failed");
+		return;
+	}
+	apptimer_thread = (acoral_thread_t *)acoral_get_res_by_id(id);
+}
+
+#endif
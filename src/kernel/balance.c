@@ -0,0 +1,130 @@
+/**
+ * @file balance.c
+ * @brief kernel层，多核负载均衡：新线程选核、空闲核偷线程
+ * @version 1.0
+ * @date 2024-05-20
+ * @copyright Copyright (c) 2024
+ * @note 每个核的负载就是它就绪队列上的线程数（包括idle线程和正在运行的线程）。
+ *       只有亲和性为ACORAL_CPU_ANY、并且不是某个核当前线程的就绪线程才可以被迁移
+ */
+
+#include "balance.h"
+#include "thread.h"
+#include "bitops.h"
+#include "edf_thrd.h"
+#include "hal.h"
+
+acoral_balance_stat_t acoral_balance_stats[CFG_MAX_CPU];
+
+unsigned char acoral_balance_enabled = true;
+
+static acoral_rdy_queue_t *cpu_ready_queue(int cpu)
+{
+	return &(((thread_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_THREAD].type_private_data))->global_ready_queue[cpu]);
+}
+
+int acoral_balance_select_cpu(void)
+{
+	int cpu, best;
+	unsigned int num;
+
+	best = acoral_current_cpu();
+	if (!acoral_balance_enabled)
+		return best;
+	num = cpu_ready_queue(best)->num;
+	for (cpu = 0; cpu < CFG_MAX_CPU; cpu++)
+	{
+		if (cpu_ready_queue(cpu)->num < num)
+		{
+			best = cpu;
+			num = cpu_ready_queue(cpu)->num;
+		}
+	}
+	return best;
+}
+
+/**
+ * @brief 在某个核的就绪队列里找第一个可迁移的线程，优先级从高到低，同优先级从队头到队尾
+ *
+ * @param cpu 核号
+ * @return acoral_thread_t* 找不到返回NULL
+ */
+static acoral_thread_t *find_migratable(int cpu)
+{
+	acoral_rdy_queue_t *queue = cpu_ready_queue(cpu);
+	acoral_list_t *head, *tmp;
+	acoral_thread_t *thread;
+	unsigned int summary, bits, word, prio;
+
+	for (summary = queue->summary; summary; summary &= summary - 1)
+	{
+		word = acoral_ffs(summary);
+		for (bits = queue->bitmap[word]; bits; bits &= bits - 1)
+		{
+			prio = (word << 5) + acoral_ffs(bits);
+			head = &queue->queue[prio];
+			for (tmp = head->next; tmp != head; tmp = tmp->next)
+			{
+				thread = list_entry(tmp, acoral_thread_t, ready_hook);
+				if (thread->affinity == ACORAL_CPU_ANY && acoral_cur_threads[cpu] != thread)
+					return thread;
+			}
+		}
+	}
+	return NULL;
+}
+
+int acoral_balance_steal(int cpu)
+{
+	int c, busiest = -1;
+	unsigned int num = 2; /* idle线程和正在运行的线程之外，至少还要有一个在等 */
+	acoral_thread_t *thread;
+
+	if (!acoral_balance_enabled)
+		return 0;
+	for (c = 0; c < CFG_MAX_CPU; c++)
+	{
+		if (c != cpu && cpu_ready_queue(c)->num > num)
+		{
+			busiest = c;
+			num = cpu_ready_queue(c)->num;
+		}
+	}
+	if (busiest < 0)
+		return 0;
+
+	thread = find_migratable(busiest);
+	if (thread == NULL)
+		return 0;
+
+	/* 线程状态不变，只是换一个就绪队列 */
+	acoral_prio_queue_del(cpu_ready_queue(busiest), thread->prio, &thread->ready_hook);
+	thread->cpu = cpu;
+#if CFG_THRD_EDF
+	if (thread->policy == ACORAL_SCHED_POLICY_EDF)
+		edf_prio_queue_add(cpu_ready_queue(cpu), thread);
+	else
+#endif
+	acoral_prio_queue_add(cpu_ready_queue(cpu), thread->prio, &thread->ready_hook);
+	acoral_balance_stats[cpu].steals++;
+	acoral_balance_stats[cpu].migrations++;
+	return 1;
+}
+
+void acoral_balance_kick(acoral_thread_t *thread)
+{
+	int cpu;
+
+	if (!acoral_balance_enabled || thread->affinity != ACORAL_CPU_ANY)
+		return;
+	for (cpu = 0; cpu < CFG_MAX_CPU; cpu++)
+	{
+		/* 只有idle线程在跑、就绪队列上也只有idle线程的核才是空闲的 */
+		if (cpu != thread->cpu && acoral_cur_threads[cpu] != NULL
+			&& acoral_cur_threads[cpu]->prio == ACORAL_IDLE_PRIO && cpu_ready_queue(cpu)->num == 1)
+		{
+			acoral_cpu_need_sched(cpu);
+			return;
+		}
+	}
+}
@@ -11,33 +11,14 @@
 
 unsigned int acoral_find_first_bit_in_integer(unsigned int word, int bit)
 {
-    if(bit)
+    if(!bit)
     {
-        if (word == 0) {
-            return -1;  // 特殊情况：所有位都是0
-        }
-        unsigned int k = 31;
-	    if (word & 0x0000ffff) { k -= 16; word <<= 16; }
-	    if (word & 0x00ff0000) { k -= 8;  word <<= 8;  }
-	    if (word & 0x0f000000) { k -= 4;  word <<= 4;  }
-	    if (word & 0x30000000) { k -= 2;  word <<= 2;  }
-	    if (word & 0x40000000) { k -= 1; }
-        return k;
+        word = ~word; //找最低的0就是找取反后最低的1
     }
-    else
-    {
-        if (word == 0xFFFFFFFF) {
-            return -1;  // 特殊情况：所有位都是1
-        }
-        unsigned int k = 31;
-	    if ((word & 0x0000ffff) != 0xffff) { k -= 16; word <<= 16; }
-	    if ((word & 0x00ff0000) != 0xff0000) { k -= 8;  word <<= 8;  }
-	    if ((word & 0x0f000000) != 0xf000000) { k -= 4;  word <<= 4;  }
-	    if ((word & 0x30000000) != 0x30000000) { k -= 2;  word <<= 2;  }
-	    if ((word & 0x40000000) != 0x40000000) { k -= 1; }
-        return k;
+    if (word == 0) {
+        return -1;  // 特殊情况：没有要找的位
     }
-	
+    return acoral_ffs(word);
 }
 
 unsigned int acoral_find_first_bit_in_array(const unsigned int *b,unsigned int length, int bit)
@@ -11,9 +11,21 @@
 #include "policy.h"
 #include "int.h"
 #include "log.h"
+#include "mem.h"
+#include "soft_timer.h"
 
 #include "hal.h"
 
+#if CFG_THRD_SLICE
+/**
+ * @brief 用时间片的普通线程在内核中的策略数据，不用时间片的线程policy_data为NULL
+ *
+ */
+typedef struct{
+	unsigned int slice_ticks;	///<时间片长度，ticks
+	unsigned int slice_left;	///<当前时间片还剩多少ticks
+}comm_policy_data_t;
+#endif
 
 static void comm_thread_exit(){
     acoral_kill_thread(acoral_cur_thread);
@@ -21,19 +33,42 @@ static void comm_thread_exit(){
 
 /**
  * @brief 初始化普通线程的一些数据
- * 
+ *
  * @param thread TCB指针
- * @param data 线程私有数据，普通线程为NULL
+ * @param data 线程私有数据，acoral_comm_policy_data_t，不用时间片可以为NULL
  * @return int 线程id
  */
 static int comm_policy_thread_init(acoral_thread_t *thread, void *data)
 {
+#if CFG_THRD_SLICE
+	acoral_comm_policy_data_t *user_data = (acoral_comm_policy_data_t *)data;
+	comm_policy_data_t *policy_data;
+
+	thread->policy_data = NULL;
+	if (user_data != NULL && user_data->slice_time_mm != 0)
+	{
+		policy_data = (comm_policy_data_t *)acoral_malloc(sizeof(comm_policy_data_t));
+		if (policy_data == NULL)
+		{
+			ACORAL_LOG_ERROR("No mem space for policy_data:%s", thread->name);
+			thread_create_fail(thread);
+			return -1;
+		}
+		policy_data->slice_ticks = time_to_ticks(user_data->slice_time_mm);
+		if (policy_data->slice_ticks == 0)
+			policy_data->slice_ticks = 1;
+		policy_data->slice_left = policy_data->slice_ticks;
+		thread->policy_data = policy_data;
+	}
+#endif
 	if (thread_stack_init(thread, comm_thread_exit) != 0)
 	{
 		ACORAL_LOG_ERROR("No thread stack:%s", thread->name);
-		acoral_enter_critical();
-		acoral_release_res((acoral_res_t *)thread);
-		acoral_exit_critical();
+#if CFG_THRD_SLICE
+		if (thread->policy_data != NULL)
+			acoral_free(thread->policy_data);
+#endif
+		thread_create_fail(thread);
 		return -1;
 	}
 	/*将线程就绪，并重新调度*/
@@ -41,13 +76,68 @@ static int comm_policy_thread_init(acoral_thread_t *thread, void *data)
 	return thread->res.id;
 }
 
+#if CFG_THRD_SLICE
+/**
+ * @brief 释放普通线程的时间片数据
+ *
+ * @param thread TCB指针
+ */
+static void comm_policy_thread_release(acoral_thread_t *thread)
+{
+	if (thread->policy_data != NULL)
+		acoral_free(thread->policy_data);
+}
+
+void comm_delay_deal()
+{
+	acoral_rdy_queue_t *rdy_queue;
+	acoral_thread_t *thread;
+	comm_policy_data_t *policy_data;
+	acoral_list_t *head;
+	int cpu;
+
+	for (cpu = 0; cpu < CFG_MAX_CPU; cpu++)
+	{
+		thread = acoral_cur_threads[cpu];
+		if (thread == NULL || thread->policy != ACORAL_SCHED_POLICY_COMM || thread->policy_data == NULL
+			|| !(thread->state & ACORAL_THREAD_STATE_READY))
+			continue;
+		policy_data = (comm_policy_data_t *)thread->policy_data;
+		if (--policy_data->slice_left > 0)
+			continue;
+		policy_data->slice_left = policy_data->slice_ticks;
+
+		/* 同优先级只有它自己就接着跑，否则挪到队尾，让那个核重新调度 */
+		rdy_queue = &(((thread_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_THREAD].type_private_data))->global_ready_queue[cpu]);
+		head = rdy_queue->queue + thread->prio;
+		if (head->next == &thread->ready_hook && head->prev == &thread->ready_hook)
+			continue;
+		acoral_list_del(&thread->ready_hook);
+		acoral_list_add2_tail(&thread->ready_hook, head);
+		acoral_cpu_need_sched(cpu);
+	}
+}
+
+/* 时间片只对正在运行的线程计时，所有核都空闲的时候没有要到期的时间片 */
+static unsigned int comm_next_expiry()
+{
+	return ACORAL_POLICY_NO_EXPIRY;
+}
+#endif
 
 void comm_policy_init()
 {
     acoral_sched_policy_t* comm_policy = (acoral_sched_policy_t*)acoral_get_res(ACORAL_RES_POLICY);
 	comm_policy->type = ACORAL_SCHED_POLICY_COMM;
 	comm_policy->policy_thread_init = comm_policy_thread_init;
+#if CFG_THRD_SLICE
+	comm_policy->policy_thread_release = comm_policy_thread_release;
+	comm_policy->delay_deal = comm_delay_deal;
+	comm_policy->next_expiry = comm_next_expiry;
+#else
 	comm_policy->policy_thread_release = NULL;
 	comm_policy->delay_deal = NULL;
+	comm_policy->next_expiry = NULL;
+#endif
 	acoral_register_sched_policy(comm_policy);
 }
@@ -12,6 +12,7 @@
 
 #include <stdlib.h>
 int daemon_id, idle_id, init_id;
+int idle_ids[CFG_MAX_CPU]; ///<每个核一个idle线程，idle_id就是0号核的
 
 char* logo = "\n\
               \n\
@@ -35,7 +36,11 @@ extern void user_main();
  */
 static void idle()
 {
-	for(;;){}
+	for(;;){
+#if CFG_TICKLESS
+		acoral_tickless_idle();
+#endif
+	}
 }
 
 /**
@@ -47,20 +52,15 @@ static void init()
 	acoral_intr_disable();
 	ACORAL_LOG_TRACE("Init Thread Start");
 
-    /* 初始化全局延时队列 */
-	acoral_init_list(&(((timer_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_TIMER].type_private_data))->global_time_delay_queue));
-    
-    /* 初始化全局超时队列 */
-	acoral_init_list(&(((timer_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_TIMER].type_private_data))->global_timeout_queue));
-    
-    /* 初始化daem线程回收的线程队列 */
-	acoral_init_list(&(((thread_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_THREAD].type_private_data))->global_daem_release_queue));
-
 	if(system_ticks_init()!=0){
 		ACORAL_LOG_ERROR("Ticks Init Failed");
 		exit(1);
 	}
 	ACORAL_LOG_TRACE("Ticks Init Done");
+#if CFG_TRACE
+	/* 有了ticks才能估算每微秒的周期数 */
+	acoral_trace_clear();
+#endif
 
 	/* 开中断，此时系统才真正能调度 */
 	acoral_intr_enable();
@@ -80,55 +80,108 @@ static void init()
 static void daem()
 {
 	acoral_thread_t *thread;
-	acoral_list_t *head, *tmp, *tmp1;
+	acoral_list_t *head, *tmp;
     acoral_list_t* daem_res_release_queue = &(((thread_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_THREAD].type_private_data))->global_daem_release_queue); ///< 将被daem线程回收的线程队列
 
 	head = daem_res_release_queue;
 	while (1)
 	{
-		for (tmp = head->next; tmp != head;)
+		/* 多核下别的核随时可能往回收队列上挂线程，队列只在临界区里访问 */
+		acoral_enter_critical();
+		while (!acoral_list_empty(head))
 		{
-			tmp1 = tmp->next;
-			acoral_enter_critical();
+			tmp = head->next;
 			thread = list_entry(tmp, acoral_thread_t, daem_hook);
-
-			/* 如果线程资源已经不再使用，即release状态，则释放 */
 			acoral_list_del(tmp);
-			acoral_exit_critical();
-			tmp = tmp1;
-			if (thread->state == ACORAL_THREAD_STATE_RELEASE)
-			{
-				ACORAL_LOG_INFO("Daem is Cleaning Thread: %s",thread->name);
-				system_policy_thread_release(thread);
-  				acoral_free((void *)thread->stack_buttom);
-				acoral_release_res((acoral_res_t *)thread);
-			}
-			else
+
+			/* 线程所在的核切走它之后才会放开内核大锁，所以在临界区里看到release状态，说明TCB和堆栈已经不再使用，可以释放 */
+			if (thread->state != ACORAL_THREAD_STATE_RELEASE)
 			{
-				acoral_enter_critical();
-				tmp1 = head->prev;
-				acoral_list_add2_tail(&thread->daem_hook, head); /**/
+				/* 还没切走，挂回队尾，放开内核大锁让它所在的核完成切换 */
+				acoral_list_add2_tail(tmp, head);
 				acoral_exit_critical();
+				acoral_enter_critical();
+				continue;
 			}
+			/* 资源池本身不加锁，释放也在临界区里做 */
+			ACORAL_LOG_INFO("Daem is Cleaning Thread: %s",thread->name);
+			system_policy_thread_release(thread);
+#if CFG_STACK_LEARN
+			acoral_stack_learn(thread);
+#endif
+			acoral_free((void *)thread->stack_buttom);
+			acoral_release_res((acoral_res_t *)thread->thread_timer);
+			acoral_release_res((acoral_res_t *)thread);
 		}
+		/* 队列空了再挂起，挂起也在临界区里，免得放开内核大锁之后、挂起之前别的线程挂上来唤醒了一个还在运行的daem，唤醒丢失 */
 		acoral_suspend_self();
+		acoral_exit_critical();
 	}
 }
 
 /**
- * @brief 主CPU创建idle、init、daem线程
+ * @brief 本核第一次切换线程，从启动代码切到本核就绪队列里优先级最高的线程，不再返回
+ * 
+ */
+static void cpu_switch_to_first_thread()
+{
+	hal_lock_status_t boot_status;
+#if CFG_FPU
+	hal_fpu_ctx_t boot_fpu;
+#endif
+
+	/* 持有内核大锁切换，新线程负责释放 */
+	acoral_enter_critical();
+	system_need_sched = false;
+	system_set_running_thread(acoral_select_thread());
+	HAL_LOCK_STATUS_SWITCH(&boot_status, &acoral_cur_thread->lock_status);
+#if CFG_FPU
+	HAL_FPU_INIT(&boot_fpu);
+	HAL_FPU_SWITCH(&boot_fpu, &acoral_cur_thread->fpu_ctx);
+#endif
+	HAL_SWITCH_TO(&acoral_cur_thread->stack);
+}
+
+#if CFG_SMP
+/**
+ * @brief 从CPU启动，直接切换到本核就绪队列里的线程（至少有本核的idle线程）
+ * 
+ */
+static void follow_cpu_start()
+{
+	acoral_intr_disable();
+	ACORAL_LOG_TRACE("CPU%d Start",acoral_current_cpu());
+	HAL_IPI_INIT(acoral_ipi_entry, NULL);
+	cpu_switch_to_first_thread();
+}
+#endif
+
+/**
+ * @brief 主CPU创建idle、init、daem线程，启动其它CPU
  * 
  */
 static void main_cpu_start()
 {
+	int cpu;
 
-	/* 创建idle线程 */
-	idle_id = acoral_create_thread("idle",idle, NULL, IDLE_STACK_SIZE, ACORAL_SCHED_POLICY_COMM, ACORAL_IDLE_PRIO,ACORAL_HARD_PRIO,NULL);
-	if (idle_id == -1) //SPG 不一定是-1才有问题吧
+	/* 多核下daem等线程可能先于init线程在别的核上运行，这些全局队列要在创建线程之前初始化 */
+    /* 初始化时间轮，延时、超时、周期都挂在上面 */
+	acoral_time_init();
+    
+    /* 初始化daem线程回收的线程队列 */
+	acoral_init_list(&(((thread_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_THREAD].type_private_data))->global_daem_release_queue));
+
+	/* 每个核创建一个idle线程，绑定在这个核上 */
+	for (cpu = 0; cpu < CFG_MAX_CPU; cpu++)
 	{
-		ACORAL_LOG_ERROR("Create Idle Thread Failed");
-		exit(2);//SPG 新建一个lib文件夹，用宏定义来封装不同的SDK
+		idle_ids[cpu] = acoral_create_thread_affinity("idle",idle, NULL, IDLE_STACK_SIZE, ACORAL_SCHED_POLICY_COMM, ACORAL_IDLE_PRIO,ACORAL_HARD_PRIO,NULL,cpu);
+		if (idle_ids[cpu] == -1) //SPG 不一定是-1才有问题吧
+		{
+			ACORAL_LOG_ERROR("Create Idle Thread Failed");
+			exit(2);//SPG 新建一个lib文件夹，用宏定义来封装不同的SDK
+		}
 	}
+	idle_id = idle_ids[0];
 
 	/* 创建init线程 */
 	init_id = acoral_create_thread("init",init, "in init", INIT_STACK_SIZE, ACORAL_SCHED_POLICY_COMM, ACORAL_INIT_PRIO,ACORAL_HARD_PRIO,NULL);
@@ -144,12 +197,20 @@ static void main_cpu_start()
 		ACORAL_LOG_ERROR("Create Daem Thread Failed");
 		exit(2);
 	}	
+#if CFG_WORKQ
+	system_workq_init();
+#endif
+#if CFG_APPTIMER
+	system_apptimer_init();
+#endif
 	printf("%s",logo);
 
 	system_sched_locked = false;
-	system_need_sched = false; 
-	system_set_running_thread(acoral_select_thread());
-	HAL_SWITCH_TO(&acoral_cur_thread->stack);
+#if CFG_SMP
+	HAL_IPI_INIT(acoral_ipi_entry, NULL);
+	HAL_START_OTHER_CPUS(follow_cpu_start);
+#endif
+	cpu_switch_to_first_thread();
 }
 
 void system_start()
@@ -0,0 +1,205 @@
+/**
+ * @file edf_thrd.c
+ * @brief kernel层，最早截止期优先（EDF）调度策略
+ * @version 1.0
+ * @date 2024-05-27
+ * @copyright Copyright (c) 2024
+ * @note EDF线程和周期线程一样按周期释放作业，区别在于就绪队列里的顺序：EDF线程仍然属于创建时给定的优先级，
+ *       不同优先级之间照旧按优先级抢占，同一优先级内按作业的绝对截止期排序，截止期早的先运行、并且可以抢占截止期晚的。
+ *       所以只要把EDF线程都放在一个专门的优先级上，就能和硬实时、普通线程共存
+ */
+
+#include "thread.h"
+#include "hal.h"
+#include "policy.h"
+#include "mem.h"
+#include "soft_timer.h"
+#include "edf_thrd.h"
+#include "period_thrd.h"
+#include "int.h"
+
+#include <stdio.h>
+
+#if CFG_THRD_EDF
+
+/**
+ * @brief EDF线程在内核中的策略数据
+ *
+ */
+typedef struct{
+	unsigned int period_ticks;		///<周期，ticks
+	unsigned int deadline_ticks;	///<相对截止期，ticks
+	unsigned int abs_deadline;		///<当前作业的绝对截止期，ticks，和acoral_get_ticks()比较时要考虑回绕
+	unsigned char job_state;		///<acoralPeriodJobStateEnum，EDF线程没有acoral_period_wait，只用RUNNING和DONE
+	acoral_edf_stat_t stat;			///<作业统计
+}edf_policy_data_t;
+
+#define EDF_DATA(thread) ((edf_policy_data_t *)(thread)->policy_data)
+
+/**
+ * @brief 到了下一个作业的释放时间：上一个作业已经完成的释放新作业，没完成的记一次超限，然后开始等下一个周期
+ * @note 在ticks中断里、临界区中调用
+ *
+ * @param timer 线程的thread_period_timer
+ */
+static void edf_timer_expire(acoral_timer_t *timer){
+	acoral_thread_t *thread = (acoral_thread_t *)acoral_get_res_by_id(timer->owner.id);
+	edf_policy_data_t *policy_data;
+
+	/* 已经被杀死的线程不再释放作业，等daem回收 */
+	if (thread->state & (ACORAL_THREAD_STATE_EXIT | ACORAL_THREAD_STATE_RELEASE))
+		return;
+	policy_data = EDF_DATA(thread);
+	/* 只看作业状态，不看SUSPEND：作业中途在等信号量、延时之类的也是挂起的，不能重置它的栈 */
+	if (policy_data->job_state == ACORAL_PERIOD_JOB_DONE){
+		/* 上一个作业已经完成，重置栈，释放新作业。截止期要在挂就绪队列之前设好，挂的时候要按它排序 */
+		thread->stack = (unsigned int *)((char *)thread->stack_buttom + thread->stack_size - 4);
+		thread->stack = HAL_STACK_INIT(thread->stack, thread->route, edf_thread_exit, thread->args);
+		HAL_LOCK_STATUS_INIT(&thread->lock_status);
+		policy_data->abs_deadline = acoral_get_ticks() + policy_data->deadline_ticks;
+		policy_data->job_state = ACORAL_PERIOD_JOB_RUNNING;
+		ready_thread(thread);
+	}else
+		policy_data->stat.overruns++; /* 上一个作业还没完成（在跑、在就绪队列上或者在等别的东西），这次释放作废，它的截止期保持不变 */
+	acoral_timer_start(timer, policy_data->period_ticks, edf_timer_expire);
+}
+
+/**
+ * @brief 初始化EDF线程的一些数据，并释放第一个作业
+ *
+ * @param thread 线程指针
+ * @param data EDF线程数据，acoral_edf_policy_data_t
+ * @return int 线程id
+ */
+static int edf_policy_thread_init(acoral_thread_t *thread, void *data){
+	acoral_edf_policy_data_t *user_data = (acoral_edf_policy_data_t *)data;
+	edf_policy_data_t *policy_data;
+	acoral_timer_t *period_timer;
+
+	if (user_data == NULL || time_to_ticks(user_data->period_time_mm) <= 0){
+		printf("EDF thread needs a period of at least one tick:%s\n", thread->name);
+		goto err_thread;
+	}
+	policy_data = (edf_policy_data_t *)acoral_malloc(sizeof(edf_policy_data_t));
+	if (policy_data == NULL){
+		printf("No mem space for policy_data:%s\n", thread->name);
+		goto err_thread;
+	}
+	policy_data->period_ticks = time_to_ticks(user_data->period_time_mm);
+	policy_data->deadline_ticks = user_data->deadline_time_mm ? time_to_ticks(user_data->deadline_time_mm) : policy_data->period_ticks;
+	policy_data->stat.jobs = 0;
+	policy_data->stat.misses = 0;
+	policy_data->stat.overruns = 0;
+	policy_data->job_state = ACORAL_PERIOD_JOB_RUNNING;
+	thread->policy_data = policy_data;
+
+	/* 分配TCB中的period_timer */
+	acoral_enter_critical();
+	period_timer = (acoral_timer_t *)acoral_get_res(ACORAL_RES_TIMER);
+	acoral_exit_critical();
+	if (period_timer == NULL){
+		printf("Alloc thread period timer fail:%s\n", thread->name);
+		goto err_data;
+	}
+	acoral_init_list(&period_timer->delay_queue_hook);
+	thread->thread_period_timer = period_timer;
+	thread->thread_period_timer->owner = thread->res;
+
+	if (thread_stack_init(thread, edf_thread_exit) != 0){
+		printf("No thread stack:%s\n", thread->name);
+		acoral_enter_critical();
+		acoral_release_res((acoral_res_t *)period_timer);
+		acoral_exit_critical();
+		goto err_data;
+	}
+
+	/* 释放第一个作业，截止期从现在开始算，同时开始等下一个周期 */
+	acoral_enter_critical();
+	policy_data->abs_deadline = acoral_get_ticks() + policy_data->deadline_ticks;
+	ready_thread(thread);
+	acoral_timer_start(thread->thread_period_timer, policy_data->period_ticks, edf_timer_expire);
+	acoral_exit_critical();
+	acoral_sched();
+	return thread->res.id;
+
+err_data:
+	acoral_free(policy_data);
+err_thread:
+	thread_create_fail(thread);
+	return -1;
+}
+
+/**
+ * @brief 释放EDF线程的策略数据，由daem在临界区中调用
+ *
+ * @param thread 线程指针
+ */
+static void edf_policy_thread_release(acoral_thread_t *thread){
+	acoral_timer_stop(thread->thread_period_timer);
+	acoral_release_res((acoral_res_t *)thread->thread_period_timer);
+	acoral_free(thread->policy_data);
+}
+
+void edf_prio_queue_add(acoral_rdy_queue_t *array, acoral_thread_t *thread)
+{
+	acoral_list_t *head, *tmp;
+	acoral_thread_t *other;
+
+	head = array->queue + thread->prio;
+	for (tmp = head->next; tmp != head; tmp = tmp->next){
+		other = list_entry(tmp, acoral_thread_t, ready_hook);
+		if (other->policy != ACORAL_SCHED_POLICY_EDF || edf_deadline_before(thread, other))
+			break;
+	}
+	/* 借用acoral_prio_queue_add维护计数和位图，再挪到按截止期找到的位置 */
+	acoral_prio_queue_add(array, thread->prio, &thread->ready_hook);
+	if (tmp != head){
+		acoral_list_del(&thread->ready_hook);
+		acoral_list_add2_tail(&thread->ready_hook, tmp);
+	}
+}
+
+int edf_deadline_before(acoral_thread_t *a, acoral_thread_t *b)
+{
+	if (a->policy != ACORAL_SCHED_POLICY_EDF || b->policy != ACORAL_SCHED_POLICY_EDF)
+		return 0;
+	return ACORAL_TICK_BEFORE(EDF_DATA(a)->abs_deadline, EDF_DATA(b)->abs_deadline);
+}
+
+void edf_thread_exit(){
+	edf_policy_data_t *policy_data;
+
+	/* 在临界区内标记并挂起，保证统计完、切走之前不会有新作业被释放 */
+	acoral_enter_critical();
+	policy_data = EDF_DATA(acoral_cur_thread);
+	policy_data->stat.jobs++;
+	if (ACORAL_TICK_AFTER(acoral_get_ticks(), policy_data->abs_deadline))
+		policy_data->stat.misses++;
+	policy_data->job_state = ACORAL_PERIOD_JOB_DONE;
+	acoral_suspend_self();
+	acoral_exit_critical();
+}
+
+int acoral_edf_get_stat(int thread_id, acoral_edf_stat_t *stat){
+	acoral_thread_t *thread = (acoral_thread_t *)acoral_get_res_by_id(thread_id);
+
+	if (thread == NULL || thread->policy != ACORAL_SCHED_POLICY_EDF)
+		return -1;
+	acoral_enter_critical();
+	*stat = EDF_DATA(thread)->stat;
+	acoral_exit_critical();
+	return 0;
+}
+
+void edf_policy_init(void){
+	acoral_sched_policy_t *edf_policy = (acoral_sched_policy_t *)acoral_get_res(ACORAL_RES_POLICY);
+
+	edf_policy->type = ACORAL_SCHED_POLICY_EDF;
+	edf_policy->policy_thread_init = edf_policy_thread_init;
+	edf_policy->policy_thread_release = edf_policy_thread_release;
+	edf_policy->delay_deal = NULL;
+	edf_policy->next_expiry = NULL;
+	acoral_register_sched_policy(edf_policy);
+}
+
+#endif
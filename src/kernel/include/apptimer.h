@@ -0,0 +1,92 @@
+/**
+ * @file apptimer.h
+ * @brief kernel层，应用定时器头文件：到期时调用户给的函数，一次性的或者按周期自动重新启动
+ * @version 1.0
+ * @date 2024-07-01
+ * @copyright Copyright (c) 2024
+ */
+#ifndef ACORAL_APPTIMER_H
+#define ACORAL_APPTIMER_H
+
+#include "autocfg.h"
+#include "thread.h"
+
+#if CFG_APPTIMER
+
+#define APPTIMER_STACK_SIZE (4096) ///<服务线程的栈，回调都在上面跑，放不下就调大
+
+/**
+ * @brief 应用定时器的模式，可以按位或
+ *
+ */
+typedef enum{
+	ACORAL_APPTIMER_ONESHOT = 0,	///<到期一次就停
+	ACORAL_APPTIMER_PERIODIC = 1,	///<到期后按周期自动重新启动，不会因为回调执行的时间而漂移
+	ACORAL_APPTIMER_IN_TICK = 2		///<回调在ticks中断里直接调用，不经过服务线程，回调必须很短、不能阻塞
+}acoralApptimerFlagEnum;
+
+/**
+ * @brief 创建应用定时器，从ACORAL_RES_TIMER资源池里分配，创建后还没启动
+ *
+ * @param fn 到期时调用的函数，默认在服务线程里调用
+ * @param arg fn的参数
+ * @param period_mm 一次性定时器是延时，周期定时器是周期，毫秒，不满一个tick的按一个tick算
+ * @param flags acoralApptimerFlagEnum的组合
+ * @return acoral_timer_t* 定时器，资源池用完了返回NULL
+ */
+acoral_timer_t *acoral_apptimer_create(void (*fn)(void *arg), void *arg, unsigned int period_mm, unsigned char flags);
+
+/**
+ * @brief 停止并删除应用定时器，还回资源池。在服务线程里已经开始执行的回调不受影响
+ *
+ * @param timer 定时器
+ * @return int 0：删除了；-1：timer为NULL
+ */
+int acoral_apptimer_del(acoral_timer_t *timer);
+
+/**
+ * @brief 启动应用定时器，从现在开始计时；已经启动的重新计时
+ * @note 可以在线程和中断里调用
+ *
+ * @param timer 定时器
+ * @return int 0：启动了；-1：timer为NULL
+ */
+int acoral_apptimer_start(acoral_timer_t *timer);
+
+/**
+ * @brief 停止应用定时器，已经到期、还在服务线程队列上没调的回调也不调了
+ * @note 可以在线程和中断里调用
+ *
+ * @param timer 定时器
+ * @return int 0：停止了；-1：timer为NULL
+ */
+int acoral_apptimer_stop(acoral_timer_t *timer);
+
+/**
+ * @brief 修改应用定时器的周期（一次性定时器是延时），正在计时的从现在开始按新周期重新计时
+ * @note 可以在线程和中断里调用
+ *
+ * @param timer 定时器
+ * @param period_mm 新的周期，毫秒
+ * @return int 0：修改了；-1：timer为NULL
+ */
+int acoral_apptimer_set_period(acoral_timer_t *timer, unsigned int period_mm);
+
+/**
+ * @brief 应用定时器最近一次到期的tick
+ * @note 回调在服务线程里调时，服务线程什么时候跑上取决于负载，回调里要知道定时器是什么时候到期的就用这个，不要用acoral_get_ticks
+ *
+ * @param timer 定时器
+ * @return unsigned int 到期的tick
+ */
+unsigned int acoral_apptimer_fired(acoral_timer_t *timer);
+
+/**
+ * @brief 初始化应用定时器，创建服务线程
+ *
+ */
+void system_apptimer_init(void);
+
+#endif
+
+#endif
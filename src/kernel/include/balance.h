@@ -0,0 +1,53 @@
+/**
+ * @file balance.h
+ * @brief kernel层，多核负载均衡头文件
+ * @version 1.0
+ * @date 2024-05-20
+ * @copyright Copyright (c) 2024
+ */
+#ifndef ACORAL_BALANCE_H
+#define ACORAL_BALANCE_H
+
+#include "thread.h"
+
+/**
+ * @brief 每个核的负载均衡统计
+ *
+ */
+typedef struct{
+	unsigned int placements;	///<新线程被放到本核的次数
+	unsigned int steals;		///<本核空闲时从别的核偷到的线程数
+	unsigned int migrations;	///<从别的核迁移到本核的线程数，包括偷来的和改亲和性迁过来的
+}acoral_balance_stat_t;
+
+extern acoral_balance_stat_t acoral_balance_stats[CFG_MAX_CPU];
+
+/// 负载均衡开关，关掉之后新线程放在创建它的核上，空闲的核也不再偷线程，用于对比测试
+extern unsigned char acoral_balance_enabled;
+
+/**
+ * @brief 为不限制亲和性的新线程选核：就绪线程最少的核，一样少时优先当前核
+ *
+ * @return int 核号
+ */
+int acoral_balance_select_cpu(void);
+
+/**
+ * @brief 本核只剩idle线程时，从就绪线程最多的核上偷一个线程过来：
+ *        从最高优先级开始找，每个优先级从队头（等得最久的）开始，取第一个可迁移的线程
+ * @note 必须在临界区中调用，目前只在acoral_select_thread中调用
+ *
+ * @param cpu 本核核号
+ * @return int 1偷到了，0没偷到
+ */
+int acoral_balance_steal(int cpu);
+
+/**
+ * @brief 线程挂到某个核的就绪队列上但不能马上运行时调用，如果有空闲的核，叫醒它来偷
+ * @note 必须在临界区中调用
+ *
+ * @param thread 刚就绪的线程
+ */
+void acoral_balance_kick(acoral_thread_t *thread);
+
+#endif
@@ -11,6 +11,19 @@
 #ifndef ACORAL_BITOPS_H
 #define ACORAL_BITOPS_H
 
+/**
+ * @brief 查找整型数为1的最低位，word不能为0
+ * @note 用__builtin_ctz实现，编译器在有Zbb扩展（__riscv_zbb）时生成ctz指令，
+ *       没有时生成查表或者libgcc实现，都没有分支，比逐级二分快
+ *
+ * @param word 整型数，不能为0
+ * @return unsigned int 位置
+ */
+static inline unsigned int acoral_ffs(unsigned int word)
+{
+    return __builtin_ctz(word);
+}
+
 /**
  * @brief 查找长度为length的整型数组中，最低非0bit的位置。
  *        bit从低到高排序为 b[0]:bit0 -> b[0]:bit31 -> b[1]:bit[0] -> ... b[length-1]:bit31
@@ -47,7 +60,7 @@ void acoral_clear_bit_in_bitmap(int nr,unsigned int *p);
 unsigned int acoral_get_bit_in_bitmap(int nr,unsigned int *bitmap);
 
 /**
- * @brief 二分法查找整型数为1的最低位
+ * @brief 查找整型数为1（或0）的最低位
  * 
  * @param word 整型数
  * @param bit 找0还是1
@@ -12,9 +12,12 @@
 #include "thread.h"
 
 /**
- * @brief 普通线程调度相关的数据
+ * @brief 普通线程调度相关的数据，创建线程时传入，传NULL表示不用时间片，同优先级的线程先来先服务，一直运行到阻塞为止
  * 
  */
+typedef struct{
+	unsigned int slice_time_mm;	///<时间片长度，单位为毫秒，0表示不用时间片，不足一个tick按一个tick算
+}acoral_comm_policy_data_t;
 
 /**
  * @brief 注册普通机制
@@ -22,4 +25,12 @@
  */
 void comm_policy_init();
 
+#if CFG_THRD_SLICE
+/**
+ * @brief 时间片处理，每个tick调用一次：各个核上正在运行的普通线程用完时间片后，挪到同优先级就绪队列的队尾
+ * @note 在acoral_ticks_entry的临界区中调用
+ */
+void comm_delay_deal(void);
+#endif
+
 #endif
@@ -9,9 +9,9 @@
 #ifndef ACORAL_CORE_H
 #define ACORAL_CORE_H
 
-#define DAEM_STACK_SIZE (256)
-#define IDLE_STACK_SIZE (128)
-#define INIT_STACK_SIZE (512)
+#define DAEM_STACK_SIZE (2048) ///<daem回收时会打印日志
+#define IDLE_STACK_SIZE (2048) ///<idle线程自己几乎不用栈，但要放得下中断现场和中断服务的调用链
+#define INIT_STACK_SIZE (4096) ///<init线程里运行user_main
 
 /**
  * @brief aCoral入口
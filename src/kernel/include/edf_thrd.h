@@ -0,0 +1,66 @@
+/**
+ * @file edf_thrd.h
+ * @brief kernel层，最早截止期优先（EDF）调度策略头文件
+ * @version 1.0
+ * @date 2024-05-27
+ * @copyright Copyright (c) 2024
+ */
+#ifndef EDF_THRD_H
+#define EDF_THRD_H
+
+#include "thread.h"
+
+/**
+ * @brief EDF策略数据块，创建线程时传入
+ *
+ */
+typedef struct{
+	unsigned int period_time_mm;	///<线程周期，单位为毫秒
+	unsigned int deadline_time_mm;	///<相对截止期，单位为毫秒，从每个作业释放时开始算，0表示等于周期
+}acoral_edf_policy_data_t;
+
+/**
+ * @brief EDF线程的作业统计
+ *
+ */
+typedef struct{
+	unsigned int jobs;		///<已经完成的作业数
+	unsigned int misses;	///<完成时已经超过截止期的作业数
+	unsigned int overruns;	///<新周期到来时上一个作业还没完成，因而被跳过的释放次数
+}acoral_edf_stat_t;
+
+/**
+ * @brief 把EDF线程挂到就绪队列上：同一优先级内按绝对截止期从早到晚排，截止期相同的按先来后到，
+ *        排在同优先级的非EDF线程前面
+ * @note 必须在临界区中调用
+ *
+ * @param array 就绪队列
+ * @param thread EDF线程
+ */
+void edf_prio_queue_add(acoral_rdy_queue_t *array, acoral_thread_t *thread);
+
+/**
+ * @brief 判断线程a的绝对截止期是否比线程b早，两者都是EDF线程时才有意义，否则返回0
+ *
+ * @param a 线程a
+ * @param b 线程b
+ * @return int 1表示a更早
+ */
+int edf_deadline_before(acoral_thread_t *a, acoral_thread_t *b);
+
+void edf_thread_exit(void);
+
+void edf_policy_init(void);
+
+/***************EDF相关API****************/
+
+/**
+ * @brief 读取EDF线程的作业统计
+ *
+ * @param thread_id 线程id
+ * @param stat 统计结果
+ * @return int 0成功，-1不是EDF线程
+ */
+int acoral_edf_get_stat(int thread_id, acoral_edf_stat_t *stat);
+
+#endif
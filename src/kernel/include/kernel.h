@@ -18,6 +18,7 @@
 #include "autocfg.h"
 #include "core.h"
 #include "thread.h"
+#include "balance.h"
 #include "int.h"
 #include "soft_timer.h"
 #include "mem.h"
@@ -27,10 +28,15 @@
 #include "policy.h"
 #include "comm_thrd.h"
 #include "period_thrd.h"
+#include "edf_thrd.h"
 #include "shell.h"
 #include "message.h"
+#include "msgq.h"
 #include "dag.h"
 #include "log.h"
 #include "resource.h"
+#include "trace.h"
+#include "workq.h"
+#include "apptimer.h"
 
 #endif /* KERNEL_H_ */
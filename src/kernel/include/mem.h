@@ -91,6 +91,7 @@ void buddy_scan(void);
 #define BLOCK_INDEX(index) ((index)>>1)   ///<bitmap的index换算，因为除去最大内存块的剩余层中64块用一个32位图表示，所以要除以2
 #define BLOCK_SHIFT 7                     ///<基本内存块偏移量
 #define BASIC_BLOCK_SIZE (1<<BLOCK_SHIFT) ///<基本内存块大小 128B
+#define BUDDY_FREE_MARK(level) (-2-(level)) ///<acoral_mem_blocks中空闲块首块的标记，记下它是第几层的空闲块
 
 #define MAGIC 0xcc
 #define MAGIC_MASK 0xfe
@@ -120,7 +121,7 @@ typedef enum{
  * 
  */
 typedef struct{
-	char level;
+	signed char level; ///<大于等于0：分配出去的块的首块，记层数；BUDDY_FREE_MARK(层数)：空闲块的首块；-1：其它。char在RISC-V上默认无符号，要显式写signed
 }acoral_block_t; //SPG 这个结构有必要？
 
 /**
@@ -128,9 +129,8 @@ typedef struct{
  * 
  */
 typedef struct{
-	int *free_list[LEVEL];  ///<各层空闲位图链表
 	unsigned int *bitmap[LEVEL];    ///<各层内存状态位图块，两种情况：一. 最大内存块层，为一块内存空闲与否；二.其余层，1 标识两块相邻内存块有一块空闲，0 标识没有空闲
-	int free_cur[LEVEL];    ///<各层空闲位图链表头
+	int free_cur[LEVEL];    ///<各层第一个可能有空闲块的32位图，只是下界，-1表示这层没有空闲块
 	unsigned int num[LEVEL];        ///<各层内存块个数
 	char level;               ///<层数 
 	unsigned char state;              ///<状态
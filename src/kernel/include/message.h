@@ -21,8 +21,9 @@
 #include "mem.h"
 #include "event.h"
 #include "thread.h"
+#include "soft_timer.h"
 
-#define ACORAL_MESSAGE_MAX_COUNT 10
+#define ACORAL_MESSAGE_MAX_COUNT 10 ///<创建消息容器时容量传0就用这个
 
 typedef enum{
 	MST_DEL_UNFORCE,
@@ -37,22 +38,41 @@ typedef enum{
     MST_ERR_UNDEF,
     MSG_ERR_COUNT,
     MSGCTR_SUCCED,
-    MSG_ERR_NULL
+    MSG_ERR_NULL,
+    MST_ERR_DEL         ///<等的时候消息容器被强制删掉了
 }acoralMessgaeErrorEnum;
 
+#define ACORAL_MSGCTR_HASH 16 ///<消息容器按id散列的桶数，必须是2的幂
+#define ACORAL_MSGCTR_BUCKET(id) ((id) & (ACORAL_MSGCTR_HASH - 1))
+
 /**
- * @brief 消息容器结构体
+ * @brief 消息容器的一个散列桶，id散列到这个桶的消息和等这些id的线程都挂在这里
  *
  */
 typedef struct
+{
+	acoral_list_t msgs;			///<每个id最早的那条消息，同id的其余消息按先后挂在它的msglist环上
+	acoral_list_t waiting;		///<等这个桶里的id的线程，按优先级排
+}acoral_msgctr_bucket_t;
+
+/**
+ * @brief 消息容器结构体
+ *
+ */
+typedef struct acoral_msgctr
 {
 	acoral_res_t res; 			///<消息容器也是资源
 	char *name;					///<消息容器名字
 	acoral_list_t msgctr_list; 	///<全局消息列表
 	unsigned int count; 		///<消息数量
-	unsigned int wait_thread_num; ///<等待线程数
-	acoral_list_t waiting; 		///<等待线程指针链
-	acoral_list_t msglist; 		///<消息链指针，用于挂载消息
+	unsigned int capacity; 		///<最多存几条消息，满了发送失败或者等
+	unsigned int wait_thread_num; ///<等待接收的线程数
+	acoral_list_t send_waiting; ///<容器满时等着发的线程，按优先级排，收走一条唤醒一个
+	acoral_msgctr_bucket_t buckets[ACORAL_MSGCTR_HASH]; ///<按id散列，收消息时只看一个桶，不用扫全部消息
+	acoral_list_t ttl_list; 	///<有生存周期的消息按到期先后排在这里
+	acoral_timer_t ttl_timer; 	///<设在ttl_list上最早到期的那条消息的到期tick，到期时回收过期消息
+	void (*expire)(struct acoral_msgctr *msgctr, unsigned int id, void *data); ///<消息过期被回收前调用，NULL表示不通知
+	unsigned int expired; 		///<一共回收了几条过期消息
 }acoral_msgctr_t;
 
 /**
@@ -62,21 +82,47 @@ typedef struct
 typedef struct
 {
 	acoral_res_t res; 		///<消息也是一种资源
-	acoral_list_t msglist; 	///<消息链指针，用于挂载到消息容器
+	acoral_list_t hash_hook; 	///<挂到消息容器的散列桶上，只有同id里最早的那条挂着
+	acoral_list_t msglist; 	///<同id的消息按发送先后连成环
+	acoral_list_t ttl_hook; 	///<有生存周期的消息挂到容器的ttl_list上
 	unsigned int id; 		///<消息标识	
-	unsigned int count; 		///<消息被接收次数，每被接收一次减一,直到0为止	
-	unsigned int ttl; 		///<消息最大生命周期  ticks计数
+	unsigned int count; 		///<消息还能被接收几次，每被接收一次减一，减到0才从容器上取下来释放
+	unsigned int ttl; 		///<消息最大生命周期  ticks计数，发送后变成到期的tick，到了这个tick还没收走就被回收；0表示一直有效
 	void *data; 			///<消息内容指针
+	unsigned char buf; 		///<data是acoral_msgbuf_alloc得到的缓冲区，消息替还没收的count个接收者各持有一个引用
 } acoral_msg_t;
 
+/**
+ * @brief 消息缓冲区池，一次分配出num块size字节的缓冲区，块前面是引用计数
+ *
+ */
+typedef struct
+{
+	unsigned int size; 		///<每块缓冲区多少字节
+	unsigned int num; 		///<一共几块
+	unsigned int free_num; 	///<还有几块空闲
+	acoral_list_t free; 	///<空闲的缓冲区
+}acoral_msgbuf_pool_t;
+
+/**
+ * @brief 消息缓冲区的头，紧挨在交给使用者的数据前面
+ *
+ */
+typedef struct
+{
+	acoral_msgbuf_pool_t *pool; ///<从哪个池里分配的
+	acoral_list_t free_hook; 	///<空闲时挂在池的free上
+	unsigned int ref; 			///<引用计数，减到0时回到池里
+}acoral_msgbuf_t;
+
 void acoral_msg_sys_init(void);
 
 
 
 /**
- * @brief 唤醒最高优先等待线程
+ * @brief 唤醒最高优先等待线程，不管它等的是哪个id
  * 
- * @param head 消息容器waiting成员
+ * @param head 等待队列
  */
 void wake_up_thread(acoral_list_t *head);
 
@@ -85,30 +131,128 @@ void wake_up_thread(acoral_list_t *head);
 /**
  * @brief 创建消息容器
  * 
+ * @param capacity 最多存几条消息，0表示ACORAL_MESSAGE_MAX_COUNT
  * @return acoral_msgctr_t* 消息容器指针
  */
-acoral_msgctr_t *acoral_msgctr_create();
+acoral_msgctr_t *acoral_msgctr_create(unsigned int capacity);
+
+/**
+ * @brief 设置消息过期的通知函数，消息过了生存周期还没被收完，回收前调用一次
+ * @note expire在临界区里调用，可能在ticks中断里，也可能在接收线程里，不能阻塞。
+ *       data是带缓冲区的消息时，调完expire后内核放掉消息持有的引用
+ *
+ * @param msgctr 消息容器
+ * @param expire 通知函数，参数是容器、过期消息的id和内容指针；NULL表示不通知
+ */
+void acoral_msgctr_set_expire(acoral_msgctr_t *msgctr, void (*expire)(acoral_msgctr_t *msgctr, unsigned int id, void *data));
 
 /**
  * @brief 创建消息
  * 
- * @param count 消息被接收次数，每被接收一次减一,直到0为止	
+ * @param count 消息被接收次数，每被接收一次减一,直到0为止，0按1算
  * @param id 消息id
- * @param nTtl 消息最大生命周期  ticks计数
+ * @param nTtl 消息最大生命周期  ticks计数，从发送时算起，过期没收走的由内核回收，接收者不会收到；0表示一直有效
  * @param dat 消息内容指针
  * @return acoral_msg_t* 消息指针
  */
 acoral_msg_t *acoral_msg_create(unsigned int count, unsigned int id, unsigned int nTtl, void *dat);
 
 /**
- * @brief 发送消息
+ * @brief 创建带缓冲区的消息，消息替count个接收者各持有buf的一个引用，每个接收者收到的都是同一块buf，不拷贝
+ * @note 接收者用完要acoral_msgbuf_put；消息没收完就被删掉时，剩下的引用由内核放掉。发送者自己的引用照旧要自己放
+ *
+ * @param count 消息被接收次数，0按1算
+ * @param id 消息id
+ * @param nTtl 消息最大生命周期  ticks计数
+ * @param buf acoral_msgbuf_alloc得到的缓冲区
+ * @return acoral_msg_t* 消息指针
+ */
+acoral_msg_t *acoral_msg_create_buf(unsigned int count, unsigned int id, unsigned int nTtl, void *buf);
+
+/**
+ * @brief 把同一块缓冲区发到多个消息容器，每个容器上一条消息，各持有一个引用
+ * @note 所有容器在一个临界区里发完再调度，优先级高的接收者不会在别的容器还没发到的时候就跑起来
+ *
+ * @param msgctrs 消息容器数组
+ * @param n 容器个数
+ * @param id 消息id
+ * @param nTtl 消息最大生命周期  ticks计数
+ * @param buf acoral_msgbuf_alloc得到的缓冲区
+ * @return int 发到了几个容器，容器满了或者消息结构分配不到的跳过
+ */
+int acoral_msg_multicast(acoral_msgctr_t **msgctrs, int n, unsigned int id, unsigned int nTtl, void *buf);
+
+/**
+ * @brief 创建消息缓冲区池
+ *
+ * @param size 每块缓冲区多少字节
+ * @param num 一共几块
+ * @return acoral_msgbuf_pool_t* 池指针，内存不够返回NULL
+ */
+acoral_msgbuf_pool_t *acoral_msgbuf_pool_create(unsigned int size, unsigned int num);
+
+/**
+ * @brief 删除消息缓冲区池
+ *
+ * @param pool 池
+ * @return int 0：删了；-1：还有缓冲区没回到池里，不删
+ */
+int acoral_msgbuf_pool_del(acoral_msgbuf_pool_t *pool);
+
+/**
+ * @brief 从池里拿一块缓冲区，引用计数为1
+ * @note 不等待，可以在线程和中断里调用
+ *
+ * @param pool 池
+ * @return void* 缓冲区，池空了返回NULL
+ */
+void *acoral_msgbuf_alloc(acoral_msgbuf_pool_t *pool);
+
+/**
+ * @brief 给缓冲区加一个引用
+ *
+ * @param buf 缓冲区
+ */
+void acoral_msgbuf_get(void *buf);
+
+/**
+ * @brief 放掉缓冲区的一个引用，最后一个放掉时回到池里
+ * @note 可以在线程和中断里调用
+ *
+ * @param buf 缓冲区
+ */
+void acoral_msgbuf_put(void *buf);
+
+/**
+ * @brief 发送消息，不等待，可以在中断里调用
  * 
  * @param msgctr 目标消息容器指针
  * @param msg 待发送消息指针
- * @return unsigned int 
+ * @return unsigned int MSGCTR_SUCCED；容器满了返回MSG_ERR_COUNT，消息还归调用者
  */
 unsigned int acoral_msg_send(acoral_msgctr_t *msgctr, acoral_msg_t *msg);
 
+/**
+ * @brief 发送消息，容器满了就等，直到有接收者收走一条腾出位置
+ * @note 超时返回MST_ERR_TIMEOUT时消息没有发出去，还归调用者，不用了要acoral_msg_del
+ *
+ * @param msgctr 目标消息容器指针
+ * @param msg 待发送消息指针
+ * @param timeout 超时毫秒数，0表示一直等
+ * @return unsigned int MSGCTR_SUCCED、MST_ERR_TIMEOUT等；等的时候容器被强制删掉返回MST_ERR_DEL，消息也还归调用者
+ */
+unsigned int acoral_msg_send_wait(acoral_msgctr_t *msgctr, acoral_msg_t *msg, unsigned int timeout);
+
+/**
+ * @brief 发送消息，容器满了就等，超时以纳秒计，不按tick取整
+ *
+ * @param msgctr 目标消息容器指针
+ * @param msg 待发送消息指针
+ * @param timeout 超时纳秒数，0表示一直等
+ * @return unsigned int MSGCTR_SUCCED、MST_ERR_TIMEOUT等
+ */
+unsigned int acoral_msg_send_wait_ns(acoral_msgctr_t *msgctr, acoral_msg_t *msg, unsigned long long timeout);
+
 /**
  * @brief 接收消息
  * 
@@ -120,9 +264,20 @@ unsigned int acoral_msg_send(acoral_msgctr_t *msgctr, acoral_msg_t *msg);
  */
 void *acoral_msg_recv(acoral_msgctr_t *msgctr, unsigned int id, unsigned int timeout, unsigned int *err);
 
+/**
+ * @brief 接收消息，超时以纳秒计，不按tick取整
+ *
+ * @param msgctr 源消息容器
+ * @param id 消息id
+ * @param timeout 超时时间（纳秒），0代表不设置超时时间
+ * @param err 错误号
+ * @return void* 消息内容指针或NULL
+ */
+void *acoral_msg_recv_ns(acoral_msgctr_t *msgctr, unsigned int id, unsigned long long timeout, unsigned int *err);
+
 /**
  * @brief 删除消息容器
- * 
+ * @note 强制删除时等在上面收发的线程都被唤醒，返回MST_ERR_DEL
  * @param pmsgctr 消息容器指针
  * @param flag 取值acoralMsgctrDeleteFlag，unforce代表如果消息的count还不为0，则不会删除
  * @return acoralMessgaeErrorEnum
@@ -130,7 +285,7 @@ void *acoral_msg_recv(acoral_msgctr_t *msgctr, unsigned int id, unsigned int tim
 unsigned int acoral_msgctr_del(acoral_msgctr_t *pmsgctr, unsigned int flag);
 
 /**
- * @brief 删除消息
+ * @brief 删除还没发送的消息，带缓冲区的放掉消息持有的引用
  * 
  * @param pmsg 消息指针
  * @return unsigned int 0成功
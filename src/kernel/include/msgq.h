@@ -0,0 +1,131 @@
+/**
+ * @file msgq.h
+ * @brief kernel层，定长消息队列头文件：创建时定好消息大小和容量，收发都是把消息拷进拷出一段连续的环形缓冲区
+ * @version 1.0
+ * @date 2024-07-20
+ * @copyright Copyright (c) 2024
+ */
+#ifndef ACORAL_MSGQ_H
+#define ACORAL_MSGQ_H
+
+#include "autocfg.h"
+#include "list.h"
+
+#if CFG_MSGQ
+
+/**
+ * @brief 定长消息队列的返回值
+ *
+ */
+typedef enum{
+	MSGQ_SUCCED,		///<成功
+	MSGQ_ERR_NULL,		///<队列或者消息指针为空
+	MSGQ_ERR_INTR,		///<在中断里调用了会阻塞的接口
+	MSGQ_ERR_TIMEOUT,	///<等到超时
+	MSGQ_ERR_FULL,		///<非阻塞发送时队列满
+	MSGQ_ERR_EMPTY,		///<非阻塞接收时队列空
+	MSGQ_ERR_BUSY		///<删除时还有线程等在上面
+}acoralMsgqRetValEnum;
+
+/**
+ * @brief 定长消息队列，和环形缓冲区一起一次分配出来
+ *
+ */
+typedef struct{
+	unsigned int elem_size;		///<每条消息多少字节
+	unsigned int capacity;		///<最多存几条消息
+	unsigned int head;			///<下一条要收的消息在第几格
+	unsigned int count;			///<现在存了几条消息
+	acoral_list_t send_waiting;	///<队列满时等着发的线程，按优先级排
+	acoral_list_t recv_waiting;	///<队列空时等着收的线程，按优先级排
+	unsigned char buf[];		///<环形缓冲区，capacity * elem_size字节
+}acoral_msgq_t;
+
+/**
+ * @brief 创建定长消息队列
+ *
+ * @param elem_size 每条消息多少字节
+ * @param capacity 最多存几条消息
+ * @return acoral_msgq_t* 队列指针，参数为0或者内存不够返回NULL
+ */
+acoral_msgq_t *acoral_msgq_create(unsigned int elem_size, unsigned int capacity);
+
+/**
+ * @brief 删除定长消息队列，队列里没收走的消息一起丢掉
+ *
+ * @param msgq 队列
+ * @return acoralMsgqRetValEnum MSGQ_SUCCED；还有线程等在上面返回MSGQ_ERR_BUSY，不删
+ */
+acoralMsgqRetValEnum acoral_msgq_del(acoral_msgq_t *msgq);
+
+/**
+ * @brief 发送消息，把elem_size字节从msg拷进队列；队列满就等
+ *
+ * @param msgq 队列
+ * @param msg 消息内容
+ * @param timeout 超时毫秒数，0表示一直等
+ * @return acoralMsgqRetValEnum MSGQ_SUCCED、MSGQ_ERR_TIMEOUT等
+ */
+acoralMsgqRetValEnum acoral_msgq_send(acoral_msgq_t *msgq, const void *msg, unsigned int timeout);
+
+/**
+ * @brief 发送消息，超时用纳秒，用高精度定时器计时
+ *
+ * @param msgq 队列
+ * @param msg 消息内容
+ * @param timeout 超时纳秒数，0表示一直等
+ * @return acoralMsgqRetValEnum MSGQ_SUCCED、MSGQ_ERR_TIMEOUT等
+ */
+acoralMsgqRetValEnum acoral_msgq_send_ns(acoral_msgq_t *msgq, const void *msg, unsigned long long timeout);
+
+/**
+ * @brief 接收消息，把最早的一条拷到msg，msg要有elem_size字节；队列空就等
+ *
+ * @param msgq 队列
+ * @param msg 收到的消息拷到这里
+ * @param timeout 超时毫秒数，0表示一直等
+ * @return acoralMsgqRetValEnum MSGQ_SUCCED、MSGQ_ERR_TIMEOUT等
+ */
+acoralMsgqRetValEnum acoral_msgq_recv(acoral_msgq_t *msgq, void *msg, unsigned int timeout);
+
+/**
+ * @brief 接收消息，超时用纳秒，用高精度定时器计时
+ *
+ * @param msgq 队列
+ * @param msg 收到的消息拷到这里
+ * @param timeout 超时纳秒数，0表示一直等
+ * @return acoralMsgqRetValEnum MSGQ_SUCCED、MSGQ_ERR_TIMEOUT等
+ */
+acoralMsgqRetValEnum acoral_msgq_recv_ns(acoral_msgq_t *msgq, void *msg, unsigned long long timeout);
+
+/**
+ * @brief 不等待地发送消息
+ * @note 可以在线程和中断里调用
+ *
+ * @param msgq 队列
+ * @param msg 消息内容
+ * @return acoralMsgqRetValEnum MSGQ_SUCCED；队列满返回MSGQ_ERR_FULL
+ */
+acoralMsgqRetValEnum acoral_msgq_trysend(acoral_msgq_t *msgq, const void *msg);
+
+/**
+ * @brief 不等待地接收消息
+ * @note 可以在线程和中断里调用
+ *
+ * @param msgq 队列
+ * @param msg 收到的消息拷到这里
+ * @return acoralMsgqRetValEnum MSGQ_SUCCED；队列空返回MSGQ_ERR_EMPTY
+ */
+acoralMsgqRetValEnum acoral_msgq_tryrecv(acoral_msgq_t *msgq, void *msg);
+
+/**
+ * @brief 队列里现在有几条消息
+ *
+ * @param msgq 队列
+ * @return unsigned int 消息条数
+ */
+unsigned int acoral_msgq_count(acoral_msgq_t *msgq);
+
+#endif
+
+#endif
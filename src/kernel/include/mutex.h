@@ -83,6 +83,15 @@ acoralMutexRetVal acoral_mutex_trypend(acoral_evt_t *evt);
  */
 acoralMutexRetVal acoral_mutex_pend(acoral_evt_t *evt, unsigned int timeout);
 
+/**
+ * @brief 获取互斥量（优先级继承），超时以纳秒计，不按tick取整
+ *
+ * @param evt 互斥量指针
+ * @param timeout 申请超时时间（纳秒，0代表不设置超时时间）
+ * @return acoralMutexRetVal
+ */
+acoralMutexRetVal acoral_mutex_pend_ns(acoral_evt_t *evt, unsigned long long timeout);
+
 /**
  * @brief 获取互斥量（优先级天花板的优先级反转解决）
  *
@@ -92,6 +101,15 @@ acoralMutexRetVal acoral_mutex_pend(acoral_evt_t *evt, unsigned int timeout);
  */
 acoralMutexRetVal acoral_mutex_pend2(acoral_evt_t *evt, unsigned int timeout);
 
+/**
+ * @brief 获取互斥量（优先级天花板），超时以纳秒计，不按tick取整
+ *
+ * @param evt 互斥量指针
+ * @param timeout 申请超时时间（纳秒，0代表不设置超时时间）
+ * @return acoralMutexRetVal
+ */
+acoralMutexRetVal acoral_mutex_pend2_ns(acoral_evt_t *evt, unsigned long long timeout);
+
 /**
  * @brief 释放互斥量
  *
@@ -18,17 +18,58 @@
 
 #include "thread.h"
 
+/**
+ * @brief 周期线程当前作业的状态，决定周期到了时怎么释放下一个作业
+ *
+ */
+typedef enum{
+	ACORAL_PERIOD_JOB_RUNNING,	///<作业还没做完（在跑、在就绪队列上或者在等别的东西），这次释放跳过
+	ACORAL_PERIOD_JOB_DONE,		///<线程函数返回了，重置栈从头再跑
+	ACORAL_PERIOD_JOB_WAITING	///<在acoral_period_wait里等，直接就绪，从acoral_period_wait返回接着跑
+}acoralPeriodJobStateEnum;
+
 /**
  * @brief 周期策略数据块
  * 
  */
 typedef struct{
 	unsigned int period_time_mm; 			///<线程周期，单位为毫秒
+	unsigned int wcet_mm; 					///<最坏执行时间，单位为毫秒，0表示不知道，这个线程不参加准入检查
+	unsigned int wcrt_mm; 					///<最坏响应时间，单位为毫秒，由准入检查算出，创建线程时不用填
+	unsigned char job_state;				///<acoralPeriodJobStateEnum，创建线程时不用填
+	unsigned int missed;					///<上一次acoral_period_wait之后因为作业没做完跳过的释放次数，创建线程时不用填
+	unsigned long long release_ns;			///<当前作业释放的时间，acoral_clock_ns，创建线程时不用填
 }acoral_period_policy_data_t;
 
 void period_thread_exit(void);
 void period_thread_delay(acoral_thread_t* thread,unsigned int time);
-void period_delay_deal(void);
 
 void period_policy_init(void);
+
+/***************周期线程相关API****************/
+
+/**
+ * @brief 读取周期线程的最坏响应时间，每次同一个核上有带WCET的周期线程创建或者被回收时都会重新计算
+ *
+ * @param thread_id 线程id
+ * @return int 最坏响应时间，单位为毫秒；不是周期线程或者没有填WCET返回-1
+ */
+int acoral_period_get_wcrt(int thread_id);
+
+/**
+ * @brief 周期线程等下一个周期：线程函数可以写成循环，每做完一次调一下，栈和局部变量都留着，
+ *        不用像线程函数返回那样每个周期重置栈、从头再跑
+ * @note 只能在周期线程自己里调用。作业做得比周期还长的话，中间的释放会被跳过，下一个周期才返回
+ *
+ * @return int 上次调用之后跳过了几次释放；不是周期线程返回-1
+ */
+int acoral_period_wait(void);
+
+/**
+ * @brief 读取周期线程当前作业的释放时间，减一下就是释放到开始运行的延迟
+ *
+ * @param thread_id 线程id
+ * @return unsigned long long 释放时的acoral_clock_ns；不是周期线程返回0
+ */
+unsigned long long acoral_period_get_release(int thread_id);
 #endif
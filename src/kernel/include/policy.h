@@ -25,7 +25,8 @@ typedef struct acoral_thread_tcb acoral_thread_t;
 
 typedef enum{
 	ACORAL_SCHED_POLICY_COMM,
-	ACORAL_SCHED_POLICY_PERIOD
+	ACORAL_SCHED_POLICY_PERIOD,
+	ACORAL_SCHED_POLICY_EDF
 }acoralSchedPolicyEnum;
 
 /**
@@ -39,17 +40,28 @@ typedef struct{
 	int (*policy_thread_init)(acoral_thread_t *,void *); ///<某种策略的初始化函数，用于线程创建时调用
 	void (*policy_thread_release)(acoral_thread_t *); 	///<某种策略的释放函数，用于消灭线程时调用
 	void (*delay_deal)(void); 							///<线程延时函数，用于例如周期、时间片等和时间相关的调度策略
+	unsigned int (*next_expiry)(void);					///<所有核都空闲时，delay_deal最早在多少个tick之后才有事可做，没有返回ACORAL_POLICY_NO_EXPIRY；有delay_deal却没有这个函数，就不能停ticks
 }acoral_sched_policy_t;
 
+#define ACORAL_POLICY_NO_EXPIRY 0xffffffff ///<策略没有要到期的事件
+
 
 typedef struct{
 #if CFG_THRD_PERIOD
-    acoral_list_t global_period_wait_queue; ///<周期线程专用等待队列，差分队列。只要是周期线程，就会被挂载到这个队列上，延时时间就是周期，每次周期过后重新挂载
+    acoral_list_t global_period_wait_queue; ///<所有周期线程，准入检查时用。等下一个周期靠各自的thread_period_timer
 #endif
 }policy_res_private_data;
 
 
 void acoral_policy_delay_deal(void);
+
+/**
+ * @brief 所有策略里最早的到期事件在多少个tick之后，用于停ticks
+ * @note 在临界区中调用
+ *
+ * @return unsigned int tick数，至少为1；没有到期事件返回ACORAL_POLICY_NO_EXPIRY
+ */
+unsigned int acoral_policy_next_expiry(void);
 acoral_sched_policy_t *acoral_get_policy_ctrl(unsigned char type);
 
 /**
@@ -85,7 +85,7 @@ typedef struct {
    unsigned int size; ///< 该资源池中每个资源的大小
    unsigned int num; ///< 资源池中资源的总数
    unsigned int free_num; ///< 资源池中未分配的资源个数
-   acoralResourceTypeEnum type; ///< 该资源池的类型（acoralResourceTypeEnum）//SPG 好像没用到
+   acoralResourceTypeEnum type; ///< 该资源池的类型（acoralResourceTypeEnum），释放资源时用来找资源池控制块
    acoral_list_t ctrl_list; ///< 资源池创建后挂载到资源池控制块pools链表上的钩子
    acoral_list_t free_list; ///< 资源池中尚有未分配的资源时，挂载到资源池控制块free_pools链表的钩子
 }acoral_pool_t;
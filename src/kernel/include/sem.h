@@ -85,6 +85,15 @@ acoralSemRetValEnum acoral_sem_trypend(acoral_evt_t *evt);
  */
 acoralSemRetValEnum acoral_sem_pend(acoral_evt_t *evt, unsigned int timeout);
 
+/**
+ * @brief 获取信号量(阻塞式)，超时以纳秒计，不按tick取整
+ *
+ * @param evt 信号量指针
+ * @param timeout 超时时间（纳秒），0代表不设置超时时间
+ * @return acoralSemRetValEnum
+ */
+acoralSemRetValEnum acoral_sem_pend_ns(acoral_evt_t *evt, unsigned long long timeout);
+
 /**
  * @brief 释放信号量
  *  desp: count > SEM_RES_NOAVAI 有等待线程 a-- && resume waiting thread.
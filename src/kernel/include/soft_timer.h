@@ -20,54 +20,231 @@
 #include "core.h"
 #include "thread.h"
 
+/* 时间单位换算，都在64位里算，参数是常量时编译期就算好了。ms/us/ns换成tick是向下取整的，_UP结尾的向上取整 */
+#define ACORAL_NS_PER_TICK (1000000000ull / CFG_TICKS_PER_SEC)      ///<一个tick多少纳秒
+#define ACORAL_US_TO_NS(us) ((unsigned long long)(us) * 1000ull)
+#define ACORAL_MS_TO_NS(ms) ((unsigned long long)(ms) * 1000000ull)
+#define ACORAL_NS_TO_US(ns) ((unsigned long long)(ns) / 1000ull)
+#define ACORAL_NS_TO_MS(ns) ((unsigned long long)(ns) / 1000000ull)
+#define ACORAL_MS_TO_TICKS(ms) ((unsigned long long)(ms) * CFG_TICKS_PER_SEC / 1000ull)
+#define ACORAL_MS_TO_TICKS_UP(ms) (((unsigned long long)(ms) * CFG_TICKS_PER_SEC + 999ull) / 1000ull)
+#define ACORAL_NS_TO_TICKS(ns) ((unsigned long long)(ns) / ACORAL_NS_PER_TICK)
+#define ACORAL_NS_TO_TICKS_UP(ns) (((unsigned long long)(ns) + ACORAL_NS_PER_TICK - 1) / ACORAL_NS_PER_TICK)
+#define ACORAL_TICKS_TO_MS(t) ((unsigned long long)(t) * 1000ull / CFG_TICKS_PER_SEC)
+#define ACORAL_TICKS_TO_NS(t) ((unsigned long long)(t) * ACORAL_NS_PER_TICK)
+
+/* 到期时间的比较：32位的tick计数在100Hz下500天就回绕，不能直接比大小，看差值的符号。
+ * 只要两个时间相差不到半圈（2^31个tick）就是对的。64位的纳秒时间几百年不回绕，也按同样的写法比 */
+#define ACORAL_TICK_AFTER(a, b) ((int)((unsigned int)(b) - (unsigned int)(a)) < 0)      ///<tick a在b之后
+#define ACORAL_TICK_BEFORE(a, b) ACORAL_TICK_AFTER(b, a)                                ///<tick a在b之前
+#define ACORAL_TICK_AFTER_EQ(a, b) ((int)((unsigned int)(a) - (unsigned int)(b)) >= 0)  ///<tick a在b之后或者就是b
+#define ACORAL_TIME_AFTER(a, b) ((long long)((unsigned long long)(b) - (unsigned long long)(a)) < 0) ///<纳秒时间a在b之后
+#define ACORAL_TIME_BEFORE(a, b) ACORAL_TIME_AFTER(b, a)                                ///<纳秒时间a在b之前
+#define ACORAL_TICKS_MAX 0x7fffffff ///<一次延时、超时最多的tick数，再多就超过半圈，到期时间比不出先后了
+
+#define ACORAL_TIMER_WHEEL_BITS 6                               ///<时间轮每层的槽数是2的多少次方
+#define ACORAL_TIMER_WHEEL_SLOTS (1 << ACORAL_TIMER_WHEEL_BITS)  ///<时间轮每层的槽数
+#define ACORAL_TIMER_WHEEL_LEVELS 4                             ///<时间轮的层数
+#define ACORAL_TIMER_WHEEL_MAX ((1u << (ACORAL_TIMER_WHEEL_BITS * ACORAL_TIMER_WHEEL_LEVELS)) - 1) ///<时间轮一次能放下的最大ticks数，更远的先放在最高层，轮到时再放一次
+
 /**
  * @brief aCoral软定时器，即以ticks中断为基准的软件实现的定时器
  * 
  */
-typedef struct 
+typedef struct acoral_timer
 {
     acoral_res_t res;
-    acoral_list_t delay_queue_hook; ///<timer挂载到目标队列的钩子
-    int delay_time;                 ///<timer将要等待的时间(ticks)
+    acoral_list_t delay_queue_hook; ///<timer挂载到时间轮槽上的钩子，没启动或者已经到期时为空
+    int delay_time;                 ///<启动时给的ticks数，到期时清零；等待超时的地方靠它是否不大于0判断是不是超时醒来的
+    unsigned int expires;           ///<在哪个tick到期
+    void (*expire)(struct acoral_timer *timer); ///<到期时在ticks中断里、临界区中调用，可以在里面重新启动这个timer
     acoral_res_t owner;             ///<timer持有者，一般为线程
+#if CFG_HRTIMER
+    unsigned long long hr_expires;  ///<挂在高精度定时器队列上时在什么时候到期，纳秒
+#endif
+#if CFG_APPTIMER
+    void (*fn)(void *arg);          ///<应用定时器到期时调用的函数
+    void *arg;                      ///<fn的参数
+    int period;                     ///<应用定时器的周期（一次性的就是延时），ticks
+    unsigned char flags;            ///<应用定时器的模式，acoralApptimerFlagEnum的组合
+    unsigned int fired;             ///<应用定时器最近一次到期的tick，回调在服务线程里调的时候可能已经晚了
+    acoral_list_t service_hook;     ///<应用定时器到期后挂到服务线程的队列上，等着调fn
+#endif
 }acoral_timer_t;
 
+/**
+ * @brief 分层时间轮：第0层每个槽是一个tick，第n层每个槽是2^(6n)个tick。
+ *        启动、停止都是O(1)，每个tick只处理第0层的一个槽，每64个tick把上一层的一个槽往下分一次
+ *
+ */
+typedef struct{
+    acoral_list_t slots[ACORAL_TIMER_WHEEL_LEVELS][ACORAL_TIMER_WHEEL_SLOTS];
+    unsigned int base;              ///<下一个要处理的tick
+}acoral_timer_wheel_t;
+
+#if CFG_TICKLESS
+/**
+ * @brief 停ticks的统计
+ *
+ */
 typedef struct{
-    acoral_list_t global_time_delay_queue; ///<aCoral线程延时队列，调用线程delay相关函数的线程都会被加到这个队列上，等待一段具体时间后重新被唤醒
-    acoral_list_t global_timeout_queue;    ///<aCoral获取资源（互斥量等）超时等待队列，即在timeout时间内获取即成功，否则超时失败
-}timer_res_private_data;
+    unsigned int sleeps;    ///<停了几次ticks
+    unsigned int ticks;     ///<停ticks期间一共过了多少个tick，每次停ticks只来一次定时中断，省下的中断数是ticks-sleeps
+}acoral_tickless_stat_t;
+#endif
 
-int time_to_ticks(unsigned int time); 
+/**
+ * @brief 毫秒换成tick数，向下取整，在64位里算，不会溢出
+ *
+ * @param time 毫秒
+ * @return int tick数，超过ACORAL_TICKS_MAX的按ACORAL_TICKS_MAX算，不会是负数
+ */
+int time_to_ticks(unsigned int time);
 
+/**
+ * @brief 初始化系统时间轮，在创建任何线程之前调用
+ *
+ */
 void acoral_time_init(void);
 int system_ticks_init();
 void acoral_ticks_entry();
-void time_delay_deal(void);
 
 /**
- * @brief 将线程挂到延时队列上
- * 
+ * @brief 初始化时间轮
+ *
+ * @param wheel 时间轮
+ * @param now 当前是第几个tick，之后每调用一次acoral_timer_wheel_tick就走一个tick
  */
-void acoral_delayqueue_add(acoral_list_t*, acoral_thread_t*);
+void acoral_timer_wheel_init(acoral_timer_wheel_t *wheel, unsigned int now);
 
 /**
- * @brief 超时链表处理函数
- * 
+ * @brief 把timer挂到时间轮上，已经挂着的先取下来，O(1)
+ * @note 系统时间轮要在临界区中调用
+ *
+ * @param wheel 时间轮
+ * @param timer 定时器
+ * @param ticks 多少个tick之后到期，小于1的按1算
+ * @param expire 到期时调用的函数
+ */
+void acoral_timer_wheel_add(acoral_timer_wheel_t *wheel, acoral_timer_t *timer, int ticks, void (*expire)(acoral_timer_t *timer));
+
+/**
+ * @brief 时间轮走一个tick，调用这个tick到期的timer的expire
+ * @note 系统时间轮由ticks中断在临界区中调用
+ *
+ * @param wheel 时间轮
+ */
+void acoral_timer_wheel_tick(acoral_timer_wheel_t *wheel);
+
+/**
+ * @brief 时间轮上最早的timer在多少个tick之后到期
+ * @note 要扫一遍各层的槽，只在停ticks前用
+ *
+ * @param wheel 时间轮
+ * @return unsigned int tick数，至少为1；时间轮空的返回ACORAL_POLICY_NO_EXPIRY
+ */
+unsigned int acoral_timer_wheel_next(acoral_timer_wheel_t *wheel);
+
+/**
+ * @brief 在系统时间轮上启动timer，已经启动的重新计时
+ * @note 在临界区中调用
+ *
+ * @param timer 定时器
+ * @param ticks 多少个tick之后到期，小于1的按1算
+ * @param expire 到期时在ticks中断里调用的函数
+ */
+void acoral_timer_start(acoral_timer_t *timer, int ticks, void (*expire)(acoral_timer_t *timer));
+
+/**
+ * @brief 停止timer，没启动或者已经到期的什么都不做，O(1)
+ * @note 在临界区中调用
+ *
+ * @param timer 定时器
+ */
+void acoral_timer_stop(acoral_timer_t *timer);
+
+///timer是否还在时间轮或者高精度定时器队列上等着到期
+#define acoral_timer_pending(timer) (!acoral_list_empty(&(timer)->delay_queue_hook))
+
+/**
+ * @brief 64位的单调时钟，由硬件自由运行的计数器（K210上是CLINT的mtime）换算，不受ticks停没停的影响，也不会回绕
+ * @note 不用进临界区，中断里也能调
+ *
+ * @return unsigned long long 开机以来的纳秒数
+ */
+unsigned long long acoral_clock_ns(void);
+
+#define acoral_clock_us() ACORAL_NS_TO_US(acoral_clock_ns())   ///<开机以来的微秒数
+#define acoral_clock_ms() ACORAL_NS_TO_MS(acoral_clock_ns())   ///<开机以来的毫秒数
+
+/**
+ * @brief 以纳秒为单位启动timer，已经启动的重新计时。开了CFG_HRTIMER时挂到按到期时间排好序的高精度定时器队列上，
+ *        最早的那个直接设到硬件比较器里，不用等tick；没开时向上取整成ticks放到时间轮上
+ * @note 在临界区中调用；停止还是用acoral_timer_stop，到期时delay_time同样会被清零
+ *
+ * @param timer 定时器
+ * @param ns 多少纳秒之后到期
+ * @param expire 到期时在定时器中断里、临界区中调用的函数
+ */
+void acoral_hrtimer_start(acoral_timer_t *timer, unsigned long long ns, void (*expire)(acoral_timer_t *timer));
+
+#if CFG_HRTIMER
+/**
+ * @brief 高精度定时器中断服务函数，处理所有到期的timer，再把硬件比较器设到下一个
+ *
  */
-void timeout_delay_deal(void);
+void acoral_hrtimer_entry(void *args);
+#endif
 
 /**
- * @brief 将线程挂到超时队列上
+ * @brief 将线程挂到超时队列上，thread_timer->delay_time个tick之后还没被唤醒就由ticks中断唤醒它
  * 
  */
 void timeout_queue_add(acoral_thread_t*);
 
+/**
+ * @brief 将线程挂到超时队列上，ns纳秒之后还没被唤醒就由定时器中断唤醒它，精度见acoral_hrtimer_start
+ *
+ */
+void timeout_queue_add_ns(acoral_thread_t*, unsigned long long ns);
+
 /**
  * @brief 将线程从超时队列删除
  * 
  */
 void timeout_queue_del(acoral_thread_t*);
 
+#if CFG_TICKLESS
+/**
+ * @brief idle线程里调用：所有核都只剩idle线程时，0号核找出时间轮和各调度策略里最早的到期事件，
+ *        停掉周期ticks，改成到那时候的单次定时，然后本核休眠直到下一个中断
+ *
+ */
+void acoral_tickless_idle(void);
+
+/**
+ * @brief 停ticks期间被定时器以外的中断唤醒，有线程要就绪时调用：恢复周期ticks，把睡过去的tick补上，
+ *        之后延时、超时的计算都以补好的tick为准
+ * @note 没有停ticks时什么都不做，可以在临界区中调用
+ *
+ */
+void acoral_tickless_exit(void);
+
+extern unsigned char acoral_tickless_active; ///<周期ticks是否已经停掉，只在临界区中访问
+
+/**
+ * @brief 线程就绪时调用：停着ticks才去acoral_tickless_exit补tick，没停时只看一眼标志，
+ *        就绪线程的路径上不用再进一层临界区
+ * @note 在临界区中调用
+ *
+ */
+static inline void acoral_tickless_wakeup(void)
+{
+	if (acoral_tickless_active)
+		acoral_tickless_exit();
+}
+#endif
+
 /***************ticks相关API****************/
 
 /**
@@ -84,5 +261,21 @@ void acoral_set_ticks(unsigned int time);
  */
 unsigned int acoral_get_ticks();
 
+/**
+ * @brief 得到64位的tick计数，不会回绕。acoral_get_ticks是它的低32位
+ *
+ * @return unsigned long long tick的值
+ */
+unsigned long long acoral_get_ticks64(void);
+
+#if CFG_TICKLESS
+/**
+ * @brief 得到停ticks的统计
+ *
+ * @param stat 统计结果
+ */
+void acoral_tickless_get_stat(acoral_tickless_stat_t *stat);
+#endif
+
 #endif
 
@@ -0,0 +1,66 @@
+/**
+ * @file spinlock.h
+ * @brief kernel层，多核之间互斥用的自旋锁
+ * @version 1.0
+ * @date 2024-05-13
+ * @copyright Copyright (c) 2024
+ * @note 自旋锁只解决核与核之间的互斥，核内的互斥还是靠关中断，所以一般不直接使用，
+ *       而是通过acoral_enter_critical()/acoral_exit_critical()间接使用内核大锁
+ */
+#ifndef ACORAL_SPINLOCK_H
+#define ACORAL_SPINLOCK_H
+
+/**
+ * @brief 自旋锁
+ *
+ */
+typedef struct {
+	volatile int lock; ///<0表示空闲，1表示被某个核持有
+}acoral_spinlock_t;
+
+/**
+ * @brief 初始化自旋锁
+ *
+ * @param lock 自旋锁
+ */
+static inline void acoral_spin_init(acoral_spinlock_t *lock)
+{
+	lock->lock = 0;
+}
+
+/**
+ * @brief 获取自旋锁，获取不到就一直等，等的时候只读不写，减少核间缓存行争抢
+ *
+ * @param lock 自旋锁
+ */
+static inline void acoral_spin_lock(acoral_spinlock_t *lock)
+{
+	while (__atomic_exchange_n(&lock->lock, 1, __ATOMIC_ACQUIRE))
+	{
+		while (__atomic_load_n(&lock->lock, __ATOMIC_RELAXED))
+			;
+	}
+}
+
+/**
+ * @brief 尝试获取自旋锁
+ *
+ * @param lock 自旋锁
+ * @return int 1获取成功，0失败
+ */
+static inline int acoral_spin_trylock(acoral_spinlock_t *lock)
+{
+	return !__atomic_exchange_n(&lock->lock, 1, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief 释放自旋锁
+ *
+ * @param lock 自旋锁
+ */
+static inline void acoral_spin_unlock(acoral_spinlock_t *lock)
+{
+	__atomic_store_n(&lock->lock, 0, __ATOMIC_RELEASE);
+}
+
+#endif
@@ -25,14 +25,31 @@
 
 #include <stdbool.h>
 
-extern unsigned char system_need_sched; 
+extern unsigned char system_need_scheds[CFG_MAX_CPU]; 
 extern unsigned char system_sched_locked;
-extern acoral_thread_t *acoral_cur_thread;
+extern acoral_thread_t *acoral_cur_threads[CFG_MAX_CPU];
+
+///当前代码运行在哪个核上
+#define acoral_current_cpu() HAL_GET_CORE_ID()
+
+///当前核是否需要调度
+#define system_need_sched (system_need_scheds[acoral_current_cpu()])
+
+///当前核正在运行的线程
+#define acoral_cur_thread (acoral_cur_threads[acoral_current_cpu()])
+
+///线程亲和性：可以在任意核上运行
+#define ACORAL_CPU_ANY (-1)
 
 ///就绪队列中的优先级位图的大小，目前等于2，算法就是优先级数目除以32向上取整
-#define ACORAL_MAX_PRIO_NUM ((CFG_MAX_THREAD + 1) & 0xff) ///<41。总共有40个线程，就有0~40共41个优先级
+#define ACORAL_MAX_PRIO_NUM (CFG_MAX_THREAD + 1) ///<41。总共有40个线程，就有0~40共41个优先级
 #define PRIO_BITMAP_SIZE ((ACORAL_MAX_PRIO_NUM+31)/32) 
 
+/* 二级位图的第一级只有一个32位字，每一位对应一个32位的优先级位图字，所以最多支持32*32个优先级 */
+#if PRIO_BITMAP_SIZE > 32
+#error "CFG_MAX_THREAD too large, at most 1023 threads (1024 priorities) are supported"
+#endif
+
 /**
  * @brief aCoral预设优先级列表
  * 
@@ -63,6 +80,23 @@ typedef enum{
 	ACORAL_THREAD_STATE_DELAY = 1<<5,		///表示线程将在一段时间之后被重新唤醒并挂载到acoral_ready_queues上，对于普通线程来说，就是调用了delay接口，对于周期线程来说，就是周期
 }acoralThreadStateEnum;
 
+#if CFG_THRD_STATS
+/**
+ * @brief 线程运行统计，在system_set_running_thread中更新，单位都是HAL_GET_CYCLES的周期
+ *
+ */
+typedef struct{
+    unsigned long long run_cycles;      ///<累计运行周期，不包括正在运行的这一段
+    unsigned long long switch_in;       ///<最近一次被换上的时间
+    unsigned long long wakeup;          ///<最近一次挂上就绪队列的时间，被换上之后清0
+    unsigned int voluntary;             ///<主动让出CPU的次数：阻塞、延时、挂起、退出
+    unsigned int involuntary;           ///<还就绪就被换下的次数：被抢占、时间片到、迁移
+    unsigned int preempted;             ///<被更高优先级的线程抢占的次数，包含在involuntary里
+    unsigned int last_latency;          ///<最近一次从就绪到运行的周期数
+    unsigned int max_latency;           ///<从就绪到运行的最大周期数
+}acoral_thread_stat_t;
+#endif
+
 /**
  *  @struct acoral_thread_t
  *  @brief 线程控制块TCB
@@ -76,7 +110,7 @@ typedef struct acoral_thread_tcb{
 	acoralThreadStateEnum state;    ///<线程状态  
     void (*route)(void *args); 	    ///<线程函数
 	void* args; 				    ///<线程函数的参数
-	unsigned char prio;             ///<原始优先级
+	unsigned int prio;              ///<原始优先级
     acoralPrioTypeEnum prio_type;   ///<线程优先级类型，包括硬实时任务ACORAL_HARD_PRIO、非硬实时任务ACORAL_NONHARD_PRIO
 	acoralSchedPolicyEnum policy;   ///<调度策略
     void* policy_data;              ///<调度策略专用数据
@@ -87,20 +121,35 @@ typedef struct acoral_thread_tcb{
 	unsigned int stack_size;        ///<栈大小
   
     /* 钩子 */
-    acoral_list_t ready_hook;	        ///<用于挂载到全局就绪队列
-	acoral_list_t timeout_hook;         ///<用于挂载到全局timeout队列
+    acoral_list_t ready_hook;	        ///<用于挂载到所在核的就绪队列
     acoral_list_t daem_hook;            ///<用于挂载到daem线程回收队列
     acoral_list_t ipc_waiting_hook;     ///<用于挂载到ipc（互斥量、信号量、消息）等待队列
 #if	CFG_THRD_PERIOD
-	acoral_list_t period_wait_hook; ///<周期等待队列
-
+	acoral_list_t period_wait_hook; ///<挂到所有周期线程的链表上，准入检查用
+#endif
+#if	CFG_THRD_PERIOD || CFG_THRD_EDF
     /* timer */
-    acoral_timer_t* thread_period_timer; ///<用于周期线程等待下一个周期到来，因为线程在等待这个周期的过程中是处于运行状态的，因此不能和thread_timer共用
+    acoral_timer_t* thread_period_timer; ///<用于周期线程和EDF线程等待下一个周期到来，因为线程在等待这个周期的过程中是处于运行状态的，因此不能和thread_timer共用
 #endif
     acoral_timer_t* thread_timer; ///<用于等待互斥量、信号量等的超时时间timeout、线程延时acoral_delay_self的时间，这些等待过程的共同点在于线程都是在suspend状态下等待的，不存在又等互斥量又等线程延时时间的情况，因此可以共用一个timer
+
+    /* 多核 */
+    int cpu;                        ///<线程挂在哪个核的就绪队列上，也就是在哪个核上运行
+    int affinity;                   ///<线程亲和性，ACORAL_CPU_ANY表示不限制，否则只能在这个核上运行
+    hal_lock_status_t lock_status;  ///<线程被切换走时所在核的临界区状态
+#if CFG_FPU
+    hal_fpu_ctx_t fpu_ctx;          ///<浮点现场，只有用过浮点的线程才会保存
+#endif
+#if CFG_THRD_STATS
+    acoral_thread_stat_t stat;      ///<运行统计
+#endif
 	
     /* 获取的资源 */
     acoral_evt_t* evt; //SPG 只能获取一个信号量或者互斥量？
+#if CFG_MSG
+    unsigned int msg_id;            ///<在消息容器上等的消息id，发消息时只唤醒等这个id的线程
+    unsigned char msg_deleted;      ///<等着的消息容器被强制删掉了，醒来后不能再碰它
+#endif
 }acoral_thread_t;
 
 /**
@@ -109,16 +158,71 @@ typedef struct acoral_thread_tcb{
  */
 typedef struct{
 	unsigned int num;							///<就绪的线程数
+	unsigned int summary;						///<一级位图，第i位为1表示bitmap[i]不为0，即优先级32*i~32*i+31中有就绪线程
 	unsigned int bitmap[PRIO_BITMAP_SIZE];		///<优先级位图，每一位对应一个优先级，为1表示这个优先级有就绪线程
 	acoral_list_t queue[ACORAL_MAX_PRIO_NUM];	///<每一个优先级都有独立的队列
 }acoral_rdy_queue_t;
 
 typedef struct{
     acoral_list_t global_daem_release_queue;
-    acoral_rdy_queue_t global_ready_queue;
+    acoral_rdy_queue_t global_ready_queue[CFG_MAX_CPU]; ///<每个核一个就绪队列
 }thread_res_private_data;
 
 int thread_stack_init(acoral_thread_t *thread,void (*exit)(void));
+
+/**
+ * @brief 调度策略初始化线程失败时调用，收回acoral_create_thread已经给线程的TCB、thread_timer和栈：
+ *        有栈的优先放进线程缓存，放不下或者还没有栈的都释放掉。策略自己的数据要在调用之前释放
+ *
+ * @param thread 创建失败的线程
+ */
+void thread_create_fail(acoral_thread_t *thread);
+
+#if CFG_STACK_CHECK
+/**
+ * @brief 扫描线程栈，从栈底往上数还保留着涂色的字，算出栈用到过的最深处
+ *
+ * @param thread 线程
+ * @return unsigned int 用过的字节数，等于栈大小说明栈底的涂色也被改了，很可能已经溢出
+ */
+unsigned int acoral_thread_stack_used(acoral_thread_t *thread);
+#endif
+
+#if CFG_STACK_LEARN
+/**
+ * @brief 学习模式的一条记录，同名线程合并
+ *
+ */
+typedef struct{
+    char *name;                 ///<线程名
+    unsigned int size;          ///<最近一次的栈大小
+    unsigned int peak;          ///<所有同名线程栈用到的最深处
+}acoral_stack_learn_t;
+
+/**
+ * @brief 记下线程栈用到的最深处，daem释放线程之前会调用
+ * @note 必须在临界区中调用
+ *
+ * @param thread 线程
+ */
+void acoral_stack_learn(acoral_thread_t *thread);
+
+/**
+ * @brief 取出学习到的记录
+ *
+ * @param tab 存放记录的数组，至少CFG_STACK_LEARN_ENTRIES个
+ * @return int 记录数
+ */
+int acoral_stack_learn_get(acoral_stack_learn_t *tab);
+
+/**
+ * @brief 按用到的最深处给出推荐的栈大小：留四分之一余量，按64字节向上取整，不低于CFG_MIN_STACK_SIZE
+ *
+ * @param peak 用到的最深处
+ * @return unsigned int 推荐的栈大小
+ */
+unsigned int acoral_stack_recommend(unsigned int peak);
+#endif
 void system_thread_module_init(void);
 void unrdy_thread(acoral_thread_t *thread);
 void ready_thread(acoral_thread_t *thread);
@@ -137,7 +241,26 @@ void ready_thread(acoral_thread_t *thread);
  * @param data 线程策略数据
  * @return int 成功返回线程id，失败返回-1
  */
-int acoral_create_thread(char *name, void (*route)(void *args),void *args,unsigned int stack_size,acoralSchedPolicyEnum sched_policy,unsigned char prio,acoralPrioTypeEnum prio_type,void *data);
+int acoral_create_thread(char *name, void (*route)(void *args),void *args,unsigned int stack_size,acoralSchedPolicyEnum sched_policy,unsigned int prio,acoralPrioTypeEnum prio_type,void *data);
+
+/**
+ * @brief aCoral创建线程API，同时指定线程亲和性
+ * 
+ * @param affinity 线程只能在这个核上运行，ACORAL_CPU_ANY表示不限制（新线程放在就绪线程最少的核上）
+ * @return int 成功返回线程id，失败返回-1
+ * @note 其余参数同acoral_create_thread
+ */
+int acoral_create_thread_affinity(char *name, void (*route)(void *args),void *args,unsigned int stack_size,acoralSchedPolicyEnum sched_policy,unsigned int prio,acoralPrioTypeEnum prio_type,void *data,int affinity);
+
+/**
+ * @brief aCoral设置线程亲和性API
+ * 
+ * @param thread_id 线程id
+ * @param affinity 目标核，ACORAL_CPU_ANY表示不限制
+ * @return int 0成功，-1核号非法
+ * @note 就绪但没在运行的线程立刻迁移；正在其它核上运行的线程等它下次被唤醒时迁移
+ */
+int acoral_thread_set_affinity(int thread_id, int affinity);
 
 /**
  * @brief aCoral挂起当前线程API
@@ -173,6 +296,13 @@ void acoral_resume_thread_by_id(int thread_id);
  */
 void acoral_delay_self(unsigned int time);
 
+/**
+ * @brief aCoral当前线程微秒延时API，不按tick取整，精度见acoral_hrtimer_start
+ *
+ * @param time 延时时间（微秒），0直接返回
+ */
+void acoral_delay_us(unsigned int time);
+
 /**
  * @brief aCoral杀死线程API
  * 
@@ -211,6 +341,39 @@ void acoral_thread_change_prio_by_id(unsigned int thread_id, unsigned int prio);
 void system_set_running_thread(acoral_thread_t *thread);
 void acoral_thread_runqueue_init(void);
 
+/**
+ * @brief 初始化一个优先级队列
+ * 
+ * @param array 优先级队列
+ */
+void acoral_prio_queue_init(acoral_rdy_queue_t *array);
+
+/**
+ * @brief 把链表节点挂到优先级队列prio对应的队尾，并置位两级位图
+ * 
+ * @param array 优先级队列
+ * @param prio 优先级
+ * @param list 要挂载的节点
+ */
+void acoral_prio_queue_add(acoral_rdy_queue_t *array, unsigned int prio, acoral_list_t *list);
+
+/**
+ * @brief 把链表节点从优先级队列中取下，该优先级空了就清除两级位图中对应的位
+ * 
+ * @param array 优先级队列
+ * @param prio 优先级
+ * @param list 要取下的节点
+ */
+void acoral_prio_queue_del(acoral_rdy_queue_t *array, unsigned int prio, acoral_list_t *list);
+
+/**
+ * @brief 常数时间找出优先级队列中就绪的最高优先级（数值最小），先查一级位图再查二级位图
+ * 
+ * @param array 优先级队列，不能为空
+ * @return unsigned int 最高优先级
+ */
+unsigned int acoral_get_highprio(acoral_rdy_queue_t *array);
+
 /**
  * @brief 将某个线程挂载到就绪队列上
  * 
@@ -227,7 +390,14 @@ void acoral_rdyqueue_del(acoral_thread_t *old);
 
 
 /**
- * @brief 从就绪队列中选出优先级最高的线程
+ * @brief 让某个核重新调度，如果不是本核，发核间中断通知它
+ * 
+ * @param cpu 核号
+ */
+void acoral_cpu_need_sched(int cpu);
+
+/**
+ * @brief 从本核就绪队列中选出优先级最高的线程，本核只剩idle线程时先尝试从别的核偷一个
  * 
  * @return acoral_thread_t* 优先级最高的线程
  */
@@ -237,6 +407,13 @@ void acoral_sched(void);
 void acoral_real_sched();
 unsigned long acoral_real_intr_sched(unsigned long old_sp);
 
+/**
+ * @brief 核间中断服务函数，别的核往本核的就绪队列上挂了更高优先级的线程，本核在中断退出时调度
+ * 
+ * @param args 无意义
+ */
+void acoral_ipi_entry(void *args);
+
 
 #endif
 
@@ -0,0 +1,92 @@
+/**
+ * @file trace.h
+ * @brief kernel层，调度事件跟踪头文件
+ * @version 1.0
+ * @date 2024-06-10
+ * @copyright Copyright (c) 2024
+ */
+#ifndef ACORAL_TRACE_H
+#define ACORAL_TRACE_H
+
+#include "autocfg.h"
+
+/**
+ * @brief 跟踪事件类型
+ *
+ */
+typedef enum{
+	ACORAL_TRACE_SWITCH = 1,	///<线程切换，id是新线程，arg是旧线程
+	ACORAL_TRACE_WAKEUP,		///<线程挂上就绪队列，id是线程，arg是目标核
+	ACORAL_TRACE_BLOCK,			///<线程离开就绪队列，id是线程，arg是离开时的状态
+	ACORAL_TRACE_IRQ_ENTER,		///<进入中断服务，id是被打断的线程，arg是向量号
+	ACORAL_TRACE_IRQ_EXIT,		///<中断服务结束，id是被打断的线程，arg是向量号
+	ACORAL_TRACE_TIMER,			///<延时或超时到期，id是被唤醒的线程，arg为0是延时，1是ipc超时
+	ACORAL_TRACE_IPC_POST,		///<释放信号量/互斥量、发送消息，id是当前线程，arg是ipc对象的资源id
+	ACORAL_TRACE_IPC_PEND,		///<申请信号量/互斥量、接收消息，id是当前线程，arg是ipc对象的资源id
+	ACORAL_TRACE_TYPE_NUM
+}acoralTraceTypeEnum;
+
+#define ACORAL_TRACE_VEC_TICK (-1)	///<IRQ事件里ticks中断的向量号
+#define ACORAL_TRACE_VEC_IPI (-2)	///<IRQ事件里核间中断的向量号
+#define ACORAL_TRACE_VEC_HRTIMER (-3)	///<IRQ事件里高精度定时器中断的向量号
+
+/**
+ * @brief 一条跟踪记录
+ *
+ */
+typedef struct{
+	unsigned long long cycles;	///<HAL_GET_CYCLES时间戳
+	unsigned int type;			///<事件类型，acoralTraceTypeEnum
+	int id;						///<线程id，没有当前线程时为-1
+	int arg;					///<附加参数，见acoralTraceTypeEnum
+}acoral_trace_rec_t;
+
+#if CFG_TRACE
+
+#if (CFG_TRACE_ENTRIES & (CFG_TRACE_ENTRIES - 1)) != 0
+#error "CFG_TRACE_ENTRIES must be a power of 2"
+#endif
+
+/**
+ * @brief 每个核一个跟踪环，只有本核（线程和中断）往里写，写满了覆盖最老的记录
+ *
+ */
+typedef struct{
+	unsigned int head;			///<写过的记录总数，取模后就是下一个写的位置
+	acoral_trace_rec_t recs[CFG_TRACE_ENTRIES];
+}acoral_trace_ring_t;
+
+extern acoral_trace_ring_t acoral_trace_rings[CFG_MAX_CPU];
+
+/// 跟踪开关，关掉之后acoral_trace直接返回
+extern volatile unsigned char acoral_trace_enabled;
+
+/**
+ * @brief 记一条跟踪事件，不拿锁：本核的线程和嵌套进来的中断用原子加各自占一个槽
+ * @note 热路径上调用，可以在临界区和中断里调用
+ *
+ * @param type 事件类型
+ * @param id 线程id
+ * @param arg 附加参数
+ */
+void acoral_trace(unsigned int type, int id, int arg);
+
+/**
+ * @brief 清空所有核的跟踪环，重新记下时间基准
+ *
+ */
+void acoral_trace_clear(void);
+
+/**
+ * @brief 停止跟踪并以文本形式打印所有核的跟踪环，用tools/trace2json.py转成Chrome/Perfetto的JSON
+ * @note 打印完之后恢复原来的跟踪开关
+ *
+ */
+void acoral_trace_dump(void);
+
+#define ACORAL_TRACE(type, id, arg) acoral_trace(type, id, arg)
+#else
+#define ACORAL_TRACE(type, id, arg)
+#endif
+
+#endif
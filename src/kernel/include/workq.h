@@ -0,0 +1,131 @@
+/**
+ * @file workq.h
+ * @brief kernel层，工作队列头文件：把短小的活交给固定的几个工作线程去做，不用每次都创建线程
+ * @version 1.0
+ * @date 2024-06-24
+ * @copyright Copyright (c) 2024
+ */
+#ifndef ACORAL_WORKQ_H
+#define ACORAL_WORKQ_H
+
+#include "autocfg.h"
+#include "list.h"
+#include "thread.h"
+
+#if CFG_WORKQ
+
+#define WORKQ_STACK_SIZE (4096) ///<工作线程的栈，活都在上面跑，放不下就调大
+
+/**
+ * @brief 工作队列的优先级档，每档有CFG_WORKQ_WORKERS个工作线程
+ *
+ */
+typedef enum{
+	ACORAL_WORKQ_HIGH,	///<优先级CFG_WORKQ_PRIO_HIGH，给要尽快做完的活，比如中断的下半部
+	ACORAL_WORKQ_LOW,	///<优先级CFG_WORKQ_PRIO_LOW，给后台的活
+	ACORAL_WORKQ_BANDS
+}acoralWorkqBandEnum;
+
+/**
+ * @brief 工作项的状态
+ *
+ */
+typedef enum{
+	ACORAL_WORK_IDLE,		///<不在任何队列上
+	ACORAL_WORK_PENDING,	///<在待处理队列上，等工作线程来取
+	ACORAL_WORK_DELAYED,	///<定时器在时间轮上，到期后挂到待处理队列
+	ACORAL_WORK_RUNNING		///<工作线程正在执行，执行期间可以再提交
+}acoralWorkStateEnum;
+
+/**
+ * @brief 工作项，由使用者分配（静态的或者嵌在自己的结构体里），初始化一次之后可以反复提交
+ *
+ */
+typedef struct{
+	acoral_list_t hook;				///<挂到待处理队列
+	void (*fn)(void *arg);			///<要做的活，在工作线程里执行
+	void *arg;						///<fn的参数
+	acoral_timer_t timer;			///<延时提交用的定时器
+	unsigned char band;				///<提交到哪一档，acoralWorkqBandEnum
+	volatile unsigned char state;	///<acoralWorkStateEnum
+	unsigned char pooled;			///<是acoral_workq_submit从内部池里拿的，做完自动还回去
+}acoral_work_t;
+
+/**
+ * @brief 一档工作队列的统计
+ *
+ */
+typedef struct{
+	unsigned int submitted;		///<提交了多少次（延时的到期时算）
+	unsigned int done;			///<做完了多少次
+	unsigned int pending;		///<现在待处理队列上有几项
+	unsigned int max_pending;	///<待处理队列最长的时候有几项
+	unsigned int pool_fails;	///<acoral_workq_submit因为内部池空了而失败的次数
+}acoral_workq_stat_t;
+
+/**
+ * @brief 初始化工作项
+ *
+ * @param work 工作项
+ * @param fn 要做的活
+ * @param arg fn的参数
+ * @param band 提交到哪一档，acoralWorkqBandEnum
+ */
+void acoral_work_init(acoral_work_t *work, void (*fn)(void *arg), void *arg, int band);
+
+/**
+ * @brief 提交工作项，马上唤醒一个空闲的工作线程
+ * @note 可以在线程和中断里调用；已经在队列上的不会重复提交，正在执行的可以再提交
+ *
+ * @param work 工作项
+ * @return int 0：提交了；-1：已经提交或者延时提交了，还没开始执行
+ */
+int acoral_work_submit(acoral_work_t *work);
+
+/**
+ * @brief 延时提交工作项，由ticks驱动，到期后再放到待处理队列上
+ * @note 可以在线程和中断里调用
+ *
+ * @param work 工作项
+ * @param time_mm 延时毫秒数，0相当于acoral_work_submit，不满一个tick的按一个tick算
+ * @return int 0：提交了；-1：已经提交或者延时提交了，还没开始执行
+ */
+int acoral_work_submit_delayed(acoral_work_t *work, unsigned int time_mm);
+
+/**
+ * @brief 取消已经提交或者延时提交的工作项
+ * @note 正在执行的取消不了，要等fn返回
+ *
+ * @param work 工作项
+ * @return int 0：取消了；-1：没有提交
+ */
+int acoral_work_cancel(acoral_work_t *work);
+
+/**
+ * @brief 提交一个一次性的活，工作项从内部池里拿，做完自动还回去，不用自己分配
+ * @note 可以在线程和中断里调用
+ *
+ * @param band 提交到哪一档，acoralWorkqBandEnum
+ * @param fn 要做的活
+ * @param arg fn的参数
+ * @return int 0：提交了；-1：内部池里的CFG_WORKQ_ITEMS项都在用
+ */
+int acoral_workq_submit(int band, void (*fn)(void *arg), void *arg);
+
+/**
+ * @brief 得到一档工作队列的统计
+ *
+ * @param band 哪一档
+ * @param stat 统计结果
+ */
+void acoral_workq_get_stat(int band, acoral_workq_stat_t *stat);
+
+/**
+ * @brief 初始化工作队列，创建各档的工作线程
+ *
+ */
+void system_workq_init(void);
+
+#endif
+
+#endif
@@ -16,7 +16,6 @@
 #include "hal.h"
 #include "thread.h"
 #include "int.h"
-#include "plic.h"
 #include <stdio.h>
 
 void system_intr_module_init()
@@ -26,22 +25,21 @@ void system_intr_module_init()
 }
 
 int acoral_intr_attach(int vector,void (*isr)(int)){
-	plic_irq_register(vector,isr,NULL);
-	return 0;
+	return HAL_INTR_ATTACH(vector,isr);
 }
 
 int acoral_intr_detach(int vector){
-	plic_irq_deregister(vector);
-	plic_irq_register(vector,acoral_default_isr,NULL);
+	HAL_INTR_DETACH(vector);
+	HAL_INTR_ATTACH(vector,acoral_default_isr);
 	return 0;
 }
 
 int acoral_intr_unmask(int vector){
-	return plic_irq_enable(vector);
+	return HAL_INTR_UNMASK(vector);
 }
 
 int acoral_intr_mask(int vector){
-	return plic_irq_disable(vector);
+	return HAL_INTR_MASK(vector);
 }
 
 void acoral_default_isr(int vector){
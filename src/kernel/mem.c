@@ -73,17 +73,52 @@ void buddy_scan()
 	printf("\r\n");
 }
 
+/**
+ * @brief 在某层位图中标记一个空闲块（其余层是标记一对伙伴中有一块空闲）
+ *
+ * @param level 层数，起始为0
+ * @param index 块（其余层是伙伴对）在位图中的位置
+ */
+static void level_set_free(int level, unsigned int index)
+{
+	int cur = index / 32;
+	acoral_set_bit_in_bitmap(index, acoral_mem_ctrl->bitmap[level]);
+	if (acoral_mem_ctrl->free_cur[level] < 0 || cur < acoral_mem_ctrl->free_cur[level])
+		acoral_mem_ctrl->free_cur[level] = cur;
+}
+
+/**
+ * @brief 找某层第一个有空闲块的32位图，free_cur只是下界，从它开始往后找
+ *
+ * @param level 层数，起始为0
+ * @return int 32位图的位置，-1表示这层没有空闲块
+ */
+static int level_first_free(int level)
+{
+	int cur = acoral_mem_ctrl->free_cur[level];
+	if (cur < 0)
+		return -1;
+	for (; cur < acoral_mem_ctrl->num[level]; cur++)
+	{
+		if (acoral_mem_ctrl->bitmap[level][cur])
+		{
+			acoral_mem_ctrl->free_cur[level] = cur;
+			return cur;
+		}
+	}
+	acoral_mem_ctrl->free_cur[level] = -1;
+	return -1;
+}
+
 unsigned int buddy_init(unsigned int start_adr, unsigned int end_adr)
 {
 	int i, k;
 	unsigned int resize_size;
 	unsigned int save_adr;
-	unsigned int index;
 	unsigned int num = 1;
 	unsigned int adjust_level = 1;
 	int level = 0;
-	unsigned int max_num, o_num;
-	unsigned int cur;
+	unsigned int top_num, o_num;
 	start_adr += 3;
 	start_adr &= ~(4 - 1); // 首地址四字节对齐
 	end_adr &= ~(4 - 1);   // 尾地址四字节对齐
@@ -109,6 +144,8 @@ unsigned int buddy_init(unsigned int start_adr, unsigned int end_adr)
 		adjust_level++;
 	}
 	acoral_mem_blocks = (acoral_block_t *)end_adr - num;
+	for (k = 0; k < num; k++)
+		acoral_mem_blocks[k].level = -1; // 所有基本内存块都没有分配，也不是空闲块的首块
 	save_adr = (unsigned int)acoral_mem_blocks;
 	level = adjust_level; // 实际层数
 	// 如果层数较小，则最大层用一块构成，如果层数较多，限制层数范围，最大层由多块构成
@@ -127,14 +164,8 @@ unsigned int buddy_init(unsigned int start_adr, unsigned int end_adr)
 		save_adr &= ~(4 - 1);								   // 四字节对齐
 		acoral_mem_ctrl->bitmap[i] = (unsigned int *)save_adr; // 当层bitmap地址
 		acoral_mem_ctrl->num[i] = num;
-		save_adr -= num * 4;							 // 每一个32位位图为4个字节
-		save_adr &= ~(4 - 1);							 // 四字节对齐
-		acoral_mem_ctrl->free_list[i] = (int *)save_adr; // 当层free_list地址
 		for (k = 0; k < num; k++)
-		{
-			acoral_mem_ctrl->bitmap[i][k] = 0;	   // 初始化当层bitmap
-			acoral_mem_ctrl->free_list[i][k] = -1; // 初始化当层free_list
-		}
+			acoral_mem_ctrl->bitmap[i][k] = 0; // 初始化当层bitmap
 		acoral_mem_ctrl->free_cur[i] = -1; // 初始化当层free_cur
 	}
 
@@ -147,23 +178,10 @@ unsigned int buddy_init(unsigned int start_adr, unsigned int end_adr)
 	save_adr &= ~(4 - 1);
 	acoral_mem_ctrl->bitmap[i] = (unsigned int *)save_adr;
 	acoral_mem_ctrl->num[i] = num;
-	save_adr -= num * 4;
-	save_adr &= ~(4 - 1);
-	acoral_mem_ctrl->free_list[i] = (int *)save_adr;
 	for (k = 0; k < num; k++)
-	{
 		acoral_mem_ctrl->bitmap[i][k] = 0;
-		;
-		acoral_mem_ctrl->free_list[i][k] = -1;
-	}
 	acoral_mem_ctrl->free_cur[i] = -1;
 
-	// 如果剩余内存大小不够形成现在的level
-	if (save_adr <= (start_adr + (resize_size >> 1)))
-		adjust_level--;
-	if (adjust_level > LEVEL)
-		level = LEVEL;
-
 	////初始化内存控制块
 	acoral_mem_ctrl->level = level;
 	acoral_mem_ctrl->start_adr = start_adr;
@@ -173,68 +191,26 @@ unsigned int buddy_init(unsigned int start_adr, unsigned int end_adr)
 	acoral_mem_ctrl->free_num = num;
 	acoral_mem_ctrl->block_size = BASIC_BLOCK_SIZE;
 
-	i = 0;
-	max_num = (1 << level) - 1; // 最大内存块层的每块内存大小
-	o_num = 0;
-
-	if (num > 0)
-	{ // 有内存块，则最大内存块层的free_cur为0
-		acoral_mem_ctrl->free_cur[level - 1] = 0;
-	}
-	else
-	{ // 无内存块，则最大内存块层的free_cur为-1
-		acoral_mem_ctrl->free_cur[level - 1] = -1;
-	}
+	////整块内存优先分给最大内存块层，一块一位
+	top_num = 1 << (level - 1); // 最大内存块层每块的基本内存块数
+	for (o_num = 0; o_num + top_num <= num; o_num += top_num)
+		level_set_free(level - 1, o_num >> (level - 1));
 
-	////整块内存优先分给最大内存块层
-	// 计算当前可分配内存容量是否能直接形成一个最大内存块层的32位图
-	while (num >= max_num * 32)
+	// 剩下不够一个最大块的，从大到小分给其余层。每块都是一对伙伴的前一半，后一半超出了内存，永远不会空闲，所以不会被合并
+	for (i = level - 2; i >= 0; i--)
 	{
-		acoral_mem_ctrl->bitmap[level - 1][i] = -1;
-		;
-		acoral_mem_ctrl->free_list[level - 1][i] = i + 1;
-		num -= max_num * 32;
-		o_num += max_num * 32;
-		i++;
-	}
-	if (num == 0)
-	{ // 所有块正好分配到最大内存块层的32位图
-		acoral_mem_ctrl->free_list[level - 1][i - 1] = -1;
-	}
-
-	// 计算当前可分配内存是否还能形成最大内存块层的一块
-	while (num >= max_num)
-	{
-		index = (o_num >> level) - 1;
-		acoral_set_bit_in_bitmap(index, acoral_mem_ctrl->bitmap[level - 1]);
-		num -= max_num;
-		o_num += max_num;
-	}
-	acoral_mem_ctrl->free_list[level - 1][i] = -1;
-
-	// 接下来的每层初始化
-	while (--level > 0)
-	{
-		index = o_num >> level;
-		if (num == 0)
-			break;
-		cur = index / 32;
-		max_num = (1 << level) - 1; // 每层的内存块大小
-		if (num >= max_num)
+		if (num - o_num >= (1u << i))
 		{
-			acoral_mem_blocks[BLOCK_INDEX(o_num)].level = -1;
-			acoral_set_bit_in_bitmap(index, acoral_mem_ctrl->bitmap[level - 1]);
-			acoral_mem_ctrl->free_list[level - 1][cur] = -1;
-			acoral_mem_ctrl->free_cur[level - 1] = cur;
-			o_num += max_num;
-			num -= max_num;
+			level_set_free(i, o_num >> (i + 1));
+			acoral_mem_blocks[BLOCK_INDEX(o_num)].level = BUDDY_FREE_MARK(i);
+			o_num += 1 << i;
 		}
 	}
 	return 0;
 }
 
 /**
- * @brief 迭代获取空闲块的首num
+ * @brief 迭代获取空闲块的首num，不够就拆上一层的块
  *
  * @param level 要获取的层数，起始为0
  * @return int 空闲块的首num
@@ -246,44 +222,29 @@ static int recus_malloc(int level)
 	int num;
 	if (level >= acoral_mem_ctrl->level) // 层数超出范围
 		return -1;
-	cur = acoral_mem_ctrl->free_cur[level]; // 获取首个空闲位图
-	if (cur < 0)							// 无空闲
+	cur = level_first_free(level); // 获取首个有空闲块的位图
+	if (cur < 0)				   // 无空闲
 	{
 		num = recus_malloc(level + 1); // 迭代向上寻找
 		if (num < 0)
 			return -1;
-		index = num >> level + 1;							   // 计算在位图中位置
-		cur = index / 32;									   // 计算在位图链表中位置
-		acoral_set_bit_in_bitmap(index, acoral_mem_ctrl->bitmap[level]); // 在位图中置1，把偶数块分出去
-		// 当前层无空闲，两个空闲块是从上层分配的，所以空闲位图链表更改，然后分配完一块还有一块，所以移动空闲位图链表头
-		acoral_mem_ctrl->free_list[level][cur] = -1;
-		acoral_mem_ctrl->free_cur[level] = cur;
+		// 上一层的块拆成两块，前一块分出去，后一块空闲
+		level_set_free(level, num >> (level + 1));
+		if (level > 0)
+			acoral_mem_blocks[BLOCK_INDEX(num + (1 << level))].level = BUDDY_FREE_MARK(level);
 		return num;
 	}
 	index = acoral_find_first_bit_in_integer(acoral_mem_ctrl->bitmap[level][cur], 1); // 获取空闲块在其32位图中的位置
 	index = cur * 32 + index;								 // 计算空闲块实际位置
-	acoral_clear_bit_in_bitmap(index, acoral_mem_ctrl->bitmap[level]); // 从只有一块空闲变成两块都不空闲了，所以清0
-	if (acoral_mem_ctrl->bitmap[level][cur] == 0)			 // 如果此位图无空闲块了
-	{
-		acoral_mem_ctrl->free_cur[level] = acoral_mem_ctrl->free_list[level][cur]; // 移动空闲位图链表头
-	}
-	num = index << level + 1; // 计算空闲块首个num
+	acoral_clear_bit_in_bitmap(index, acoral_mem_ctrl->bitmap[level]); // 最大层是这块不空闲了，其余层是两块都不空闲了
 	/*最高level情况*/
 	if (level == acoral_mem_ctrl->level - 1) // 最大内存块层
-	{
-		if ((num >> 1) + (1 << level) > acoral_mem_ctrl->block_num)
-			return -1;
-		return num >> 1;
-	}
-	// 其余层
-	if (acoral_mem_blocks[BLOCK_INDEX(num)].level >= 0) // 检查这块内存有没有被分配
-	{
-		return num + (1 << level);
-	} // 如果此块已经被分配，那就是后面一块为空闲块
-	else
-	{
-		return num;
-	}
+		return index << level;
+	// 其余层，前一块不是这一层的空闲块（已分配或者被拆开了），空闲的就是后一块
+	num = index << (level + 1);
+	if (acoral_mem_blocks[BLOCK_INDEX(num)].level != BUDDY_FREE_MARK(level))
+		num += 1 << level;
+	return num;
 }
 
 /**
@@ -294,56 +255,17 @@ static int recus_malloc(int level)
  */
 static void *r_malloc(unsigned char level)
 {
-	unsigned int index;
-	int num, cur;
+	int num;
 	acoral_enter_critical();
-	acoral_mem_ctrl->free_num -= 1 << level; // 提前减去即将分配的基本内存块数
-	cur = acoral_mem_ctrl->free_cur[level];
-	if (cur < 0)
+	num = recus_malloc(level);
+	if (num < 0)
 	{
-		num = recus_malloc(level + 1);
-		if (num < 0)
-		{
-			acoral_exit_critical();
-			return NULL;
-		}
-		index = num >> level + 1;
-		cur = index / 32;
-		acoral_set_bit_in_bitmap(index, acoral_mem_ctrl->bitmap[level]);
-		acoral_mem_ctrl->free_list[level][cur] = -1;
-		acoral_mem_ctrl->free_cur[level] = cur;
-		if ((num & 0x1) == 0)
-			acoral_mem_blocks[BLOCK_INDEX(num)].level = level;
-#ifdef CFG_TEST_MEM
-		buddy_scan();
-#endif
 		acoral_exit_critical();
-		return (void *)(acoral_mem_ctrl->start_adr + (num << BLOCK_SHIFT));
-	}
-	index = acoral_find_first_bit_in_integer(acoral_mem_ctrl->bitmap[level][cur],1);
-	index = index + cur * 32;
-	acoral_clear_bit_in_bitmap(index, acoral_mem_ctrl->bitmap[level]);
-	if (acoral_mem_ctrl->bitmap[level][cur] == 0)
-	{
-		acoral_mem_ctrl->free_cur[level] = acoral_mem_ctrl->free_list[level][cur];
-	}
-	if (level == acoral_mem_ctrl->level - 1)
-	{
-		num = index << level;
-		if (num + (1 << level) > acoral_mem_ctrl->block_num)
-		{
-			acoral_exit_critical();
-			return NULL;
-		}
-	}
-	else
-	{
-		num = index << level + 1;
-		if (acoral_mem_blocks[BLOCK_INDEX(num)].level >= 0)
-			num += (1 << level);
+		return NULL;
 	}
+	acoral_mem_ctrl->free_num -= 1 << level;
 	if ((num & 0x1) == 0)
-		acoral_mem_blocks[BLOCK_INDEX(num)].level = level;
+		acoral_mem_blocks[BLOCK_INDEX(num)].level = level; // 奇数基本内存块一定是0层的，不用记
 #ifdef CFG_TEST_MEM
 	buddy_scan();
 #endif
@@ -391,11 +313,11 @@ void *buddy_malloc(unsigned int size)
 
 void buddy_free(void *ptr)
 {
-	unsigned char level;
-	unsigned char buddy_level;
-	int cur;
+	signed char level;
+	signed char buddy_level;
 	unsigned int index;
 	unsigned int num;
+	unsigned int buddy;
 	unsigned int max_level;
 	unsigned int adr;
 	adr = (unsigned int)ptr;
@@ -422,26 +344,21 @@ void buddy_free(void *ptr)
 	if (num & 0x1) // 奇数基本内存块
 	{
 		level = 0; // 奇数基本内存块一定是从0层分配
-		// 下面是地址检查
+		// 下面是地址检查，奇数块没有自己的记录，看偶数伙伴的
 		index = num >> 1;
 		buddy_level = acoral_mem_blocks[BLOCK_INDEX(num)].level;
 
-		// 不是从0层，直接返回错误
+		// 伙伴是更大的块的首块，这个地址在那个块中间
 		if (buddy_level > 0)
 		{
 			printf("Invalid Free Address:0x%x\n", (unsigned int)ptr);
 			acoral_exit_critical();
 			return;
 		}
-		/*伙伴分配出去，如果对应的位为1,肯定是回收过一次了*/
-		if (buddy_level == 0 && acoral_get_bit_in_bitmap(index, acoral_mem_ctrl->bitmap[level]))
-		{
-			printf("Address:0x%x have been freed\n", (unsigned int)ptr);
-			acoral_exit_critical();
-			return;
-		}
-		/*伙伴没有分配出去了，如果对应的位为0,肯定是回收过一次了*/
-		if (buddy_level < 0 && !acoral_get_bit_in_bitmap(index, acoral_mem_ctrl->bitmap[level]))
+		/*伙伴分配出去了，对应的位为1说明空闲的是自己；伙伴空闲，对应的位为0说明两块都空闲了。都是回收过一次了*/
+		if ((buddy_level == 0 && acoral_get_bit_in_bitmap(index, acoral_mem_ctrl->bitmap[level])) ||
+			(buddy_level == BUDDY_FREE_MARK(0) && !acoral_get_bit_in_bitmap(index, acoral_mem_ctrl->bitmap[level])) ||
+			(buddy_level != 0 && buddy_level != BUDDY_FREE_MARK(0)))
 		{
 			printf("Address:0x%x have been freed\n", (unsigned)ptr);
 			acoral_exit_critical();
@@ -458,38 +375,30 @@ void buddy_free(void *ptr)
 			acoral_exit_critical();
 			return;
 		}
-		acoral_mem_ctrl->free_num += 1 << level;		// 空闲基本块数增加
 		acoral_mem_blocks[BLOCK_INDEX(num)].level = -1; // 标志此基本块未被分配
 	}
-	if (level == max_level - 1) // 最大内存块直接回收
-	{
-		index = num >> level;								   // 最大内存块层，一块一位
-		acoral_set_bit_in_bitmap(index, acoral_mem_ctrl->bitmap[level]); // 标志空闲
-		acoral_exit_critical();
-		return;
-	}
-	index = (num >> 1) + level; // 其余层，两块一位
-	while (level < max_level)	// 其余层回收，有可能回收到最大层
+	acoral_mem_ctrl->free_num += 1 << level; // 空闲基本块数增加
+
+	while (level < max_level - 1) // 其余层回收，有可能回收到最大层
 	{
-		cur = index / 32;
-		if (!acoral_get_bit_in_bitmap(index, acoral_mem_ctrl->bitmap[level])) // 两块都没空闲
+		index = num >> (level + 1); // 两块一位，和分配时的位置算法一致
+		if (!acoral_get_bit_in_bitmap(index, acoral_mem_ctrl->bitmap[level])) // 伙伴不空闲
 		{
-			acoral_set_bit_in_bitmap(index, acoral_mem_ctrl->bitmap[level]);								// 设置成有一块空闲
-			if (acoral_mem_ctrl->free_cur[level] < 0 || cur < acoral_mem_ctrl->free_cur[level]) // 无空闲块或者释放的位比空闲位图链表头小
-			{
-				acoral_mem_ctrl->free_list[level][cur] = acoral_mem_ctrl->free_cur[level];
-				acoral_mem_ctrl->free_cur[level] = cur;
-			}
+			level_set_free(level, index); // 设置成有一块空闲
+			if (level > 0 || (num & 0x1) == 0)
+				acoral_mem_blocks[BLOCK_INDEX(num)].level = BUDDY_FREE_MARK(level);
 			break;
 		}
-		/*有个伙伴是空闲的，向上级回收*/
+		/*伙伴是空闲的，合并成上一层的一块，继续向上级回收*/
 		acoral_clear_bit_in_bitmap(index, acoral_mem_ctrl->bitmap[level]);
-		if (cur == acoral_mem_ctrl->free_cur[level])
-			acoral_mem_ctrl->free_cur[level] = acoral_mem_ctrl->free_list[level][cur];
+		buddy = num ^ (1 << level);
+		if (level > 0 || (buddy & 0x1) == 0)
+			acoral_mem_blocks[BLOCK_INDEX(buddy)].level = -1;
+		num &= ~(1 << level);
 		level++;
-		if (level < max_level - 1)
-			index = index >> 1;
 	}
+	if (level == max_level - 1) // 最大内存块直接回收，一块一位
+		level_set_free(level, num >> level);
 	acoral_exit_critical();
 #ifdef CFG_TEST_MEM
 	buddy_scan();
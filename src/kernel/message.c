@@ -20,17 +20,16 @@
 #include "soft_timer.h"
 #include "message.h"
 #include "resource.h"
+#include "trace.h"
 
 #include <stdio.h>
 
-void acoral_msgctr_queue_add(acoral_msgctr_t *msgctr,
-							 acoral_thread_t *thread)
-{ /*需按优先级排序*/
-	/*acoral_list_add2_tail (&thread->ipc_waiting_hook, &msgctr->waiting);*/
-	acoral_list_t *p, *q;
+/* 按优先级挂到等待队列上，同优先级的先来先醒 */
+static void msgctr_wait_add(acoral_list_t *p, acoral_thread_t *thread)
+{
+	acoral_list_t *q;
 	acoral_thread_t *ptd;
 
-	p = &msgctr->waiting;
 	q = p->next;
 	for (; p != q; q = q->next)
 	{
@@ -41,9 +40,17 @@ void acoral_msgctr_queue_add(acoral_msgctr_t *msgctr,
 	acoral_list_add(&thread->ipc_waiting_hook, q->prev);
 }
 
-acoral_msgctr_t *acoral_msgctr_create()
+/* 挂到thread->msg_id所在桶的等待队列上 */
+void acoral_msgctr_queue_add(acoral_msgctr_t *msgctr,
+							 acoral_thread_t *thread)
+{ /*需按优先级排序*/
+	msgctr_wait_add(&msgctr->buckets[ACORAL_MSGCTR_BUCKET(thread->msg_id)].waiting, thread);
+}
+
+acoral_msgctr_t *acoral_msgctr_create(unsigned int capacity)
 {
 	acoral_msgctr_t *msgctr;
+	int i;
 
 	msgctr = (acoral_msgctr_t *)acoral_get_res(ACORAL_RES_MST);
 
@@ -52,15 +59,234 @@ acoral_msgctr_t *acoral_msgctr_create()
 
 	msgctr->name = NULL;
 	msgctr->count = 0;
+	msgctr->capacity = capacity ? capacity : ACORAL_MESSAGE_MAX_COUNT;
 	msgctr->wait_thread_num = 0;
+	acoral_init_list(&msgctr->send_waiting);
 
 	acoral_init_list(&msgctr->msgctr_list);
-	acoral_init_list(&msgctr->msglist);
-	acoral_init_list(&msgctr->waiting);
+	for (i = 0; i < ACORAL_MSGCTR_HASH; i++)
+	{
+		acoral_init_list(&msgctr->buckets[i].msgs);
+		acoral_init_list(&msgctr->buckets[i].waiting);
+	}
+	acoral_init_list(&msgctr->ttl_list);
+	acoral_init_list(&msgctr->ttl_timer.delay_queue_hook);
+	msgctr->expire = NULL;
+	msgctr->expired = 0;
 
 	return msgctr;
 }
 
+void acoral_msgctr_set_expire(acoral_msgctr_t *msgctr, void (*expire)(acoral_msgctr_t *msgctr, unsigned int id, void *data))
+{
+	acoral_enter_critical();
+	msgctr->expire = expire;
+	acoral_exit_critical();
+}
+
+/* 在桶里找这个id最早的那条消息，桶里每个id只挂一条，所以只和散列到同一个桶的其它id比。在临界区里调用 */
+static acoral_msg_t *msgctr_find(acoral_msgctr_t *msgctr, unsigned int id)
+{
+	acoral_list_t *p, *q;
+	acoral_msg_t *pmsg;
+
+	p = &msgctr->buckets[ACORAL_MSGCTR_BUCKET(id)].msgs;
+	for (q = p->next; p != q; q = q->next)
+	{
+		pmsg = list_entry(q, acoral_msg_t, hash_hook);
+		if (pmsg->id == id)
+			return pmsg;
+	}
+	return NULL;
+}
+
+/* 挂到这个id的消息环的末尾，是这个id的第一条就挂到桶上。在临界区里调用 */
+static void msgctr_enqueue(acoral_msgctr_t *msgctr, acoral_msg_t *msg)
+{
+	acoral_msg_t *first = msgctr_find(msgctr, msg->id);
+
+	if (first != NULL)
+		acoral_list_add2_tail(&msg->msglist, &first->msglist);
+	else
+		acoral_list_add2_tail(&msg->hash_hook, &msgctr->buckets[ACORAL_MSGCTR_BUCKET(msg->id)].msgs);
+}
+
+/* 取下这个id最早的那条消息，下一条顶替它挂到桶上。在临界区里调用 */
+static void msgctr_dequeue(acoral_msg_t *msg)
+{
+	acoral_msg_t *next;
+
+	if (msg->msglist.next != &msg->msglist)
+	{
+		next = list_entry(msg->msglist.next, acoral_msg_t, msglist);
+		acoral_list_add(&next->hash_hook, &msg->hash_hook);
+		acoral_list_del(&msg->msglist);
+	}
+	acoral_list_del(&msg->hash_hook);
+}
+
+/* 从容器上取下任意一条消息：是这个id最早的那条就让下一条顶替，否则直接从消息环上摘掉。在临界区里调用 */
+static void msgctr_unlink(acoral_msg_t *msg)
+{
+	if (acoral_list_empty(&msg->hash_hook))
+		acoral_list_del(&msg->msglist);
+	else
+		msgctr_dequeue(msg);
+}
+
+/* 唤醒等这个id的线程里优先级最高的n个，等别的id的不动。在临界区里调用 */
+static void msgctr_wake_id(acoral_msgctr_t *msgctr, unsigned int id, unsigned int n)
+{
+	acoral_list_t *p, *q, *next;
+	acoral_thread_t *thread;
+
+	p = &msgctr->buckets[ACORAL_MSGCTR_BUCKET(id)].waiting;
+	for (q = p->next; p != q && n > 0; q = next)
+	{
+		next = q->next;
+		thread = list_entry(q, acoral_thread_t, ipc_waiting_hook);
+		if (thread->msg_id == id)
+		{
+			acoral_list_del(&thread->ipc_waiting_hook);
+			msgctr->wait_thread_num--;
+			ready_thread(thread);
+			n--;
+		}
+	}
+}
+
+/* 池头、缓冲区头和每块的跨度都按8字节对齐，交出去的数据可以放任何类型 */
+#define MSGBUF_ALIGN(size) (((size) + 7) & ~7u)
+#define MSGBUF_HDR_SIZE MSGBUF_ALIGN(sizeof(acoral_msgbuf_t))
+#define MSGBUF_STRIDE(size) (MSGBUF_HDR_SIZE + MSGBUF_ALIGN(size))
+#define MSGBUF_HDR(buf) ((acoral_msgbuf_t *)((char *)(buf) - MSGBUF_HDR_SIZE))
+
+/* 放掉缓冲区的n个引用。在临界区里调用 */
+static void msgbuf_put_n(void *buf, unsigned int n)
+{
+	acoral_msgbuf_t *hdr = MSGBUF_HDR(buf);
+
+	hdr->ref -= n;
+	if (hdr->ref == 0)
+	{
+		acoral_list_add2_tail(&hdr->free_hook, &hdr->pool->free);
+		hdr->pool->free_num++;
+	}
+}
+
+/* 释放消息结构，带缓冲区的先放掉还没被收走的引用。在临界区里调用 */
+static void msg_release(acoral_msg_t *msg)
+{
+	if (msg->buf && msg->count > 0)
+		msgbuf_put_n(msg->data, msg->count);
+	acoral_release_res((acoral_res_t *)msg);
+}
+
+/* 消息过了生存周期没有。到期的tick本身就算过期，和ttl_timer到期的时刻对上 */
+#define msg_expired(msg, now) (!acoral_list_empty(&(msg)->ttl_hook) && ACORAL_TICK_AFTER_EQ(now, (msg)->ttl))
+
+/* 容器上一条消息收走了或者回收了，叫醒一个等着发的。在临界区里调用 */
+static void msgctr_slot_free(acoral_msgctr_t *msgctr)
+{
+	msgctr->count--;
+	if (!acoral_list_empty(&msgctr->send_waiting))
+		wake_up_thread(&msgctr->send_waiting);
+}
+
+/* 回收一条过期消息，先通知再释放。在临界区里调用 */
+static void msgctr_expire_msg(acoral_msgctr_t *msgctr, acoral_msg_t *msg)
+{
+	msgctr_unlink(msg);
+	acoral_list_del(&msg->ttl_hook);
+	msgctr->expired++;
+	if (msgctr->expire != NULL)
+		msgctr->expire(msgctr, msg->id, msg->data);
+	msg_release(msg);
+	msgctr_slot_free(msgctr);
+}
+
+static void msgctr_ttl_expire(acoral_timer_t *timer);
+
+/* ttl_timer设到ttl_list上最早那条的到期tick，没有了就停掉。在临界区里调用 */
+static void msgctr_ttl_arm(acoral_msgctr_t *msgctr)
+{
+	acoral_msg_t *first;
+
+	if (acoral_list_empty(&msgctr->ttl_list))
+	{
+		acoral_timer_stop(&msgctr->ttl_timer);
+		return;
+	}
+	first = list_entry(msgctr->ttl_list.next, acoral_msg_t, ttl_hook);
+	acoral_timer_start(&msgctr->ttl_timer, (int)(first->ttl - acoral_get_ticks()), msgctr_ttl_expire);
+}
+
+/* ttl_timer到期，在ticks中断里、临界区中调用。ttl_list是按到期先后排的，只看前面过期的几条，不扫整个容器 */
+static void msgctr_ttl_expire(acoral_timer_t *timer)
+{
+	acoral_msgctr_t *msgctr = list_entry(timer, acoral_msgctr_t, ttl_timer);
+	unsigned int now = acoral_get_ticks();
+	acoral_msg_t *msg;
+
+	while (!acoral_list_empty(&msgctr->ttl_list))
+	{
+		msg = list_entry(msgctr->ttl_list.next, acoral_msg_t, ttl_hook);
+		if (!msg_expired(msg, now))
+			break;
+		msgctr_expire_msg(msgctr, msg);
+	}
+	msgctr_ttl_arm(msgctr);
+}
+
+/* 按到期先后插到ttl_list上，从后往前找，生存周期一样的消息直接挂到末尾。
+ * 插在最前面的话ttl_timer要提前。在临界区里调用 */
+static void msgctr_ttl_add(acoral_msgctr_t *msgctr, acoral_msg_t *msg)
+{
+	acoral_list_t *q;
+
+	for (q = msgctr->ttl_list.prev; q != &msgctr->ttl_list; q = q->prev)
+		if (!ACORAL_TICK_AFTER(list_entry(q, acoral_msg_t, ttl_hook)->ttl, msg->ttl))
+			break;
+	acoral_list_add(&msg->ttl_hook, q);
+	if (q == &msgctr->ttl_list)
+		msgctr_ttl_arm(msgctr);
+}
+
+/* 把消息挂到容器上，唤醒等这个id的线程。在临界区里调用 */
+static unsigned int msg_post(acoral_msgctr_t *msgctr, acoral_msg_t *msg)
+{
+	ACORAL_TRACE(ACORAL_TRACE_IPC_POST, acoral_cur_thread->res.id, msgctr->res.id);
+
+	/*----------------*/
+	/*   消息数限制*/
+	/*----------------*/
+	if (msgctr->capacity <= msgctr->count)
+		return MSG_ERR_COUNT;
+
+	/*----------------*/
+	/*   增加消息*/
+	/*----------------*/
+	msgctr->count++;
+	/* 生存周期换成到期的tick，tick会回绕，以后和当前tick比较要用ACORAL_TICK_AFTER；0表示一直有效，不换算。
+	 * 换算后是不是有生存周期看ttl_hook挂没挂着，到期的tick刚好回绕到0也不会当成一直有效 */
+	if (msg->ttl)
+	{
+		msg->ttl += acoral_get_ticks();
+		msgctr_ttl_add(msgctr, msg);
+	}
+	msgctr_enqueue(msgctr, msg);
+
+	/*----------------*/
+	/*   唤醒等待*/
+	/*----------------*/
+	if (msgctr->wait_thread_num > 0)
+	{
+		/* 只唤醒等这个id的线程，消息能被收几次就唤醒几个*/
+		msgctr_wake_id(msgctr, msg->id, msg->count);
+	}
+	return MSGCTR_SUCCED;
+}
+
 acoral_msg_t *acoral_msg_create(
 	unsigned int count, unsigned int id,
 	unsigned int nTtl /* = 0*/, void *dat /*= NULL*/)
@@ -73,15 +299,36 @@ acoral_msg_t *acoral_msg_create(
 		return NULL;
 
 	msg->id = id;	 /*消息标识*/
-	msg->count = count;		 /*消息被接收次数*/
+	msg->count = count ? count : 1;		 /*消息被接收次数*/
 	msg->ttl = nTtl; /*消息生存周期*/
 	msg->data = dat; /*消息指针*/
+	msg->buf = 0;
+	acoral_init_list(&msg->hash_hook);
 	acoral_init_list(&msg->msglist);
+	acoral_init_list(&msg->ttl_hook);
+	return msg;
+}
+
+acoral_msg_t *acoral_msg_create_buf(unsigned int count, unsigned int id, unsigned int nTtl, void *buf)
+{
+	acoral_msg_t *msg;
+
+	if (buf == NULL)
+		return NULL;
+	msg = acoral_msg_create(count, id, nTtl, buf);
+	if (msg == NULL)
+		return NULL;
+	msg->buf = 1;
+	acoral_enter_critical();
+	MSGBUF_HDR(buf)->ref += msg->count;
+	acoral_exit_critical();
 	return msg;
 }
 
 unsigned int acoral_msg_send(acoral_msgctr_t *msgctr, acoral_msg_t *msg)
 {
+	unsigned int ret;
+
 	/*	if (acoral_intr_nesting > 0)
 			return MST_ERR_INTR;
 	*/
@@ -98,44 +345,120 @@ unsigned int acoral_msg_send(acoral_msgctr_t *msgctr, acoral_msg_t *msg)
 		acoral_exit_critical();
 		return MSG_ERR_NULL;
 	}
+	ret = msg_post(msgctr, msg);
+	acoral_exit_critical();
+	acoral_sched();
+	return ret;
+}
 
-	/*----------------*/
-	/*   消息数限制*/
-	/*----------------*/
-	if (ACORAL_MESSAGE_MAX_COUNT <= msgctr->count)
+/* timeout_ns不为0时用高精度定时器计超时，否则timeout毫秒换算成ticks；两个都是0就一直等 */
+static unsigned int msg_send_wait(acoral_msgctr_t *msgctr,
+								  acoral_msg_t *msg,
+								  unsigned int timeout,
+								  unsigned long long timeout_ns)
+{
+	int timed = timeout > 0 || timeout_ns > 0, armed = 0;
+	unsigned int ret;
+	acoral_thread_t *cur;
+
+	if (acoral_intr_nesting > 0)
+		return MST_ERR_INTR;
+	if (NULL == msgctr)
+		return MST_ERR_NULL;
+	if (NULL == msg)
+		return MSG_ERR_NULL;
+
+	cur = acoral_cur_thread;
+
+	acoral_enter_critical();
+	cur->msg_deleted = 0;
+	while (msgctr->count >= msgctr->capacity)
 	{
+		/* 醒来时有位置了，就算同时超时也先发出去 */
+		if (armed && timed && cur->thread_timer->delay_time <= 0)
+		{
+			acoral_exit_critical();
+			return MST_ERR_TIMEOUT;
+		}
+		if (!armed)
+		{
+			armed = 1;
+			if (timeout_ns > 0)
+				timeout_queue_add_ns(cur, timeout_ns);
+			else if (timeout > 0)
+			{
+				cur->thread_timer->delay_time = time_to_ticks(timeout);
+				timeout_queue_add(cur);
+			}
+		}
+		msgctr_wait_add(&msgctr->send_waiting, cur);
+		unrdy_thread(cur);
 		acoral_exit_critical();
-		return MSG_ERR_COUNT;
+		acoral_sched();
+		acoral_enter_critical();
+		/* 容器被删掉了，msgctr已经释放，不能再看 */
+		if (cur->msg_deleted)
+		{
+			if (armed)
+				timeout_queue_del(cur);
+			acoral_exit_critical();
+			return MST_ERR_DEL;
+		}
+		/* 被接收者唤醒时已经摘下来了，超时醒来的还挂着 */
+		acoral_list_del(&cur->ipc_waiting_hook);
 	}
+	if (armed)
+		timeout_queue_del(cur);
+	ret = msg_post(msgctr, msg);
+	acoral_exit_critical();
+	acoral_sched();
+	return ret;
+}
 
-	/*----------------*/
-	/*   增加消息*/
-	/*----------------*/
-	msgctr->count++;
-	msg->ttl += acoral_get_ticks();
-	acoral_list_add2_tail(&msg->msglist, &msgctr->msglist);
+unsigned int acoral_msg_send_wait(acoral_msgctr_t *msgctr, acoral_msg_t *msg, unsigned int timeout)
+{
+	return msg_send_wait(msgctr, msg, timeout, 0);
+}
 
-	/*----------------*/
-	/*   唤醒等待*/
-	/*----------------*/
-	if (msgctr->wait_thread_num > 0)
+unsigned int acoral_msg_send_wait_ns(acoral_msgctr_t *msgctr, acoral_msg_t *msg, unsigned long long timeout)
+{
+	return msg_send_wait(msgctr, msg, 0, timeout);
+}
+
+int acoral_msg_multicast(acoral_msgctr_t **msgctrs, int n, unsigned int id, unsigned int nTtl, void *buf)
+{
+	acoral_msg_t *msg;
+	int i, sent = 0;
+
+	if (buf == NULL)
+		return 0;
+	acoral_enter_critical();
+	for (i = 0; i < n; i++)
 	{
-		/* 此处将最高优先级唤醒*/
-		wake_up_thread(&msgctr->waiting);
-		msgctr->wait_thread_num--;
+		if (msgctrs[i] == NULL)
+			continue;
+		msg = acoral_msg_create_buf(1, id, nTtl, buf);
+		if (msg == NULL)
+			continue;
+		if (msg_post(msgctrs[i], msg) == MSGCTR_SUCCED)
+			sent++;
+		else
+			msg_release(msg);
 	}
 	acoral_exit_critical();
 	acoral_sched();
-	return MSGCTR_SUCCED;
+	return sent;
 }
 
-void *acoral_msg_recv(acoral_msgctr_t *msgctr,
+/* timeout_ns不为0时用高精度定时器计超时，否则timeout毫秒换算成ticks；两个都是0就一直等 */
+static void *msg_recv(acoral_msgctr_t *msgctr,
 					  unsigned int id,
 					  unsigned int timeout,
+					  unsigned long long timeout_ns,
 					  unsigned int *err)
 {
+	int timed = timeout > 0 || timeout_ns > 0, armed = 0;
 	void *dat;
-	acoral_list_t *p, *q;
 	acoral_msg_t *pmsg;
 	acoral_thread_t *cur;
 
@@ -153,122 +476,259 @@ void *acoral_msg_recv(acoral_msgctr_t *msgctr,
 	cur = acoral_cur_thread;
 
 	acoral_enter_critical();
-	if (timeout > 0)
-	{
-		cur->thread_timer->delay_time = time_to_ticks(timeout);
-		timeout_queue_add(cur);
-	}
+	ACORAL_TRACE(ACORAL_TRACE_IPC_PEND, cur->res.id, msgctr->res.id);
+	cur->msg_deleted = 0;
 	while (1)
 	{
-		p = &msgctr->msglist;
-		q = p->next;
-		for (; p != q; q = q->next)
+		/* ttl_timer在到期的那个tick已经回收过了，这里再看一眼，保证收不到过期的 */
+		while ((pmsg = msgctr_find(msgctr, id)) != NULL && msg_expired(pmsg, acoral_get_ticks()))
 		{
-			pmsg = list_entry(q, acoral_msg_t, msglist);
-			if ((pmsg->id == id) && (pmsg->count > 0))
-			{
-				/*-----------------*/
-				/* 有接收消息*/
-				/*-----------------*/
-				pmsg->count--;
-				/*-----------------*/
-				/* 延时列表删除*/
-				/*-----------------*/
+			msgctr_expire_msg(msgctr, pmsg);
+			msgctr_ttl_arm(msgctr);
+		}
+		if (pmsg != NULL)
+		{
+			/*-----------------*/
+			/* 延时列表删除*/
+			/*-----------------*/
+			if (armed)
 				timeout_queue_del(cur);
-				dat = pmsg->data;
-				acoral_list_del(q);
+			/*-----------------*/
+			/* 有接收消息，带缓冲区的把消息持有的一个引用交给接收者*/
+			/* 收够次数了才取下来释放，没收够的留在原处给下一个接收者*/
+			/*-----------------*/
+			dat = pmsg->data;
+			if (--pmsg->count == 0)
+			{
+				msgctr_dequeue(pmsg);
+				/* 它要是ttl_list上最早的，ttl_timer先不动，到时候发现没有过期的再往后设 */
+				acoral_list_del(&pmsg->ttl_hook);
 				acoral_release_res((acoral_res_t *)pmsg);
-				msgctr->count--;
-				acoral_exit_critical();
-				return dat;
+				/* 腾出一个位置，叫醒一个等着发的 */
+				msgctr_slot_free(msgctr);
 			}
+			acoral_exit_critical();
+			/* 叫醒的发送者优先级高的话马上让给它 */
+			acoral_sched();
+			return dat;
 		}
+		/* 醒来时已经有这个id的消息了，就算同时超时也先收下 */
+		if (armed && timed && cur->thread_timer->delay_time <= 0)
+			break;
 
 		/*-----------------*/
-		/*  没有接收消息*/
+		/*  没有接收消息，第一次等的时候才启动超时*/
 		/*-----------------*/
+		if (!armed)
+		{
+			armed = 1;
+			if (timeout_ns > 0)
+				timeout_queue_add_ns(cur, timeout_ns);
+			else if (timeout > 0)
+			{
+				cur->thread_timer->delay_time = time_to_ticks(timeout);
+				timeout_queue_add(cur);
+			}
+		}
+		cur->msg_id = id;
 		msgctr->wait_thread_num++;
 		acoral_msgctr_queue_add(msgctr, cur);
 		unrdy_thread(cur);
 		acoral_exit_critical();
 		acoral_sched();
-		/*-----------------*/
-		/*  看有没有超时*/
-		/*-----------------*/
 		acoral_enter_critical();
-
-		if (timeout > 0 && (int)cur->thread_timer->delay_time <= 0)
-			break;
+		if (cur->msg_deleted)
+		{
+			if (armed)
+				timeout_queue_del(cur);
+			acoral_exit_critical();
+			*err = MST_ERR_DEL;
+			return NULL;
+		}
+		/* 被发消息的一方唤醒时已经摘下来了，超时醒来的还挂着 */
+		if (!acoral_list_empty(&cur->ipc_waiting_hook))
+		{
+			acoral_list_del(&cur->ipc_waiting_hook);
+			msgctr->wait_thread_num--;
+		}
 	}
 
 	/*---------------*/
 	/*  超时退出*/
 	/*---------------*/
-	//	timeout_queue_del(cur);
-	if (msgctr->wait_thread_num > 0)
-		msgctr->wait_thread_num--;
-	acoral_list_del(&cur->ipc_waiting_hook);
 	acoral_exit_critical();
 	*err = MST_ERR_TIMEOUT;
 	return NULL;
 }
 
-unsigned int acoral_msgctr_del(acoral_msgctr_t *pmsgctr, unsigned int flag)
+void *acoral_msg_recv(acoral_msgctr_t *msgctr,
+					  unsigned int id,
+					  unsigned int timeout,
+					  unsigned int *err)
+{
+	return msg_recv(msgctr, id, timeout, 0, err);
+}
+
+void *acoral_msg_recv_ns(acoral_msgctr_t *msgctr,
+						 unsigned int id,
+						 unsigned long long timeout,
+						 unsigned int *err)
+{
+	return msg_recv(msgctr, id, 0, timeout, err);
+}
+
+/* 容器被强制删掉，叫醒等在上面的线程，它们醒来看到msg_deleted就返回MST_ERR_DEL，不再碰容器。在临界区里调用 */
+static void msgctr_wake_deleted(acoral_list_t *head)
 {
-	acoral_list_t *p, *q;
 	acoral_thread_t *thread;
-	acoral_msg_t *pmsg;
+
+	while (!acoral_list_empty(head))
+	{
+		thread = list_entry(head->next, acoral_thread_t, ipc_waiting_hook);
+		acoral_list_del(&thread->ipc_waiting_hook);
+		thread->msg_deleted = 1;
+		ready_thread(thread);
+	}
+}
+
+unsigned int acoral_msgctr_del(acoral_msgctr_t *pmsgctr, unsigned int flag)
+{
+	acoral_list_t *p;
+	acoral_msg_t *pmsg, *next;
+	int i;
 
 	if (NULL == pmsgctr)
 		return MST_ERR_NULL;
+	/* 唤醒等待线程和释放容器在同一个临界区里，醒来的线程拿到内核大锁时容器已经不在了，它们不会再去看 */
+	acoral_enter_critical();
 	if (flag == MST_DEL_UNFORCE)
 	{
-		if ((pmsgctr->count > 0) || (pmsgctr->wait_thread_num > 0))
+		if ((pmsgctr->count > 0) || (pmsgctr->wait_thread_num > 0) || !acoral_list_empty(&pmsgctr->send_waiting))
+		{
+			acoral_exit_critical();
 			return MST_ERR_UNDEF;
-		else
-			acoral_release_res((acoral_res_t *)pmsgctr);
+		}
+		/* 最后一条消息收走了，ttl_timer可能还没到期 */
+		acoral_timer_stop(&pmsgctr->ttl_timer);
+		acoral_release_res((acoral_res_t *)pmsgctr);
+		acoral_exit_critical();
+		return MSGCTR_SUCCED;
 	}
-	else
+
+	acoral_timer_stop(&pmsgctr->ttl_timer);
+	// 释放等着发的进程
+	msgctr_wake_deleted(&pmsgctr->send_waiting);
+	for (i = 0; i < ACORAL_MSGCTR_HASH; i++)
 	{
 		// 释放等待进程
-		if (pmsgctr->wait_thread_num > 0)
-		{
-			p = &pmsgctr->waiting;
-			q = p->next;
-			for (; q != p; q = q->next)
-			{
-				thread = list_entry(q, acoral_thread_t, ipc_waiting_hook);
-				// acoral_list_del  (&thread->ipc_waiting_hook);
-				ready_thread(thread);
-			}
-		}
+		msgctr_wake_deleted(&pmsgctr->buckets[i].waiting);
 
-		// 释放消息结构
-		if (pmsgctr->count > 0)
+		// 释放消息结构，每个id的消息环一起释放
+		p = &pmsgctr->buckets[i].msgs;
+		while (!acoral_list_empty(p))
 		{
-			p = &pmsgctr->msglist;
-			q = p->next;
-			for (; p != q; q = p->next)
+			pmsg = list_entry(p->next, acoral_msg_t, hash_hook);
+			acoral_list_del(&pmsg->hash_hook);
+			while (pmsg->msglist.next != &pmsg->msglist)
 			{
-				pmsg = list_entry(q, acoral_msg_t, msglist);
-				acoral_list_del(q);
-				acoral_release_res((acoral_res_t *)pmsg);
+				next = list_entry(pmsg->msglist.next, acoral_msg_t, msglist);
+				acoral_list_del(&next->msglist);
+				msg_release(next);
 			}
+			msg_release(pmsg);
 		}
-
-		// 释放资源
-		acoral_release_res((acoral_res_t *)pmsgctr);
 	}
+
+	// 释放资源
+	acoral_release_res((acoral_res_t *)pmsgctr);
+	acoral_exit_critical();
+	acoral_sched();
 	return MSGCTR_SUCCED;
 }
 
 unsigned int acoral_msg_del(acoral_msg_t *pmsg)
 {
 	if (NULL != pmsg)
-		acoral_release_res((acoral_res_t *)pmsg);
+	{
+		acoral_enter_critical();
+		msg_release(pmsg);
+		acoral_exit_critical();
+	}
 	return 0;
 }
 
+acoral_msgbuf_pool_t *acoral_msgbuf_pool_create(unsigned int size, unsigned int num)
+{
+	acoral_msgbuf_pool_t *pool;
+	acoral_msgbuf_t *hdr;
+	char *base;
+	unsigned int i;
+
+	if (size == 0 || num == 0)
+		return NULL;
+	pool = (acoral_msgbuf_pool_t *)acoral_malloc(MSGBUF_ALIGN(sizeof(acoral_msgbuf_pool_t)) + MSGBUF_STRIDE(size) * num);
+	if (pool == NULL)
+		return NULL;
+	pool->size = size;
+	pool->num = num;
+	pool->free_num = num;
+	acoral_init_list(&pool->free);
+	base = (char *)pool + MSGBUF_ALIGN(sizeof(acoral_msgbuf_pool_t));
+	for (i = 0; i < num; i++)
+	{
+		hdr = (acoral_msgbuf_t *)(base + MSGBUF_STRIDE(size) * i);
+		hdr->pool = pool;
+		hdr->ref = 0;
+		acoral_list_add2_tail(&hdr->free_hook, &pool->free);
+	}
+	return pool;
+}
+
+int acoral_msgbuf_pool_del(acoral_msgbuf_pool_t *pool)
+{
+	acoral_enter_critical();
+	if (pool->free_num != pool->num)
+	{
+		acoral_exit_critical();
+		return -1;
+	}
+	acoral_exit_critical();
+	acoral_free(pool);
+	return 0;
+}
+
+void *acoral_msgbuf_alloc(acoral_msgbuf_pool_t *pool)
+{
+	acoral_msgbuf_t *hdr;
+
+	acoral_enter_critical();
+	if (acoral_list_empty(&pool->free))
+	{
+		acoral_exit_critical();
+		return NULL;
+	}
+	hdr = list_entry(pool->free.next, acoral_msgbuf_t, free_hook);
+	acoral_list_del(&hdr->free_hook);
+	pool->free_num--;
+	hdr->ref = 1;
+	acoral_exit_critical();
+	return (char *)hdr + MSGBUF_HDR_SIZE;
+}
+
+void acoral_msgbuf_get(void *buf)
+{
+	acoral_enter_critical();
+	MSGBUF_HDR(buf)->ref++;
+	acoral_exit_critical();
+}
+
+void acoral_msgbuf_put(void *buf)
+{
+	acoral_enter_critical();
+	msgbuf_put_n(buf, 1);
+	acoral_exit_critical();
+}
+
 void wake_up_thread(acoral_list_t *head)
 {
 	acoral_list_t *p, *q;
@@ -283,14 +743,22 @@ void wake_up_thread(acoral_list_t *head)
 
 void acoral_print_all_msg(acoral_msgctr_t *msgctr)
 {
-	acoral_list_t *p, *q;
+	acoral_list_t *p, *q, *r;
 	acoral_msg_t *pmsg;
+	int i;
 
-	p = &msgctr->msglist;
-	q = p->next;
-	for (; p != q; q = q->next)
+	for (i = 0; i < ACORAL_MSGCTR_HASH; i++)
 	{
-		pmsg = list_entry(q, acoral_msg_t, msglist);
-		printf("\nid = %d", pmsg->id);
+		p = &msgctr->buckets[i].msgs;
+		for (q = p->next; p != q; q = q->next)
+		{
+			pmsg = list_entry(q, acoral_msg_t, hash_hook);
+			r = &pmsg->msglist;
+			do
+			{
+				printf("\nid = %d", list_entry(r, acoral_msg_t, msglist)->id);
+				r = r->next;
+			} while (r != &pmsg->msglist);
+		}
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,236 @@
+/**
+ * @file msgq.c
+ * @brief kernel层，定长消息队列：消息按值拷进拷出环形缓冲区，收发都不用分配消息结构
+ * @version 1.0
+ * @date 2024-07-20
+ * @copyright Copyright (c) 2024
+ * @note 缓冲区和等待队列都只在临界区里访问，所以中断里也能用不等待的收发。
+ *       收发一条消息只唤醒对面等待队列上优先级最高的一个线程，它醒来后重新看队列，被别的线程抢先了就接着等
+ */
+
+#include "msgq.h"
+#include "thread.h"
+#include "int.h"
+#include "mem.h"
+#include "soft_timer.h"
+
+#include <string.h>
+
+#if CFG_MSGQ
+
+/* 按优先级插到等待队列上，同优先级的先来先醒。在临界区里调用 */
+static void msgq_wait_add(acoral_list_t *head, acoral_thread_t *thread)
+{
+	acoral_list_t *q;
+
+	for (q = head->next; q != head; q = q->next)
+		if (list_entry(q, acoral_thread_t, ipc_waiting_hook)->prio > thread->prio)
+			break;
+	acoral_list_add(&thread->ipc_waiting_hook, q->prev);
+}
+
+/* 唤醒等待队列上的第一个线程。在临界区里调用 */
+static void msgq_wake(acoral_list_t *head)
+{
+	acoral_thread_t *thread;
+
+	if (acoral_list_empty(head))
+		return;
+	thread = list_entry(head->next, acoral_thread_t, ipc_waiting_hook);
+	acoral_list_del(&thread->ipc_waiting_hook);
+	ready_thread(thread);
+}
+
+/* 拷进队尾，叫醒一个等着收的。在临界区里、队列不满时调用 */
+static void msgq_put(acoral_msgq_t *msgq, const void *msg)
+{
+	unsigned int tail = msgq->head + msgq->count;
+
+	if (tail >= msgq->capacity)
+		tail -= msgq->capacity;
+	memcpy(msgq->buf + tail * msgq->elem_size, msg, msgq->elem_size);
+	msgq->count++;
+	msgq_wake(&msgq->recv_waiting);
+}
+
+/* 从队头拷出来，叫醒一个等着发的。在临界区里、队列不空时调用 */
+static void msgq_get(acoral_msgq_t *msgq, void *msg)
+{
+	memcpy(msg, msgq->buf + msgq->head * msgq->elem_size, msgq->elem_size);
+	if (++msgq->head == msgq->capacity)
+		msgq->head = 0;
+	msgq->count--;
+	msgq_wake(&msgq->send_waiting);
+}
+
+/* 在临界区里调用，把当前线程挂到等待队列上等一次；第一次等的时候启动超时，
+ * timeout_ns不为0时用高精度定时器，否则timeout毫秒换算成ticks。返回1表示超时了 */
+static int msgq_wait(acoral_list_t *head, unsigned int timeout, unsigned long long timeout_ns, int *armed)
+{
+	acoral_thread_t *cur = acoral_cur_thread;
+
+	if (!*armed)
+	{
+		*armed = 1;
+		if (timeout_ns > 0)
+			timeout_queue_add_ns(cur, timeout_ns);
+		else if (timeout > 0)
+		{
+			cur->thread_timer->delay_time = time_to_ticks(timeout);
+			timeout_queue_add(cur);
+		}
+	}
+	msgq_wait_add(head, cur);
+	unrdy_thread(cur);
+	acoral_exit_critical();
+	acoral_sched();
+	acoral_enter_critical();
+	/* 被对面唤醒时已经从等待队列上摘下来了，超时醒来的还在上面 */
+	acoral_list_del(&cur->ipc_waiting_hook);
+	return (timeout > 0 || timeout_ns > 0) && cur->thread_timer->delay_time <= 0;
+}
+
+static acoralMsgqRetValEnum msgq_send(acoral_msgq_t *msgq, const void *msg, unsigned int timeout, unsigned long long timeout_ns)
+{
+	int armed = 0;
+
+	if (acoral_intr_nesting)
+		return MSGQ_ERR_INTR;
+	if (msgq == NULL || msg == NULL)
+		return MSGQ_ERR_NULL;
+
+	acoral_enter_critical();
+	while (msgq->count == msgq->capacity)
+	{
+		if (msgq_wait(&msgq->send_waiting, timeout, timeout_ns, &armed) && msgq->count == msgq->capacity)
+		{
+			acoral_exit_critical();
+			return MSGQ_ERR_TIMEOUT;
+		}
+	}
+	if (armed)
+		timeout_queue_del(acoral_cur_thread);
+	msgq_put(msgq, msg);
+	acoral_exit_critical();
+	acoral_sched();
+	return MSGQ_SUCCED;
+}
+
+static acoralMsgqRetValEnum msgq_recv(acoral_msgq_t *msgq, void *msg, unsigned int timeout, unsigned long long timeout_ns)
+{
+	int armed = 0;
+
+	if (acoral_intr_nesting)
+		return MSGQ_ERR_INTR;
+	if (msgq == NULL || msg == NULL)
+		return MSGQ_ERR_NULL;
+
+	acoral_enter_critical();
+	while (msgq->count == 0)
+	{
+		if (msgq_wait(&msgq->recv_waiting, timeout, timeout_ns, &armed) && msgq->count == 0)
+		{
+			acoral_exit_critical();
+			return MSGQ_ERR_TIMEOUT;
+		}
+	}
+	if (armed)
+		timeout_queue_del(acoral_cur_thread);
+	msgq_get(msgq, msg);
+	acoral_exit_critical();
+	acoral_sched();
+	return MSGQ_SUCCED;
+}
+
+acoral_msgq_t *acoral_msgq_create(unsigned int elem_size, unsigned int capacity)
+{
+	acoral_msgq_t *msgq;
+
+	if (elem_size == 0 || capacity == 0)
+		return NULL;
+	msgq = (acoral_msgq_t *)acoral_malloc(sizeof(acoral_msgq_t) + elem_size * capacity);
+	if (msgq == NULL)
+		return NULL;
+	msgq->elem_size = elem_size;
+	msgq->capacity = capacity;
+	msgq->head = 0;
+	msgq->count = 0;
+	acoral_init_list(&msgq->send_waiting);
+	acoral_init_list(&msgq->recv_waiting);
+	return msgq;
+}
+
+acoralMsgqRetValEnum acoral_msgq_del(acoral_msgq_t *msgq)
+{
+	if (msgq == NULL)
+		return MSGQ_ERR_NULL;
+	acoral_enter_critical();
+	if (!acoral_list_empty(&msgq->send_waiting) || !acoral_list_empty(&msgq->recv_waiting))
+	{
+		acoral_exit_critical();
+		return MSGQ_ERR_BUSY;
+	}
+	acoral_exit_critical();
+	acoral_free(msgq);
+	return MSGQ_SUCCED;
+}
+
+acoralMsgqRetValEnum acoral_msgq_send(acoral_msgq_t *msgq, const void *msg, unsigned int timeout)
+{
+	return msgq_send(msgq, msg, timeout, 0);
+}
+
+acoralMsgqRetValEnum acoral_msgq_send_ns(acoral_msgq_t *msgq, const void *msg, unsigned long long timeout)
+{
+	return msgq_send(msgq, msg, 0, timeout);
+}
+
+acoralMsgqRetValEnum acoral_msgq_recv(acoral_msgq_t *msgq, void *msg, unsigned int timeout)
+{
+	return msgq_recv(msgq, msg, timeout, 0);
+}
+
+acoralMsgqRetValEnum acoral_msgq_recv_ns(acoral_msgq_t *msgq, void *msg, unsigned long long timeout)
+{
+	return msgq_recv(msgq, msg, 0, timeout);
+}
+
+acoralMsgqRetValEnum acoral_msgq_trysend(acoral_msgq_t *msgq, const void *msg)
+{
+	if (msgq == NULL || msg == NULL)
+		return MSGQ_ERR_NULL;
+	acoral_enter_critical();
+	if (msgq->count == msgq->capacity)
+	{
+		acoral_exit_critical();
+		return MSGQ_ERR_FULL;
+	}
+	msgq_put(msgq, msg);
+	acoral_exit_critical();
+	/* 中断里acoral_sched直接返回，等中断退出时再调度 */
+	acoral_sched();
+	return MSGQ_SUCCED;
+}
+
+acoralMsgqRetValEnum acoral_msgq_tryrecv(acoral_msgq_t *msgq, void *msg)
+{
+	if (msgq == NULL || msg == NULL)
+		return MSGQ_ERR_NULL;
+	acoral_enter_critical();
+	if (msgq->count == 0)
+	{
+		acoral_exit_critical();
+		return MSGQ_ERR_EMPTY;
+	}
+	msgq_get(msgq, msg);
+	acoral_exit_critical();
+	acoral_sched();
+	return MSGQ_SUCCED;
+}
+
+unsigned int acoral_msgq_count(acoral_msgq_t *msgq)
+{
+	return msgq->count;
+}
+
+#endif
@@ -19,6 +19,7 @@
 #include "int.h"
 #include "soft_timer.h"
 #include "mutex.h"
+#include "trace.h"
 #include <stdio.h>
 
 extern void acoral_evt_queue_del(acoral_thread_t *thread);
@@ -116,8 +117,9 @@ acoralMutexRetVal acoral_mutex_trypend(acoral_evt_t *evt)
 	return MUTEX_ERR_TIMEOUT;
 }
 
-acoralMutexRetVal acoral_mutex_pend(acoral_evt_t *evt, unsigned int timeout)
+static acoralMutexRetVal mutex_pend(acoral_evt_t *evt, unsigned int timeout, unsigned long long timeout_ns)
 {
+	int timed = timeout > 0 || timeout_ns > 0;
 	unsigned char highPrio;
 	acoral_thread_t *thread;
 	acoral_thread_t *cur;
@@ -133,6 +135,7 @@ acoralMutexRetVal acoral_mutex_pend(acoral_evt_t *evt, unsigned int timeout)
 		acoral_exit_critical();
 		return MUTEX_ERR_NULL;
 	}
+	ACORAL_TRACE(ACORAL_TRACE_IPC_PEND, cur->res.id, evt->res.id);
 
 	if ((unsigned char)(evt->count & MUTEX_L_MASK) == MUTEX_AVAI)
 	{
@@ -162,7 +165,9 @@ acoralMutexRetVal acoral_mutex_pend(acoral_evt_t *evt, unsigned int timeout)
 	/*不需要或不能提高优先级*/
 	unrdy_thread(cur);
 	acoral_evt_queue_add(evt, cur);
-	if (timeout > 0)
+	if (timeout_ns > 0)
+		timeout_queue_add_ns(cur, timeout_ns);
+	else if (timeout > 0)
 	{
 		/*加载到超时队列*/
 		cur->thread_timer->delay_time = time_to_ticks(timeout);
@@ -171,7 +176,7 @@ acoralMutexRetVal acoral_mutex_pend(acoral_evt_t *evt, unsigned int timeout)
 	acoral_exit_critical();
 	acoral_sched();
 	acoral_enter_critical();
-	if (evt->data != cur && timeout > 0 && cur->thread_timer->delay_time <= 0)
+	if (evt->data != cur && timed && cur->thread_timer->delay_time <= 0)
 	{
 		printf("Time Out Return\n");
 		acoral_evt_queue_del(cur);
@@ -194,8 +199,9 @@ acoralMutexRetVal acoral_mutex_pend(acoral_evt_t *evt, unsigned int timeout)
 	return MUTEX_SUCCED;
 }
 
-acoralMutexRetVal acoral_mutex_pend2(acoral_evt_t *evt, unsigned int timeout)
+static acoralMutexRetVal mutex_pend2(acoral_evt_t *evt, unsigned int timeout, unsigned long long timeout_ns)
 {
+	int timed = timeout > 0 || timeout_ns > 0;
 	acoral_thread_t *cur;
 
 	if (acoral_intr_nesting > 0)
@@ -209,6 +215,7 @@ acoralMutexRetVal acoral_mutex_pend2(acoral_evt_t *evt, unsigned int timeout)
 		acoral_exit_critical();
 		return MUTEX_ERR_NULL;
 	}
+	ACORAL_TRACE(ACORAL_TRACE_IPC_PEND, cur->res.id, evt->res.id);
 
 	if ((unsigned char)(evt->count & MUTEX_L_MASK) == MUTEX_AVAI)
 	{
@@ -226,7 +233,9 @@ acoralMutexRetVal acoral_mutex_pend2(acoral_evt_t *evt, unsigned int timeout)
 	/* 互斥量已被占有*/
 	unrdy_thread(cur);
 	acoral_evt_queue_add(evt, cur);
-	if (timeout > 0)
+	if (timeout_ns > 0)
+		timeout_queue_add_ns(cur, timeout_ns);
+	else if (timeout > 0)
 	{
 		/*加载到超时队列*/
 		cur->thread_timer->delay_time = time_to_ticks(timeout);
@@ -240,7 +249,7 @@ acoralMutexRetVal acoral_mutex_pend2(acoral_evt_t *evt, unsigned int timeout)
 	acoral_enter_critical();
 
 	/*超时时间内未获得互斥量*/
-	if (evt->data != cur && timeout > 0 && cur->thread_timer->delay_time <= 0)
+	if (evt->data != cur && timed && cur->thread_timer->delay_time <= 0)
 	{
 		printf("Time Out Return\n");
 		acoral_evt_queue_del(cur);
@@ -262,6 +271,26 @@ acoralMutexRetVal acoral_mutex_pend2(acoral_evt_t *evt, unsigned int timeout)
 	return MUTEX_SUCCED;
 }
 
+acoralMutexRetVal acoral_mutex_pend(acoral_evt_t *evt, unsigned int timeout)
+{
+	return mutex_pend(evt, timeout, 0);
+}
+
+acoralMutexRetVal acoral_mutex_pend_ns(acoral_evt_t *evt, unsigned long long timeout)
+{
+	return mutex_pend(evt, 0, timeout);
+}
+
+acoralMutexRetVal acoral_mutex_pend2(acoral_evt_t *evt, unsigned int timeout)
+{
+	return mutex_pend2(evt, timeout, 0);
+}
+
+acoralMutexRetVal acoral_mutex_pend2_ns(acoral_evt_t *evt, unsigned long long timeout)
+{
+	return mutex_pend2(evt, 0, timeout);
+}
+
 acoralMutexRetVal acoral_mutex_post(acoral_evt_t *evt)
 {
 	unsigned char ownerPrio;
@@ -277,6 +306,7 @@ acoralMutexRetVal acoral_mutex_post(acoral_evt_t *evt)
 		acoral_exit_critical();
 		return MUTEX_ERR_NULL; /*error*/
 	}
+	ACORAL_TRACE(ACORAL_TRACE_IPC_POST, acoral_cur_thread->res.id, evt->res.id);
 
 	highPrio = (unsigned char)(evt->count >> 8);
 	ownerPrio = (unsigned char)(evt->count & MUTEX_L_MASK);
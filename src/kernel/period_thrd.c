@@ -27,33 +27,131 @@
 
 #if CFG_THRD_PERIOD
 
+static acoral_list_t *period_wait_queue(void){
+	return &(((policy_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_POLICY].type_private_data))->global_period_wait_queue);
+}
+
+/// n个线程的Liu-Layland利用率上界n(2^(1/n)-1)，千分比，向下取整
+static const unsigned short period_ll_bound[] = {1000, 828, 779, 756, 743, 734, 728, 724, 720, 717};
+#define PERIOD_LL_BOUND_LIMIT 693 ///<n>10时用极限ln2，比真实上界小，结果偏保守
+
+/**
+ * @brief 周期线程实际的周期，毫秒。周期是按tick算的，不是tick整数倍的部分会被舍掉
+ *
+ * @param data 周期线程数据
+ * @return unsigned int 实际周期
+ */
+static unsigned int period_effective_mm(acoral_period_policy_data_t *data){
+	return ACORAL_TICKS_TO_MS(time_to_ticks(data->period_time_mm));
+}
+
+/**
+ * @brief 准入检查：对某个核上所有填了WCET的周期线程（加上将要加入的新线程）先做Liu-Layland利用率检查，
+ *        再做精确的响应时间分析，可调度时把每个线程的最坏响应时间写回它的策略数据
+ * @note 必须在临界区中调用。截止期等于周期；优先级相同的线程也算作干扰，结果偏保守；
+ *       不考虑非周期线程、中断和调度本身的开销，亲和性为ACORAL_CPU_ANY的线程按它当前所在的核算
+ *
+ * @param cpu 核号
+ * @param new 将要加入的新线程，还没挂到周期线程链表上；为NULL时只是重新计算最坏响应时间
+ * @return int 0利用率不超过Liu-Layland上界，一定可调度；1超过了上界，但响应时间分析可调度；-1不可调度
+ */
+static int period_admit(int cpu, acoral_thread_t *new){
+	acoral_thread_t *set[CFG_MAX_THREAD];
+	unsigned int wcrt[CFG_MAX_THREAD];
+	acoral_period_policy_data_t *data, *hp;
+	acoral_list_t *head, *tmp;
+	acoral_thread_t *thread;
+	unsigned int n = 0, u = 0, i, j, r, next, t;
+
+	head = period_wait_queue();
+	for (tmp = head->next; tmp != head; tmp = tmp->next){
+		thread = list_entry(tmp, acoral_thread_t, period_wait_hook);
+		if (thread->cpu == cpu && ((acoral_period_policy_data_t *)thread->policy_data)->wcet_mm)
+			set[n++] = thread;
+	}
+	if (new != NULL && ((acoral_period_policy_data_t *)new->policy_data)->wcet_mm)
+		set[n++] = new;
+	if (n == 0)
+		return 0;
+
+	/* 利用率检查，每个线程的利用率向上取整 */
+	for (i = 0; i < n; i++){
+		data = (acoral_period_policy_data_t *)set[i]->policy_data;
+		t = period_effective_mm(data);
+		if (t == 0)
+			return -1;
+		u += (data->wcet_mm * 1000 + t - 1) / t;
+	}
+	if (u > 1000)
+		return -1;
+
+	/* 响应时间分析：R = C_i + sum(ceil(R/T_j)*C_j)，j是优先级不低于i的其他线程，从R = C_i开始迭代到不动点，超过周期就不可调度 */
+	for (i = 0; i < n; i++){
+		data = (acoral_period_policy_data_t *)set[i]->policy_data;
+		t = period_effective_mm(data);
+		next = data->wcet_mm;
+		do{
+			r = next;
+			next = data->wcet_mm;
+			for (j = 0; j < n; j++){
+				if (j == i || set[j]->prio > set[i]->prio)
+					continue;
+				hp = (acoral_period_policy_data_t *)set[j]->policy_data;
+				next += (r + period_effective_mm(hp) - 1) / period_effective_mm(hp) * hp->wcet_mm;
+			}
+		}while (next != r && next <= t);
+		if (next > t)
+			return -1;
+		wcrt[i] = r;
+	}
+	for (i = 0; i < n; i++)
+		((acoral_period_policy_data_t *)set[i]->policy_data)->wcrt_mm = wcrt[i];
+	return u <= (n <= sizeof(period_ll_bound) / sizeof(period_ll_bound[0]) ? period_ll_bound[n - 1] : PERIOD_LL_BOUND_LIMIT) ? 0 : 1;
+}
+
 /**
- * @brief 初始化周期线程的一些数据
- * 
+ * @brief 初始化周期线程的一些数据，填了WCET的线程要先通过准入检查
+ *
  * @param thread 线程指针
  * @param data 周期线程数据，acoral_period_policy_data_t
- * @return int 
+ * @return int
  */
 static int period_policy_thread_init(acoral_thread_t *thread,void *data){
 	acoral_period_policy_data_t *policy_data;
+	acoral_timer_t* period_timer;
 
     policy_data=(acoral_period_policy_data_t *)acoral_malloc(sizeof(acoral_period_policy_data_t));
     if(policy_data==NULL){
         printf("No level2 mem space for policy_data:%s\n",thread->name);
-        acoral_enter_critical();
-        acoral_release_res((acoral_res_t *)thread);
-        acoral_exit_critical();
-        return -1;
+        goto err_thread;
     }
     policy_data->period_time_mm=((acoral_period_policy_data_t*)data)->period_time_mm;
+    policy_data->wcet_mm=((acoral_period_policy_data_t*)data)->wcet_mm;
+    policy_data->wcrt_mm=0;
+    policy_data->job_state=ACORAL_PERIOD_JOB_RUNNING;
+    policy_data->missed=0;
+    policy_data->release_ns=acoral_clock_ns();
     thread->policy_data=policy_data;
 
+	/* 先做准入检查，被拒绝的线程不用再分配定时器和栈。检查和挂到周期线程链表在同一个临界区里完成，
+	 * 检查的线程集合里才不会漏掉同时创建的线程 */
+	acoral_enter_critical();
+	if(period_admit(thread->cpu,thread)<0){
+		acoral_exit_critical();
+		printf("Period thread set on cpu%d is not schedulable, reject:%s\n",thread->cpu,thread->name);
+		goto err_data;
+	}
+	acoral_list_add2_tail(&thread->period_wait_hook,period_wait_queue());
+	acoral_exit_critical();
+
     /* 分配TCB中的period_timer */
-    acoral_timer_t* period_timer = (acoral_timer_t *)acoral_get_res(ACORAL_RES_TIMER);
+    acoral_enter_critical();
+    period_timer = (acoral_timer_t *)acoral_get_res(ACORAL_RES_TIMER);
+    acoral_exit_critical();
     if(NULL==period_timer){
         printf("Alloc thread timer fail\n");
         printf("No Mem Space or Beyond the max thread\n");
-        return -1;
+        goto err_admit;
     }
     acoral_init_list(&period_timer->delay_queue_hook);
     thread->thread_period_timer = period_timer;
@@ -61,99 +159,140 @@ static int period_policy_thread_init(acoral_thread_t *thread,void *data){
 
 	if(thread_stack_init(thread,period_thread_exit)!=0){
 		printf("No thread stack:%s\n",thread->name);
-		acoral_enter_critical();
-		acoral_release_res((acoral_res_t *)thread);
-		acoral_exit_critical();
-		return -1;
+		goto err_timer;
 	}
-        /*将线程就绪，并重新调度*/
-	acoral_resume_thread(thread);
+
 	acoral_enter_critical();
-	period_thread_delay(thread,((acoral_period_policy_data_t*)data)->period_time_mm);
+    /*将线程就绪，并重新调度*/
+	ready_thread(thread);
+	period_thread_delay(thread,policy_data->period_time_mm);
 	acoral_exit_critical();
+	acoral_sched();
 	return thread->res.id;
+
+err_timer:
+	acoral_enter_critical();
+	acoral_release_res((acoral_res_t *)period_timer);
+	acoral_exit_critical();
+err_admit:
+	/* 已经算进去了，取下来之后同一个核上其他线程的最坏响应时间重新算 */
+	acoral_enter_critical();
+	acoral_list_del(&thread->period_wait_hook);
+	period_admit(thread->cpu,NULL);
+	acoral_exit_critical();
+err_data:
+	acoral_free(policy_data);
+err_thread:
+	thread_create_fail(thread);
+	return -1;
 }
 
 void period_policy_thread_release(acoral_thread_t *thread){
-	acoral_free2(thread->policy_data);	
+	/* 从时间轮和周期线程链表上取下，否则daem回收TCB之后上面会留下野指针 */
+	acoral_timer_stop(thread->thread_period_timer);
+	acoral_list_del(&thread->period_wait_hook);
+	acoral_release_res((acoral_res_t *)thread->thread_period_timer);
+	acoral_free(thread->policy_data);
+	/* 少了一个线程，同一个核上其他线程的最坏响应时间只会变小，重新算一遍 */
+	period_admit(thread->cpu,NULL);
 }
 
-void acoral_periodqueue_add(acoral_thread_t *new){
-	acoral_list_t   *tmp,*head;
-	acoral_thread_t *thread;
-	int  delay2;
-	int  new_thread_period= new->thread_period_timer->delay_time;
-	head = &(((policy_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_POLICY].type_private_data))->global_period_wait_queue);
-	new->state|=ACORAL_THREAD_STATE_DELAY;
-
-    /* 找到period_wait_queue中新线程应该插入的位置并插入 */
-	for (tmp=head->next; delay2 = new_thread_period, tmp != head; tmp = tmp->next){
-		thread = list_entry (tmp, acoral_thread_t, period_wait_hook);
-		new_thread_period  = new_thread_period - thread->thread_period_timer->delay_time;
-		if (new_thread_period < 0)
-			break;
-	}
-	new->thread_period_timer->delay_time = delay2;
-	acoral_list_add(&new->period_wait_hook,tmp->prev);
+int acoral_period_get_wcrt(int thread_id){
+	acoral_thread_t *thread = (acoral_thread_t *)acoral_get_res_by_id(thread_id);
+	acoral_period_policy_data_t *policy_data;
+	int wcrt = -1;
 
-	/* 插入新线程后，后续线程的时间处理*/
-	if(tmp != head){
-		thread = list_entry(tmp, acoral_thread_t, period_wait_hook);
-		thread->thread_period_timer->delay_time-=delay2;
+	if(thread == NULL || thread->policy != ACORAL_SCHED_POLICY_PERIOD)
+		return -1;
+	acoral_enter_critical();
+	policy_data = (acoral_period_policy_data_t *)thread->policy_data;
+	if(policy_data->wcet_mm)
+		wcrt = policy_data->wcrt_mm;
+	acoral_exit_critical();
+	return wcrt;
+}
+
+/* 一个周期到了：线程函数返回了的，重置栈再就绪；在acoral_period_wait里等的直接就绪；没跑完的这次就不再释放了。然后开始等下一个周期 */
+static void period_timer_expire(acoral_timer_t *timer){
+	acoral_thread_t *thread = (acoral_thread_t *)acoral_get_res_by_id(timer->owner.id);
+	acoral_period_policy_data_t *policy_data = (acoral_period_policy_data_t *)thread->policy_data;
+
+	/* 已经被杀死的线程不再释放，等daem回收 */
+	if(thread->state&(ACORAL_THREAD_STATE_EXIT|ACORAL_THREAD_STATE_RELEASE))
+		return;
+	/* 只看作业状态，不看SUSPEND：作业中途在等信号量之类的也是挂起的，不能重置它的栈 */
+	switch(policy_data->job_state){
+	case ACORAL_PERIOD_JOB_DONE:
+		thread->stack=(unsigned int *)((char *)thread->stack_buttom+thread->stack_size-4);
+		thread->stack = HAL_STACK_INIT(thread->stack,thread->route,period_thread_exit,thread->args);
+		HAL_LOCK_STATUS_INIT(&thread->lock_status);
+		/* fall through */
+	case ACORAL_PERIOD_JOB_WAITING:
+		policy_data->job_state=ACORAL_PERIOD_JOB_RUNNING;
+		policy_data->release_ns=acoral_clock_ns();
+		ready_thread(thread);
+		break;
+	default:
+		policy_data->missed++;
+		break;
 	}
+	period_thread_delay(thread,policy_data->period_time_mm);
 }
 
 void period_thread_delay(acoral_thread_t* thread,unsigned int time){
-	thread->thread_period_timer->delay_time=time_to_ticks(time);
-	acoral_periodqueue_add(thread);
+	thread->state|=ACORAL_THREAD_STATE_DELAY;
+	acoral_timer_start(thread->thread_period_timer,time_to_ticks(time),period_timer_expire);
 }
 
-void period_delay_deal(){
-	// int need_re_sched= 0;
-	acoral_list_t *tmp,*tmp1,*head;
-	acoral_thread_t * thread;
-	head = &(((policy_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_POLICY].type_private_data))->global_period_wait_queue);
-	if(acoral_list_empty(head))
-	    	return;
-	thread=list_entry(head->next,acoral_thread_t,period_wait_hook);
-	thread->thread_period_timer->delay_time--;
-	for(tmp=head->next;tmp!=head;){
-		thread=list_entry(tmp,acoral_thread_t,period_wait_hook);
-		if(thread->thread_period_timer->delay_time>0)
-		    break;
-		/*防止add判断delay时取下thread*/
-		tmp1=tmp->next;
-		acoral_list_del(&thread->period_wait_hook);
-		tmp=tmp1;
-		if(thread->state&ACORAL_THREAD_STATE_SUSPEND){
-			thread->stack=(unsigned int *)((char *)thread->stack_buttom+thread->stack_size-4);
-			thread->stack = HAL_STACK_INIT(thread->stack,thread->route,period_thread_exit,thread->args);
-			ready_thread(thread);
-			// need_re_sched = 1;
-		}
-		period_thread_delay(thread,((acoral_period_policy_data_t*)thread->policy_data)->period_time_mm);
-		// if(need_re_sched)
-		// {
-		// 	acoral_sched();//SPG我是小丑，时钟中断里不能调度的，应该在把中断退出函数加回来
-		// }
-	}
+void period_thread_exit(){
+	/* 在临界区里标记并挂起，标记之后、挂起之前到期的释放会等挂起了再就绪 */
+	acoral_enter_critical();
+	((acoral_period_policy_data_t *)acoral_cur_thread->policy_data)->job_state=ACORAL_PERIOD_JOB_DONE;
+	acoral_suspend_self();
+	acoral_exit_critical();
 }
 
-void period_thread_exit(){
+int acoral_period_wait(void){
+	acoral_thread_t *cur = acoral_cur_thread;
+	acoral_period_policy_data_t *policy_data;
+	int missed;
+
+	if(cur->policy != ACORAL_SCHED_POLICY_PERIOD)
+		return -1;
+	acoral_enter_critical();
+	policy_data = (acoral_period_policy_data_t *)cur->policy_data;
+	missed = policy_data->missed;
+	policy_data->missed = 0;
+	policy_data->job_state = ACORAL_PERIOD_JOB_WAITING;
 	acoral_suspend_self();
+	acoral_exit_critical();
+	return missed;
+}
+
+unsigned long long acoral_period_get_release(int thread_id){
+	acoral_thread_t *thread = (acoral_thread_t *)acoral_get_res_by_id(thread_id);
+	unsigned long long release;
+
+	if(thread == NULL || thread->policy != ACORAL_SCHED_POLICY_PERIOD)
+		return 0;
+	acoral_enter_critical();
+	release = ((acoral_period_policy_data_t *)thread->policy_data)->release_ns;
+	acoral_exit_critical();
+	return release;
 }
 
 
 void period_policy_init(void){
-    /* 初始化全局周期线程等待队列 */
-    acoral_init_list(&(((policy_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_POLICY].type_private_data))->global_period_wait_queue));
+    /* 初始化周期线程链表 */
+    acoral_init_list(period_wait_queue());
 
-    acoral_sched_policy_t* period_policy = acoral_get_res(ACORAL_RES_POLICY);
+    acoral_sched_policy_t* period_policy = (acoral_sched_policy_t*)acoral_get_res(ACORAL_RES_POLICY);
 
 	period_policy->type=ACORAL_SCHED_POLICY_PERIOD;
 	period_policy->policy_thread_init=period_policy_thread_init;
 	period_policy->policy_thread_release=period_policy_thread_release;
-	period_policy->delay_deal=period_delay_deal;
+	period_policy->delay_deal=NULL;
+	period_policy->next_expiry=NULL;
 	acoral_register_sched_policy(period_policy);
 }
 
@@ -18,6 +18,7 @@
 #include "int.h"
 #include "comm_thrd.h"
 #include "period_thrd.h"
+#include "edf_thrd.h"
 #include "log.h"
 
 #include <stdio.h>
@@ -55,10 +56,8 @@ int acoral_policy_thread_init(acoralSchedPolicyEnum policy,acoral_thread_t *thre
     /* 取得策略控制块 */
 	policy_ctrl = acoral_get_policy_ctrl(policy);	
 	if(policy_ctrl == NULL || policy_ctrl->policy_thread_init == NULL){
-		acoral_enter_critical();
-		acoral_release_res((acoral_res_t *)thread);
-		acoral_exit_critical();
 		ACORAL_LOG_ERROR("No thread policy support:%d\n",thread->policy);
+		thread_create_fail(thread);
 		return -1;
 	}
 
@@ -82,6 +81,22 @@ void acoral_policy_delay_deal(){
 	}
 }
 
+unsigned int acoral_policy_next_expiry(){
+	acoral_list_t   *tmp,*head;
+	acoral_sched_policy_t  *policy_ctrl;
+	unsigned int next = ACORAL_POLICY_NO_EXPIRY, expiry;
+	head=&policy_list;
+	for(tmp=head->next;tmp!=head;tmp=tmp->next){
+		policy_ctrl=list_entry(tmp,acoral_sched_policy_t,list);
+		if(policy_ctrl->delay_deal==NULL)
+			continue;
+		expiry = policy_ctrl->next_expiry!=NULL ? policy_ctrl->next_expiry() : 1;
+		if(expiry<next)
+			next=expiry;
+	}
+	return next;
+}
+
 void system_policy_thread_release(acoral_thread_t *thread){
 	acoral_sched_policy_t   *policy_ctrl;
 	policy_ctrl=acoral_get_policy_ctrl(thread->policy);
@@ -97,6 +112,10 @@ void acoral_sched_policy_init(){
 #if CFG_THRD_PERIOD
 	period_policy_init();
 #endif
+
+#if CFG_THRD_EDF
+	edf_policy_init();
+#endif
 }
 
 
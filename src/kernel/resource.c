@@ -54,7 +54,7 @@ acoral_res_system_t acoral_res_system = {
             // .list = {NULL , NULL},                              
             .type_private_data = &(policy_res_private_data){
 #if CFG_THRD_PERIOD
-                .global_period_wait_queue = NULL
+                .global_period_wait_queue = NULL,
 #endif
             }
         },
@@ -77,27 +77,27 @@ acoral_res_system_t acoral_res_system = {
 #endif
 
 #if CFG_MSG
-        /* system_res_ctrl_container[ACORAL_RES_MST] */
+        /* system_res_ctrl_container[ACORAL_RES_MSG] */
         {
-            .type = ACORAL_RES_MST,
-            .size = sizeof(acoral_msgctr_t),            // 消息容器控制块的大小
+            .type = ACORAL_RES_MSG,
+            .size = sizeof(acoral_msg_t),               // 消息容器控制块的大小
             .num_per_pool = 10,                         // 每个消息容器控制块池中的消息容器控制块数量
             .num = 0,                                   // 初始时没有创建消息容器控制块池
             .max_pools = 4,                             // 最多允许创建消息容器控制块池的数量
-            .free_pools = LIST_HEAD_INIT(acoral_res_system.system_res_ctrl_container[ACORAL_RES_MST].free_pools),                                  
-            .pools = LIST_HEAD_INIT(acoral_res_system.system_res_ctrl_container[ACORAL_RES_MST].pools),                        
+            .free_pools = LIST_HEAD_INIT(acoral_res_system.system_res_ctrl_container[ACORAL_RES_MSG].free_pools),                                  
+            .pools = LIST_HEAD_INIT(acoral_res_system.system_res_ctrl_container[ACORAL_RES_MSG].pools),                           
             // .list = {NULL , NULL},                      
         },
 
-        /* system_res_ctrl_container[ACORAL_RES_MSG] */
+        /* system_res_ctrl_container[ACORAL_RES_MST] */
         {
-            .type = ACORAL_RES_MSG,
-            .size = sizeof(acoral_msg_t),               // 消息容器控制块的大小
+            .type = ACORAL_RES_MST,
+            .size = sizeof(acoral_msgctr_t),            // 消息容器控制块的大小
             .num_per_pool = 10,                         // 每个消息容器控制块池中的消息容器控制块数量
             .num = 0,                                   // 初始时没有创建消息容器控制块池
             .max_pools = 4,                             // 最多允许创建消息容器控制块池的数量
-            .free_pools = LIST_HEAD_INIT(acoral_res_system.system_res_ctrl_container[ACORAL_RES_MSG].free_pools),                                  
-            .pools = LIST_HEAD_INIT(acoral_res_system.system_res_ctrl_container[ACORAL_RES_MSG].pools),                           
+            .free_pools = LIST_HEAD_INIT(acoral_res_system.system_res_ctrl_container[ACORAL_RES_MST].free_pools),                                  
+            .pools = LIST_HEAD_INIT(acoral_res_system.system_res_ctrl_container[ACORAL_RES_MST].pools),                        
             // .list = {NULL , NULL},                      
         },
 #endif
@@ -107,14 +107,10 @@ acoral_res_system_t acoral_res_system = {
             .size = sizeof(acoral_timer_t),               // 消息容器控制块的大小
             .num_per_pool = 10,                         // 每个消息容器控制块池中的消息容器控制块数量
             .num = 0,                                   // 初始时没有创建消息容器控制块池
-            .max_pools = 2,                             // 最多允许创建消息容器控制块池的数量
+            .max_pools = 2 + CFG_APPTIMER * 2,          // 最多允许创建的池数，应用定时器也从这里分配，多留两个池
             .free_pools = LIST_HEAD_INIT(acoral_res_system.system_res_ctrl_container[ACORAL_RES_TIMER].free_pools),                                  
             .pools = LIST_HEAD_INIT(acoral_res_system.system_res_ctrl_container[ACORAL_RES_TIMER].pools),                             
             // .list = {NULL , NULL},                      
-            .type_private_data = &(timer_res_private_data){
-                .global_time_delay_queue = NULL,
-                .global_timeout_queue = NULL
-            }
         },
     }
 };
@@ -137,7 +133,8 @@ static int allocate_res_pool(acoral_res_pool_ctrl_t *pool_ctrl)
     acoral_enter_critical();
     int first_free_res_pool_index = acoral_find_first_bit_in_array(acoral_res_system.system_res_pools_bitmap, (CFG_MAX_RES_POOLS+31)/32, 0);
     if(first_free_res_pool_index == -1){
-        return NULL;
+        acoral_exit_critical();
+        return ACORAL_RES_NO_POOL;
     }
     acoral_set_bit_in_bitmap(first_free_res_pool_index, acoral_res_system.system_res_pools_bitmap);
     pool = &(acoral_res_system.system_res_pools[first_free_res_pool_index]);
@@ -145,6 +142,7 @@ static int allocate_res_pool(acoral_res_pool_ctrl_t *pool_ctrl)
 
     /* 定义pool的类型 */
 	pool->id = pool_ctrl->type << ACORAL_RES_TYPE_BIT | pool->id;
+	pool->type = pool_ctrl->type;
     
 	pool->size = pool_ctrl->size;
 	pool->num = pool_ctrl->num_per_pool;
@@ -319,6 +317,13 @@ void acoral_pool_ctrl_init(acoral_res_pool_ctrl_t *pool_ctrl)
 	// acoral_init_list(pool_ctrl->pools);
 	// acoral_init_list(pool_ctrl->free_pools);
 
+	/* ACORAL_RES_UNKNOWN这类没有资源大小的控制块不分配资源池，否则下面会除0（RISC-V上除0不会异常，x86上会） */
+	if (pool_ctrl->size == 0)
+	{
+		pool_ctrl->num_per_pool = 0;
+		return;
+	}
+
 	/* 调整资源池中资源的个数，以最大化利用分配的内存，详见绿书p144 */
 	size = acoral_malloc_adjust_size(pool_ctrl->size * pool_ctrl->num_per_pool);
 	if (size < pool_ctrl->size)
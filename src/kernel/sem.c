@@ -19,6 +19,7 @@
 #include "int.h"
 #include "soft_timer.h"
 #include "sem.h"
+#include "trace.h"
 #include <stdio.h>
 
 extern void acoral_evt_queue_del(acoral_thread_t *thread);
@@ -113,9 +114,11 @@ acoralSemRetValEnum acoral_sem_trypend(acoral_evt_t *evt)
 	return SEM_ERR_TIMEOUT;
 }
 
-acoralSemRetValEnum acoral_sem_pend(acoral_evt_t *evt, unsigned int timeout)
+/* timeout_ns不为0时用高精度定时器计超时，否则timeout毫秒换算成ticks；两个都是0就一直等 */
+static acoralSemRetValEnum sem_pend(acoral_evt_t *evt, unsigned int timeout, unsigned long long timeout_ns)
 {
 	acoral_thread_t *cur = acoral_cur_thread;
+	int timed = timeout > 0 || timeout_ns > 0;
 
 	if (acoral_intr_nesting)
 	{
@@ -134,6 +137,7 @@ acoralSemRetValEnum acoral_sem_pend(acoral_evt_t *evt, unsigned int timeout)
 
 	/* 计算信号量处理*/
 	acoral_enter_critical();
+	ACORAL_TRACE(ACORAL_TRACE_IPC_PEND, cur->res.id, evt->res.id);
 	if ((char)evt->count <= SEM_RES_AVAI)
 	{ /* available*/
 		evt->count++;
@@ -143,7 +147,9 @@ acoralSemRetValEnum acoral_sem_pend(acoral_evt_t *evt, unsigned int timeout)
 
 	evt->count++;
 	unrdy_thread(cur);
-	if (timeout > 0)
+	if (timeout_ns > 0)
+		timeout_queue_add_ns(cur, timeout_ns);
+	else if (timeout > 0)
 	{
 		cur->thread_timer->delay_time = time_to_ticks(timeout);
 		timeout_queue_add(cur);
@@ -154,7 +160,7 @@ acoralSemRetValEnum acoral_sem_pend(acoral_evt_t *evt, unsigned int timeout)
 	acoral_sched();
 
 	acoral_enter_critical();
-	if (timeout > 0 && cur->thread_timer->delay_time <= 0)
+	if (timed && cur->thread_timer->delay_time <= 0)
 	{
 		//--------------
 		// modify by pegasus 0804: count-- [+]
@@ -171,6 +177,16 @@ acoralSemRetValEnum acoral_sem_pend(acoral_evt_t *evt, unsigned int timeout)
 	return SEM_SUCCED;
 }
 
+acoralSemRetValEnum acoral_sem_pend(acoral_evt_t *evt, unsigned int timeout)
+{
+	return sem_pend(evt, timeout, 0);
+}
+
+acoralSemRetValEnum acoral_sem_pend_ns(acoral_evt_t *evt, unsigned long long timeout)
+{
+	return sem_pend(evt, 0, timeout);
+}
+
 acoralSemRetValEnum acoral_sem_post(acoral_evt_t *evt)
 {
 	acoral_thread_t *thread;
@@ -186,6 +202,7 @@ acoralSemRetValEnum acoral_sem_post(acoral_evt_t *evt)
 	}
 
 	acoral_enter_critical();
+	ACORAL_TRACE(ACORAL_TRACE_IPC_POST, acoral_cur_thread->res.id, evt->res.id);
 
 	/* 计算信号量的释放*/
 	if ((char)evt->count <= SEM_RES_NOAVAI)
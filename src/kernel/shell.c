@@ -125,7 +125,7 @@ void cmd_exe(char *buf){
 	}	
 }
 
-#define SHELL_STACK_SIZE 1024
+#define SHELL_STACK_SIZE 4096
 void system_shell_init(){
 
 	head_cmd=NULL;
@@ -29,19 +29,33 @@
 #include "thread.h"
 #include "log.h"
 #include "list.h"
+#include "trace.h"
 #include <stdbool.h>
 
 /*----------------*/
 /*  延时处理队列timeout*/
 /*  pegasus   0719*/
 /*----------------*/
-static unsigned int ticks;
+static unsigned long long ticks;	///<64位，几个月不关机也不会回绕；时间轮和acoral_get_ticks只用低32位
+
+#if CFG_TICKLESS
+unsigned char acoral_tickless_active;		///<周期ticks是否已经停掉，只在临界区中访问
+static acoral_tickless_stat_t tickless_stat;
+#endif
 
 int time_to_ticks(unsigned int mtime){
-	return (mtime)*CFG_TICKS_PER_SEC/1000; ///<计算time对应的ticks数量
+	/* 32位里乘CFG_TICKS_PER_SEC的话十几个小时的延时就溢出了，所以在64位里算。换算完最大有2^32/1000*CFG_TICKS_PER_SEC，
+	 * CFG_TICKS_PER_SEC超过500就放不进int，转成负数的话等待超时的地方会当成已经超时，这里饱和 */
+	unsigned long long ticks = ACORAL_MS_TO_TICKS(mtime);
+
+	return ticks > ACORAL_TICKS_MAX ? ACORAL_TICKS_MAX : (int)ticks;
 }
 
 unsigned int acoral_get_ticks(){
+	return (unsigned int)ticks;
+}
+
+unsigned long long acoral_get_ticks64(void){
 	return ticks;
 }
 
@@ -49,137 +63,330 @@ void acoral_set_ticks(unsigned int time){
   	ticks=time;
 }
 
-void acoral_ticks_entry(){
-	ticks++;
-	time_delay_deal();
-	acoral_policy_delay_deal();
-	/*--------------------*/
-	/* 超时链表处理函数*/
-	/* pegasus  0719*/
-	/*--------------------*/
-	timeout_delay_deal();
+static acoral_timer_wheel_t timer_wheel;	///<系统时间轮，延时、IPC超时、周期和EDF的释放、延时工作项都挂在上面
+
+#define TIMER_WHEEL_MASK (ACORAL_TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_INDEX(wheel, level) (((wheel)->base >> ((level) * ACORAL_TIMER_WHEEL_BITS)) & TIMER_WHEEL_MASK)
+
+/* 按到期时间离base还有多远决定放在哪一层的哪个槽 */
+static void timer_wheel_insert(acoral_timer_wheel_t *wheel, acoral_timer_t *timer){
+	unsigned int expires = timer->expires;
+	unsigned int idx = expires - wheel->base;
+	int level;
+
+	if(idx > ACORAL_TIMER_WHEEL_MAX){
+		idx = ACORAL_TIMER_WHEEL_MAX;
+		expires = wheel->base + idx;
+	}
+	for(level = 0; level < ACORAL_TIMER_WHEEL_LEVELS - 1; level++){
+		if(idx < 1u << ((level + 1) * ACORAL_TIMER_WHEEL_BITS))
+			break;
+	}
+	acoral_list_add2_tail(&timer->delay_queue_hook, &wheel->slots[level][(expires >> (level * ACORAL_TIMER_WHEEL_BITS)) & TIMER_WHEEL_MASK]);
 }
 
-int system_ticks_init(){
-	ticks=0;    	/*初始化滴答时钟计数器*/
-	return hal_timer_init(CFG_TICKS_PER_SEC, acoral_ticks_entry, NULL);
+/* 把槽上的timer整个挪到to上，槽清空 */
+static void timer_slot_move(acoral_list_t *slot, acoral_list_t *to){
+	acoral_init_list(to);
+	if(acoral_list_empty(slot))
+		return;
+	to->next = slot->next;
+	to->prev = slot->prev;
+	to->next->prev = to;
+	to->prev->next = to;
+	acoral_init_list(slot);
 }
 
+/* 上一层当前槽里的timer离到期都不到一圈了，重新放一次，会落到下面的层 */
+static void timer_wheel_cascade(acoral_timer_wheel_t *wheel, int level){
+	acoral_list_t list;
+	acoral_timer_t *timer;
 
-void acoral_delayqueue_add(acoral_list_t *queue, acoral_thread_t *new){
-	acoral_list_t   *tmp, *head;
-	acoral_thread_t *thread;
-	int  delay2;
-	int  delay= new->thread_timer->delay_time;
-	head=queue;
-	acoral_enter_critical();
-	/*这里采用关ticks中断，不用关中断，是为了减少最大关中断时间，下面是个链表，时间不确定。*/
-	/*这里可以看出，延时函数会有些误差，因为ticks中断可能被延迟*/
-
-	new->state|=ACORAL_THREAD_STATE_DELAY;
-	for (tmp=head->next;delay2=delay,tmp!=head; tmp=tmp->next){
-		thread = (acoral_thread_t *)acoral_get_res_by_id(((acoral_timer_t*)list_entry(tmp, acoral_timer_t, delay_queue_hook))->owner.id);
-		delay  = delay-thread->thread_timer->delay_time;
-		if (delay < 0)
+	timer_slot_move(&wheel->slots[level][TIMER_WHEEL_INDEX(wheel, level)], &list);
+	while(!acoral_list_empty(&list)){
+		timer = list_entry(list.next, acoral_timer_t, delay_queue_hook);
+		acoral_list_del(&timer->delay_queue_hook);
+		timer_wheel_insert(wheel, timer);
+	}
+}
+
+void acoral_timer_wheel_init(acoral_timer_wheel_t *wheel, unsigned int now){
+	int level, i;
+
+	for(level = 0; level < ACORAL_TIMER_WHEEL_LEVELS; level++)
+		for(i = 0; i < ACORAL_TIMER_WHEEL_SLOTS; i++)
+			acoral_init_list(&wheel->slots[level][i]);
+	wheel->base = now + 1;
+}
+
+void acoral_timer_wheel_add(acoral_timer_wheel_t *wheel, acoral_timer_t *timer, int ticks, void (*expire)(acoral_timer_t *timer)){
+	if(ticks < 1)
+		ticks = 1;
+	acoral_list_del(&timer->delay_queue_hook);
+	timer->delay_time = ticks;
+	/* base-1是当前的tick，在expire里重新启动时也一样 */
+	timer->expires = wheel->base - 1 + ticks;
+	timer->expire = expire;
+	timer_wheel_insert(wheel, timer);
+}
+
+void acoral_timer_wheel_tick(acoral_timer_wheel_t *wheel){
+	unsigned int index = wheel->base & TIMER_WHEEL_MASK;
+	acoral_list_t list;
+	acoral_timer_t *timer;
+	int level;
+
+	/* 第0层转完一圈，从上一层分一个槽下来；上一层也转完一圈的话再往上 */
+	if(index == 0){
+		for(level = 1; level < ACORAL_TIMER_WHEEL_LEVELS; level++){
+			timer_wheel_cascade(wheel, level);
+			if(TIMER_WHEEL_INDEX(wheel, level) != 0)
+				break;
+		}
+	}
+	wheel->base++;
+	/* 先整个取下来再处理，expire里重新启动的timer就算落回这个槽也要等下一圈 */
+	timer_slot_move(&wheel->slots[0][index], &list);
+	while(!acoral_list_empty(&list)){
+		timer = list_entry(list.next, acoral_timer_t, delay_queue_hook);
+		acoral_list_del(&timer->delay_queue_hook);
+		timer->delay_time = 0;
+		timer->expire(timer);
+	}
+}
+
+unsigned int acoral_timer_wheel_next(acoral_timer_wheel_t *wheel){
+	unsigned int next = ACORAL_POLICY_NO_EXPIRY, delta, cur;
+	acoral_list_t *head, *tmp;
+	int level, i;
+
+	/* 第0层的槽正好一个tick一个，从当前位置往后第一个非空的槽就是这一层最早的 */
+	cur = wheel->base & TIMER_WHEEL_MASK;
+	for(i = 0; i < ACORAL_TIMER_WHEEL_SLOTS; i++){
+		if(!acoral_list_empty(&wheel->slots[0][(cur + i) & TIMER_WHEEL_MASK])){
+			next = i + 1;
+			break;
+		}
+	}
+	/* 上面的层从当前槽的下一个开始排，当前槽是最晚的；但base正好在这一层的槽边界上时，当前槽要到处理base这个tick时才往下分，
+	 * 里面是最早的。第一个非空的槽里找最早的 */
+	for(level = 1; level < ACORAL_TIMER_WHEEL_LEVELS; level++){
+		cur = TIMER_WHEEL_INDEX(wheel, level);
+		for(i = (wheel->base & ((1u << (level * ACORAL_TIMER_WHEEL_BITS)) - 1)) ? 1 : 0; i <= ACORAL_TIMER_WHEEL_SLOTS; i++){
+			head = &wheel->slots[level][(cur + i) & TIMER_WHEEL_MASK];
+			if(acoral_list_empty(head))
+				continue;
+			for(tmp = head->next; tmp != head; tmp = tmp->next){
+				delta = list_entry(tmp, acoral_timer_t, delay_queue_hook)->expires - (wheel->base - 1);
+				if(delta < next)
+					next = delta;
+			}
 			break;
+		}
 	}
-	new->thread_timer->delay_time = delay2;
-	acoral_list_add(&new->thread_timer->delay_queue_hook,tmp->prev);
-	/* 插入等待任务后，后继等待任务时间处理*/
-	if(tmp != head){
-		thread = (acoral_thread_t *)acoral_get_res_by_id(((acoral_timer_t*)list_entry(tmp, acoral_timer_t, delay_queue_hook))->owner.id);
-		thread->thread_timer->delay_time-=delay2;
+	return next;
+}
+
+void acoral_timer_start(acoral_timer_t *timer, int ticks, void (*expire)(acoral_timer_t *timer)){
+	acoral_timer_wheel_add(&timer_wheel, timer, ticks, expire);
+}
+
+void acoral_timer_stop(acoral_timer_t *timer){
+	acoral_list_del(&timer->delay_queue_hook);
+}
+
+#if CFG_HRTIMER
+static acoral_list_t hrtimer_queue;	///<高精度定时器队列，按hr_expires从早到晚排，最早的设在硬件比较器里
+#endif
+
+unsigned long long acoral_clock_ns(void){
+	return HAL_HRTIMER_NOW();
+}
+
+void acoral_hrtimer_start(acoral_timer_t *timer, unsigned long long ns, void (*expire)(acoral_timer_t *timer)){
+#if CFG_HRTIMER
+	acoral_list_t *tmp;
+
+	/* 至少晚1纳秒，expire里用0重新启动也不会在同一次中断里转个不停 */
+	if(ns < 1)
+		ns = 1;
+	acoral_list_del(&timer->delay_queue_hook);
+	/* 不按tick计，只要不是0就行，到期时和时间轮一样清零 */
+	timer->delay_time = 1;
+	timer->hr_expires = HAL_HRTIMER_NOW() + ns;
+	timer->expire = expire;
+	/* 一般是最晚的，从队尾往前找第一个不比它晚的插在后面，同时到期的按启动的先后 */
+	for(tmp = hrtimer_queue.prev; tmp != &hrtimer_queue; tmp = tmp->prev){
+		if(!ACORAL_TIME_AFTER(list_entry(tmp, acoral_timer_t, delay_queue_hook)->hr_expires, timer->hr_expires))
+			break;
 	}
-	unrdy_thread(new);
+	acoral_list_add(&timer->delay_queue_hook, tmp);
+	if(hrtimer_queue.next == &timer->delay_queue_hook)
+		HAL_HRTIMER_SET(timer->hr_expires);
+#else
+	unsigned long long n = ACORAL_NS_TO_TICKS_UP(ns);
 
+	acoral_timer_start(timer, n > 0x7fffffff ? 0x7fffffff : (int)n, expire);
+#endif
+}
+
+#if CFG_HRTIMER
+void acoral_hrtimer_entry(void *args){
+	unsigned long long now;
+	acoral_timer_t *timer;
+
+	acoral_enter_critical();
+	ACORAL_TRACE(ACORAL_TRACE_IRQ_ENTER, acoral_cur_thread ? acoral_cur_thread->res.id : -1, ACORAL_TRACE_VEC_HRTIMER);
+	/* 停掉队首的timer时不去改比较器，这时候会空来一次，找不到到期的，重新设到新的队首就行 */
+	now = HAL_HRTIMER_NOW();
+	while(!acoral_list_empty(&hrtimer_queue)){
+		timer = list_entry(hrtimer_queue.next, acoral_timer_t, delay_queue_hook);
+		if(ACORAL_TIME_AFTER(timer->hr_expires, now))
+			break;
+		acoral_list_del(&timer->delay_queue_hook);
+		timer->delay_time = 0;
+		timer->expire(timer);
+	}
+	if(acoral_list_empty(&hrtimer_queue))
+		HAL_HRTIMER_CANCEL();
+	else
+		HAL_HRTIMER_SET(list_entry(hrtimer_queue.next, acoral_timer_t, delay_queue_hook)->hr_expires);
+	ACORAL_TRACE(ACORAL_TRACE_IRQ_EXIT, acoral_cur_thread ? acoral_cur_thread->res.id : -1, ACORAL_TRACE_VEC_HRTIMER);
 	acoral_exit_critical();
-	acoral_sched();
-	return;
-}
-
-void time_delay_deal(){
-	acoral_list_t   *tmp,*tmp1,*head;
-	acoral_thread_t *thread;
-	head = &(((timer_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_TIMER].type_private_data))->global_time_delay_queue);
-	if(acoral_list_empty(head))
-	  	return;
-	thread=(acoral_thread_t *)acoral_get_res_by_id(((acoral_timer_t*)list_entry(head->next, acoral_timer_t, delay_queue_hook))->owner.id);
-	thread->thread_timer->delay_time--;
-	for(tmp=head->next;tmp!=head;){
-		thread=(acoral_thread_t *)acoral_get_res_by_id(((acoral_timer_t*)list_entry(tmp, acoral_timer_t, delay_queue_hook))->owner.id);
-		if(thread->thread_timer->delay_time>0)
-		    break;
-		/*防止add判断delay时取下thread*/
-
-		tmp1=tmp->next;
-		acoral_list_del(&thread->thread_timer->delay_queue_hook);
-
-		tmp=tmp1;
-		thread->state&=~ACORAL_THREAD_STATE_DELAY;
-		ready_thread(thread);
+}
+#endif
+
+void acoral_time_init(void){
+	acoral_timer_wheel_init(&timer_wheel, (unsigned int)ticks);
+#if CFG_HRTIMER
+	acoral_init_list(&hrtimer_queue);
+#endif
+}
+
+/**
+ * @brief 走n个tick，每个tick依次处理时间轮和各调度策略
+ * @note 在临界区中调用
+ *
+ * @param n tick数
+ */
+static void ticks_advance(unsigned int n){
+	while(n--){
+		ticks++;
+		acoral_timer_wheel_tick(&timer_wheel);
+		acoral_policy_delay_deal();
 	}
 }
 
-void timeout_queue_add(acoral_thread_t *new)
-{
-	acoral_list_t   *tmp ,*head;
-	acoral_thread_t *thread;
-	int  delay2;
-	int  delay= new->thread_timer->delay_time; //SPG用tcb的delay，delay线程也用delay成员，冲突？
-	head = &(((timer_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_TIMER].type_private_data))->global_timeout_queue);
+void acoral_ticks_entry(){
+	unsigned int n = 1;
+	/* 中断里本来就关着中断，进临界区是为了拿内核大锁，和其它核互斥 */
+	acoral_enter_critical();
+	ACORAL_TRACE(ACORAL_TRACE_IRQ_ENTER, acoral_cur_thread ? acoral_cur_thread->res.id : -1, ACORAL_TRACE_VEC_TICK);
+#if CFG_TICKLESS
+	/* 单次定时到期，恢复周期ticks，把睡过去的tick补上 */
+	if(acoral_tickless_active){
+		acoral_tickless_active = 0;
+		n = HAL_TICKLESS_EXIT();
+		if(n == 0)
+			n = 1;
+		tickless_stat.ticks += n;
+	}
+#endif
+	ticks_advance(n);
+	ACORAL_TRACE(ACORAL_TRACE_IRQ_EXIT, acoral_cur_thread ? acoral_cur_thread->res.id : -1, ACORAL_TRACE_VEC_TICK);
+	acoral_exit_critical();
+}
+
+#if CFG_TICKLESS
+void acoral_tickless_exit(){
+	unsigned int n;
 	acoral_enter_critical();
+	/* 先清标志，补tick时就绪线程又会走到这里 */
+	if(acoral_tickless_active){
+		acoral_tickless_active = 0;
+		n = HAL_TICKLESS_EXIT();
+		tickless_stat.ticks += n;
+		ticks_advance(n);
+	}
+	acoral_exit_critical();
+}
+
+void acoral_tickless_idle(){
+	thread_res_private_data *thread_data = (thread_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_THREAD].type_private_data);
+	unsigned int next, expiry;
+	int cpu;
 
-	for (tmp=head->next;delay2=delay,tmp!=head; tmp=tmp->next){
-		thread = list_entry (tmp, acoral_thread_t, timeout_hook);
-		delay  = delay-thread->thread_timer->delay_time;
-		if (delay < 0)
+	/* ticks只发给0号核，由它来停；其它核直接睡，等核间中断 */
+	if(acoral_current_cpu() != 0){
+		HAL_CPU_SLEEP();
+		return;
+	}
+	acoral_enter_critical();
+	for(cpu = 0; cpu < CFG_MAX_CPU; cpu++){
+		/* 每个核都只剩idle线程在跑，而且没有待处理的调度 */
+		if(acoral_cur_threads[cpu] == NULL || acoral_cur_threads[cpu]->prio != ACORAL_IDLE_PRIO
+			|| thread_data->global_ready_queue[cpu].num != 1 || system_need_scheds[cpu])
 			break;
 	}
-	new->thread_timer->delay_time = delay2;
-	acoral_list_add(&new->timeout_hook,tmp->prev);
-	/* 插入等待任务后，后继等待任务时间处理*/
-	if(tmp != head){
-		thread = list_entry(tmp, acoral_thread_t, timeout_hook);
-		thread->thread_timer->delay_time-=delay2;
+	if(!acoral_tickless_active && cpu == CFG_MAX_CPU){
+		next = acoral_timer_wheel_next(&timer_wheel);
+		expiry = acoral_policy_next_expiry();
+		if(expiry < next)
+			next = expiry;
+		if(next > CFG_TICKLESS_MAX_TICKS)
+			next = CFG_TICKLESS_MAX_TICKS;
+		/* 下一个tick就有事，停了也省不下什么 */
+		if(next > 1 && HAL_TICKLESS_ENTER(next) == 0){
+			acoral_tickless_active = 1;
+			tickless_stat.sleeps++;
+		}
 	}
+	acoral_exit_critical();
+	HAL_CPU_SLEEP();
+}
 
+void acoral_tickless_get_stat(acoral_tickless_stat_t *stat){
+	acoral_enter_critical();
+	*stat = tickless_stat;
 	acoral_exit_critical();
-	return;
 }
+#endif
 
-void timeout_queue_del(acoral_thread_t *new)
-{
-	if (acoral_list_empty(&new->timeout_hook))
-		return;
-	acoral_list_del(&new->timeout_hook);
-	return;
+int system_ticks_init(){
+	ticks=0;    	/*初始化滴答时钟计数器*/
+#if CFG_HRTIMER
+	if(hal_hrtimer_init(acoral_hrtimer_entry, NULL) != 0)
+		return -1;
+#endif
+	return hal_timer_init(CFG_TICKS_PER_SEC, acoral_ticks_entry, NULL);
 }
 
-void timeout_delay_deal()
+
+/* 等待超时：不管线程还在不在等待队列上都把它就绪，由等待的地方看delay_time判断是超时醒来的 */
+static void timeout_timer_expire(acoral_timer_t *timer){
+	acoral_thread_t *thread = (acoral_thread_t *)acoral_get_res_by_id(timer->owner.id);
+
+	ACORAL_TRACE(ACORAL_TRACE_TIMER, thread->res.id, 1);
+	ready_thread(thread);
+}
+
+void timeout_queue_add(acoral_thread_t *new)
 {
-	acoral_list_t *tmp, *tmp1, *head;
-	acoral_thread_t  *thread;
+	acoral_enter_critical();
+	acoral_timer_start(new->thread_timer, new->thread_timer->delay_time, timeout_timer_expire);
+	acoral_exit_critical();
+}
 
-	head = &(((timer_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_TIMER].type_private_data))->global_timeout_queue);
-	if(acoral_list_empty(head))
-	{
-	  	return;
-	}
+void timeout_queue_add_ns(acoral_thread_t *new, unsigned long long ns)
+{
+	acoral_enter_critical();
+	acoral_hrtimer_start(new->thread_timer, ns, timeout_timer_expire);
+	acoral_exit_critical();
+}
 
-	thread=list_entry(head->next,acoral_thread_t,timeout_hook);
-	if (thread->thread_timer->delay_time>0)
-		thread->thread_timer->delay_time--;
-	for(tmp=head->next;tmp!=head;)
-	{
-		thread=list_entry(tmp,acoral_thread_t,timeout_hook);
-		if(thread->thread_timer->delay_time>0)
-		    break;
-
-		tmp1=tmp->next;
-		acoral_list_del(&thread->timeout_hook);
-
-		tmp=tmp1;
-		/*thread->state*/
-		ready_thread(thread);
-	}
+void timeout_queue_del(acoral_thread_t *new)
+{
+	acoral_enter_critical();
+	acoral_timer_stop(new->thread_timer);
+	acoral_exit_critical();
 }
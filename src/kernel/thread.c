@@ -9,34 +9,154 @@
 #include "thread.h"
 #include "int.h"
 #include "log.h"
+#include "bitops.h"
+#include "balance.h"
+#include "edf_thrd.h"
+#include "trace.h"
 
 #include "hal.h"
 
 #include <stdio.h>
+#include <string.h>
 
 extern void acoral_evt_queue_del(acoral_thread_t *thread);
 extern int daemon_id;
 
-/// aCoral是否需要调度标志，仅当aCoral就绪队列ready_queue有线程加入或被取下时，该标志被置为true；
-/// 当发生调度之后，该标志位被置为false，直到又有新的线程被就绪或者挂起
-unsigned char system_need_sched = false; 
+/// 每个核的aCoral是否需要调度标志，仅当这个核的就绪队列有线程加入或被取下时，该标志被置为true；
+/// 当这个核发生调度之后，该标志位被置为false，直到又有新的线程被就绪或者挂起
+unsigned char system_need_scheds[CFG_MAX_CPU]; 
 
 /// aCoral初始化完成之前，调度都是被上锁的 
 unsigned char system_sched_locked = true;
 
-/// acoral当前运行的线程
-acoral_thread_t *acoral_cur_thread = NULL;		
+/// 每个核当前运行的线程
+acoral_thread_t *acoral_cur_threads[CFG_MAX_CPU];		
 
-int acoral_create_thread(char *name, void (*route)(void *args),void *args,unsigned int stack_size,acoralSchedPolicyEnum sched_policy,unsigned char prio,acoralPrioTypeEnum prio_type,void *data){
+#if CFG_THRD_CACHE
+#define THRD_CACHE_CLASSES 4 ///<按栈大小分档：不超过下限的1、2、4倍各一档，更大的都在最后一档
+
+/**
+ * @brief 线程缓存：退出的线程把TCB、thread_timer和栈整套留下，下次创建栈大小相近的线程直接拿来用，
+ *        不用再走资源池和acoral_malloc，也不用等daem回收
+ * @note 只在临界区里访问
+ */
+typedef struct{
+	acoral_list_t head;		///<通过daem_hook挂着缓存的线程
+	unsigned int num;		///<这一档缓存了几个，不超过CFG_THRD_CACHE
+}acoral_thread_cache_t;
+
+static acoral_thread_cache_t thread_cache[THRD_CACHE_CLASSES];
+
+static acoral_thread_cache_t *thread_cache_class(unsigned int stack_size){
+	int c = 0;
+
+	while(c < THRD_CACHE_CLASSES - 1 && stack_size > ((unsigned int)CFG_MIN_STACK_SIZE << c))
+		c++;
+	return &thread_cache[c];
+}
+
+static void thread_cache_init(void){
+	int c;
+
+	for(c = 0; c < THRD_CACHE_CLASSES; c++){
+		acoral_init_list(&thread_cache[c].head);
+		thread_cache[c].num = 0;
+	}
+}
+
+/* 把线程挂到它那一档的缓存上，临界区里调用，这一档满了返回-1 */
+static int thread_cache_add(acoral_thread_t *thread){
+	acoral_thread_cache_t *cache = thread_cache_class(thread->stack_size);
+
+	if(cache->num >= CFG_THRD_CACHE)
+		return -1;
+	acoral_list_add2_tail(&thread->daem_hook, &cache->head);
+	cache->num++;
+	return 0;
+}
+
+/**
+ * @brief 把被杀掉的线程放进缓存，临界区里调用
+ * @note 自己退出的线程放进来时还是EXIT状态，栈还在用，要等它所在的核切走它变成RELEASE之后才能被拿走；
+ *       调度策略的数据不跟着缓存，现在就释放，和daem回收时做的一样
+ *
+ * @param thread 已经从就绪队列和等待队列上取下的线程
+ * @return int 0：放进去了；-1：这一档满了，还是交给daem释放
+ */
+static int thread_cache_put(acoral_thread_t *thread){
+	if(thread_cache_class(thread->stack_size)->num >= CFG_THRD_CACHE)
+		return -1;
+	system_policy_thread_release(thread);
+#if CFG_STACK_LEARN
+	acoral_stack_learn(thread);
+#endif
+	return thread_cache_add(thread);
+}
+
+/**
+ * @brief 从缓存里拿一个已经被切走、栈不小于stack_size的线程，临界区里调用
+ *
+ * @param stack_size 要的栈大小
+ * @return acoral_thread_t* 拿到的线程，TCB资源id、thread_timer和栈都还是原来的；没有合适的返回NULL
+ */
+static acoral_thread_t *thread_cache_get(unsigned int stack_size){
+	acoral_thread_cache_t *cache = thread_cache_class(stack_size);
+	acoral_list_t *tmp;
+	acoral_thread_t *thread;
+
+	for(tmp = cache->head.next; tmp != &cache->head; tmp = tmp->next){
+		thread = list_entry(tmp, acoral_thread_t, daem_hook);
+		if(thread->state != ACORAL_THREAD_STATE_RELEASE || thread->stack_size < stack_size)
+			continue;
+		acoral_list_del(tmp);
+		cache->num--;
+		return thread;
+	}
+	return NULL;
+}
+#else
+#define thread_cache_init()
+#define thread_cache_add(thread) (-1)
+#define thread_cache_put(thread) (-1)
+#define thread_cache_get(stack_size) NULL
+#endif
+
+int acoral_create_thread(char *name, void (*route)(void *args),void *args,unsigned int stack_size,acoralSchedPolicyEnum sched_policy,unsigned int prio,acoralPrioTypeEnum prio_type,void *data){
+	return acoral_create_thread_affinity(name, route, args, stack_size, sched_policy, prio, prio_type, data, ACORAL_CPU_ANY);
+}
+
+int acoral_create_thread_affinity(char *name, void (*route)(void *args),void *args,unsigned int stack_size,acoralSchedPolicyEnum sched_policy,unsigned int prio,acoralPrioTypeEnum prio_type,void *data,int affinity){
 	acoral_thread_t* thread;
-    acoral_timer_t* thread_timer;
 
-    /* 分配TCB资源*/
-	thread = (acoral_thread_t *)acoral_get_res(ACORAL_RES_THREAD);
-	if(NULL == thread){
-		ACORAL_LOG_ERROR("Alloc thread:%s fail, No Mem Space or Beyond the max thread\n",name);
+	if (affinity != ACORAL_CPU_ANY && (affinity < 0 || affinity >= CFG_MAX_CPU)){
+		ACORAL_LOG_ERROR("Create thread:%s fail, no cpu %d\n",name,affinity);
 		return -1;
 	}
+    acoral_timer_t* thread_timer;
+
+    /* 传0用默认大小，自己指定的只要不低于下限就照办，先定下来才能去缓存里找合适的栈 */
+    stack_size &= ~(hal_sp_align-1); //确保堆栈是hal_sp_align字节对齐的
+    if(stack_size == 0)
+        stack_size = CFG_DEFAULT_STACK_SIZE;
+    else if(stack_size < CFG_MIN_STACK_SIZE)
+        stack_size = CFG_MIN_STACK_SIZE;
+
+    /* 优先拿退出线程留下的整套TCB、thread_timer和栈，拿不到再分配TCB资源 */
+	acoral_enter_critical();
+	thread = thread_cache_get(stack_size);
+	acoral_exit_critical();
+	if(thread != NULL){
+		stack_size = thread->stack_size;
+		thread_timer = thread->thread_timer;
+	}else{
+		thread = (acoral_thread_t *)acoral_get_res(ACORAL_RES_THREAD);
+		if(NULL == thread){
+			ACORAL_LOG_ERROR("Alloc thread:%s fail, No Mem Space or Beyond the max thread\n",name);
+			return -1;
+		}
+		thread->stack_buttom = NULL;
+		thread_timer = NULL;
+	}
 
     /* TCB 基本信息初始化 */
 	thread->name = name;
@@ -46,7 +166,13 @@ int acoral_create_thread(char *name, void (*route)(void *args),void *args,unsign
     thread->policy = sched_policy;
     thread->prio = prio;
     thread->prio_type = prio_type;
-	thread->stack_size = stack_size&(~(hal_sp_align-1)); //确保堆栈是hal_sp_align字节对齐的
+	thread->stack_size = stack_size;
+    thread->affinity = affinity;
+    if (affinity == ACORAL_CPU_ANY){
+        thread->cpu = acoral_balance_select_cpu();
+        acoral_balance_stats[thread->cpu].placements++;
+    }else
+        thread->cpu = affinity;
 
     /* 根据优先级类型调整prio */
     if (thread->prio_type == ACORAL_NONHARD_PRIO){
@@ -62,16 +188,23 @@ int acoral_create_thread(char *name, void (*route)(void *args),void *args,unsign
 	//  	}
 	//  }
 
+#if CFG_THRD_STATS
+    memset(&thread->stat, 0, sizeof(thread->stat));
+#endif
+
     /* 钩子初始化 */
-    acoral_init_list(&thread->timeout_hook);
     acoral_init_list(&thread->ready_hook);
     acoral_init_list(&thread->daem_hook);
     acoral_init_list(&thread->ipc_waiting_hook);
 
     /* 初始化 thread_timer */
-    thread_timer = (acoral_timer_t *)acoral_get_res(ACORAL_RES_TIMER);
+    if(NULL == thread_timer)
+        thread_timer = (acoral_timer_t *)acoral_get_res(ACORAL_RES_TIMER);
     if(NULL == thread_timer){
 		ACORAL_LOG_ERROR("Alloc thread timer fail\n");
+		acoral_enter_critical();
+		acoral_release_res((acoral_res_t *)thread);
+		acoral_exit_critical();
 		return -1;
 	}
     acoral_init_list(&thread_timer->delay_queue_hook);
@@ -82,9 +215,26 @@ int acoral_create_thread(char *name, void (*route)(void *args),void *args,unsign
 	return acoral_policy_thread_init(sched_policy,thread,data);
 }
 
+void thread_create_fail(acoral_thread_t *thread){
+	acoral_enter_critical();
+	/* 线程从没运行过，也没挂到任何队列上，可以直接拿去重用 */
+	acoral_timer_stop(thread->thread_timer);
+	thread->state = ACORAL_THREAD_STATE_RELEASE;
+	if(thread->stack_buttom == NULL || thread_cache_add(thread) != 0){
+		if(thread->stack_buttom != NULL)
+			acoral_free((void *)thread->stack_buttom);
+		acoral_release_res((acoral_res_t *)thread->thread_timer);
+		acoral_release_res((acoral_res_t *)thread);
+	}
+	acoral_exit_critical();
+}
+
 static void suspend_thread(acoral_thread_t *thread){
+	/* 在临界区内调度：挂起自己时，直到上下文保存完才放开内核大锁，别的核才能唤醒或重置这个线程 */
+	acoral_enter_critical();
 	unrdy_thread(thread);
 	acoral_sched();
+	acoral_exit_critical();
 }
 
 void acoral_suspend_self(){
@@ -97,7 +247,9 @@ void acoral_suspend_thread_by_id(int thread_id){
 }
 
 void acoral_resume_thread(acoral_thread_t *thread){
+	acoral_enter_critical();
 	ready_thread(thread);
+	acoral_exit_critical();
 	acoral_sched();
 }
 void acoral_resume_thread_by_id(int thread_id){
@@ -105,19 +257,41 @@ void acoral_resume_thread_by_id(int thread_id){
 	acoral_resume_thread(thread);
 }
 
-static void delay_thread(acoral_thread_t* thread,unsigned int time_mm){
+/* 延时到了，清掉延时状态，把线程就绪 */
+static void delay_timer_expire(acoral_timer_t *timer){
+	acoral_thread_t *thread = (acoral_thread_t *)acoral_get_res_by_id(timer->owner.id);
+
+	thread->state&=~ACORAL_THREAD_STATE_DELAY;
+	ACORAL_TRACE(ACORAL_TRACE_TIMER, thread->res.id, 0);
+	ready_thread(thread);
+}
+
+/* time_ns不为0时用高精度定时器，否则把time_mm换算成ticks放到时间轮上 */
+static void delay_thread(acoral_thread_t* thread,unsigned int time_mm,unsigned long long time_ns){
+	acoral_enter_critical();
     /* 线程已经处在某个等待队列中，则不能再去等待另一个 */
-	if(!acoral_list_empty(&thread->thread_timer->delay_queue_hook)){
+	if(acoral_timer_pending(thread->thread_timer)){
+		acoral_exit_critical();
 		return;	
 	}
-
-	thread->thread_timer->delay_time = time_to_ticks(time_mm);
-	/**/
-	acoral_delayqueue_add(&(((timer_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_TIMER].type_private_data))->global_time_delay_queue),thread);
+	thread->state|=ACORAL_THREAD_STATE_DELAY;
+	if(time_ns)
+		acoral_hrtimer_start(thread->thread_timer, time_ns, delay_timer_expire);
+	else
+		acoral_timer_start(thread->thread_timer, time_to_ticks(time_mm), delay_timer_expire);
+	unrdy_thread(thread);
+	acoral_exit_critical();
+	acoral_sched();
 }
 
 void acoral_delay_self(unsigned int time){
-	delay_thread(acoral_cur_thread,time);
+	delay_thread(acoral_cur_thread,time,0);
+}
+
+void acoral_delay_us(unsigned int time){
+	if(time == 0)
+		return;
+	delay_thread(acoral_cur_thread,0,time*1000ull);
 }
 
 void acoral_kill_thread(acoral_thread_t *thread){
@@ -126,16 +300,12 @@ void acoral_kill_thread(acoral_thread_t *thread){
 
 	if(thread->state & ACORAL_THREAD_STATE_SUSPEND){
 		evt=thread->evt;
-		if(thread->state&ACORAL_THREAD_STATE_DELAY){
-			acoral_list_del(&thread->thread_timer->delay_queue_hook);
-		}else
-		{
-			/**/
-			if(evt!=NULL){
-				acoral_evt_queue_del(thread);
-			}
+		if(!(thread->state&ACORAL_THREAD_STATE_DELAY) && evt!=NULL){
+			acoral_evt_queue_del(thread);
 		}
 	}
+	/* 延时和等待超时共用thread_timer，不管是哪种都从时间轮上取下来，否则到期时会去唤醒已经死掉的线程 */
+	acoral_timer_stop(thread->thread_timer);
 	unrdy_thread(thread);
 	
     /* 让线程进入ACORAL_THREAD_STATE_EXIT状态，但此时TCB和堆栈在上下文切换和函数调用的时候还有用，直到切换到新线程的上下文之后，才会变成ACORAL_THREAD_STATE_RELEASE状态，这个状态下的线程才会被daem释放。详见绿书P98.*/
@@ -143,14 +313,46 @@ void acoral_kill_thread(acoral_thread_t *thread){
 
     acoral_list_t *head = daem_res_release_queue;
 	acoral_thread_t *daem = (acoral_thread_t *)acoral_get_res_by_id(daemon_id);
-	thread->state=ACORAL_THREAD_STATE_EXIT;
-	acoral_list_add2_tail(&thread->daem_hook,head);
-	ready_thread(daem);
+	/* 没在任何核上运行的线程（就绪或挂起的）不会再有切换用到它的TCB和堆栈，直接交给daem释放，否则daem会一直等它被切走 */
+	thread->state = acoral_cur_threads[thread->cpu] == thread ? ACORAL_THREAD_STATE_EXIT : ACORAL_THREAD_STATE_RELEASE;
+	/* 缓存放得下就不用麻烦daem了 */
+	if(thread_cache_put(thread) != 0){
+		acoral_list_add2_tail(&thread->daem_hook,head);
+		ready_thread(daem);
+	}
 
     acoral_exit_critical();
 	acoral_sched();
 }
 
+int acoral_thread_set_affinity(int thread_id, int affinity){
+	acoral_thread_t *thread;
+	if (affinity != ACORAL_CPU_ANY && (affinity < 0 || affinity >= CFG_MAX_CPU))
+		return -1;
+	thread = (acoral_thread_t *)acoral_get_res_by_id(thread_id);
+
+	acoral_enter_critical();
+	thread->affinity = affinity;
+	if ((thread->state & ACORAL_THREAD_STATE_READY) && affinity != ACORAL_CPU_ANY && thread->cpu != affinity){
+		if (thread == acoral_cur_thread){
+			/* 迁移自己：先挂到目标核上，再在临界区内调度切走。切换完成之前内核大锁一直被本核持有，目标核选不到它 */
+			acoral_rdyqueue_del(thread);
+			thread->cpu = affinity;
+			acoral_balance_stats[affinity].migrations++;
+			acoral_rdyqueue_add(thread);
+			acoral_sched();
+		}else if (acoral_cur_threads[thread->cpu] != thread){
+			/* 就绪但没在运行，重新挂一次，acoral_rdyqueue_add会按新的亲和性选核；
+			 * 正在其它核上运行的线程不能动，它的上下文还没保存 */
+			acoral_rdyqueue_del(thread);
+			acoral_rdyqueue_add(thread);
+		}
+	}
+	acoral_exit_critical();
+	acoral_sched();
+	return 0;
+}
+
 void acoral_kill_thread_by_id(int id){
 	acoral_thread_t *thread;
 	thread=(acoral_thread_t *)acoral_get_res_by_id(id);
@@ -193,26 +395,107 @@ void unrdy_thread(acoral_thread_t *thread){
 	acoral_rdyqueue_del(thread);
 }
 
+#if CFG_STACK_CHECK
+#define STACK_PAINT 0xa5a5a5a5u ///<涂在空栈上的花纹
+#endif
+
 int thread_stack_init(acoral_thread_t *thread,void (*exit)(void)){
-    if(thread->stack_size<CFG_MIN_STACK_SIZE)
-    {
-        thread->stack_size=CFG_MIN_STACK_SIZE;
-    }	
-	thread->stack_buttom=(unsigned int *)acoral_malloc(thread->stack_size);
-	if(thread->stack_buttom==NULL)
-    {
-		return -1;
+#if CFG_STACK_CHECK
+	unsigned int used;
+#endif
+
+	/* 从缓存里拿的线程栈还在，只要把上一个线程用过的那一段重新涂色 */
+	if(thread->stack_buttom!=NULL)
+	{
+#if CFG_STACK_CHECK
+		used = acoral_thread_stack_used(thread);
+		memset((char *)thread->stack_buttom + thread->stack_size - used, STACK_PAINT & 0xff, used);
+#endif
+	}
+	else
+	{
+		thread->stack_buttom=(unsigned int *)acoral_malloc(thread->stack_size);
+		if(thread->stack_buttom==NULL)
+		{
+			return -1;
+		}
+#if CFG_STACK_CHECK
+		memset(thread->stack_buttom, STACK_PAINT & 0xff, thread->stack_size);
+#endif
 	}
 	thread->stack = HAL_STACK_INIT((unsigned int *)((char *)thread->stack_buttom+thread->stack_size-4),thread->route,exit,thread->args);
+	HAL_LOCK_STATUS_INIT(&thread->lock_status);
+#if CFG_FPU
+	HAL_FPU_INIT(&thread->fpu_ctx);
+#endif
 
 	return 0;
 }
 
+#if CFG_STACK_CHECK
+static unsigned int stack_paint_block[256]; ///<一整块涂色，扫栈时整块比较
+
+unsigned int acoral_thread_stack_used(acoral_thread_t *thread){
+	unsigned int *p = thread->stack_buttom;
+	unsigned int *end = (unsigned int *)((char *)thread->stack_buttom + thread->stack_size);
+
+	/* 栈从高地址往低地址长，栈底那一段没被碰过的还是涂色。
+	 * 复用缓存的栈时每次创建都要扫一遍，逐字比太慢，先整块用memcmp比，找到第一块被碰过的再逐字比 */
+	while(end - p >= 256 && memcmp(p, stack_paint_block, sizeof(stack_paint_block)) == 0)
+		p += 256;
+	while(p < end && *p == STACK_PAINT)
+		p++;
+	return (char *)end - (char *)p;
+}
+#endif
+
+#if CFG_STACK_LEARN
+static acoral_stack_learn_t stack_learn_table[CFG_STACK_LEARN_ENTRIES];
+
+void acoral_stack_learn(acoral_thread_t *thread){
+	unsigned int used = acoral_thread_stack_used(thread);
+	int i;
+
+	for(i = 0; i < CFG_STACK_LEARN_ENTRIES; i++){
+		if(stack_learn_table[i].name == NULL){
+			stack_learn_table[i].name = thread->name;
+			break;
+		}
+		if(strcmp(stack_learn_table[i].name, thread->name) == 0)
+			break;
+	}
+	/* 表满了，新名字不记 */
+	if(i == CFG_STACK_LEARN_ENTRIES)
+		return;
+	stack_learn_table[i].size = thread->stack_size;
+	if(used > stack_learn_table[i].peak)
+		stack_learn_table[i].peak = used;
+}
+
+int acoral_stack_learn_get(acoral_stack_learn_t *tab){
+	int n;
+	acoral_enter_critical();
+	for(n = 0; n < CFG_STACK_LEARN_ENTRIES && stack_learn_table[n].name != NULL; n++)
+		tab[n] = stack_learn_table[n];
+	acoral_exit_critical();
+	return n;
+}
+
+unsigned int acoral_stack_recommend(unsigned int peak){
+	unsigned int size = (peak + peak / 4 + 63) & ~63u;
+	return size < CFG_MIN_STACK_SIZE ? CFG_MIN_STACK_SIZE : size;
+}
+#endif
+
 void acoral_sched_mechanism_init(){
 	acoral_thread_runqueue_init();
 }
 
 void system_thread_module_init(){
+#if CFG_STACK_CHECK
+	memset(stack_paint_block, STACK_PAINT & 0xff, sizeof(stack_paint_block));
+#endif
+	thread_cache_init();
 	acoral_sched_mechanism_init();
 	acoral_sched_policy_init();
 }
@@ -222,7 +505,7 @@ void system_thread_module_init(){
 
 
 
-void acoral_prio_queue_add(acoral_rdy_queue_t *array, unsigned char prio, acoral_list_t *list)
+void acoral_prio_queue_add(acoral_rdy_queue_t *array, unsigned int prio, acoral_list_t *list)
 {
 	acoral_list_t *queue;
 	acoral_list_t *head;
@@ -231,9 +514,10 @@ void acoral_prio_queue_add(acoral_rdy_queue_t *array, unsigned char prio, acoral
 	head = queue;
 	acoral_list_add2_tail(list, head);
 	acoral_set_bit_in_bitmap(prio, array->bitmap);
+	array->summary |= 1u << (prio >> 5);
 }
 
-void acoral_prio_queue_del(acoral_rdy_queue_t *array, unsigned char prio, acoral_list_t *list)
+void acoral_prio_queue_del(acoral_rdy_queue_t *array, unsigned int prio, acoral_list_t *list)
 {
 	acoral_list_t *queue;
 	acoral_list_t *head;
@@ -242,20 +526,26 @@ void acoral_prio_queue_del(acoral_rdy_queue_t *array, unsigned char prio, acoral
 	array->num--;
 	acoral_list_del(list);
 	if (acoral_list_empty(head))
+	{
 		acoral_clear_bit_in_bitmap(prio, array->bitmap);
+		if (array->bitmap[prio >> 5] == 0)
+			array->summary &= ~(1u << (prio >> 5));
+	}
 }
 
 unsigned int acoral_get_highprio(acoral_rdy_queue_t *array)
 {
-	return acoral_find_first_bit_in_array(array->bitmap, PRIO_BITMAP_SIZE,1);
+	unsigned int word = acoral_ffs(array->summary);
+	return (word << 5) + acoral_ffs(array->bitmap[word]);
 }
 
 void acoral_prio_queue_init(acoral_rdy_queue_t *array)
 {
-	unsigned char i;
+	unsigned int i;
 	acoral_list_t *queue;
 	acoral_list_t *head;
 	array->num = 0;
+	array->summary = 0;
 	for (i = 0; i < PRIO_BITMAP_SIZE; i++)
 		array->bitmap[i] = 0;
 	for (i = 0; i < ACORAL_MAX_PRIO_NUM; i++)
@@ -269,37 +559,116 @@ void acoral_prio_queue_init(acoral_rdy_queue_t *array)
 
 void system_set_running_thread(acoral_thread_t *thread)
 {
-	acoral_cur_thread->state &= ~ACORAL_THREAD_STATE_RUNNING;
+	acoral_thread_t *prev = acoral_cur_thread;
+#if CFG_THRD_STATS
+	unsigned long long now = HAL_GET_CYCLES();
+	unsigned int latency;
+
+	if (prev != NULL)
+	{
+		prev->stat.run_cycles += now - prev->stat.switch_in;
+		/* 换下时还挂在就绪队列上，说明不是自己让出的 */
+		if (prev->state & ACORAL_THREAD_STATE_READY)
+		{
+			prev->stat.involuntary++;
+			if (thread->prio < prev->prio)
+				prev->stat.preempted++;
+		}
+		else
+			prev->stat.voluntary++;
+	}
+	thread->stat.switch_in = now;
+	if (thread->stat.wakeup != 0)
+	{
+		latency = now - thread->stat.wakeup;
+		thread->stat.last_latency = latency;
+		if (latency > thread->stat.max_latency)
+			thread->stat.max_latency = latency;
+		thread->stat.wakeup = 0;
+	}
+#endif
+	/* 系统第一次切换线程时还没有当前线程 */
+	if (prev != NULL)
+		prev->state &= ~ACORAL_THREAD_STATE_RUNNING;
 	thread->state |= ACORAL_THREAD_STATE_RUNNING;
 	acoral_cur_thread = thread;
 }
 
 
-void acoral_thread_runqueue_init() //TODO多核队列？
+void acoral_thread_runqueue_init()
 {
 	/*初始化每个核上的优先级队列*/
-    acoral_rdy_queue_t* rdy_queue = &(((thread_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_THREAD].type_private_data))->global_ready_queue);
-	acoral_prio_queue_init(rdy_queue);
+	int cpu;
+	for (cpu = 0; cpu < CFG_MAX_CPU; cpu++)
+	{
+		acoral_rdy_queue_t* rdy_queue = &(((thread_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_THREAD].type_private_data))->global_ready_queue[cpu]);
+		acoral_prio_queue_init(rdy_queue);
+	}
+}
+
+void acoral_cpu_need_sched(int cpu)
+{
+	system_need_scheds[cpu] = true;
+#if CFG_SMP
+	/* 还没启动的核没有当前线程，启动后自己会调度 */
+	if (cpu != acoral_current_cpu() && acoral_cur_threads[cpu] != NULL)
+		HAL_IPI_SEND(cpu);
+#endif
 }
 
 void acoral_rdyqueue_add(acoral_thread_t *thread)
 {
-	 acoral_rdy_queue_t* rdy_queue = &(((thread_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_THREAD].type_private_data))->global_ready_queue);
+	acoral_rdy_queue_t* rdy_queue;
+#if CFG_TICKLESS
+	/* 停ticks期间被别的中断唤醒，先把tick补上，线程醒来看到的时间才是对的 */
+	acoral_tickless_wakeup();
+#endif
+#if CFG_THRD_STATS
+	/* 还没切走的当前线程（比如挂起自己之后马上被唤醒）不算一次唤醒 */
+	thread->stat.wakeup = acoral_cur_threads[thread->cpu] != thread ? HAL_GET_CYCLES() : 0;
+#endif
+	/* 按亲和性选核。线程如果还是原来那个核的当前线程，说明它的上下文还没保存完（比如刚挂起自己还没切走），
+	 * 这时只能先挂回原来的核，等下次唤醒再迁移 */
+	if (thread->affinity != ACORAL_CPU_ANY && thread->cpu != thread->affinity && acoral_cur_threads[thread->cpu] != thread){
+		thread->cpu = thread->affinity;
+		acoral_balance_stats[thread->cpu].migrations++;
+	}
+	rdy_queue = &(((thread_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_THREAD].type_private_data))->global_ready_queue[thread->cpu]);
+#if CFG_THRD_EDF
+	if (thread->policy == ACORAL_SCHED_POLICY_EDF)
+		edf_prio_queue_add(rdy_queue, thread);
+	else
+#endif
 	acoral_prio_queue_add(rdy_queue, thread->prio, &thread->ready_hook);
 	thread->state &= ~ACORAL_THREAD_STATE_SUSPEND;
 	thread->state |= ACORAL_THREAD_STATE_READY;
-	system_need_sched = true;
+	ACORAL_TRACE(ACORAL_TRACE_WAKEUP, thread->res.id, thread->cpu);
+	/*只有比目标核当前线程优先级高（同优先级的EDF线程则是截止期更早）才需要打断它，否则看看有没有空闲的核可以来偷*/
+	if (acoral_cur_threads[thread->cpu] == NULL || thread->prio < acoral_cur_threads[thread->cpu]->prio
+#if CFG_THRD_EDF
+		|| (thread->prio == acoral_cur_threads[thread->cpu]->prio && edf_deadline_before(thread, acoral_cur_threads[thread->cpu]))
+#endif
+		)
+		acoral_cpu_need_sched(thread->cpu);
+	else{
+		system_need_scheds[thread->cpu] = true;
+		acoral_balance_kick(thread);
+	}
 }
 
 void acoral_rdyqueue_del(acoral_thread_t *thread)
 {
-	 acoral_rdy_queue_t* rdy_queue = &(((thread_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_THREAD].type_private_data))->global_ready_queue);
+	acoral_rdy_queue_t* rdy_queue = &(((thread_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_THREAD].type_private_data))->global_ready_queue[thread->cpu]);
 	acoral_prio_queue_del(rdy_queue, thread->prio, &thread->ready_hook);
+	ACORAL_TRACE(ACORAL_TRACE_BLOCK, thread->res.id, thread->state);
 	thread->state &= ~ACORAL_THREAD_STATE_READY;
 	thread->state &= ~ACORAL_THREAD_STATE_RUNNING;
 	thread->state |= ACORAL_THREAD_STATE_SUSPEND;
-	/*设置线程所在的核可调度*/
-	system_need_sched = true;
+	/*设置线程所在的核可调度，线程如果正在别的核上运行，要通知那个核把它换下来*/
+	if (acoral_cur_threads[thread->cpu] == thread)
+		acoral_cpu_need_sched(thread->cpu);
+	else
+		system_need_scheds[thread->cpu] = true;
 }
 
 void acoral_sched()
@@ -335,16 +704,19 @@ void acoral_real_sched()
 	if (prev != next)
 	{
 		system_set_running_thread(next);
+		HAL_LOCK_STATUS_SWITCH(&prev->lock_status, &next->lock_status);
+#if CFG_FPU
+		HAL_FPU_SWITCH(&prev->fpu_ctx, &next->fpu_ctx);
+#endif
+		ACORAL_TRACE(ACORAL_TRACE_SWITCH, next->res.id, prev->res.id);
 		
 		if (prev->state == ACORAL_THREAD_STATE_EXIT)
 		{
-            ACORAL_LOG_TRACE("Switch to Thread: %s",acoral_cur_thread->name);
 			prev->state = ACORAL_THREAD_STATE_RELEASE;
 			HAL_SWITCH_TO(&next->stack);
 			return;
 		}
 		/*线程切换*/
-        ACORAL_LOG_TRACE("Context Switch to Thread: %s",acoral_cur_thread->name);
 		HAL_CONTEXT_SWITCH(&prev->stack, &next->stack);
 	}
 }
@@ -360,8 +732,11 @@ unsigned long acoral_real_intr_sched(unsigned long old_sp)
 	if (prev != next)
 	{
 		system_set_running_thread(next);
-        ACORAL_LOG_TRACE("After Intr , Switch to Thread: %s's Stack",next->name);
-		// ACORAL_LOG_TRACE("Switch to Thread: %s\n",acoral_cur_thread->name);
+		HAL_LOCK_STATUS_SWITCH(&prev->lock_status, &next->lock_status);
+#if CFG_FPU
+		HAL_FPU_SWITCH(&prev->fpu_ctx, &next->fpu_ctx);
+#endif
+		ACORAL_TRACE(ACORAL_TRACE_SWITCH, next->res.id, prev->res.id);
 		if (prev->state == ACORAL_THREAD_STATE_EXIT)
 		{
 			prev->state = ACORAL_THREAD_STATE_RELEASE;
@@ -381,11 +756,24 @@ acoral_thread_t* acoral_select_thread()
 	acoral_list_t *head;
 	acoral_thread_t *thread;
 	acoral_list_t *queue;
-	acoral_rdy_queue_t* rdy_queue = &(((thread_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_THREAD].type_private_data))->global_ready_queue);
-	/*找出就绪队列中优先级最高的线程的优先级*/
+	int cpu = acoral_current_cpu();
+	acoral_rdy_queue_t* rdy_queue = &(((thread_res_private_data*)(acoral_res_system.system_res_ctrl_container[ACORAL_RES_THREAD].type_private_data))->global_ready_queue[cpu]);
+	/*找出本核就绪队列中优先级最高的线程的优先级*/
 	index = acoral_get_highprio(rdy_queue);
+#if CFG_SMP
+	/*本核只剩idle线程了，从最忙的核偷一个线程过来*/
+	if (index == ACORAL_IDLE_PRIO && acoral_balance_steal(cpu))
+		index = acoral_get_highprio(rdy_queue);
+#endif
 	queue = rdy_queue->queue + index;
 	head = queue;
 	thread = list_entry(head->next, acoral_thread_t, ready_hook);
 	return thread;
 }
+
+void acoral_ipi_entry(void *args)
+{
+	ACORAL_TRACE(ACORAL_TRACE_IRQ_ENTER, acoral_cur_thread ? acoral_cur_thread->res.id : -1, ACORAL_TRACE_VEC_IPI);
+	system_need_sched = true;
+	ACORAL_TRACE(ACORAL_TRACE_IRQ_EXIT, acoral_cur_thread ? acoral_cur_thread->res.id : -1, ACORAL_TRACE_VEC_IPI);
+}
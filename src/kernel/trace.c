@@ -0,0 +1,127 @@
+/**
+ * @file trace.c
+ * @brief kernel层，调度事件跟踪：每个核一个定长的二进制环，热路径上只写内存，需要时再打印出来
+ * @version 1.0
+ * @date 2024-06-10
+ * @copyright Copyright (c) 2024
+ * @note 打印格式是按行的文本，每行第一个字段区分类型：
+ *       H（头：核数、每微秒周期数）、T（线程id和名字）、E（事件：核、周期、类型、线程id、参数）、L（某个核被覆盖掉的记录数）
+ */
+
+#include "trace.h"
+#include "thread.h"
+#include "int.h"
+#include "soft_timer.h"
+#include "resource.h"
+#include "hal.h"
+#include <stdio.h>
+
+#if CFG_TRACE
+
+acoral_trace_ring_t acoral_trace_rings[CFG_MAX_CPU];
+
+volatile unsigned char acoral_trace_enabled = 1;
+
+static unsigned long long trace_base_cycles;	///<清空时的周期数，和trace_base_ticks一起估算每微秒的周期数
+static unsigned int trace_base_ticks;
+
+static const char *trace_type_names[ACORAL_TRACE_TYPE_NUM] = {
+	[ACORAL_TRACE_SWITCH] = "switch",
+	[ACORAL_TRACE_WAKEUP] = "wakeup",
+	[ACORAL_TRACE_BLOCK] = "block",
+	[ACORAL_TRACE_IRQ_ENTER] = "irq_enter",
+	[ACORAL_TRACE_IRQ_EXIT] = "irq_exit",
+	[ACORAL_TRACE_TIMER] = "timer",
+	[ACORAL_TRACE_IPC_POST] = "ipc_post",
+	[ACORAL_TRACE_IPC_PEND] = "ipc_pend",
+};
+
+void acoral_trace(unsigned int type, int id, int arg)
+{
+	acoral_trace_ring_t *ring;
+	acoral_trace_rec_t *rec;
+	unsigned int slot;
+
+	if (!acoral_trace_enabled)
+		return;
+	ring = &acoral_trace_rings[acoral_current_cpu()];
+	/* 本核的线程可能在写到一半时被中断打断，中断里也要写，先原子地占一个槽，各写各的 */
+	slot = __atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED);
+	rec = &ring->recs[slot & (CFG_TRACE_ENTRIES - 1)];
+	rec->cycles = HAL_GET_CYCLES();
+	rec->type = type;
+	rec->id = id;
+	rec->arg = arg;
+}
+
+void acoral_trace_clear(void)
+{
+	unsigned char enabled = acoral_trace_enabled;
+	int cpu;
+
+	acoral_trace_enabled = 0;
+	for (cpu = 0; cpu < CFG_MAX_CPU; cpu++)
+		acoral_trace_rings[cpu].head = 0;
+	trace_base_cycles = HAL_GET_CYCLES();
+	trace_base_ticks = acoral_get_ticks();
+	acoral_trace_enabled = enabled;
+}
+
+/* 打印还活着的线程的名字，已经被回收的线程转换时只能显示id */
+static void trace_dump_threads(void)
+{
+	acoral_list_t *head, *list;
+	acoral_pool_t *pool;
+	acoral_res_t *res;
+	acoral_thread_t *thread;
+	int i;
+
+	head = &acoral_res_system.system_res_ctrl_container[ACORAL_RES_THREAD].pools;
+	acoral_enter_critical();
+	for (list = head->next; list != head; list = list->next)
+	{
+		pool = list_entry(list, acoral_pool_t, ctrl_list);
+		for (i = 0; i < pool->num; i++)
+		{
+			res = (acoral_res_t *)(pool->base_adr + pool->size * i);
+			if (ACORAL_RES_TYPE(res->id) != ACORAL_RES_THREAD)
+				continue;
+			thread = list_entry(res, acoral_thread_t, res);
+			printf("T %d %s\r\n", thread->res.id, thread->name);
+		}
+	}
+	acoral_exit_critical();
+}
+
+void acoral_trace_dump(void)
+{
+	unsigned char enabled = acoral_trace_enabled;
+	unsigned long long cycles, us;
+	unsigned int head, first, i;
+	acoral_trace_rec_t *rec;
+	int cpu;
+
+	/* 停下来再读，否则读的同时还在被覆盖。其它核上正在写的那一条可能不完整 */
+	acoral_trace_enabled = 0;
+	cycles = HAL_GET_CYCLES() - trace_base_cycles;
+	us = (unsigned long long)(acoral_get_ticks() - trace_base_ticks) * 1000000 / CFG_TICKS_PER_SEC;
+	printf("H %d %llu\r\n", CFG_MAX_CPU, us ? cycles / us : 0);
+	trace_dump_threads();
+	for (cpu = 0; cpu < CFG_MAX_CPU; cpu++)
+	{
+		head = acoral_trace_rings[cpu].head;
+		first = head > CFG_TRACE_ENTRIES ? head - CFG_TRACE_ENTRIES : 0;
+		if (first)
+			printf("L %d %u\r\n", cpu, first);
+		for (i = first; i != head; i++)
+		{
+			rec = &acoral_trace_rings[cpu].recs[i & (CFG_TRACE_ENTRIES - 1)];
+			if (rec->type == 0 || rec->type >= ACORAL_TRACE_TYPE_NUM)
+				continue;
+			printf("E %d %llu %s %d %d\r\n", cpu, rec->cycles, trace_type_names[rec->type], rec->id, rec->arg);
+		}
+	}
+	acoral_trace_enabled = enabled;
+}
+
+#endif
@@ -0,0 +1,225 @@
+/**
+ * @file workq.c
+ * @brief kernel层，工作队列：每档优先级固定几个工作线程，从待处理队列上取工作项来执行
+ * @version 1.0
+ * @date 2024-06-24
+ * @copyright Copyright (c) 2024
+ * @note 待处理队列和空闲工作线程的掩码都只在临界区里访问，所以中断里也能提交。延时提交用工作项自带的定时器，挂在系统时间轮上。
+ *       工作线程没活干就挂起自己，和daem一样在临界区里挂起，提交的一方在临界区里把它就绪，不会丢唤醒
+ */
+
+#include "workq.h"
+#include "thread.h"
+#include "int.h"
+#include "soft_timer.h"
+#include "policy.h"
+#include "log.h"
+
+#if CFG_WORKQ
+
+#if CFG_WORKQ_WORKERS > 32
+#error "CFG_WORKQ_WORKERS must not exceed 32"
+#endif
+
+/**
+ * @brief 一档工作队列
+ *
+ */
+typedef struct{
+	acoral_list_t pending;							///<待处理的工作项，先进先出
+	acoral_thread_t *workers[CFG_WORKQ_WORKERS];	///<这一档的工作线程
+	unsigned int idle;								///<挂起等活的工作线程，每一位对应workers里的一个
+	acoral_workq_stat_t stat;
+}acoral_workq_t;
+
+static acoral_workq_t workqs[ACORAL_WORKQ_BANDS];
+
+static acoral_work_t workq_pool[CFG_WORKQ_ITEMS];	///<acoral_workq_submit用的工作项
+static acoral_list_t workq_pool_free;
+
+/* 挂到待处理队列上，有空闲的工作线程就叫醒一个。在临界区里调用 */
+static void workq_enqueue(acoral_work_t *work)
+{
+	acoral_workq_t *wq = &workqs[work->band];
+	int i;
+
+	work->state = ACORAL_WORK_PENDING;
+	acoral_list_add2_tail(&work->hook, &wq->pending);
+	wq->stat.submitted++;
+	if (++wq->stat.pending > wq->stat.max_pending)
+		wq->stat.max_pending = wq->stat.pending;
+	if (wq->idle)
+	{
+		i = __builtin_ctz(wq->idle);
+		wq->idle &= ~(1u << i);
+		ready_thread(wq->workers[i]);
+	}
+}
+
+/* 延时提交的到期了，在ticks中断里调用 */
+static void workq_timer_expire(acoral_timer_t *timer)
+{
+	workq_enqueue(list_entry(timer, acoral_work_t, timer));
+}
+
+static void workq_worker(void *args)
+{
+	int index = (int)(long)args;
+	acoral_workq_t *wq = &workqs[index / CFG_WORKQ_WORKERS];
+	acoral_work_t *work;
+
+	while (1)
+	{
+		acoral_enter_critical();
+		while (!acoral_list_empty(&wq->pending))
+		{
+			work = list_entry(wq->pending.next, acoral_work_t, hook);
+			acoral_list_del(&work->hook);
+			wq->stat.pending--;
+			work->state = ACORAL_WORK_RUNNING;
+			acoral_exit_critical();
+
+			work->fn(work->arg);
+
+			acoral_enter_critical();
+			wq->stat.done++;
+			/* 执行期间又被提交了就不动它 */
+			if (work->state == ACORAL_WORK_RUNNING)
+			{
+				work->state = ACORAL_WORK_IDLE;
+				if (work->pooled)
+					acoral_list_add2_tail(&work->hook, &workq_pool_free);
+			}
+		}
+		/* 在临界区里标记空闲并挂起，提交的一方看到空闲位时这个线程一定已经挂起或者马上挂起 */
+		wq->idle |= 1u << (index % CFG_WORKQ_WORKERS);
+		acoral_suspend_self();
+		acoral_exit_critical();
+	}
+}
+
+void acoral_work_init(acoral_work_t *work, void (*fn)(void *arg), void *arg, int band)
+{
+	acoral_init_list(&work->hook);
+	work->fn = fn;
+	work->arg = arg;
+	acoral_init_list(&work->timer.delay_queue_hook);
+	work->band = band;
+	work->state = ACORAL_WORK_IDLE;
+	work->pooled = 0;
+}
+
+int acoral_work_submit(acoral_work_t *work)
+{
+	acoral_enter_critical();
+	if (work->state == ACORAL_WORK_PENDING || work->state == ACORAL_WORK_DELAYED)
+	{
+		acoral_exit_critical();
+		return -1;
+	}
+	workq_enqueue(work);
+	acoral_exit_critical();
+	acoral_sched();
+	return 0;
+}
+
+int acoral_work_submit_delayed(acoral_work_t *work, unsigned int time_mm)
+{
+	if (time_mm == 0)
+		return acoral_work_submit(work);
+
+	acoral_enter_critical();
+	if (work->state == ACORAL_WORK_PENDING || work->state == ACORAL_WORK_DELAYED)
+	{
+		acoral_exit_critical();
+		return -1;
+	}
+	work->state = ACORAL_WORK_DELAYED;
+	acoral_timer_start(&work->timer, time_to_ticks(time_mm), workq_timer_expire);
+	acoral_exit_critical();
+	return 0;
+}
+
+int acoral_work_cancel(acoral_work_t *work)
+{
+	acoral_enter_critical();
+	if (work->state == ACORAL_WORK_PENDING)
+	{
+		workqs[work->band].stat.pending--;
+		acoral_list_del(&work->hook);
+	}
+	else if (work->state == ACORAL_WORK_DELAYED)
+		acoral_timer_stop(&work->timer);
+	else
+	{
+		acoral_exit_critical();
+		return -1;
+	}
+	work->state = ACORAL_WORK_IDLE;
+	if (work->pooled)
+		acoral_list_add2_tail(&work->hook, &workq_pool_free);
+	acoral_exit_critical();
+	return 0;
+}
+
+int acoral_workq_submit(int band, void (*fn)(void *arg), void *arg)
+{
+	acoral_work_t *work;
+
+	acoral_enter_critical();
+	if (acoral_list_empty(&workq_pool_free))
+	{
+		workqs[band].stat.pool_fails++;
+		acoral_exit_critical();
+		return -1;
+	}
+	work = list_entry(workq_pool_free.next, acoral_work_t, hook);
+	acoral_list_del(&work->hook);
+	work->fn = fn;
+	work->arg = arg;
+	work->band = band;
+	workq_enqueue(work);
+	acoral_exit_critical();
+	acoral_sched();
+	return 0;
+}
+
+void acoral_workq_get_stat(int band, acoral_workq_stat_t *stat)
+{
+	acoral_enter_critical();
+	*stat = workqs[band].stat;
+	acoral_exit_critical();
+}
+
+void system_workq_init(void)
+{
+	static const unsigned int prios[ACORAL_WORKQ_BANDS] = {CFG_WORKQ_PRIO_HIGH, CFG_WORKQ_PRIO_LOW};
+	acoral_workq_t *wq;
+	int band, i, id;
+
+	acoral_init_list(&workq_pool_free);
+	for (i = 0; i < CFG_WORKQ_ITEMS; i++)
+	{
+		acoral_work_init(&workq_pool[i], NULL, NULL, 0);
+		workq_pool[i].pooled = 1;
+		acoral_list_add2_tail(&workq_pool[i].hook, &workq_pool_free);
+	}
+	for (band = 0; band < ACORAL_WORKQ_BANDS; band++)
+	{
+		wq = &workqs[band];
+		acoral_init_list(&wq->pending);
+		for (i = 0; i < CFG_WORKQ_WORKERS; i++)
+		{
+			id = acoral_create_thread(band == ACORAL_WORKQ_HIGH ? "workq_high" : "workq_low", workq_worker, (void *)(long)(band * CFG_WORKQ_WORKERS + i),
+					WORKQ_STACK_SIZE, ACORAL_SCHED_POLICY_COMM, prios[band], ACORAL_HARD_PRIO, NULL);
+			if (id == -1)
+			{
+				ACORAL_LOG_ERROR("Create Workq Thread Failed");
+				continue;
+			}
+			wq->workers[i] = (acoral_thread_t *)acoral_get_res_by_id(id);
+		}
+	}
+}
+
+#endif
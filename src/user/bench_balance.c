@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <string.h>
+#include "acoral.h"
+#include "user.h"
+
+#define BENCH_BAL_THREADS 64        ///<总共创建的短命线程数
+#define BENCH_BAL_WAVE 8            ///<每一波同时存在的线程数，受CFG_MAX_THREAD限制，不能太大
+#define BENCH_BAL_WORK 2000000      ///<每个线程的空循环次数
+
+static acoral_evt_t *bal_done;
+
+static void bal_worker(void *args)
+{
+    volatile unsigned int i;
+    for (i = 0; i < BENCH_BAL_WORK; i++)
+        ;
+    acoral_sem_post(bal_done);
+}
+
+/**
+ * @brief 分波创建一批CPU密集的短命线程，等它们全部跑完，统计总周期数和负载均衡计数
+ *
+ * @param enable 是否打开负载均衡
+ */
+static void bench_balance_once(unsigned char enable)
+{
+    acoral_balance_stat_t before[CFG_MAX_CPU];
+    unsigned long long start, cycles;
+    unsigned int placements = 0, steals = 0, migrations = 0;
+    int created, i, cpu;
+
+    acoral_balance_enabled = enable;
+    memcpy(before, acoral_balance_stats, sizeof(before));
+
+    start = HAL_GET_CYCLES();
+    for (created = 0; created < BENCH_BAL_THREADS; created += BENCH_BAL_WAVE)
+    {
+        for (i = 0; i < BENCH_BAL_WAVE; i++)
+        {
+            /* 上一波的TCB可能还没被daem回收，等一会再建 */
+            while (acoral_create_thread("bal", bal_worker, NULL, 0, ACORAL_SCHED_POLICY_COMM, 30, ACORAL_HARD_PRIO, NULL) == -1)
+                acoral_delay_self(10);
+        }
+        for (i = 0; i < BENCH_BAL_WAVE; i++)
+            acoral_sem_pend(bal_done, 0);
+    }
+    cycles = HAL_GET_CYCLES() - start;
+
+    for (cpu = 0; cpu < CFG_MAX_CPU; cpu++)
+    {
+        placements += acoral_balance_stats[cpu].placements - before[cpu].placements;
+        steals += acoral_balance_stats[cpu].steals - before[cpu].steals;
+        migrations += acoral_balance_stats[cpu].migrations - before[cpu].migrations;
+    }
+    printf("%s\t%llu\t%llu\t%u\t%u\t%u\r\n", enable ? "on" : "off", cycles, cycles / BENCH_BAL_THREADS,
+           placements, steals, migrations);
+}
+
+static void bench_balance_thread(void *args)
+{
+    int cpu;
+
+    bal_done = acoral_sem_create(0);
+    printf("balance benchmark: %d cpus, %d threads in waves of %d, %d loops each\r\n",
+           CFG_MAX_CPU, BENCH_BAL_THREADS, BENCH_BAL_WAVE, BENCH_BAL_WORK);
+    printf("balance\tcycles\tcycles/thread\tplaced\tsteals\tmigrations\r\n");
+    bench_balance_once(false);
+    bench_balance_once(true);
+    for (cpu = 0; cpu < CFG_MAX_CPU; cpu++)
+        printf("cpu%d: placements %u, steals %u, migrations %u\r\n", cpu, acoral_balance_stats[cpu].placements,
+               acoral_balance_stats[cpu].steals, acoral_balance_stats[cpu].migrations);
+}
+
+/**
+ * @brief 负载均衡吞吐测试：先关掉负载均衡跑一遍（所有线程都挤在创建它们的核上），再打开跑一遍
+ *
+ */
+void bench_balance()
+{
+    acoral_create_thread_affinity("bench_bal", bench_balance_thread, NULL, 0, ACORAL_SCHED_POLICY_COMM, 10, ACORAL_HARD_PRIO, NULL, 0);
+}
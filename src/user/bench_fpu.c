@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include "acoral.h"
+#include "user.h"
+
+/* 浮点现场切换测试：两个绑在0号核上的同优先级线程用两个信号量来回唤醒，每一轮切换两次。
+ * 三种组合：都只用整数、一个用浮点一个不用、都用浮点，比较每次切换的周期数。
+ * 用浮点的线程每一轮都改几个跨函数调用的浮点累加器（编译器会把它们放在被调用者保存的浮点寄存器里），
+ * 最后检查结果，浮点现场在切换中被破坏的话就对不上 */
+
+#define BENCH_FPU_ROUNDS 20000
+
+static acoral_evt_t *fpu_ping_sem, *fpu_pong_sem, *fpu_done_sem;
+static volatile int fpu_errors;
+static unsigned long long fpu_cycles;
+
+/* 整数线程：只做信号量操作 */
+static void fpu_int_worker(void *args)
+{
+    int first = (int)(long)args;
+    int i;
+    for (i = 0; i < BENCH_FPU_ROUNDS; i++)
+    {
+        if (first)
+        {
+            acoral_sem_post(fpu_pong_sem);
+            acoral_sem_pend(fpu_ping_sem, 0);
+        }
+        else
+        {
+            acoral_sem_pend(fpu_pong_sem, 0);
+            acoral_sem_post(fpu_ping_sem);
+        }
+    }
+    acoral_sem_post(fpu_done_sem);
+}
+
+/* 浮点线程：每一轮都改三个累加器，都是能精确表示的数，结果可以直接比较 */
+static void fpu_fp_worker(void *args)
+{
+    int first = (int)(long)args;
+    double a = 0.0, b = 1.0, c = 0.0;
+    float d = 0.0f;
+    int i;
+    for (i = 0; i < BENCH_FPU_ROUNDS; i++)
+    {
+        a += 0.5;
+        b *= 1.0;
+        c -= 0.25;
+        d += 1.0f;
+        if (first)
+        {
+            acoral_sem_post(fpu_pong_sem);
+            acoral_sem_pend(fpu_ping_sem, 0);
+        }
+        else
+        {
+            acoral_sem_pend(fpu_pong_sem, 0);
+            acoral_sem_post(fpu_ping_sem);
+        }
+    }
+    if (a != BENCH_FPU_ROUNDS * 0.5 || b != 1.0 || c != BENCH_FPU_ROUNDS * -0.25 || d != (float)BENCH_FPU_ROUNDS)
+        fpu_errors++;
+    acoral_sem_post(fpu_done_sem);
+}
+
+/**
+ * @brief 跑一种组合
+ *
+ * @param name 组合名
+ * @param ping 先post的线程
+ * @param pong 先pend的线程
+ */
+static void bench_fpu_once(const char *name, void (*ping)(void *), void (*pong)(void *))
+{
+    unsigned long long start;
+
+    fpu_errors = 0;
+    fpu_ping_sem = acoral_sem_create(0);
+    fpu_pong_sem = acoral_sem_create(0);
+    start = HAL_GET_CYCLES();
+    acoral_create_thread_affinity("fpu_ping", ping, (void *)1, 0, ACORAL_SCHED_POLICY_COMM, 20, ACORAL_HARD_PRIO, NULL, 0);
+    acoral_create_thread_affinity("fpu_pong", pong, (void *)0, 0, ACORAL_SCHED_POLICY_COMM, 20, ACORAL_HARD_PRIO, NULL, 0);
+    acoral_sem_pend(fpu_done_sem, 0);
+    acoral_sem_pend(fpu_done_sem, 0);
+    fpu_cycles = HAL_GET_CYCLES() - start;
+    acoral_sem_del(fpu_ping_sem);
+    acoral_sem_del(fpu_pong_sem);
+    printf("%s\t%d\t%llu\t%d\r\n", name, BENCH_FPU_ROUNDS * 2, fpu_cycles / (BENCH_FPU_ROUNDS * 2), fpu_errors);
+}
+
+static void bench_fpu_thread(void *args)
+{
+    fpu_done_sem = acoral_sem_create(0);
+    printf("fpu benchmark: 2 threads ping-pong on cpu0, CFG_FPU=%d\r\n", CFG_FPU);
+    printf("threads\tswitches\tcycles/switch\terrors\r\n");
+    bench_fpu_once("int+int", fpu_int_worker, fpu_int_worker);
+    bench_fpu_once("fp+int", fpu_fp_worker, fpu_int_worker);
+    bench_fpu_once("fp+fp", fpu_fp_worker, fpu_fp_worker);
+}
+
+/**
+ * @brief 浮点现场切换测试：只用整数的线程切换不应该因为浮点现场变慢，用浮点的线程切换后浮点寄存器不能被破坏
+ *
+ */
+void bench_fpu()
+{
+    acoral_create_thread_affinity("bench_fpu", bench_fpu_thread, NULL, 0, ACORAL_SCHED_POLICY_COMM, 10, ACORAL_HARD_PRIO, NULL, 0);
+}
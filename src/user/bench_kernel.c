@@ -0,0 +1,919 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "acoral.h"
+#include "shell.h"
+#include "user.h"
+
+/* 内核开销测试集，参照Thread-Metric的思路，每一项都重复很多次，记下每一次的周期数（HAL_GET_CYCLES，
+ * K210上是mcycle，主机上是TSC），打印最小、平均、99分位和最大值，用来在内核版本之间比较。
+ * 所有线程都绑在0号核上，不受其它核的干扰。可以在shell里用"bench [项目名]"运行，也可以在user_main里调用bench_kernel */
+
+#define BENCH_SAMPLES 1000          ///<每一项的采样数
+#define BENCH_THREAD_SAMPLES 100    ///<创建/杀死线程的采样数，每次都要等daem回收，少一些
+#define BENCH_SPAWN_BURST 16        ///<短命线程测试里连着创建的线程数，批与批之间才让daem回收
+#define BENCH_TIMERS 2048           ///<定时器测试里同时挂在时间轮上的定时器数
+#define BENCH_TIMER_SPAN 4096       ///<定时器测试里到期时间在1到这么多个tick之间均匀分布
+#define BENCH_WAKEUP_US 500         ///<唤醒抖动测试里每次延时多少微秒
+#define BENCH_WAKEUP_TICK_SAMPLES 100   ///<唤醒抖动测试里按tick延时的采样数，每次要等一个tick，少一些
+#define BENCH_PERIOD_SAMPLES 100    ///<周期线程测试每种写法的作业数，一个tick一个作业
+#define BENCH_MSGQ_CAPACITY 4       ///<定长消息队列测试里队列的容量
+#define BENCH_MSGQ_MAX 256          ///<定长消息队列测试里最大的消息字节数
+#define BENCH_FRAME (320 * 240 * 2)    ///<分发测试里一帧的字节数，320x240的RGB565
+#define BENCH_FANOUT 3              ///<分发测试里一帧发给几个接收线程
+#define BENCH_FANOUT_SAMPLES 100    ///<分发测试的帧数，每帧要拷几百KB，少一些
+#define BENCH_INTR_VECTOR 5         ///<中断唤醒测试用的软件中断向量
+#define BENCH_PRIO_HIGH 20
+#define BENCH_PRIO_LOW 21
+#define BENCH_PRIO_DRIVER 25        ///<测试驱动线程，比所有被测线程都低
+#define BENCH_PRIO_IDLE_THREAD 30   ///<创建线程测试里被创建的线程，比驱动线程低，不会运行
+
+static unsigned long long bench_samples[BENCH_SAMPLES];
+static unsigned long long bench_samples2[BENCH_SAMPLES];
+static volatile int bench_n;
+static volatile int bench_stop;
+static volatile unsigned long long bench_stamp;
+static int bench_peer_id;
+static int bench_ids[2];
+static acoral_evt_t *bench_done;
+static acoral_evt_t *bench_sem1, *bench_sem2;
+static acoral_evt_t bench_mutex_evt; ///<acoral_mutex_del不回收，用静态的互斥量
+static acoral_evt_t *bench_mutex = &bench_mutex_evt;
+static acoral_msgctr_t *bench_ctr1, *bench_ctr2;
+#if CFG_MSGQ
+static acoral_msgq_t *bench_q1, *bench_q2;
+static unsigned int bench_msg_size;
+#endif
+
+static void bench_record(unsigned long long cycles)
+{
+    if (bench_n < BENCH_SAMPLES)
+        bench_samples[bench_n++] = cycles;
+}
+
+static int bench_cmp(const void *a, const void *b)
+{
+    unsigned long long x = *(const unsigned long long *)a, y = *(const unsigned long long *)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief 打印一项的统计结果
+ *
+ * @param name 项目名
+ * @param samples 采样，会被排序
+ * @param n 采样数
+ */
+static void bench_report(const char *name, unsigned long long *samples, int n)
+{
+    unsigned long long sum = 0;
+    int i;
+
+    if (n == 0)
+    {
+        printf("%-16s\tno samples\r\n", name);
+        return;
+    }
+    qsort(samples, n, sizeof(samples[0]), bench_cmp);
+    for (i = 0; i < n; i++)
+        sum += samples[i];
+    printf("%-16s\t%d\t%llu\t%llu\t%llu\t%llu\r\n", name, n, samples[0], sum / n, samples[(n * 99 + 99) / 100 - 1], samples[n - 1]);
+}
+
+static void bench_spawn(char *name, void (*route)(void *), void *args, unsigned int prio)
+{
+    acoral_create_thread_affinity(name, route, args, 0, ACORAL_SCHED_POLICY_COMM, prio, ACORAL_HARD_PRIO, NULL, 0);
+}
+
+/*------------------- 协作式切换：同优先级的两个线程互相唤醒对方、挂起自己 -------------------*/
+
+static void bench_coop_worker(void *args)
+{
+    int peer;
+
+    /* 先挂起，等驱动线程把两个线程都建好再开始 */
+    acoral_suspend_self();
+    peer = bench_ids[1 - (int)(long)args];
+    while (bench_n < BENCH_SAMPLES)
+    {
+        acoral_resume_thread_by_id(peer);
+        bench_stamp = HAL_GET_CYCLES();
+        acoral_suspend_self();
+        bench_record(HAL_GET_CYCLES() - bench_stamp);
+    }
+    /* 先采满的一方把对方唤醒，对方醒来后直接退出 */
+    if (!bench_stop)
+    {
+        bench_stop = 1;
+        acoral_resume_thread_by_id(peer);
+    }
+    acoral_sem_post(bench_done);
+}
+
+/*------------------- 抢占式切换：低优先级线程唤醒被挂起的高优先级线程 -------------------*/
+
+static void bench_preempt_high(void *args)
+{
+    while (1)
+    {
+        acoral_suspend_self();
+        if (bench_stop)
+            break;
+        bench_record(HAL_GET_CYCLES() - bench_stamp);
+    }
+    acoral_sem_post(bench_done);
+}
+
+static void bench_preempt_low(void *args)
+{
+    int i;
+    for (i = 0; i < BENCH_SAMPLES; i++)
+    {
+        bench_stamp = HAL_GET_CYCLES();
+        acoral_resume_thread_by_id(bench_peer_id);
+    }
+    bench_stop = 1;
+    acoral_resume_thread_by_id(bench_peer_id);
+    acoral_sem_post(bench_done);
+}
+
+/*------------------- 中断唤醒线程：中断服务函数post信号量，唤醒等在上面的高优先级线程 -------------------*/
+
+#ifdef HAL_INTR_RAISE
+static void bench_intr_isr(int vector)
+{
+    acoral_sem_post(bench_sem1);
+}
+
+static void bench_intr_high(void *args)
+{
+    while (1)
+    {
+        acoral_sem_pend(bench_sem1, 0);
+        if (bench_stop)
+            break;
+        bench_record(HAL_GET_CYCLES() - bench_stamp);
+    }
+    acoral_sem_post(bench_done);
+}
+
+static void bench_intr_low(void *args)
+{
+    int i;
+    for (i = 0; i < BENCH_SAMPLES; i++)
+    {
+        bench_stamp = HAL_GET_CYCLES();
+        HAL_INTR_RAISE(BENCH_INTR_VECTOR);
+    }
+    bench_stop = 1;
+    acoral_sem_post(bench_sem1);
+    acoral_sem_post(bench_done);
+}
+#endif
+
+/*------------------- 信号量乒乓：一次往返包括两次切换 -------------------*/
+
+static void bench_sem_ping(void *args)
+{
+    unsigned long long start;
+    int i;
+    for (i = 0; i < BENCH_SAMPLES; i++)
+    {
+        start = HAL_GET_CYCLES();
+        acoral_sem_post(bench_sem1);
+        acoral_sem_pend(bench_sem2, 0);
+        bench_record(HAL_GET_CYCLES() - start);
+    }
+    acoral_sem_post(bench_done);
+}
+
+static void bench_sem_pong(void *args)
+{
+    int i;
+    for (i = 0; i < BENCH_SAMPLES; i++)
+    {
+        acoral_sem_pend(bench_sem1, 0);
+        acoral_sem_post(bench_sem2);
+    }
+    acoral_sem_post(bench_done);
+}
+
+/*------------------- 互斥量移交：持有者释放互斥量，等在上面的高优先级线程拿到它 -------------------*/
+
+static void bench_mutex_high(void *args)
+{
+    while (1)
+    {
+        acoral_suspend_self();
+        if (bench_stop)
+            break;
+        acoral_mutex_pend(bench_mutex, 0);
+        bench_record(HAL_GET_CYCLES() - bench_stamp);
+        acoral_mutex_post(bench_mutex);
+    }
+    acoral_sem_post(bench_done);
+}
+
+static void bench_mutex_low(void *args)
+{
+    int i;
+    for (i = 0; i < BENCH_SAMPLES; i++)
+    {
+        acoral_mutex_pend(bench_mutex, 0);
+        /* 高优先级线程醒来去拿互斥量，阻塞，回到这里 */
+        acoral_resume_thread_by_id(bench_peer_id);
+        bench_stamp = HAL_GET_CYCLES();
+        acoral_mutex_post(bench_mutex);
+    }
+    bench_stop = 1;
+    acoral_resume_thread_by_id(bench_peer_id);
+    acoral_sem_post(bench_done);
+}
+
+/*------------------- 消息往返：发一个消息，对方收到后回一个 -------------------*/
+
+static void bench_msg_ping(void *args)
+{
+    unsigned long long start;
+    unsigned int err;
+    int i;
+    for (i = 0; i < BENCH_SAMPLES; i++)
+    {
+        start = HAL_GET_CYCLES();
+        acoral_msg_send(bench_ctr1, acoral_msg_create(1, 1, 0, (void *)(long)i));
+        acoral_msg_recv(bench_ctr2, 2, 0, &err);
+        bench_record(HAL_GET_CYCLES() - start);
+    }
+    acoral_sem_post(bench_done);
+}
+
+static void bench_msg_pong(void *args)
+{
+    unsigned int err;
+    void *data;
+    int i;
+    for (i = 0; i < BENCH_SAMPLES; i++)
+    {
+        data = acoral_msg_recv(bench_ctr1, 1, 0, &err);
+        acoral_msg_send(bench_ctr2, acoral_msg_create(1, 2, 0, data));
+    }
+    acoral_sem_post(bench_done);
+}
+
+/*------------------- 一帧分发给几个接收线程：每个接收者一份拷贝，或者多播同一块缓冲区 -------------------*/
+
+static acoral_msgctr_t *bench_fanout_ctrs[BENCH_FANOUT];
+static unsigned char *bench_frame;  ///<“摄像头”写好的一帧，拷贝方式从这里拷
+
+/* 比驱动线程高，单核上驱动线程发完这一帧后，几个接收者都收完、放掉才回到驱动线程 */
+static void bench_fanout_copy_rx(void *args)
+{
+    acoral_msgctr_t *ctr = bench_fanout_ctrs[(long)args];
+    unsigned int err;
+    int i;
+    for (i = 0; i < BENCH_FANOUT_SAMPLES; i++)
+        acoral_free(acoral_msg_recv(ctr, 1, 0, &err));
+    acoral_sem_post(bench_done);
+}
+
+static void bench_fanout_buf_rx(void *args)
+{
+    acoral_msgctr_t *ctr = bench_fanout_ctrs[(long)args];
+    unsigned int err;
+    int i;
+    for (i = 0; i < BENCH_FANOUT_SAMPLES; i++)
+        acoral_msgbuf_put(acoral_msg_recv(ctr, 1, 0, &err));
+    acoral_sem_post(bench_done);
+}
+
+#if CFG_MSGQ
+/*------------------- 按值传数据的消息往返：定长消息队列拷进拷出，消息容器要自己分配一块拷进去，收的一方拷出来再释放 -------------------*/
+
+static void bench_msgq_ping(void *args)
+{
+    unsigned char buf[BENCH_MSGQ_MAX];
+    unsigned long long start;
+    int i;
+    for (i = 0; i < BENCH_SAMPLES; i++)
+    {
+        buf[0] = i;
+        start = HAL_GET_CYCLES();
+        acoral_msgq_send(bench_q1, buf, 0);
+        acoral_msgq_recv(bench_q2, buf, 0);
+        bench_record(HAL_GET_CYCLES() - start);
+    }
+    acoral_sem_post(bench_done);
+}
+
+static void bench_msgq_pong(void *args)
+{
+    unsigned char buf[BENCH_MSGQ_MAX];
+    int i;
+    for (i = 0; i < BENCH_SAMPLES; i++)
+    {
+        acoral_msgq_recv(bench_q1, buf, 0);
+        acoral_msgq_send(bench_q2, buf, 0);
+    }
+    acoral_sem_post(bench_done);
+}
+
+static void bench_msgctr_send(acoral_msgctr_t *ctr, unsigned int id, const void *buf)
+{
+    void *p = acoral_malloc(bench_msg_size);
+    memcpy(p, buf, bench_msg_size);
+    acoral_msg_send(ctr, acoral_msg_create(1, id, 0, p));
+}
+
+static void bench_msgctr_recv(acoral_msgctr_t *ctr, unsigned int id, void *buf)
+{
+    unsigned int err;
+    void *p = acoral_msg_recv(ctr, id, 0, &err);
+    memcpy(buf, p, bench_msg_size);
+    acoral_free(p);
+}
+
+static void bench_msgctr_ping(void *args)
+{
+    unsigned char buf[BENCH_MSGQ_MAX];
+    unsigned long long start;
+    int i;
+    for (i = 0; i < BENCH_SAMPLES; i++)
+    {
+        buf[0] = i;
+        start = HAL_GET_CYCLES();
+        bench_msgctr_send(bench_ctr1, 1, buf);
+        bench_msgctr_recv(bench_ctr2, 2, buf);
+        bench_record(HAL_GET_CYCLES() - start);
+    }
+    acoral_sem_post(bench_done);
+}
+
+static void bench_msgctr_pong(void *args)
+{
+    unsigned char buf[BENCH_MSGQ_MAX];
+    int i;
+    for (i = 0; i < BENCH_SAMPLES; i++)
+    {
+        bench_msgctr_recv(bench_ctr1, 1, buf);
+        bench_msgctr_send(bench_ctr2, 2, buf);
+    }
+    acoral_sem_post(bench_done);
+}
+#endif
+
+/*------------------- 各个测试项 -------------------*/
+
+static void bench_case_coop(void)
+{
+    bench_ids[0] = acoral_create_thread_affinity("bench_coop", bench_coop_worker, (void *)0, 0, ACORAL_SCHED_POLICY_COMM, BENCH_PRIO_HIGH, ACORAL_HARD_PRIO, NULL, 0);
+    bench_ids[1] = acoral_create_thread_affinity("bench_coop", bench_coop_worker, (void *)1, 0, ACORAL_SCHED_POLICY_COMM, BENCH_PRIO_HIGH, ACORAL_HARD_PRIO, NULL, 0);
+    acoral_resume_thread_by_id(bench_ids[0]);
+    acoral_sem_pend(bench_done, 0);
+    acoral_sem_pend(bench_done, 0);
+    bench_report("coop_switch", bench_samples, bench_n);
+}
+
+static void bench_case_preempt(void)
+{
+    bench_peer_id = acoral_create_thread_affinity("bench_high", bench_preempt_high, NULL, 0, ACORAL_SCHED_POLICY_COMM, BENCH_PRIO_HIGH, ACORAL_HARD_PRIO, NULL, 0);
+    bench_spawn("bench_low", bench_preempt_low, NULL, BENCH_PRIO_LOW);
+    acoral_sem_pend(bench_done, 0);
+    acoral_sem_pend(bench_done, 0);
+    bench_report("preempt_switch", bench_samples, bench_n);
+}
+
+static void bench_case_intr(void)
+{
+#ifdef HAL_INTR_RAISE
+    bench_sem1 = acoral_sem_create(0);
+    acoral_intr_attach(BENCH_INTR_VECTOR, bench_intr_isr);
+    acoral_intr_unmask(BENCH_INTR_VECTOR);
+    bench_spawn("bench_high", bench_intr_high, NULL, BENCH_PRIO_HIGH);
+    bench_spawn("bench_low", bench_intr_low, NULL, BENCH_PRIO_LOW);
+    acoral_sem_pend(bench_done, 0);
+    acoral_sem_pend(bench_done, 0);
+    acoral_intr_mask(BENCH_INTR_VECTOR);
+    acoral_intr_detach(BENCH_INTR_VECTOR);
+    acoral_sem_del(bench_sem1);
+    bench_report("intr_wakeup", bench_samples, bench_n);
+#else
+    printf("%-16s\tskipped, no software-triggered interrupt in this HAL\r\n", "intr_wakeup");
+#endif
+}
+
+static void bench_case_sem(void)
+{
+    bench_sem1 = acoral_sem_create(0);
+    bench_sem2 = acoral_sem_create(0);
+    bench_spawn("bench_ping", bench_sem_ping, NULL, BENCH_PRIO_HIGH);
+    bench_spawn("bench_pong", bench_sem_pong, NULL, BENCH_PRIO_HIGH);
+    acoral_sem_pend(bench_done, 0);
+    acoral_sem_pend(bench_done, 0);
+    acoral_sem_del(bench_sem1);
+    acoral_sem_del(bench_sem2);
+    bench_report("sem_pingpong", bench_samples, bench_n);
+}
+
+static void bench_case_mutex(void)
+{
+    acoral_mutex_init(bench_mutex, BENCH_PRIO_HIGH);
+    bench_peer_id = acoral_create_thread_affinity("bench_high", bench_mutex_high, NULL, 0, ACORAL_SCHED_POLICY_COMM, BENCH_PRIO_HIGH, ACORAL_HARD_PRIO, NULL, 0);
+    bench_spawn("bench_low", bench_mutex_low, NULL, BENCH_PRIO_LOW);
+    acoral_sem_pend(bench_done, 0);
+    acoral_sem_pend(bench_done, 0);
+    bench_report("mutex_handoff", bench_samples, bench_n);
+}
+
+static void bench_case_msg(void)
+{
+    bench_ctr1 = acoral_msgctr_create(0);
+    bench_ctr2 = acoral_msgctr_create(0);
+    bench_spawn("bench_ping", bench_msg_ping, NULL, BENCH_PRIO_HIGH);
+    bench_spawn("bench_pong", bench_msg_pong, NULL, BENCH_PRIO_HIGH);
+    acoral_sem_pend(bench_done, 0);
+    acoral_sem_pend(bench_done, 0);
+    acoral_msgctr_del(bench_ctr1, MST_DEL_UNFORCE);
+    acoral_msgctr_del(bench_ctr2, MST_DEL_UNFORCE);
+    bench_report("msg_roundtrip", bench_samples, bench_n);
+}
+
+/* 消息容器里先放ids-1个别的id的消息，同一个线程发一条再收回来，测接收的开销，不切换线程 */
+static void bench_case_msgid(void)
+{
+    static const unsigned int ids[] = {1, 2, 4, 8, 16, 32, 64};
+    unsigned long long t0;
+    acoral_msg_t *msg;
+    unsigned int err;
+    char name[24];
+    int i, j;
+    for (i = 0; i < sizeof(ids) / sizeof(ids[0]); i++)
+    {
+        sprintf(name, "msgid_%u", ids[i]);
+        bench_ctr1 = acoral_msgctr_create(ids[i]);
+        for (j = 1; j < ids[i]; j++)
+        {
+            msg = acoral_msg_create(1, 1000 + j, 0, NULL);
+            if (msg == NULL)
+                break;
+            acoral_msg_send(bench_ctr1, msg);
+        }
+        /* 留一个给下面发收用，消息池不够就不测了 */
+        if (j < ids[i] || (msg = acoral_msg_create(1, 1, 0, NULL)) == NULL)
+        {
+            acoral_msgctr_del(bench_ctr1, MST_DEL_FORCE);
+            printf("%-16s\tskipped, out of message resources\r\n", name);
+            continue;
+        }
+        acoral_msg_del(msg);
+        for (j = 0; j < BENCH_SAMPLES; j++)
+        {
+            acoral_msg_send(bench_ctr1, acoral_msg_create(1, 1, 0, NULL));
+            t0 = HAL_GET_CYCLES();
+            acoral_msg_recv(bench_ctr1, 1, 0, &err);
+            bench_samples[j] = HAL_GET_CYCLES() - t0;
+        }
+        acoral_msgctr_del(bench_ctr1, MST_DEL_FORCE);
+        bench_report(name, bench_samples, BENCH_SAMPLES);
+    }
+}
+
+static void bench_case_fanout(void)
+{
+    acoral_msgbuf_pool_t *pool;
+    unsigned long long t0;
+    void *p;
+    long i;
+    int j;
+
+    bench_frame = acoral_malloc(BENCH_FRAME);
+    pool = acoral_msgbuf_pool_create(BENCH_FRAME, 2);
+    if (bench_frame == NULL || pool == NULL)
+    {
+        printf("%-16s\tskipped, no memory for frames\r\n", "fanout");
+        if (bench_frame != NULL)
+            acoral_free(bench_frame);
+        return;
+    }
+    for (i = 0; i < BENCH_FANOUT; i++)
+        bench_fanout_ctrs[i] = acoral_msgctr_create(0);
+
+    /* 拷贝：每个接收者分配一块、拷一份，收完释放 */
+    for (i = 0; i < BENCH_FANOUT; i++)
+        bench_spawn("bench_rx", bench_fanout_copy_rx, (void *)i, BENCH_PRIO_HIGH);
+    for (j = 0; j < BENCH_FANOUT_SAMPLES; j++)
+    {
+        t0 = HAL_GET_CYCLES();
+        for (i = 0; i < BENCH_FANOUT; i++)
+        {
+            p = acoral_malloc(BENCH_FRAME);
+            memcpy(p, bench_frame, BENCH_FRAME);
+            acoral_msg_send(bench_fanout_ctrs[i], acoral_msg_create(1, 1, 0, p));
+        }
+        bench_record(HAL_GET_CYCLES() - t0);
+    }
+    for (i = 0; i < BENCH_FANOUT; i++)
+        acoral_sem_pend(bench_done, 0);
+    bench_report("fanout_copy", bench_samples, bench_n);
+
+    /* 零拷贝：帧直接写在池里的缓冲区上，多播给所有接收者，最后一个放掉时回到池里 */
+    bench_n = 0;
+    for (i = 0; i < BENCH_FANOUT; i++)
+        bench_spawn("bench_rx", bench_fanout_buf_rx, (void *)i, BENCH_PRIO_HIGH);
+    for (j = 0; j < BENCH_FANOUT_SAMPLES; j++)
+    {
+        t0 = HAL_GET_CYCLES();
+        p = acoral_msgbuf_alloc(pool);
+        acoral_msg_multicast(bench_fanout_ctrs, BENCH_FANOUT, 1, 0, p);
+        acoral_msgbuf_put(p);
+        bench_record(HAL_GET_CYCLES() - t0);
+    }
+    for (i = 0; i < BENCH_FANOUT; i++)
+        acoral_sem_pend(bench_done, 0);
+    bench_report("fanout_zerocopy", bench_samples, bench_n);
+
+    for (i = 0; i < BENCH_FANOUT; i++)
+        acoral_msgctr_del(bench_fanout_ctrs[i], MST_DEL_UNFORCE);
+    acoral_msgbuf_pool_del(pool);
+    acoral_free(bench_frame);
+}
+
+static void bench_case_msgq(void)
+{
+#if CFG_MSGQ
+    static const unsigned int sizes[] = {4, 16, 64, BENCH_MSGQ_MAX};
+    char name[24];
+    int i;
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        bench_msg_size = sizes[i];
+
+        bench_n = 0;
+        bench_ctr1 = acoral_msgctr_create(0);
+        bench_ctr2 = acoral_msgctr_create(0);
+        bench_spawn("bench_ping", bench_msgctr_ping, NULL, BENCH_PRIO_HIGH);
+        bench_spawn("bench_pong", bench_msgctr_pong, NULL, BENCH_PRIO_HIGH);
+        acoral_sem_pend(bench_done, 0);
+        acoral_sem_pend(bench_done, 0);
+        acoral_msgctr_del(bench_ctr1, MST_DEL_UNFORCE);
+        acoral_msgctr_del(bench_ctr2, MST_DEL_UNFORCE);
+        sprintf(name, "msgctr_%u", sizes[i]);
+        bench_report(name, bench_samples, bench_n);
+
+        bench_n = 0;
+        bench_q1 = acoral_msgq_create(bench_msg_size, BENCH_MSGQ_CAPACITY);
+        bench_q2 = acoral_msgq_create(bench_msg_size, BENCH_MSGQ_CAPACITY);
+        bench_spawn("bench_ping", bench_msgq_ping, NULL, BENCH_PRIO_HIGH);
+        bench_spawn("bench_pong", bench_msgq_pong, NULL, BENCH_PRIO_HIGH);
+        acoral_sem_pend(bench_done, 0);
+        acoral_sem_pend(bench_done, 0);
+        acoral_msgq_del(bench_q1);
+        acoral_msgq_del(bench_q2);
+        sprintf(name, "msgq_%u", sizes[i]);
+        bench_report(name, bench_samples, bench_n);
+    }
+#else
+    printf("%-16s\tskipped, CFG_MSGQ is off\r\n", "msgq");
+#endif
+}
+
+static void bench_case_malloc(void)
+{
+    unsigned long long t0, t1, t2;
+    void *p;
+    int i;
+    for (i = 0; i < BENCH_SAMPLES; i++)
+    {
+        t0 = HAL_GET_CYCLES();
+        p = acoral_malloc(64);
+        t1 = HAL_GET_CYCLES();
+        acoral_free(p);
+        t2 = HAL_GET_CYCLES();
+        bench_samples[i] = t1 - t0;
+        bench_samples2[i] = t2 - t1;
+    }
+    bench_report("malloc", bench_samples, BENCH_SAMPLES);
+    bench_report("free", bench_samples2, BENCH_SAMPLES);
+}
+
+static void bench_idle_thread(void *args)
+{
+}
+
+static void bench_case_thread(void)
+{
+    unsigned long long t0, t1, t2;
+    int i, id;
+    for (i = 0; i < BENCH_THREAD_SAMPLES; i++)
+    {
+        /* 被创建的线程优先级比驱动线程低，不会运行，测的只是创建本身 */
+        t0 = HAL_GET_CYCLES();
+        id = acoral_create_thread_affinity("bench_idle", bench_idle_thread, NULL, 0, ACORAL_SCHED_POLICY_COMM, BENCH_PRIO_IDLE_THREAD, ACORAL_HARD_PRIO, NULL, 0);
+        t1 = HAL_GET_CYCLES();
+        acoral_kill_thread_by_id(id);
+        t2 = HAL_GET_CYCLES();
+        bench_samples[i] = t1 - t0;
+        bench_samples2[i] = t2 - t1;
+        /* 让daem把TCB和栈回收掉，否则线程数会超过上限 */
+        acoral_delay_self(1000 / CFG_TICKS_PER_SEC);
+    }
+    bench_report("thread_create", bench_samples, BENCH_THREAD_SAMPLES);
+    bench_report("thread_kill", bench_samples2, BENCH_THREAD_SAMPLES);
+}
+
+static void bench_spawn_worker(void *args)
+{
+}
+
+static void bench_case_spawn(void)
+{
+    unsigned long long t0;
+    int i, n = 0, fails = 0;
+    for (i = 0; i < BENCH_THREAD_SAMPLES; i++)
+    {
+        /* 被创建的线程比驱动线程高，马上运行并退出，测的是一个短命线程从创建到退出的全过程。
+         * 一批连着创建，批与批之间才让daem有机会回收，模拟事件来了就起一个线程处理的用法 */
+        t0 = HAL_GET_CYCLES();
+        if (acoral_create_thread_affinity("bench_spawn", bench_spawn_worker, NULL, 0, ACORAL_SCHED_POLICY_COMM, BENCH_PRIO_HIGH, ACORAL_HARD_PRIO, NULL, 0) < 0)
+            fails++;
+        else
+            bench_samples[n++] = HAL_GET_CYCLES() - t0;
+        if (i % BENCH_SPAWN_BURST == BENCH_SPAWN_BURST - 1)
+            acoral_delay_self(1000 / CFG_TICKS_PER_SEC);
+    }
+    acoral_delay_self(1000 / CFG_TICKS_PER_SEC);
+    bench_report("thread_spawn", bench_samples, n);
+    if (fails)
+        printf("thread_spawn: %d creates failed\r\n", fails);
+}
+
+#if CFG_WORKQ
+static void bench_work_job(void *args)
+{
+    bench_record(HAL_GET_CYCLES() - bench_stamp);
+}
+#endif
+
+static void bench_case_workq(void)
+{
+#if CFG_WORKQ
+    unsigned long long t0;
+    int i;
+    for (i = 0; i < BENCH_SAMPLES; i++)
+    {
+        /* 高档工作线程比驱动线程高，单核上提交之后马上被执行，可以和thread_spawn比：
+         * workq_start是提交到开始执行，workq_roundtrip是提交到做完返回 */
+        t0 = bench_stamp = HAL_GET_CYCLES();
+        acoral_workq_submit(ACORAL_WORKQ_HIGH, bench_work_job, NULL);
+        bench_samples2[i] = HAL_GET_CYCLES() - t0;
+    }
+    bench_report("workq_start", bench_samples, bench_n);
+    bench_report("workq_roundtrip", bench_samples2, BENCH_SAMPLES);
+#else
+    printf("%-16s\tskipped, CFG_WORKQ is off\r\n", "workq");
+#endif
+}
+
+/*------------------- 定时器：几千个定时器挂在一个测试专用的时间轮上，测启动、每个tick的处理和停止 -------------------*/
+
+static acoral_timer_t bench_timers[BENCH_TIMERS];
+static acoral_timer_wheel_t bench_wheel;
+static int bench_timer_fired;
+
+static void bench_timer_expire(acoral_timer_t *timer)
+{
+    bench_timer_fired++;
+}
+
+static void bench_case_timer(void)
+{
+    unsigned long long t0;
+    unsigned int seed = 1;
+    int i, n;
+
+    /* 用自己的时间轮，不受ticks中断干扰，也不会把几千个定时器挂到系统时间轮上 */
+    acoral_timer_wheel_init(&bench_wheel, 0);
+    bench_timer_fired = 0;
+    for (i = 0; i < BENCH_TIMERS; i++)
+    {
+        acoral_init_list(&bench_timers[i].delay_queue_hook);
+        seed = seed * 1103515245 + 12345;
+        t0 = HAL_GET_CYCLES();
+        acoral_timer_wheel_add(&bench_wheel, &bench_timers[i], 1 + (seed >> 8) % BENCH_TIMER_SPAN, bench_timer_expire);
+        /* 只记后面的，这时候时间轮上已经挂了上千个 */
+        if (i >= BENCH_TIMERS - BENCH_SAMPLES)
+            bench_samples[i - (BENCH_TIMERS - BENCH_SAMPLES)] = HAL_GET_CYCLES() - t0;
+    }
+    bench_report("timer_start", bench_samples, BENCH_SAMPLES);
+
+    for (i = 0; i < BENCH_SAMPLES; i++)
+    {
+        t0 = HAL_GET_CYCLES();
+        acoral_timer_wheel_tick(&bench_wheel);
+        bench_samples[i] = HAL_GET_CYCLES() - t0;
+    }
+    bench_report("timer_tick", bench_samples, BENCH_SAMPLES);
+
+    for (i = 0, n = 0; i < BENCH_TIMERS; i++)
+    {
+        if (!acoral_timer_pending(&bench_timers[i]))
+            continue;
+        t0 = HAL_GET_CYCLES();
+        acoral_timer_stop(&bench_timers[i]);
+        if (n < BENCH_SAMPLES)
+            bench_samples[n++] = HAL_GET_CYCLES() - t0;
+    }
+    bench_report("timer_stop", bench_samples, n);
+    printf("timer: %d timers, %d expired in %d ticks\r\n", BENCH_TIMERS, bench_timer_fired, BENCH_SAMPLES);
+}
+
+/*------------------- 唤醒抖动：延时到了之后醒来的时间和要求的差多少纳秒，高精度定时器和按tick的延时比较 -------------------*/
+
+/* 实际延时和要求的差，早醒晚醒都算 */
+static unsigned long long bench_wakeup_err(unsigned long long t0, unsigned long long t1, unsigned long long want)
+{
+    return t1 - t0 > want ? t1 - t0 - want : want - (t1 - t0);
+}
+
+static void bench_case_wakeup(void)
+{
+    unsigned long long t0, want;
+    int i;
+
+    /* 单位是纳秒，不是周期数。hr_wakeup每次延时BENCH_WAKEUP_US微秒，只会晚醒 */
+    want = BENCH_WAKEUP_US * 1000ull;
+    for (i = 0; i < BENCH_SAMPLES; i++)
+    {
+        t0 = acoral_clock_ns();
+        acoral_delay_us(BENCH_WAKEUP_US);
+        bench_samples[i] = bench_wakeup_err(t0, acoral_clock_ns(), want);
+    }
+    bench_report("hr_wakeup_ns", bench_samples, BENCH_SAMPLES);
+
+    /* tick_wakeup延时一个tick，醒在下一个tick边界上，差多少取决于发起延时时离边界还有多远，最多差一个tick */
+    want = 1000000000ull / CFG_TICKS_PER_SEC;
+    for (i = 0; i < BENCH_WAKEUP_TICK_SAMPLES; i++)
+    {
+        t0 = acoral_clock_ns();
+        acoral_delay_self(1000 / CFG_TICKS_PER_SEC);
+        bench_samples[i] = bench_wakeup_err(t0, acoral_clock_ns(), want);
+        /* 错开发起的时刻，不总是刚好在边界上 */
+        acoral_delay_us(BENCH_WAKEUP_US * (i % 16 + 1));
+    }
+    bench_report("tick_wakeup_ns", bench_samples, BENCH_WAKEUP_TICK_SAMPLES);
+#if !CFG_HRTIMER
+    printf("wakeup: CFG_HRTIMER is off, acoral_delay_us rounds up to ticks\r\n");
+#endif
+}
+
+/*------------------- 周期线程：释放到开始运行的延迟（纳秒），线程函数每个周期返回一次和用acoral_period_wait循环比较 -------------------*/
+
+#if CFG_THRD_PERIOD
+static void bench_period_record(void)
+{
+    unsigned long long now = acoral_clock_ns();
+
+    bench_record(now - acoral_period_get_release(acoral_cur_thread->res.id));
+}
+
+/* 每个周期重置栈、从头进来一次 */
+static void bench_period_reinit(void *args)
+{
+    bench_period_record();
+}
+
+/* 只进来一次，在循环里等下一个周期 */
+static void bench_period_loop(void *args)
+{
+    bench_period_record();
+    while (1)
+    {
+        acoral_period_wait();
+        bench_period_record();
+    }
+}
+
+static void bench_period_run(const char *name, void (*route)(void *))
+{
+    acoral_period_policy_data_t data = {.period_time_mm = 1000 / CFG_TICKS_PER_SEC};
+    int id;
+
+    bench_n = 0;
+    id = acoral_create_thread_affinity((char *)name, route, NULL, 0, ACORAL_SCHED_POLICY_PERIOD, BENCH_PRIO_HIGH, ACORAL_HARD_PRIO, &data, 0);
+    if (id < 0)
+    {
+        printf("%-16s	create failed\r\n", name);
+        return;
+    }
+    while (bench_n < BENCH_PERIOD_SAMPLES)
+        acoral_delay_self(100);
+    acoral_kill_thread_by_id(id);
+    bench_report(name, bench_samples, bench_n);
+}
+#endif
+
+static void bench_case_period(void)
+{
+#if CFG_THRD_PERIOD
+    /* 单位是纳秒，不是周期数。p99和min的差就是抖动 */
+    bench_period_run("period_reinit", bench_period_reinit);
+    bench_period_run("period_wait", bench_period_loop);
+#else
+    printf("%-16s\tskipped, CFG_THRD_PERIOD is off\r\n", "period");
+#endif
+}
+
+typedef struct{
+    const char *name;
+    void (*run)(void);
+}bench_case_t;
+
+static const bench_case_t bench_cases[] = {
+    {"coop", bench_case_coop},
+    {"preempt", bench_case_preempt},
+    {"intr", bench_case_intr},
+    {"sem", bench_case_sem},
+    {"mutex", bench_case_mutex},
+    {"msg", bench_case_msg},
+    {"msgid", bench_case_msgid},
+    {"fanout", bench_case_fanout},
+    {"msgq", bench_case_msgq},
+    {"malloc", bench_case_malloc},
+    {"thread", bench_case_thread},
+    {"spawn", bench_case_spawn},
+    {"workq", bench_case_workq},
+    {"timer", bench_case_timer},
+    {"wakeup", bench_case_wakeup},
+    {"period", bench_case_period},
+};
+
+#define BENCH_CASES (sizeof(bench_cases) / sizeof(bench_cases[0]))
+
+static acoral_evt_t *bench_finish; ///<全部测完后post，shell命令等在上面
+
+static void bench_driver(void *args)
+{
+    const char *which = (const char *)args;
+    int i;
+
+    bench_done = acoral_sem_create(0);
+    printf("kernel benchmark, cycles from HAL_GET_CYCLES, all threads on cpu0\r\n");
+    printf("%-16s\tsamples\tmin\tavg\tp99\tmax\r\n", "case");
+    for (i = 0; i < BENCH_CASES; i++)
+    {
+        if (which != NULL && strcmp(which, bench_cases[i].name) != 0)
+            continue;
+        bench_n = 0;
+        bench_stop = 0;
+        bench_cases[i].run();
+        /* 让退出的测试线程被daem回收 */
+        acoral_delay_self(1000 / CFG_TICKS_PER_SEC);
+    }
+    acoral_sem_del(bench_done);
+    if (bench_finish != NULL)
+        acoral_sem_post(bench_finish);
+}
+
+/**
+ * @brief 内核开销测试集：协作式/抢占式切换、中断唤醒、信号量、互斥量、消息、多个id的消息接收、一帧分发给多个线程、定长消息队列和消息容器按值传数据、内存分配、线程创建和杀死、定时器、唤醒抖动、周期线程释放延迟
+ *
+ */
+void bench_kernel()
+{
+    bench_finish = NULL;
+    acoral_create_thread_affinity("bench", bench_driver, NULL, 0, ACORAL_SCHED_POLICY_COMM, BENCH_PRIO_DRIVER, ACORAL_HARD_PRIO, NULL, 0);
+}
+
+static void bench_cmd_exe(int argc, char **argv)
+{
+    static char which[16];
+    int i;
+
+    if (argc > 1)
+    {
+        for (i = 0; i < BENCH_CASES; i++)
+            if (strcmp(argv[1], bench_cases[i].name) == 0)
+                break;
+        if (i == BENCH_CASES)
+        {
+            printf("unknown case '%s', cases:", argv[1]);
+            for (i = 0; i < BENCH_CASES; i++)
+                printf(" %s", bench_cases[i].name);
+            printf("\r\n");
+            return;
+        }
+        strncpy(which, argv[1], sizeof(which) - 1);
+    }
+    /* shell线程等测试跑完，输出才不会和提示符混在一起 */
+    bench_finish = acoral_sem_create(0);
+    acoral_create_thread_affinity("bench", bench_driver, argc > 1 ? which : NULL, 0, ACORAL_SCHED_POLICY_COMM, BENCH_PRIO_DRIVER, ACORAL_HARD_PRIO, NULL, 0);
+    acoral_sem_pend(bench_finish, 0);
+    acoral_sem_del(bench_finish);
+    bench_finish = NULL;
+}
+
+acoral_shell_cmd_t bench_cmd = {
+    "bench",
+    (void *)bench_cmd_exe,
+    "Kernel latency benchmarks: bench [coop|preempt|intr|sem|mutex|msg|malloc|thread|spawn|workq|timer]",
+    NULL
+};
@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include "acoral.h"
+#include "user.h"
+
+#define BENCH_RDY_THREADS 64    ///<挂到就绪队列上的假线程数
+#define BENCH_RDY_ROUNDS 200    ///<每种优先级数目重复的轮数
+
+static acoral_rdy_queue_t bench_queue;
+static acoral_thread_t bench_threads[BENCH_RDY_THREADS];
+
+static acoral_thread_t* bench_select(acoral_rdy_queue_t *queue){
+    unsigned int prio = acoral_get_highprio(queue);
+    return list_entry(queue->queue[prio].next, acoral_thread_t, ready_hook);
+}
+
+/**
+ * @brief 在一个私有的优先级队列上测add/select/del的平均周期数，不影响系统真正的就绪队列
+ * 
+ * @param prio_num 假线程的优先级分布在0~prio_num-1之间
+ * @param lowest 为true时全部线程都放在最低优先级，这是原来线性扫描位图的最坏情况
+ */
+static void bench_rdyqueue_once(unsigned int prio_num, bool lowest){
+    unsigned long long start, add = 0, sel = 0, del = 0;
+    unsigned int seed = prio_num;
+    acoral_thread_t *thread;
+    int i, r;
+
+    acoral_prio_queue_init(&bench_queue);
+    for(r = 0; r < BENCH_RDY_ROUNDS; r++){
+        for(i = 0; i < BENCH_RDY_THREADS; i++){
+            seed = seed * 1103515245 + 12345;
+            bench_threads[i].prio = lowest ? prio_num - 1 : (seed >> 16) % prio_num;
+        }
+
+        start = HAL_GET_CYCLES();
+        for(i = 0; i < BENCH_RDY_THREADS; i++){
+            acoral_prio_queue_add(&bench_queue, bench_threads[i].prio, &bench_threads[i].ready_hook);
+        }
+        add += HAL_GET_CYCLES() - start;
+
+        start = HAL_GET_CYCLES();
+        for(i = 0; i < BENCH_RDY_THREADS; i++){
+            thread = bench_select(&bench_queue);
+        }
+        sel += HAL_GET_CYCLES() - start;
+
+        /* 按优先级从高到低取下，每次取下前都要重新select，和调度器的行为一致 */
+        start = HAL_GET_CYCLES();
+        for(i = 0; i < BENCH_RDY_THREADS; i++){
+            thread = bench_select(&bench_queue);
+            acoral_prio_queue_del(&bench_queue, thread->prio, &thread->ready_hook);
+        }
+        del += HAL_GET_CYCLES() - start;
+    }
+
+    printf("%4d\t%s\t%llu\t%llu\t%llu\r\n", prio_num, lowest ? "lowest" : "random",
+        add / (BENCH_RDY_ROUNDS * BENCH_RDY_THREADS),
+        sel / (BENCH_RDY_ROUNDS * BENCH_RDY_THREADS),
+        del / (BENCH_RDY_ROUNDS * BENCH_RDY_THREADS));
+}
+
+void bench_rdyqueue(){
+    unsigned int prio_num;
+
+    printf("\t\tReady Queue Benchmark (cycles/op)\r\n");
+    printf("----------------------------------------------------------------\r\n");
+    printf("prios\tdist\tadd\tselect\tselect+del\r\n");
+    acoral_enter_critical();
+    for(prio_num = 32; prio_num <= 1024; prio_num <<= 1){
+        if(prio_num > ACORAL_MAX_PRIO_NUM){
+            printf("%4d\tskipped, build with -DCFG_MAX_THREAD=%d or more\r\n", prio_num, prio_num - 1);
+            continue;
+        }
+        bench_rdyqueue_once(prio_num, false);
+        bench_rdyqueue_once(prio_num, true);
+    }
+    acoral_exit_critical();
+    printf("----------------------------------------------------------------\r\n");
+}
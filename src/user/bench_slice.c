@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include "acoral.h"
+#include "user.h"
+
+#define BENCH_SLICE_THREADS 4       ///<同优先级的CPU密集线程数
+#define BENCH_SLICE_RUN_MS 2000     ///<每种时间片跑多久
+
+static const unsigned int bench_slices[] = {0, 10, 50, 200}; ///<时间片长度，毫秒，0表示不用时间片
+
+static volatile unsigned int slice_stop;
+static volatile unsigned long long slice_loops[BENCH_SLICE_THREADS];
+static volatile unsigned int slice_switches;
+static volatile unsigned long long slice_switch_cycles;
+static volatile unsigned long long slice_stamp[BENCH_SLICE_THREADS];
+static volatile int slice_last;
+static acoral_evt_t *slice_done;
+
+/* 空转计数，每一圈都在自己的槽里记下时间戳。发现上一圈不是自己跑的，说明中间换过线程，
+ * 现在和其他线程最新的时间戳之差就是这次切换的开销（包括tick中断处理）。
+ * 时间戳各记各的，被切走的线程最多少记一圈，不会把别人的运行时间算进来 */
+static void slice_worker(void *args)
+{
+    int id = (int)(long)args;
+    unsigned long long now, last;
+    int i;
+    while (!slice_stop)
+    {
+        slice_loops[id]++;
+        if (slice_last != id)
+        {
+            now = HAL_GET_CYCLES();
+            if (slice_last >= 0)
+            {
+                last = 0;
+                for (i = 0; i < BENCH_SLICE_THREADS; i++)
+                    if (i != id && slice_stamp[i] > last)
+                        last = slice_stamp[i];
+                slice_switch_cycles += now - last;
+                slice_switches++;
+            }
+            slice_last = id;
+        }
+        slice_stamp[id] = HAL_GET_CYCLES();
+    }
+    acoral_sem_post(slice_done);
+}
+
+/**
+ * @brief 跑一种时间片：同时创建N个同优先级线程，一段时间后让它们退出
+ *
+ * @param slice_mm 时间片长度，毫秒
+ */
+static void bench_slice_once(unsigned int slice_mm)
+{
+    acoral_comm_policy_data_t data = {.slice_time_mm = slice_mm};
+    unsigned long long total = 0, min, max, sum = 0, sum2 = 0;
+    int i;
+
+    slice_stop = 0;
+    slice_switches = 0;
+    slice_switch_cycles = 0;
+    slice_last = -1;
+    for (i = 0; i < BENCH_SLICE_THREADS; i++)
+    {
+        slice_loops[i] = 0;
+        slice_stamp[i] = 0;
+        acoral_create_thread_affinity("slice", slice_worker, (void *)(long)i, 0, ACORAL_SCHED_POLICY_COMM, 30, ACORAL_HARD_PRIO, &data, 0);
+    }
+    acoral_delay_self(BENCH_SLICE_RUN_MS);
+    slice_stop = 1;
+    for (i = 0; i < BENCH_SLICE_THREADS; i++)
+        acoral_sem_pend(slice_done, 0);
+
+    /* 公平性用Jain指数(sum x)^2/(n*sum x^2)，1表示完全公平，1/n表示只有一个线程在跑；按千分比打印，先把计数缩小防止平方溢出 */
+    min = max = slice_loops[0];
+    for (i = 0; i < BENCH_SLICE_THREADS; i++)
+    {
+        if (slice_loops[i] < min)
+            min = slice_loops[i];
+        if (slice_loops[i] > max)
+            max = slice_loops[i];
+        sum += slice_loops[i] >> 10;
+        sum2 += (slice_loops[i] >> 10) * (slice_loops[i] >> 10);
+    }
+    for (i = 0; i < BENCH_SLICE_THREADS; i++)
+        total += slice_loops[i];
+    printf("%u\t%llu\t%llu\t%llu\t%llu\t%u\t%llu\r\n", slice_mm, total, min, max,
+           sum2 ? sum * sum * 1000 / (BENCH_SLICE_THREADS * sum2) : 0, slice_switches,
+           slice_switches ? slice_switch_cycles / slice_switches : 0);
+}
+
+static void bench_slice_thread(void *args)
+{
+    int i;
+
+    slice_done = acoral_sem_create(0);
+    printf("slice benchmark: %d equal-priority cpu-bound threads on cpu0, %d ms per run\r\n", BENCH_SLICE_THREADS, BENCH_SLICE_RUN_MS);
+    printf("slice(ms)\tloops\tmin\tmax\tjain(1/1000)\tswitches\tcycles/switch\r\n");
+    for (i = 0; i < sizeof(bench_slices) / sizeof(bench_slices[0]); i++)
+        bench_slice_once(bench_slices[i]);
+}
+
+/**
+ * @brief 时间片轮转测试：N个同优先级的CPU密集线程，比较不同时间片下的公平性和切换开销
+ *
+ */
+void bench_slice()
+{
+    acoral_create_thread_affinity("bench_slice", bench_slice_thread, NULL, 0, ACORAL_SCHED_POLICY_COMM, 10, ACORAL_HARD_PRIO, NULL, 0);
+}
@@ -2,6 +2,8 @@
 #include "shell.h"
 #include "mem.h"
 #include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
 
 void malloc_scan(int argc,char **argv){
 	acoral_mem_scan();
@@ -25,6 +27,236 @@ acoral_shell_cmd_t mem2_cmd={
 	NULL
 };
 
+#if CFG_TRACE
+void trace(int argc,char **argv){
+	if(argc < 2 || strcmp(argv[1],"dump") == 0)
+		acoral_trace_dump();
+	else if(strcmp(argv[1],"on") == 0)
+		acoral_trace_enabled = 1;
+	else if(strcmp(argv[1],"off") == 0)
+		acoral_trace_enabled = 0;
+	else if(strcmp(argv[1],"clear") == 0)
+		acoral_trace_clear();
+	else
+		printf("usage: trace [dump|on|off|clear]\r\n");
+}
+
+acoral_shell_cmd_t trace_cmd={
+	"trace",
+	(void*)trace,
+	"Scheduler trace: trace [dump|on|off|clear], convert dump with tools/trace2json.py",
+	NULL
+};
+#endif
+
+#if CFG_THRD_STATS
+typedef struct{
+	int id;
+	char *name;
+	int cpu;
+	unsigned int prio;
+	unsigned long long run;		///<到取样时为止的运行周期，包括正在运行的这一段
+	unsigned long long delta;	///<窗口内的运行周期
+	acoral_thread_stat_t stat;
+}top_entry_t;
+
+static top_entry_t top_before[CFG_MAX_THREAD], top_after[CFG_MAX_THREAD];
+
+/* 在临界区里给所有线程拍一张快照，返回线程数 */
+static int top_snapshot(top_entry_t *tab, unsigned long long *now){
+	acoral_list_t *head, *list;
+	acoral_pool_t *pool;
+	acoral_res_t *res;
+	acoral_thread_t *thread;
+	int i, n = 0;
+
+	head = &acoral_res_system.system_res_ctrl_container[ACORAL_RES_THREAD].pools;
+	acoral_enter_critical();
+	*now = HAL_GET_CYCLES();
+	for(list = head->next; list != head; list = list->next){
+		pool = list_entry(list, acoral_pool_t, ctrl_list);
+		for(i = 0; i < pool->num && n < CFG_MAX_THREAD; i++){
+			res = (acoral_res_t *)(pool->base_adr + pool->size * i);
+			if(ACORAL_RES_TYPE(res->id) != ACORAL_RES_THREAD)
+				continue;
+			thread = list_entry(res, acoral_thread_t, res);
+			/* 已经退出、等着回收或者留在线程缓存里的 */
+			if(thread->state == ACORAL_THREAD_STATE_RELEASE)
+				continue;
+			tab[n].id = thread->res.id;
+			tab[n].name = thread->name;
+			tab[n].cpu = thread->cpu;
+			tab[n].prio = thread->prio;
+			tab[n].stat = thread->stat;
+			tab[n].run = thread->stat.run_cycles;
+			if(acoral_cur_threads[thread->cpu] == thread)
+				tab[n].run += *now - thread->stat.switch_in;
+			n++;
+		}
+	}
+	acoral_exit_critical();
+	return n;
+}
+
+/* 千分比打印成xx.x% */
+static void top_print_share(unsigned long long part, unsigned long long whole){
+	unsigned int permille = whole ? part * 1000 / whole : 0;
+	printf("%3u.%u%%", permille / 10, permille % 10);
+}
+
+void top(int argc,char **argv){
+	unsigned int window_ms = argc > 1 ? atoi(argv[1]) : 1000;
+	unsigned long long t0, t1, window, idle[CFG_MAX_CPU] = {0};
+	top_entry_t tmp;
+	int n0, n1, i, j;
+
+	if(window_ms == 0)
+		window_ms = 1000;
+	n0 = top_snapshot(top_before, &t0);
+	acoral_delay_self(window_ms);
+	n1 = top_snapshot(top_after, &t1);
+	window = t1 - t0;
+
+	/* 窗口内新建的线程之前的运行周期算0；id可能被回收后复用，名字也要对得上 */
+	for(i = 0; i < n1; i++){
+		top_after[i].delta = top_after[i].run;
+		for(j = 0; j < n0; j++){
+			if(top_before[j].id == top_after[i].id && top_before[j].name == top_after[i].name && top_before[j].run <= top_after[i].run){
+				top_after[i].delta = top_after[i].run - top_before[j].run;
+				break;
+			}
+		}
+		if(top_after[i].prio == ACORAL_IDLE_PRIO)
+			idle[top_after[i].cpu] += top_after[i].delta;
+	}
+	/* 按窗口内的占用率从高到低排 */
+	for(i = 1; i < n1; i++){
+		tmp = top_after[i];
+		for(j = i; j > 0 && top_after[j - 1].delta < tmp.delta; j--)
+			top_after[j] = top_after[j - 1];
+		top_after[j] = tmp;
+	}
+
+	printf("top: %u ms window, %llu cycles\r\n", window_ms, window);
+	for(i = 0; i < CFG_MAX_CPU; i++){
+		printf("cpu%d idle ", i);
+		top_print_share(idle[i], window);
+		printf("\r\n");
+	}
+	printf("Name\t\tid\tCPU\tPrio\tShare\tVol\tInvol\tPreempt\tLat\tMaxLat\r\n");
+	for(i = 0; i < n1; i++){
+		printf("%-12s\t%d\t%d\t%u\t", top_after[i].name, top_after[i].id, top_after[i].cpu, top_after[i].prio);
+		top_print_share(top_after[i].delta, window);
+		printf("\t%u\t%u\t%u\t%u\t%u\r\n", top_after[i].stat.voluntary, top_after[i].stat.involuntary, top_after[i].stat.preempted,
+			top_after[i].stat.last_latency, top_after[i].stat.max_latency);
+	}
+}
+
+acoral_shell_cmd_t top_cmd={
+	"top",
+	(void*)top,
+	"CPU share of each thread over a window: top [ms], latency in cycles",
+	NULL
+};
+#endif
+
+#if CFG_STACK_CHECK
+typedef struct{
+	int id;
+	char *name;
+	unsigned int size;
+	unsigned int used;
+}stack_entry_t;
+
+static stack_entry_t stack_tab[CFG_MAX_THREAD];
+
+void stack(int argc,char **argv){
+	acoral_list_t *head, *list;
+	acoral_pool_t *pool;
+	acoral_res_t *res;
+	acoral_thread_t *thread;
+	int i, n = 0, learn = argc > 1 && strcmp(argv[1], "learn") == 0;
+#if CFG_STACK_LEARN
+	static acoral_stack_learn_t tab[CFG_STACK_LEARN_ENTRIES];
+#else
+	if(learn){
+		printf("learn mode needs CFG_STACK_LEARN\r\n");
+		return;
+	}
+#endif
+
+	/* 临界区里只记下来，出了临界区再打印，打印慢，不能一直占着内核大锁 */
+	head = &acoral_res_system.system_res_ctrl_container[ACORAL_RES_THREAD].pools;
+	acoral_enter_critical();
+	for(list = head->next; list != head; list = list->next){
+		pool = list_entry(list, acoral_pool_t, ctrl_list);
+		for(i = 0; i < pool->num && n < CFG_MAX_THREAD; i++){
+			res = (acoral_res_t *)(pool->base_adr + pool->size * i);
+			if(ACORAL_RES_TYPE(res->id) != ACORAL_RES_THREAD)
+				continue;
+			thread = list_entry(res, acoral_thread_t, res);
+			if(thread->state == ACORAL_THREAD_STATE_RELEASE)
+				continue;
+#if CFG_STACK_LEARN
+			/* 还活着的线程也算进去 */
+			if(learn){
+				acoral_stack_learn(thread);
+				continue;
+			}
+#endif
+			stack_tab[n].id = thread->res.id;
+			stack_tab[n].name = thread->name;
+			stack_tab[n].size = thread->stack_size;
+			stack_tab[n].used = acoral_thread_stack_used(thread);
+			n++;
+		}
+	}
+	acoral_exit_critical();
+	if(!learn){
+		printf("Name\t\tid\tSize\tUsed\tUsed%%\r\n");
+		for(i = 0; i < n; i++)
+			printf("%-12s\t%d\t%u\t%u\t%u%%%s\r\n", stack_tab[i].name, stack_tab[i].id, stack_tab[i].size, stack_tab[i].used,
+				stack_tab[i].used * 100 / stack_tab[i].size, stack_tab[i].used >= stack_tab[i].size ? " OVERFLOW" : "");
+	}
+#if CFG_STACK_LEARN
+	if(learn){
+		n = acoral_stack_learn_get(tab);
+		printf("Name\t\tSize\tPeak\tRecommended\r\n");
+		for(i = 0; i < n; i++)
+			printf("%-12s\t%u\t%u\t%u\r\n", tab[i].name, tab[i].size, tab[i].peak, acoral_stack_recommend(tab[i].peak));
+	}
+#endif
+}
+
+acoral_shell_cmd_t stack_cmd={
+	"stack",
+	(void*)stack,
+	"Stack high-water mark of each thread; stack learn: recommended sizes (CFG_STACK_LEARN)",
+	NULL
+};
+#endif
+
+#if CFG_WORKQ
+void workq(int argc,char **argv){
+	static const char *names[ACORAL_WORKQ_BANDS] = {"high", "low"};
+	acoral_workq_stat_t stat;
+	int band;
+
+	printf("Band	Submit	Done	Pending	MaxPend	PoolFail\r\n");
+	for(band = 0; band < ACORAL_WORKQ_BANDS; band++){
+		acoral_workq_get_stat(band, &stat);
+		printf("%s\t%u\t%u\t%u\t%u\t%u\r\n", names[band], stat.submitted, stat.done, stat.pending, stat.max_pending, stat.pool_fails);
+	}
+}
+
+acoral_shell_cmd_t workq_cmd={
+	"workq",
+	(void*)workq,
+	"Work queue statistics of each band",
+	NULL
+};
+#endif
+
 extern acoral_shell_cmd_t *head_cmd;
 void help(int argc,char **argv){
 	acoral_shell_cmd_t *curr;
@@ -54,11 +286,25 @@ acoral_shell_cmd_t spg_cmd={
 };
 
 extern acoral_shell_cmd_t dt_cmd;
+extern acoral_shell_cmd_t bench_cmd;
 extern int fs_cmd_init(void);
 void cmd_init(void){
 	add_command(&mem_cmd);
 	//add_command(&mem2_cmd);
 	add_command(&dt_cmd);
+	add_command(&bench_cmd);
+#if CFG_TRACE
+	add_command(&trace_cmd);
+#endif
+#if CFG_THRD_STATS
+	add_command(&top_cmd);
+#endif
+#if CFG_STACK_CHECK
+	add_command(&stack_cmd);
+#endif
+#if CFG_WORKQ
+	add_command(&workq_cmd);
+#endif
 	add_command(&spg_cmd);
 	add_command(&help_cmd);
 }
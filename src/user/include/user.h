@@ -5,5 +5,20 @@ void test_comm_thread();
 void test_period_thread();
 int test_yolo2();
 int test_iris();
+void bench_rdyqueue();
+void test_smp();
+void bench_balance();
+void test_edf();
+void test_rta();
+void bench_slice();
+void test_tickless();
+void bench_fpu();
+void bench_kernel();
+void test_workq();
+void test_apptimer();
+void test_hrtimer();
+void test_clock();
+void test_msgq();
+void test_msg();
 
 #endif
\ No newline at end of file
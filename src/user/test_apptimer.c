@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include "acoral.h"
+#include "user.h"
+
+/* 应用定时器测试：
+ * 1. 一次性定时器只到期一次，时间对；
+ * 2. 周期定时器按周期到期，相邻两次正好隔一个周期，停掉之后不再到期；
+ * 3. 改周期之后按新周期到期；
+ * 4. 在ticks中断里直接调的回调；
+ * 5. 反复创建删除，资源池不会漏 */
+
+#if CFG_APPTIMER
+#define APPTIMER_TEST_ONESHOT 100   ///<一次性定时器的延时，毫秒
+#define APPTIMER_TEST_PERIOD 50     ///<周期定时器的周期，毫秒
+#define APPTIMER_TEST_RUNS 10       ///<周期定时器看几个周期
+#define APPTIMER_TEST_LOOPS 100     ///<反复创建删除的次数
+
+typedef struct{
+    volatile unsigned int runs;
+    volatile unsigned int first;    ///<第一次到期的tick
+    volatile unsigned int last;     ///<最后一次到期的tick
+    volatile unsigned int bad_gaps; ///<和上一次不是正好隔一个周期的次数
+    unsigned int gap;               ///<期望的间隔，ticks
+    acoral_timer_t *timer;          ///<测的是哪个定时器
+}apptimer_test_t;
+
+static apptimer_test_t apptimer_tests[3];
+
+static void apptimer_test_fn(void *args)
+{
+    apptimer_test_t *t = (apptimer_test_t *)args;
+    /* 服务线程可能晚跑，看定时器到期的tick，不看现在的 */
+    unsigned int now = acoral_apptimer_fired(t->timer);
+
+    if (t->runs == 0)
+        t->first = now;
+    else if (now - t->last != t->gap)
+        t->bad_gaps++;
+    t->last = now;
+    t->runs++;
+}
+
+static void apptimer_test_thread(void *args)
+{
+    acoral_timer_t *oneshot, *periodic, *tick;
+    unsigned int errors = 0, t0, i, runs;
+    acoral_timer_t *timer;
+
+    /* 1. 一次性 */
+    oneshot = acoral_apptimer_create(apptimer_test_fn, &apptimer_tests[0], APPTIMER_TEST_ONESHOT, ACORAL_APPTIMER_ONESHOT);
+    if (oneshot == NULL)
+        errors++;
+    apptimer_tests[0].timer = oneshot;
+    t0 = acoral_get_ticks();
+    acoral_apptimer_start(oneshot);
+    acoral_delay_self(APPTIMER_TEST_ONESHOT * 3);
+    if (apptimer_tests[0].runs != 1 || apptimer_tests[0].first - t0 != (unsigned int)time_to_ticks(APPTIMER_TEST_ONESHOT))
+        errors++;
+    printf("apptimer: oneshot %u runs after %u ticks, %u errors\r\n", apptimer_tests[0].runs, apptimer_tests[0].first - t0, errors);
+
+    /* 2. 周期，服务线程里调 */
+    apptimer_tests[1].gap = time_to_ticks(APPTIMER_TEST_PERIOD);
+    periodic = acoral_apptimer_create(apptimer_test_fn, &apptimer_tests[1], APPTIMER_TEST_PERIOD, ACORAL_APPTIMER_PERIODIC);
+    apptimer_tests[1].timer = periodic;
+    acoral_apptimer_start(periodic);
+    acoral_delay_self(APPTIMER_TEST_PERIOD * APPTIMER_TEST_RUNS + APPTIMER_TEST_PERIOD / 2);
+    acoral_apptimer_stop(periodic);
+    runs = apptimer_tests[1].runs;
+    if (runs != APPTIMER_TEST_RUNS || apptimer_tests[1].bad_gaps)
+        errors++;
+    acoral_delay_self(APPTIMER_TEST_PERIOD * 3);
+    if (apptimer_tests[1].runs != runs)
+        errors++;
+    printf("apptimer: periodic %u runs, %u bad gaps, %u errors\r\n", runs, apptimer_tests[1].bad_gaps, errors);
+
+    /* 3. 改周期，从改的时候开始按新周期算 */
+    apptimer_tests[1].runs = 0;
+    apptimer_tests[1].gap = time_to_ticks(APPTIMER_TEST_PERIOD * 2);
+    acoral_apptimer_start(periodic);
+    acoral_apptimer_set_period(periodic, APPTIMER_TEST_PERIOD * 2);
+    acoral_delay_self(APPTIMER_TEST_PERIOD * 2 * APPTIMER_TEST_RUNS + APPTIMER_TEST_PERIOD);
+    acoral_apptimer_del(periodic);
+    if (apptimer_tests[1].runs != APPTIMER_TEST_RUNS || apptimer_tests[1].bad_gaps)
+        errors++;
+    printf("apptimer: new period %u runs, %u bad gaps, %u errors\r\n", apptimer_tests[1].runs, apptimer_tests[1].bad_gaps, errors);
+
+    /* 4. 在ticks中断里调 */
+    apptimer_tests[2].gap = time_to_ticks(APPTIMER_TEST_PERIOD);
+    tick = acoral_apptimer_create(apptimer_test_fn, &apptimer_tests[2], APPTIMER_TEST_PERIOD, ACORAL_APPTIMER_PERIODIC | ACORAL_APPTIMER_IN_TICK);
+    apptimer_tests[2].timer = tick;
+    acoral_apptimer_start(tick);
+    acoral_delay_self(APPTIMER_TEST_PERIOD * APPTIMER_TEST_RUNS + APPTIMER_TEST_PERIOD / 2);
+    acoral_apptimer_del(tick);
+    if (apptimer_tests[2].runs != APPTIMER_TEST_RUNS || apptimer_tests[2].bad_gaps)
+        errors++;
+    printf("apptimer: in tick %u runs, %u bad gaps, %u errors\r\n", apptimer_tests[2].runs, apptimer_tests[2].bad_gaps, errors);
+
+    /* 5. 反复创建删除，有的还在计时就删掉 */
+    acoral_apptimer_del(oneshot);
+    for (i = 0; i < APPTIMER_TEST_LOOPS; i++)
+    {
+        timer = acoral_apptimer_create(apptimer_test_fn, &apptimer_tests[0], APPTIMER_TEST_ONESHOT, ACORAL_APPTIMER_ONESHOT);
+        if (timer == NULL)
+        {
+            errors++;
+            break;
+        }
+        if (i % 2)
+            acoral_apptimer_start(timer);
+        acoral_apptimer_del(timer);
+    }
+    acoral_delay_self(APPTIMER_TEST_ONESHOT * 2);
+    if (apptimer_tests[0].runs != 1)
+        errors++;
+    printf("apptimer: %u errors\r\n", errors);
+}
+#endif
+
+/**
+ * @brief 应用定时器测试：一次性、周期、改周期、在ticks中断里调、反复创建删除
+ *
+ */
+void test_apptimer()
+{
+#if CFG_APPTIMER
+    acoral_create_thread("apptimer_test", apptimer_test_thread, NULL, 0, ACORAL_SCHED_POLICY_COMM, 10, ACORAL_HARD_PRIO, NULL);
+#else
+    printf("apptimer: CFG_APPTIMER is off\r\n");
+#endif
+}
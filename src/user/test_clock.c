@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include "acoral.h"
+#include "user.h"
+
+/* 时钟和回绕测试：
+ * 1. 换算宏是常量表达式，大的毫秒数换成tick不溢出，放不进int的饱和，不会变成负数；
+ * 2. tick比较宏跨过32位回绕时结果对；
+ * 3. 时间轮从快要回绕的tick开始走，跨过回绕的定时器都在该到期的那个tick到期；
+ * 4. 64位时钟单调，和tick计数对得上 */
+
+#define CLOCK_TEST_TIMERS 512       ///<挂在测试时间轮上的定时器数
+#define CLOCK_TEST_SPAN 20000       ///<定时器的到期时间在1到这么多个tick之间
+#define CLOCK_TEST_BEFORE_WRAP 5000 ///<测试时间轮从回绕前多少个tick开始走
+#define CLOCK_TEST_DELAY 100        ///<对时钟的延时，毫秒
+
+/* 放在静态初始化里，换算宏不是常量表达式的话编译不过 */
+static const unsigned long long clock_test_consts[] = {ACORAL_MS_TO_NS(5), ACORAL_US_TO_NS(250), ACORAL_MS_TO_TICKS(1000), ACORAL_NS_PER_TICK};
+
+static acoral_timer_t clock_test_timers[CLOCK_TEST_TIMERS];
+static unsigned int clock_test_want[CLOCK_TEST_TIMERS];  ///<每个定时器该在哪个tick到期
+static acoral_timer_wheel_t clock_test_wheel;
+static unsigned int clock_test_now;     ///<测试时间轮当前的tick
+static unsigned int clock_test_fired, clock_test_wrong;
+
+static void clock_test_expire(acoral_timer_t *timer)
+{
+    clock_test_fired++;
+    if (clock_test_want[timer - clock_test_timers] != clock_test_now)
+        clock_test_wrong++;
+}
+
+static void clock_test_thread(void *args)
+{
+    unsigned int errors = 0, seed = 1, i, t;
+    unsigned long long c0, c1, k0, k1;
+
+    /* 1. 换算 */
+    if (clock_test_consts[0] != 5000000 || clock_test_consts[1] != 250000 || clock_test_consts[2] != CFG_TICKS_PER_SEC)
+        errors++;
+    if ((unsigned long long)time_to_ticks(4000000000u) != (4000000ull * CFG_TICKS_PER_SEC > ACORAL_TICKS_MAX ? ACORAL_TICKS_MAX : 4000000ull * CFG_TICKS_PER_SEC))
+        errors++;
+    if (time_to_ticks(0xffffffffu) <= 0)
+        errors++;
+    if (ACORAL_NS_TO_TICKS_UP(1) != 1 || ACORAL_NS_TO_TICKS(ACORAL_NS_PER_TICK - 1) != 0)
+        errors++;
+
+    /* 2. 回绕前后的比较 */
+    if (!ACORAL_TICK_AFTER(5u, 0xfffffff0u) || !ACORAL_TICK_BEFORE(0xfffffff0u, 5u) || ACORAL_TICK_AFTER(5u, 5u))
+        errors++;
+    if (!ACORAL_TICK_AFTER_EQ(5u, 5u) || !ACORAL_TICK_AFTER_EQ(3u, 0xfffffffeu) || ACORAL_TICK_AFTER_EQ(0xfffffffeu, 3u))
+        errors++;
+    printf("clock: conversions and compares done, %u errors\r\n", errors);
+
+    /* 3. 测试专用的时间轮，从0xffffffff-CLOCK_TEST_BEFORE_WRAP开始，一半的定时器跨过回绕 */
+    clock_test_now = 0xffffffffu - CLOCK_TEST_BEFORE_WRAP;
+    acoral_timer_wheel_init(&clock_test_wheel, clock_test_now);
+    clock_test_fired = clock_test_wrong = 0;
+    for (i = 0; i < CLOCK_TEST_TIMERS; i++)
+    {
+        acoral_init_list(&clock_test_timers[i].delay_queue_hook);
+        seed = seed * 1103515245 + 12345;
+        t = 1 + (seed >> 8) % CLOCK_TEST_SPAN;
+        clock_test_want[i] = clock_test_now + t;
+        acoral_timer_wheel_add(&clock_test_wheel, &clock_test_timers[i], t, clock_test_expire);
+    }
+    for (i = 0; i < CLOCK_TEST_SPAN; i++)
+    {
+        clock_test_now++;
+        acoral_timer_wheel_tick(&clock_test_wheel);
+    }
+    if (clock_test_fired != CLOCK_TEST_TIMERS || clock_test_wrong)
+        errors++;
+    printf("clock: wheel across wrap, %u fired, %u wrong, %u errors\r\n", clock_test_fired, clock_test_wrong, errors);
+
+    /* 4. 时钟单调，延时前后和tick计数对得上 */
+    c0 = acoral_clock_ns();
+    for (i = 0; i < 1000; i++)
+    {
+        c1 = acoral_clock_ns();
+        if (c1 < c0)
+            errors++;
+        c0 = c1;
+    }
+    if (acoral_get_ticks() != (unsigned int)acoral_get_ticks64())
+        errors++;
+    c0 = acoral_clock_ns();
+    k0 = acoral_get_ticks64();
+    acoral_delay_self(CLOCK_TEST_DELAY);
+    c1 = acoral_clock_ns();
+    k1 = acoral_get_ticks64();
+    /* 按tick的延时醒在tick边界上，最多早一个tick */
+    if (k1 - k0 != (unsigned long long)time_to_ticks(CLOCK_TEST_DELAY)
+        || c1 - c0 < ACORAL_MS_TO_NS(CLOCK_TEST_DELAY) - ACORAL_NS_PER_TICK)
+        errors++;
+    printf("clock: delay %ums took %llu ticks, %lluus, uptime %llums\r\n", CLOCK_TEST_DELAY, k1 - k0, ACORAL_NS_TO_US(c1 - c0), acoral_clock_ms());
+    printf("clock: %u errors\r\n", errors);
+}
+
+/**
+ * @brief 时钟测试：换算宏、回绕前后的比较、跨过回绕的时间轮、64位时钟
+ *
+ */
+void test_clock()
+{
+    acoral_create_thread_affinity("clock_test", clock_test_thread, NULL, 0, ACORAL_SCHED_POLICY_COMM, 10, ACORAL_HARD_PRIO, NULL, 0);
+}
@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include "acoral.h"
+#include "user.h"
+
+/* EDF与周期策略对比测试：
+ * 两个周期任务T1(C=6,T=12)、T2(C=8,T=18)，单位是tick，总利用率 6/12+8/18≈0.944。
+ * 用周期策略按单调速率（周期短的优先级高）分配优先级时，T2的最坏响应时间是20个tick，超过了它的周期18，每个超周期都会错过截止期；
+ * 换成EDF，利用率不超过1就可以调度，不应该错过任何截止期。
+ * 作业的执行时间按tick模拟，不依赖CPU速度：作业一直空转，每看到一次tick变化就算自己用掉了一个tick。
+ * 作业都是在tick边界上释放的，完成也紧跟在tick边界之后，所以每个tick区间都完整地属于某一个线程，
+ * 被抢占的作业恢复运行时看到的变化，算的正是被抢占之前它跑完的那个区间。
+ * 所有线程都绑在0号核上，其他核不参与。
+ * 最后再跑一个中途阻塞的EDF作业：每个作业延时1.5个周期，周期到的时候它还挂在延时上，这次释放必须算作超限，
+ * 不能把它当成做完了的作业重置栈，否则作业会从头再跑，永远做不完。
+ * 还要反复创建周期为0的EDF线程，每次都失败，失败时TCB、thread_timer都要收回，之后照样能创建线程 */
+
+#define EDF_TEST_HYPERPERIODS 5 ///<每种策略跑几个超周期
+#define EDF_TEST_HYPERPERIOD 36 ///<超周期，tick
+#define EDF_TEST_BLOCK_PERIOD 10 ///<阻塞作业的周期，tick
+#define EDF_TEST_BLOCK_JOBS 5 ///<阻塞作业跑几个
+#define EDF_TEST_REJECTS 128 ///<创建失败的次数，比TCB和定时器资源池都大
+
+typedef struct{
+    char *name;
+    unsigned int c;         ///<执行时间，tick
+    unsigned int t;         ///<周期，tick，截止期等于周期
+    unsigned int t0;        ///<第一个作业的释放时间
+    unsigned int jobs;      ///<完成的作业数
+    unsigned int misses;    ///<完成时超过截止期的作业数
+}edf_test_task_t;
+
+static edf_test_task_t edf_tasks[2] = {
+    {.name = "T1", .c = 6, .t = 12},
+    {.name = "T2", .c = 8, .t = 18}
+};
+
+/* 模拟执行c个tick */
+static void edf_consume(unsigned int c)
+{
+    unsigned int last = acoral_get_ticks(), now, used = 0;
+    while (used < c)
+    {
+        now = acoral_get_ticks();
+        if (now != last)
+        {
+            used++;
+            last = now;
+        }
+    }
+}
+
+/* 等到下一个tick刚开始的时候返回 */
+static unsigned int edf_tick_edge(void)
+{
+    unsigned int now = acoral_get_ticks();
+    while (acoral_get_ticks() == now)
+        ;
+    return now + 1;
+}
+
+/* 一个作业：按释放时所在的周期算出截止期，模拟执行C个tick，完成时检查有没有超过截止期 */
+static void edf_job(void *args)
+{
+    edf_test_task_t *task = (edf_test_task_t *)args;
+    unsigned int k, deadline;
+
+    k = (acoral_get_ticks() - task->t0) / task->t;
+    deadline = task->t0 + (k + 1) * task->t;
+    edf_consume(task->c);
+    if ((int)(acoral_get_ticks() - deadline) > 0)
+        task->misses++;
+    task->jobs++;
+}
+
+static volatile unsigned int edf_block_started; ///<阻塞作业开始的次数
+static volatile unsigned int edf_block_done; ///<阻塞作业做完的次数
+
+/* 一个作业：延时1.5个周期再返回，周期到的时候它挂在延时上 */
+static void edf_block_job(void *args)
+{
+    edf_block_started++;
+    acoral_delay_self(EDF_TEST_BLOCK_PERIOD * 3 / 2 * 1000 / CFG_TICKS_PER_SEC);
+    edf_block_done++;
+}
+
+/* 跑阻塞作业：每个作业都要做完，每两个周期释放一个，中间那次释放记为超限 */
+static void edf_test_block(void)
+{
+    acoral_edf_policy_data_t edf_data;
+    acoral_edf_stat_t stat;
+    unsigned int errors = 0;
+    int id;
+
+    edf_block_started = 0;
+    edf_block_done = 0;
+    edf_data.period_time_mm = EDF_TEST_BLOCK_PERIOD * 1000 / CFG_TICKS_PER_SEC;
+    edf_data.deadline_time_mm = 2 * edf_data.period_time_mm;
+    edf_tick_edge();
+    id = acoral_create_thread_affinity("edf_block", edf_block_job, NULL, 0, ACORAL_SCHED_POLICY_EDF, 20, ACORAL_HARD_PRIO, &edf_data, 0);
+    /* 最后一个作业在(2*EDF_TEST_BLOCK_JOBS-2)个周期时释放，再过1.5个周期做完 */
+    acoral_delay_self(2 * EDF_TEST_BLOCK_JOBS * EDF_TEST_BLOCK_PERIOD * 1000 / CFG_TICKS_PER_SEC);
+    acoral_edf_get_stat(id, &stat);
+    acoral_kill_thread_by_id(id);
+    if (edf_block_done < EDF_TEST_BLOCK_JOBS || edf_block_started > edf_block_done + 1)
+        errors++;
+    if (stat.jobs != edf_block_done || stat.overruns < EDF_TEST_BLOCK_JOBS - 1 || stat.misses)
+        errors++;
+    printf("edf: blocking job started %u, done %u (kernel: %u jobs, %u misses, %u overruns), %u errors\r\n",
+           edf_block_started, edf_block_done, stat.jobs, stat.misses, stat.overruns, errors);
+}
+
+/* 反复创建失败，再看还能不能创建线程 */
+static void edf_test_reject(void)
+{
+    acoral_edf_policy_data_t edf_data;
+    unsigned int errors = 0;
+    int i, id;
+
+    edf_data.period_time_mm = 0;
+    edf_data.deadline_time_mm = 0;
+    for (i = 0; i < EDF_TEST_REJECTS; i++)
+        if (acoral_create_thread_affinity("edf_bad", edf_block_job, NULL, 0, ACORAL_SCHED_POLICY_EDF, 20, ACORAL_HARD_PRIO, &edf_data, 0) != -1)
+            errors++;
+    edf_data.period_time_mm = EDF_TEST_BLOCK_PERIOD * 1000 / CFG_TICKS_PER_SEC;
+    id = acoral_create_thread_affinity("edf_ok", edf_block_job, NULL, 0, ACORAL_SCHED_POLICY_EDF, 20, ACORAL_HARD_PRIO, &edf_data, 0);
+    if (id == -1)
+        errors++;
+    else
+        acoral_kill_thread_by_id(id);
+    printf("edf: %d failed creations, %u errors\r\n", EDF_TEST_REJECTS, errors);
+}
+
+/**
+ * @brief 用某种策略跑一遍任务集
+ *
+ * @param policy ACORAL_SCHED_POLICY_PERIOD或ACORAL_SCHED_POLICY_EDF
+ * @param id 返回两个线程的id
+ */
+static void edf_test_run(acoralSchedPolicyEnum policy, int *id)
+{
+    acoral_period_policy_data_t period_data;
+    acoral_edf_policy_data_t edf_data;
+    unsigned int t0;
+    int i;
+
+    for (i = 0; i < 2; i++)
+    {
+        edf_tasks[i].jobs = 0;
+        edf_tasks[i].misses = 0;
+    }
+    /* 两个任务在同一个tick里创建，第一个作业同时释放 */
+    t0 = edf_tick_edge();
+    for (i = 0; i < 2; i++)
+    {
+        edf_tasks[i].t0 = t0;
+        if (policy == ACORAL_SCHED_POLICY_PERIOD)
+        {
+            /* 单调速率：周期越短优先级越高 */
+            period_data.period_time_mm = edf_tasks[i].t * 1000 / CFG_TICKS_PER_SEC;
+            period_data.wcet_mm = 0; /* 不填WCET，跳过准入检查，这个任务集在单调速率下本来就过不了 */
+            id[i] = acoral_create_thread_affinity(edf_tasks[i].name, edf_job, &edf_tasks[i], 0, ACORAL_SCHED_POLICY_PERIOD, 20 + i, ACORAL_HARD_PRIO, &period_data, 0);
+        }
+        else
+        {
+            /* EDF线程都放在同一个优先级上，由截止期决定先后 */
+            edf_data.period_time_mm = edf_tasks[i].t * 1000 / CFG_TICKS_PER_SEC;
+            edf_data.deadline_time_mm = 0;
+            id[i] = acoral_create_thread_affinity(edf_tasks[i].name, edf_job, &edf_tasks[i], 0, ACORAL_SCHED_POLICY_EDF, 20, ACORAL_HARD_PRIO, &edf_data, 0);
+        }
+    }
+    acoral_delay_self(EDF_TEST_HYPERPERIODS * EDF_TEST_HYPERPERIOD * 1000 / CFG_TICKS_PER_SEC);
+}
+
+static void edf_test_thread(void *args)
+{
+    acoral_edf_stat_t stat;
+    int id[2], i;
+
+    printf("edf: T1(C=%u,T=%u) T2(C=%u,T=%u) U=%u/1000, %d hyperperiods\r\n",
+           edf_tasks[0].c, edf_tasks[0].t, edf_tasks[1].c, edf_tasks[1].t,
+           1000 * edf_tasks[0].c / edf_tasks[0].t + 1000 * edf_tasks[1].c / edf_tasks[1].t,
+           EDF_TEST_HYPERPERIODS);
+    printf("policy\ttask\tjobs\tmisses\r\n");
+
+    edf_test_run(ACORAL_SCHED_POLICY_PERIOD, id);
+    for (i = 0; i < 2; i++)
+    {
+        acoral_kill_thread_by_id(id[i]);
+        printf("period\t%s\t%u\t%u\r\n", edf_tasks[i].name, edf_tasks[i].jobs, edf_tasks[i].misses);
+    }
+
+    edf_test_run(ACORAL_SCHED_POLICY_EDF, id);
+    for (i = 0; i < 2; i++)
+    {
+        acoral_edf_get_stat(id[i], &stat);
+        acoral_kill_thread_by_id(id[i]);
+        printf("edf\t%s\t%u\t%u\t(kernel: %u jobs, %u misses, %u overruns)\r\n", edf_tasks[i].name, edf_tasks[i].jobs, edf_tasks[i].misses,
+               stat.jobs, stat.misses, stat.overruns);
+    }
+
+    edf_test_block();
+    edf_test_reject();
+}
+
+/**
+ * @brief EDF测试：利用率接近1的任务集，周期策略（单调速率）下错过截止期，EDF下不错过；中途阻塞跨过周期的作业不会被重置
+ *
+ */
+void test_edf()
+{
+    acoral_create_thread_affinity("edf_test", edf_test_thread, NULL, 0, ACORAL_SCHED_POLICY_COMM, 10, ACORAL_HARD_PRIO, NULL, 0);
+}
@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include "acoral.h"
+#include "user.h"
+
+/* 高精度定时器测试：
+ * 1. 不满一个tick的微秒延时，不会早醒，也不会拖到下一个tick；
+ * 2. 信号量、消息的纳秒超时，到时间返回超时，不早于给的时间；
+ * 3. 超时之前等到了就正常返回，超时定时器取下来了，不会再把线程叫醒 */
+
+#if CFG_HRTIMER
+#define HRTIMER_TEST_LOOPS 100          ///<每种延时测几次
+#define HRTIMER_TEST_SLACK_NS 1000000   ///<晚醒超过这么多纳秒的单独计数，主机上偶尔会被宿主调度走几毫秒，不算错
+#define HRTIMER_TEST_TIMEOUT_NS 300000  ///<ipc超时的纳秒数
+#define HRTIMER_TEST_POST_US 100        ///<超时前post的测试里，post的线程过多少微秒post
+#define HRTIMER_TEST_LONG_NS 3000000    ///<超时前post的测试里给的超时，比post晚得多
+
+static acoral_evt_t *hrtimer_test_sem;
+static unsigned int hrtimer_test_late;  ///<晚醒超过HRTIMER_TEST_SLACK_NS的次数
+
+/* 检查从t0开始的一次等待：早醒算错，晚醒太多的记下来 */
+static int hrtimer_test_check(unsigned long long t0, unsigned long long want)
+{
+    unsigned long long passed = acoral_clock_ns() - t0;
+
+    if (passed > want + HRTIMER_TEST_SLACK_NS)
+        hrtimer_test_late++;
+    return passed < want;
+}
+
+static void hrtimer_test_poster(void *args)
+{
+    acoral_delay_us(HRTIMER_TEST_POST_US);
+    acoral_sem_post(hrtimer_test_sem);
+}
+
+static void hrtimer_test_thread(void *args)
+{
+    static const unsigned int delays[] = {50, 200, 1000, 3000};
+    unsigned long long t0, max_late;
+    unsigned int errors = 0, i, j, err;
+    acoral_msgctr_t *msgctr;
+
+    /* 1. 微秒延时，都比一个tick短 */
+    for (j = 0; j < sizeof(delays) / sizeof(delays[0]); j++)
+    {
+        max_late = 0;
+        for (i = 0; i < HRTIMER_TEST_LOOPS; i++)
+        {
+            t0 = acoral_clock_ns();
+            acoral_delay_us(delays[j]);
+            if (hrtimer_test_check(t0, delays[j] * 1000ull))
+                errors++;
+            t0 = acoral_clock_ns() - t0 - delays[j] * 1000ull;
+            if ((long long)t0 > (long long)max_late)
+                max_late = t0;
+        }
+        printf("hrtimer: delay %uus, max late %lluns, %u errors\r\n", delays[j], max_late, errors);
+    }
+
+    /* 2. 没人post的信号量和没人发的消息，等到超时 */
+    hrtimer_test_sem = acoral_sem_create(0);
+    for (i = 0; i < HRTIMER_TEST_LOOPS; i++)
+    {
+        t0 = acoral_clock_ns();
+        if (acoral_sem_pend_ns(hrtimer_test_sem, HRTIMER_TEST_TIMEOUT_NS) != SEM_ERR_TIMEOUT)
+            errors++;
+        if (hrtimer_test_check(t0, HRTIMER_TEST_TIMEOUT_NS))
+            errors++;
+    }
+    msgctr = acoral_msgctr_create(0);
+    for (i = 0; i < HRTIMER_TEST_LOOPS; i++)
+    {
+        t0 = acoral_clock_ns();
+        if (acoral_msg_recv_ns(msgctr, 1, HRTIMER_TEST_TIMEOUT_NS, &err) != NULL || err != MST_ERR_TIMEOUT)
+            errors++;
+        if (hrtimer_test_check(t0, HRTIMER_TEST_TIMEOUT_NS))
+            errors++;
+    }
+    acoral_msgctr_del(msgctr, MST_DEL_UNFORCE);
+    printf("hrtimer: ipc timeouts done, %u errors\r\n", errors);
+
+    /* 3. 超时之前被post，接着延时到超时原本该到的时候之后，被取消的超时不能把延时提前叫醒 */
+    for (i = 0; i < HRTIMER_TEST_LOOPS / 10; i++)
+    {
+        acoral_create_thread_affinity("hrtimer_post", hrtimer_test_poster, NULL, 0, ACORAL_SCHED_POLICY_COMM, 9, ACORAL_HARD_PRIO, NULL, 0);
+        if (acoral_sem_pend_ns(hrtimer_test_sem, HRTIMER_TEST_LONG_NS) != SEM_SUCCED)
+            errors++;
+        t0 = acoral_clock_ns();
+        acoral_delay_us(HRTIMER_TEST_LONG_NS / 1000);
+        if (hrtimer_test_check(t0, HRTIMER_TEST_LONG_NS))
+            errors++;
+    }
+    acoral_sem_del(hrtimer_test_sem);
+    printf("hrtimer: %u late beyond %uns, %u errors\r\n", hrtimer_test_late, HRTIMER_TEST_SLACK_NS, errors);
+}
+#endif
+
+/**
+ * @brief 高精度定时器测试：微秒延时的精度、信号量和消息的纳秒超时、超时前等到的情况
+ *
+ */
+void test_hrtimer()
+{
+#if CFG_HRTIMER
+    acoral_create_thread_affinity("hrtimer_test", hrtimer_test_thread, NULL, 0, ACORAL_SCHED_POLICY_COMM, 10, ACORAL_HARD_PRIO, NULL, 0);
+#else
+    printf("hrtimer: CFG_HRTIMER is off\r\n");
+#endif
+}
@@ -0,0 +1,292 @@
+#include <stdio.h>
+#include <string.h>
+#include "acoral.h"
+#include "user.h"
+
+/* 消息容器测试：
+ * 1. 同一个id的消息先发先收，不同id的互不影响，散列到同一个桶的id也分得开；
+ * 2. 发一个id的消息只唤醒等这个id的线程，等别的id的优先级再高也不动；
+ * 3. 能收两次的消息叫醒两个等待线程，两个都收到；
+ * 4. 等不到消息的按时超时，超时后容器上不留等待线程；
+ * 5. 容器满了非阻塞发送失败，阻塞发送等到有位置或者超时，收走一条唤醒一个发送者；强制删容器时等着收发的都返回MST_ERR_DEL；
+ * 6. 一块缓冲区多播到几个容器，每个接收者拿到的是同一块，最后一个放掉时回到池里；容器删掉时没收走的引用也放掉；
+ * 7. 过了生存周期的消息没人收也会被回收，通知函数调一次，收不到过期的，腾出的位置让等着发的发进来 */
+
+#if CFG_MSG
+#define MSG_TEST_ID 5
+#define MSG_TEST_ID2 (MSG_TEST_ID + ACORAL_MSGCTR_HASH) ///<和MSG_TEST_ID散列到同一个桶
+#define MSG_TEST_TIMEOUT 20     ///<等超时的毫秒数
+#define MSG_TEST_FRAME (320 * 240 * 2)  ///<缓冲区大小，一帧320x240的RGB565
+#define MSG_TEST_FANOUT 3       ///<多播到几个容器
+#define MSG_TEST_CAPACITY 2     ///<流控测试里容器的容量
+#define MSG_TEST_PRODUCED 6     ///<流控测试里生产者发的消息数
+#define MSG_TEST_TTL 3          ///<生存周期测试里短的那条消息的生存周期，ticks
+
+static acoral_msgctr_t *msg_test_ctr;
+static volatile long msg_test_got[2];   ///<两个等待线程收到的内容，0表示还没收到
+static long msg_test_expired;           ///<过期通知收到的内容加起来
+
+static void msg_test_waiter(void *args)
+{
+    int which = (int)(long)args;
+    unsigned int err;
+
+    msg_test_got[which] = (long)acoral_msg_recv(msg_test_ctr, which ? MSG_TEST_ID2 : MSG_TEST_ID, 0, &err);
+}
+
+/* 比测试线程高，在满的容器上一直等着发，结果放到msg_test_got[0] */
+static void msg_test_blocked_sender(void *args)
+{
+    acoral_msg_t *msg = acoral_msg_create(1, MSG_TEST_ID, 0, NULL);
+
+    msg_test_got[0] = acoral_msg_send_wait(msg_test_ctr, msg, 0);
+    acoral_msg_del(msg);
+}
+
+/* 比测试线程高，等一个没有的id，错误号放到msg_test_got[1] */
+static void msg_test_blocked_receiver(void *args)
+{
+    unsigned int err = 0;
+
+    acoral_msg_recv(msg_test_ctr, MSG_TEST_ID2, 0, &err);
+    msg_test_got[1] = err;
+}
+
+/* 比测试线程高，容器满了就等测试线程收走 */
+static void msg_test_producer(void *args)
+{
+    long i;
+
+    for (i = 1; i <= MSG_TEST_PRODUCED; i++)
+        acoral_msg_send_wait(msg_test_ctr, acoral_msg_create(1, MSG_TEST_ID, 0, (void *)i), 0);
+}
+
+static void msg_test_backpressure(unsigned int *errors)
+{
+    acoral_msg_t *msg;
+    unsigned int err, t0;
+    long i;
+
+    msg_test_ctr = acoral_msgctr_create(MSG_TEST_CAPACITY);
+
+    /* 容器满了：非阻塞的失败，阻塞的等到超时，消息都还归自己 */
+    for (i = 0; i < MSG_TEST_CAPACITY; i++)
+        acoral_msg_send(msg_test_ctr, acoral_msg_create(1, MSG_TEST_ID2, 0, NULL));
+    msg = acoral_msg_create(1, MSG_TEST_ID2, 0, NULL);
+    if (acoral_msg_send(msg_test_ctr, msg) != MSG_ERR_COUNT)
+        (*errors)++;
+    t0 = acoral_get_ticks();
+    if (acoral_msg_send_wait(msg_test_ctr, msg, MSG_TEST_TIMEOUT) != MST_ERR_TIMEOUT
+        || acoral_get_ticks() - t0 < (unsigned int)time_to_ticks(MSG_TEST_TIMEOUT))
+        (*errors)++;
+    acoral_msg_del(msg);
+    for (i = 0; i < MSG_TEST_CAPACITY; i++)
+        acoral_msg_recv(msg_test_ctr, MSG_TEST_ID2, MSG_TEST_TIMEOUT, &err);
+
+    /* 生产者一口气发，发满就停下来等；测试线程每收一条，它补一条，容器里一直是满的 */
+    acoral_create_thread_affinity("msg_producer", msg_test_producer, NULL, 0, ACORAL_SCHED_POLICY_COMM, 9, ACORAL_HARD_PRIO, NULL, 0);
+    for (i = 1; i <= MSG_TEST_PRODUCED; i++)
+    {
+        if (msg_test_ctr->count != (i <= MSG_TEST_PRODUCED - MSG_TEST_CAPACITY + 1 ? MSG_TEST_CAPACITY : MSG_TEST_PRODUCED - i + 1))
+            (*errors)++;
+        if ((long)acoral_msg_recv(msg_test_ctr, MSG_TEST_ID, MSG_TEST_TIMEOUT, &err) != i)
+            (*errors)++;
+    }
+    if (acoral_msgctr_del(msg_test_ctr, MST_DEL_UNFORCE) != MSGCTR_SUCCED)
+        (*errors)++;
+
+    /* 有线程等着收发时强制删掉，都被叫醒返回MST_ERR_DEL，不再碰已经释放的容器 */
+    msg_test_ctr = acoral_msgctr_create(1);
+    acoral_msg_send(msg_test_ctr, acoral_msg_create(1, MSG_TEST_ID, 0, NULL));
+    msg_test_got[0] = msg_test_got[1] = -1;
+    acoral_create_thread_affinity("msg_sender", msg_test_blocked_sender, NULL, 0, ACORAL_SCHED_POLICY_COMM, 8, ACORAL_HARD_PRIO, NULL, 0);
+    acoral_create_thread_affinity("msg_waiter", msg_test_blocked_receiver, NULL, 0, ACORAL_SCHED_POLICY_COMM, 9, ACORAL_HARD_PRIO, NULL, 0);
+    if (msg_test_got[0] != -1 || msg_test_got[1] != -1)
+        (*errors)++;
+    if (acoral_msgctr_del(msg_test_ctr, MST_DEL_FORCE) != MSGCTR_SUCCED)
+        (*errors)++;
+    if (msg_test_got[0] != MST_ERR_DEL || msg_test_got[1] != MST_ERR_DEL)
+        (*errors)++;
+    printf("msg: backpressure done, %u errors\r\n", *errors);
+}
+
+static void msg_test_expire(acoral_msgctr_t *msgctr, unsigned int id, void *data)
+{
+    msg_test_expired += (long)data;
+}
+
+static void msg_test_ttl(unsigned int *errors)
+{
+    acoral_msg_t *msg;
+    unsigned int err, t0;
+
+    msg_test_ctr = acoral_msgctr_create(3);
+    msg_test_expired = 0;
+    acoral_msgctr_set_expire(msg_test_ctr, msg_test_expire);
+
+    /* 同一个id：短的在前，一直有效的在中间，长的在后；另一个id的比短的还早过期 */
+    acoral_msg_send(msg_test_ctr, acoral_msg_create(1, MSG_TEST_ID, MSG_TEST_TTL, (void *)1));
+    acoral_msg_send(msg_test_ctr, acoral_msg_create(1, MSG_TEST_ID, 0, (void *)2));
+    acoral_msg_send(msg_test_ctr, acoral_msg_create(1, MSG_TEST_ID2, 1, (void *)4));
+    /* 满了，要等一条过期腾出位置 */
+    t0 = acoral_get_ticks();
+    if (acoral_msg_send_wait(msg_test_ctr, acoral_msg_create(1, MSG_TEST_ID, 4 * MSG_TEST_TTL, (void *)8), MSG_TEST_TIMEOUT * 10) != MSGCTR_SUCCED
+        || acoral_get_ticks() - t0 > 1)
+        (*errors)++;
+    if (msg_test_ctr->expired != 1 || msg_test_expired != 4)
+        (*errors)++;
+
+    /* 没人收，到时候由定时器回收；收到的是一直有效的那条，不是过期的 */
+    acoral_delay_self(ACORAL_TICKS_TO_MS(MSG_TEST_TTL + 1));
+    if (msg_test_ctr->expired != 2 || msg_test_expired != 5 || msg_test_ctr->count != 2)
+        (*errors)++;
+    if ((long)acoral_msg_recv(msg_test_ctr, MSG_TEST_ID, MSG_TEST_TIMEOUT, &err) != 2)
+        (*errors)++;
+
+    /* 剩下那条也过期，之后等这个id的只能等到超时 */
+    acoral_delay_self(ACORAL_TICKS_TO_MS(4 * MSG_TEST_TTL));
+    if (msg_test_ctr->expired != 3 || msg_test_expired != 13 || msg_test_ctr->count != 0)
+        (*errors)++;
+    if (acoral_msg_recv(msg_test_ctr, MSG_TEST_ID, MSG_TEST_TIMEOUT, &err) != NULL || err != MST_ERR_TIMEOUT)
+        (*errors)++;
+
+    /* 没过期就收走的不通知，删容器时定时器也停掉 */
+    msg = acoral_msg_create(1, MSG_TEST_ID, MSG_TEST_TTL, (void *)16);
+    acoral_msg_send(msg_test_ctr, msg);
+    if ((long)acoral_msg_recv(msg_test_ctr, MSG_TEST_ID, MSG_TEST_TIMEOUT, &err) != 16)
+        (*errors)++;
+    if (acoral_msgctr_del(msg_test_ctr, MST_DEL_UNFORCE) != MSGCTR_SUCCED)
+        (*errors)++;
+    acoral_delay_self(ACORAL_TICKS_TO_MS(MSG_TEST_TTL + 1));
+    if (msg_test_expired != 13)
+        (*errors)++;
+    printf("msg: ttl done, %u errors\r\n", *errors);
+}
+
+static void msg_test_buffers(unsigned int *errors)
+{
+    acoral_msgctr_t *ctrs[MSG_TEST_FANOUT];
+    acoral_msgbuf_pool_t *pool;
+    unsigned char *buf, *got;
+    unsigned int err, i;
+
+    pool = acoral_msgbuf_pool_create(MSG_TEST_FRAME, 2);
+    if (pool == NULL)
+    {
+        printf("msg: no memory for buffer pool\r\n");
+        (*errors)++;
+        return;
+    }
+    for (i = 0; i < MSG_TEST_FANOUT; i++)
+        ctrs[i] = acoral_msgctr_create(0);
+
+    /* 多播之后发送者马上放掉自己的引用，缓冲区靠消息持有的引用留着 */
+    buf = acoral_msgbuf_alloc(pool);
+    if (((unsigned long)buf & 7) != 0)
+        (*errors)++;
+    memset(buf, 0x5a, MSG_TEST_FRAME);
+    if (acoral_msg_multicast(ctrs, MSG_TEST_FANOUT, MSG_TEST_ID, 0, buf) != MSG_TEST_FANOUT)
+        (*errors)++;
+    acoral_msgbuf_put(buf);
+    for (i = 0; i < MSG_TEST_FANOUT; i++)
+    {
+        got = acoral_msg_recv(ctrs[i], MSG_TEST_ID, MSG_TEST_TIMEOUT, &err);
+        if (got != buf || got[0] != 0x5a || got[MSG_TEST_FRAME - 1] != 0x5a)
+            (*errors)++;
+        if (pool->free_num != 1)
+            (*errors)++;
+        acoral_msgbuf_put(got);
+    }
+    if (pool->free_num != 2)
+        (*errors)++;
+
+    /* 能收三次的消息只收了一次就删容器，剩下两个引用由内核放掉 */
+    buf = acoral_msgbuf_alloc(pool);
+    acoral_msg_send(ctrs[0], acoral_msg_create_buf(3, MSG_TEST_ID, 0, buf));
+    acoral_msgbuf_put(buf);
+    got = acoral_msg_recv(ctrs[0], MSG_TEST_ID, MSG_TEST_TIMEOUT, &err);
+    if (got != buf || ctrs[0]->count != 1)
+        (*errors)++;
+    acoral_msgbuf_put(got);
+    if (pool->free_num != 1)
+        (*errors)++;
+    for (i = 0; i < MSG_TEST_FANOUT; i++)
+        acoral_msgctr_del(ctrs[i], MST_DEL_FORCE);
+    if (pool->free_num != 2 || acoral_msgbuf_pool_del(pool) != 0)
+        (*errors)++;
+    printf("msg: buffers and multicast done, %u errors\r\n", *errors);
+}
+
+static void msg_test_thread(void *args)
+{
+    unsigned int errors = 0, err, t0;
+    long i;
+
+    msg_test_ctr = acoral_msgctr_create(0);
+
+    /* 1. 两个id交替发，按id分别收 */
+    for (i = 1; i <= 8; i++)
+        acoral_msg_send(msg_test_ctr, acoral_msg_create(1, i % 2 ? MSG_TEST_ID : MSG_TEST_ID2, 0, (void *)i));
+    for (i = 2; i <= 8; i += 2)
+        if ((long)acoral_msg_recv(msg_test_ctr, MSG_TEST_ID2, MSG_TEST_TIMEOUT, &err) != i)
+            errors++;
+    for (i = 1; i <= 8; i += 2)
+        if ((long)acoral_msg_recv(msg_test_ctr, MSG_TEST_ID, MSG_TEST_TIMEOUT, &err) != i)
+            errors++;
+    if (msg_test_ctr->count != 0)
+        errors++;
+    printf("msg: per-id fifo done, %u errors\r\n", errors);
+
+    /* 2. 两个等待线程都比测试线程高，等的id在同一个桶里；发给低的那个，高的那个不能被叫醒 */
+    msg_test_got[0] = msg_test_got[1] = 0;
+    acoral_create_thread_affinity("msg_waiter", msg_test_waiter, (void *)0, 0, ACORAL_SCHED_POLICY_COMM, 8, ACORAL_HARD_PRIO, NULL, 0);
+    acoral_create_thread_affinity("msg_waiter", msg_test_waiter, (void *)1, 0, ACORAL_SCHED_POLICY_COMM, 9, ACORAL_HARD_PRIO, NULL, 0);
+    if (msg_test_ctr->wait_thread_num != 2)
+        errors++;
+    acoral_msg_send(msg_test_ctr, acoral_msg_create(1, MSG_TEST_ID2, 0, (void *)22));
+    if (msg_test_got[1] != 22 || msg_test_got[0] != 0 || msg_test_ctr->wait_thread_num != 1)
+        errors++;
+    acoral_msg_send(msg_test_ctr, acoral_msg_create(1, MSG_TEST_ID, 0, (void *)11));
+    if (msg_test_got[0] != 11 || msg_test_ctr->wait_thread_num != 0)
+        errors++;
+    printf("msg: wake by id done, %u errors\r\n", errors);
+
+    /* 3. 两个等待线程等同一个id，发一条能收两次的 */
+    msg_test_got[0] = msg_test_got[1] = 0;
+    acoral_create_thread_affinity("msg_waiter", msg_test_waiter, (void *)1, 0, ACORAL_SCHED_POLICY_COMM, 8, ACORAL_HARD_PRIO, NULL, 0);
+    acoral_create_thread_affinity("msg_waiter", msg_test_waiter, (void *)1, 0, ACORAL_SCHED_POLICY_COMM, 9, ACORAL_HARD_PRIO, NULL, 0);
+    acoral_msg_send(msg_test_ctr, acoral_msg_create(2, MSG_TEST_ID2, 0, (void *)33));
+    if (msg_test_got[1] != 33 || msg_test_ctr->wait_thread_num != 0 || msg_test_ctr->count != 0)
+        errors++;
+    printf("msg: multi-receive done, %u errors\r\n", errors);
+
+    /* 4. 没有的id等到超时 */
+    acoral_msg_send(msg_test_ctr, acoral_msg_create(1, MSG_TEST_ID, 0, (void *)1));
+    t0 = acoral_get_ticks();
+    if (acoral_msg_recv(msg_test_ctr, MSG_TEST_ID2, MSG_TEST_TIMEOUT, &err) != NULL || err != MST_ERR_TIMEOUT
+        || acoral_get_ticks() - t0 < (unsigned int)time_to_ticks(MSG_TEST_TIMEOUT))
+        errors++;
+    if (msg_test_ctr->wait_thread_num != 0 || (long)acoral_msg_recv(msg_test_ctr, MSG_TEST_ID, MSG_TEST_TIMEOUT, &err) != 1)
+        errors++;
+    if (acoral_msgctr_del(msg_test_ctr, MST_DEL_UNFORCE) != MSGCTR_SUCCED)
+        errors++;
+
+    msg_test_backpressure(&errors);
+    msg_test_ttl(&errors);
+    msg_test_buffers(&errors);
+    printf("msg: %u errors\r\n", errors);
+}
+#endif
+
+/**
+ * @brief 消息容器测试：按id先进先出、只唤醒等这个id的线程、多次接收、接收超时、满了阻塞发送、过期回收、缓冲区多播
+ *
+ */
+void test_msg()
+{
+#if CFG_MSG
+    acoral_create_thread_affinity("msg_test", msg_test_thread, NULL, 0, ACORAL_SCHED_POLICY_COMM, 10, ACORAL_HARD_PRIO, NULL, 0);
+#else
+    printf("msg: CFG_MSG is off\r\n");
+#endif
+}
@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <string.h>
+#include "acoral.h"
+#include "user.h"
+
+/* 定长消息队列测试：
+ * 1. 先进先出，绕过缓冲区末尾之后内容不乱；
+ * 2. 满了非阻塞发送失败，空了非阻塞接收失败，阻塞的等到超时；
+ * 3. 满了阻塞发送，对面收走一条就发进去；空了阻塞接收，对面发一条就收到；
+ * 4. 中断服务函数里非阻塞发送，线程收到 */
+
+#if CFG_MSGQ
+#define MSGQ_TEST_CAPACITY 4
+#define MSGQ_TEST_ROUNDS 1000       ///<生产者和消费者之间传的消息数
+#define MSGQ_TEST_TIMEOUT 20        ///<等超时的毫秒数
+#define MSGQ_TEST_VECTOR 5          ///<中断发送测试用的软件中断向量
+
+/* 故意不是4的倍数，拷贝不能偷懒按字拷 */
+typedef struct{
+    unsigned int seq;
+    unsigned char pad[9];
+}msgq_test_msg_t;
+
+static acoral_msgq_t *msgq_test_q;
+static volatile unsigned int msgq_test_isr_sent;
+
+static void msgq_test_fill(msgq_test_msg_t *m, unsigned int seq)
+{
+    m->seq = seq;
+    memset(m->pad, seq & 0xff, sizeof(m->pad));
+}
+
+static int msgq_test_check(const msgq_test_msg_t *m, unsigned int seq)
+{
+    unsigned int i;
+
+    if (m->seq != seq)
+        return 1;
+    for (i = 0; i < sizeof(m->pad); i++)
+        if (m->pad[i] != (seq & 0xff))
+            return 1;
+    return 0;
+}
+
+/* 比测试线程低，测试线程等着的时候才跑 */
+static void msgq_test_consumer(void *args)
+{
+    msgq_test_msg_t m;
+    unsigned int i;
+
+    for (i = 0; i < MSGQ_TEST_ROUNDS; i++)
+        acoral_msgq_recv(msgq_test_q, &m, 0);
+}
+
+static void msgq_test_producer(void *args)
+{
+    msgq_test_msg_t m;
+    unsigned int i;
+
+    for (i = 0; i < MSGQ_TEST_ROUNDS; i++)
+    {
+        msgq_test_fill(&m, i);
+        acoral_msgq_send(msgq_test_q, &m, 0);
+    }
+}
+
+#ifdef HAL_INTR_RAISE
+static void msgq_test_isr(int vector)
+{
+    msgq_test_msg_t m;
+
+    msgq_test_fill(&m, msgq_test_isr_sent);
+    if (acoral_msgq_trysend(msgq_test_q, &m) == MSGQ_SUCCED)
+        msgq_test_isr_sent++;
+}
+#endif
+
+static void msgq_test_thread(void *args)
+{
+    msgq_test_msg_t m;
+    unsigned int errors = 0, i, j, t0;
+
+    msgq_test_q = acoral_msgq_create(sizeof(msgq_test_msg_t), MSGQ_TEST_CAPACITY);
+    if (msgq_test_q == NULL)
+    {
+        printf("msgq: create failed\r\n");
+        return;
+    }
+
+    /* 1. 每次发三条收三条，写的位置一圈圈绕过缓冲区末尾 */
+    for (i = 0; i < 10; i++)
+    {
+        for (j = 0; j < 3; j++)
+        {
+            msgq_test_fill(&m, i * 3 + j);
+            if (acoral_msgq_trysend(msgq_test_q, &m) != MSGQ_SUCCED)
+                errors++;
+        }
+        for (j = 0; j < 3; j++)
+            if (acoral_msgq_tryrecv(msgq_test_q, &m) != MSGQ_SUCCED || msgq_test_check(&m, i * 3 + j))
+                errors++;
+    }
+    printf("msgq: fifo done, %u errors\r\n", errors);
+
+    /* 2. 满和空 */
+    for (i = 0; i < MSGQ_TEST_CAPACITY; i++)
+        acoral_msgq_trysend(msgq_test_q, &m);
+    if (acoral_msgq_trysend(msgq_test_q, &m) != MSGQ_ERR_FULL || acoral_msgq_count(msgq_test_q) != MSGQ_TEST_CAPACITY)
+        errors++;
+    t0 = acoral_get_ticks();
+    if (acoral_msgq_send(msgq_test_q, &m, MSGQ_TEST_TIMEOUT) != MSGQ_ERR_TIMEOUT
+        || acoral_get_ticks() - t0 < (unsigned int)time_to_ticks(MSGQ_TEST_TIMEOUT))
+        errors++;
+    for (i = 0; i < MSGQ_TEST_CAPACITY; i++)
+        acoral_msgq_tryrecv(msgq_test_q, &m);
+    if (acoral_msgq_tryrecv(msgq_test_q, &m) != MSGQ_ERR_EMPTY)
+        errors++;
+    t0 = acoral_get_ticks();
+    if (acoral_msgq_recv(msgq_test_q, &m, MSGQ_TEST_TIMEOUT) != MSGQ_ERR_TIMEOUT
+        || acoral_get_ticks() - t0 < (unsigned int)time_to_ticks(MSGQ_TEST_TIMEOUT))
+        errors++;
+#if CFG_HRTIMER
+    if (acoral_msgq_recv_ns(msgq_test_q, &m, 200000) != MSGQ_ERR_TIMEOUT)
+        errors++;
+#endif
+    printf("msgq: full and empty done, %u errors\r\n", errors);
+
+    /* 3. 测试线程发，低优先级的消费者收：队列满了测试线程就等，消费者收走一条再发 */
+    acoral_create_thread_affinity("msgq_consumer", msgq_test_consumer, NULL, 0, ACORAL_SCHED_POLICY_COMM, 11, ACORAL_HARD_PRIO, NULL, 0);
+    for (i = 0; i < MSGQ_TEST_ROUNDS; i++)
+    {
+        msgq_test_fill(&m, i);
+        if (acoral_msgq_send(msgq_test_q, &m, 1000) != MSGQ_SUCCED)
+            errors++;
+    }
+    acoral_delay_self(20);
+    if (acoral_msgq_count(msgq_test_q) != 0)
+        errors++;
+    /* 反过来，低优先级的生产者发，测试线程收，队列空了测试线程就等 */
+    acoral_create_thread_affinity("msgq_producer", msgq_test_producer, NULL, 0, ACORAL_SCHED_POLICY_COMM, 11, ACORAL_HARD_PRIO, NULL, 0);
+    for (i = 0; i < MSGQ_TEST_ROUNDS; i++)
+        if (acoral_msgq_recv(msgq_test_q, &m, 1000) != MSGQ_SUCCED || msgq_test_check(&m, i))
+            errors++;
+    printf("msgq: blocking send and recv done, %u errors\r\n", errors);
+
+    /* 4. 中断里发，满了的丢掉 */
+#ifdef HAL_INTR_RAISE
+    msgq_test_isr_sent = 0;
+    acoral_intr_attach(MSGQ_TEST_VECTOR, msgq_test_isr);
+    acoral_intr_unmask(MSGQ_TEST_VECTOR);
+    for (i = 0; i < MSGQ_TEST_CAPACITY * 2; i++)
+        HAL_INTR_RAISE(MSGQ_TEST_VECTOR);
+    acoral_delay_self(20);
+    acoral_intr_mask(MSGQ_TEST_VECTOR);
+    acoral_intr_detach(MSGQ_TEST_VECTOR);
+    if (msgq_test_isr_sent != MSGQ_TEST_CAPACITY)
+        errors++;
+    for (i = 0; i < msgq_test_isr_sent; i++)
+        if (acoral_msgq_recv(msgq_test_q, &m, MSGQ_TEST_TIMEOUT) != MSGQ_SUCCED || msgq_test_check(&m, i))
+            errors++;
+    printf("msgq: isr sent %u, %u errors\r\n", msgq_test_isr_sent, errors);
+#endif
+
+    if (acoral_msgq_del(msgq_test_q) != MSGQ_SUCCED)
+        errors++;
+    printf("msgq: %u errors\r\n", errors);
+}
+#endif
+
+/**
+ * @brief 定长消息队列测试：先进先出、满和空、阻塞收发、中断里发送
+ *
+ */
+void test_msgq()
+{
+#if CFG_MSGQ
+    acoral_create_thread_affinity("msgq_test", msgq_test_thread, NULL, 0, ACORAL_SCHED_POLICY_COMM, 10, ACORAL_HARD_PRIO, NULL, 0);
+#else
+    printf("msgq: CFG_MSGQ is off\r\n");
+#endif
+}
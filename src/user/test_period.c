@@ -9,10 +9,26 @@ void p1(){
     return;
 }
 
+/* 用acoral_period_wait写成循环，局部变量一直留着，不用static */
+void p2(){
+    int i = 0, missed;
+    while (1) {
+        i++;
+        printf("p2 job %d\n", i);
+        missed = acoral_period_wait();
+        if (missed > 0)
+            printf("p2 missed %d releases\n", missed);
+    }
+}
+
 void test_period_thread(){
     acoral_period_policy_data_t p1data={
         .period_time_mm = 2000
     };
+    acoral_period_policy_data_t p2data={
+        .period_time_mm = 1000
+    };
 
     acoral_create_thread("p1",p1,NULL,0,ACORAL_SCHED_POLICY_PERIOD,21,ACORAL_HARD_PRIO,&p1data);
-}
\ No newline at end of file
+    acoral_create_thread("p2",p2,NULL,0,ACORAL_SCHED_POLICY_PERIOD,22,ACORAL_HARD_PRIO,&p2data);
+}
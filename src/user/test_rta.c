@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include "acoral.h"
+#include "user.h"
+
+/* 周期线程准入检查测试，所有线程都绑在0号核上，单位是毫秒：
+ * 1. A(C=20,T=50)、B(C=30,T=100)，利用率0.7，不超过两个线程的Liu-Layland上界0.828，直接可调度；
+ * 2. 加上C(C=40,T=200)，利用率0.9，超过了三个线程的上界0.779，但响应时间分析得出C的最坏响应时间是180，不超过周期，可以加入；
+ * 3. 再加D(C=10,T=100)，利用率正好1.0，但它优先级最低，最坏响应时间会超过周期100，应该被拒绝；
+ * 4. D再被拒绝很多次，次数比TCB和定时器资源池都大，其他线程的最坏响应时间不变，之后照样能创建线程 */
+
+typedef struct{
+    char *name;
+    unsigned int c;
+    unsigned int t;
+    unsigned int prio;
+    int expect;         ///<期望的最坏响应时间，-1表示期望被拒绝
+}rta_test_task_t;
+
+static rta_test_task_t rta_tasks[] = {
+    {"A", 20, 50, 20, 20},
+    {"B", 30, 100, 21, 50},
+    {"C", 40, 200, 22, 180},
+    {"D", 10, 100, 23, -1}
+};
+
+#define RTA_TEST_TASKS (sizeof(rta_tasks) / sizeof(rta_tasks[0]))
+#define RTA_TEST_REJECTS 128 ///<D再被拒绝的次数
+
+/* 作业本身什么都不做，只关心准入检查 */
+static void rta_job(void *args)
+{
+}
+
+static void rta_test_thread(void *args)
+{
+    acoral_period_policy_data_t data;
+    int id[RTA_TEST_TASKS];
+    int i, wcrt, extra, errors = 0;
+
+    printf("rta: task\tC\tT\tprio\tid\r\n");
+    for (i = 0; i < RTA_TEST_TASKS; i++)
+    {
+        data.period_time_mm = rta_tasks[i].t;
+        data.wcet_mm = rta_tasks[i].c;
+        id[i] = acoral_create_thread_affinity(rta_tasks[i].name, rta_job, NULL, 0, ACORAL_SCHED_POLICY_PERIOD, rta_tasks[i].prio, ACORAL_HARD_PRIO, &data, 0);
+        printf("rta: %s\t%u\t%u\t%u\t%d\r\n", rta_tasks[i].name, rta_tasks[i].c, rta_tasks[i].t, rta_tasks[i].prio, id[i]);
+        if ((id[i] == -1) != (rta_tasks[i].expect == -1))
+            errors++;
+    }
+
+    /* 后加入的线程会让前面低优先级线程的最坏响应时间变大，所以全部加完再读 */
+    printf("rta: task\twcrt\texpect\r\n");
+    for (i = 0; i < RTA_TEST_TASKS; i++)
+    {
+        if (id[i] == -1)
+            continue;
+        wcrt = acoral_period_get_wcrt(id[i]);
+        printf("rta: %s\t%d\t%d\r\n", rta_tasks[i].name, wcrt, rta_tasks[i].expect);
+        if (wcrt != rta_tasks[i].expect)
+            errors++;
+    }
+
+    /* 被拒绝的线程什么都不能留下，不漏资源，也不改别人的最坏响应时间 */
+    data.period_time_mm = rta_tasks[RTA_TEST_TASKS - 1].t;
+    data.wcet_mm = rta_tasks[RTA_TEST_TASKS - 1].c;
+    for (i = 0; i < RTA_TEST_REJECTS; i++)
+        if (acoral_create_thread_affinity("D", rta_job, NULL, 0, ACORAL_SCHED_POLICY_PERIOD, rta_tasks[RTA_TEST_TASKS - 1].prio, ACORAL_HARD_PRIO, &data, 0) != -1)
+            errors++;
+    for (i = 0; i < RTA_TEST_TASKS; i++)
+        if (id[i] != -1 && acoral_period_get_wcrt(id[i]) != rta_tasks[i].expect)
+            errors++;
+    /* 不填WCET的不参加准入检查，一定能建 */
+    data.wcet_mm = 0;
+    extra = acoral_create_thread_affinity("E", rta_job, NULL, 0, ACORAL_SCHED_POLICY_PERIOD, 24, ACORAL_HARD_PRIO, &data, 0);
+    printf("rta: %d rejections, then E id %d\r\n", RTA_TEST_REJECTS, extra);
+    if (extra == -1)
+        errors++;
+    else
+        acoral_kill_thread_by_id(extra);
+    /* 杀掉一个线程时会马上重算剩下的最坏响应时间，所以全部读完再杀 */
+    for (i = 0; i < RTA_TEST_TASKS; i++)
+        if (id[i] != -1)
+            acoral_kill_thread_by_id(id[i]);
+    printf("rta: %d errors\r\n", errors);
+}
+
+/**
+ * @brief 周期线程准入检查和最坏响应时间测试
+ *
+ */
+void test_rta()
+{
+    acoral_create_thread_affinity("rta_test", rta_test_thread, NULL, 0, ACORAL_SCHED_POLICY_COMM, 10, ACORAL_HARD_PRIO, NULL, 0);
+}
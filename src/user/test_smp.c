@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include "acoral.h"
+#include "user.h"
+
+/* 多核压力测试：
+ * 1. ping/pong两个线程分别绑在0号核和1号核上，用两个信号量来回唤醒，测跨核唤醒和核间中断；
+ * 2. 每个核一个adder线程，在临界区里累加同一个计数器，测内核大锁；
+ * 3. 一个migrator线程不停地改自己的亲和性，测线程迁移，每次迁移后检查自己是否真的跑到了目标核上 */
+
+#define SMP_PINGPONG_ROUNDS 2000
+#define SMP_ADD_ROUNDS 200000
+#define SMP_MIGRATE_ROUNDS 2000
+
+static acoral_evt_t *ping_sem, *pong_sem, *done_sem;
+static volatile unsigned int smp_counter;
+static volatile int migrate_errors;
+static unsigned long long smp_start, pingpong_cycles, migrate_cycles;
+
+static void smp_ping(void *args)
+{
+    int i;
+    for (i = 0; i < SMP_PINGPONG_ROUNDS; i++)
+    {
+        acoral_sem_post(pong_sem);
+        acoral_sem_pend(ping_sem, 0);
+    }
+    pingpong_cycles = HAL_GET_CYCLES() - smp_start;
+    acoral_sem_post(done_sem);
+}
+
+static void smp_pong(void *args)
+{
+    int i;
+    for (i = 0; i < SMP_PINGPONG_ROUNDS; i++)
+    {
+        acoral_sem_pend(pong_sem, 0);
+        acoral_sem_post(ping_sem);
+    }
+    acoral_sem_post(done_sem);
+}
+
+static void smp_adder(void *args)
+{
+    int i;
+    for (i = 0; i < SMP_ADD_ROUNDS; i++)
+    {
+        acoral_enter_critical();
+        smp_counter++;
+        acoral_exit_critical();
+    }
+    acoral_sem_post(done_sem);
+}
+
+static void smp_migrator(void *args)
+{
+    int i, cpu;
+    int id = acoral_cur_thread->res.id;
+    for (i = 0; i < SMP_MIGRATE_ROUNDS; i++)
+    {
+        cpu = i % CFG_MAX_CPU;
+        acoral_thread_set_affinity(id, cpu);
+        if (acoral_current_cpu() != cpu)
+            migrate_errors++;
+    }
+    migrate_cycles = HAL_GET_CYCLES() - smp_start;
+    acoral_sem_post(done_sem);
+}
+
+static void smp_checker(void *args)
+{
+    int i;
+    for (i = 0; i < 2 + CFG_MAX_CPU + 1; i++)
+        acoral_sem_pend(done_sem, 0);
+    printf("smp: %d cpus\n", CFG_MAX_CPU);
+    printf("  ping-pong: %d rounds, %llu cycles/round\n", SMP_PINGPONG_ROUNDS, pingpong_cycles / SMP_PINGPONG_ROUNDS);
+    printf("  adder    : counter %u, expect %u\n", smp_counter, SMP_ADD_ROUNDS * CFG_MAX_CPU);
+    printf("  migrator : %d migrations, %d errors, %llu cycles/migration\n", SMP_MIGRATE_ROUNDS, migrate_errors, migrate_cycles / SMP_MIGRATE_ROUNDS);
+}
+
+void test_smp()
+{
+    int cpu;
+    ping_sem = acoral_sem_create(0);
+    pong_sem = acoral_sem_create(0);
+    done_sem = acoral_sem_create(0);
+    smp_start = HAL_GET_CYCLES();
+
+    acoral_create_thread("checker",smp_checker,NULL,0,ACORAL_SCHED_POLICY_COMM,10,ACORAL_HARD_PRIO,NULL);
+    acoral_create_thread_affinity("ping",smp_ping,NULL,0,ACORAL_SCHED_POLICY_COMM,20,ACORAL_HARD_PRIO,NULL,0);
+    acoral_create_thread_affinity("pong",smp_pong,NULL,0,ACORAL_SCHED_POLICY_COMM,20,ACORAL_HARD_PRIO,NULL,CFG_MAX_CPU - 1);
+    for (cpu = 0; cpu < CFG_MAX_CPU; cpu++)
+        acoral_create_thread_affinity("adder",smp_adder,NULL,0,ACORAL_SCHED_POLICY_COMM,25,ACORAL_HARD_PRIO,NULL,cpu);
+    acoral_create_thread("migrator",smp_migrator,NULL,0,ACORAL_SCHED_POLICY_COMM,22,ACORAL_HARD_PRIO,NULL);
+}
@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include "acoral.h"
+#include "user.h"
+
+/* 停ticks测试：系统里只有测试线程，它每次延时一段时间，其间所有核都空闲，0号核应该停掉周期ticks。
+ * 检查三件事：
+ * 1. 醒来时tick已经补上，延时前后tick的差等于延时的tick数；
+ * 2. 墙上时间也对得上，说明单次定时没有早到或者晚到；
+ * 3. 这段时间里定时中断的次数远少于tick数。
+ * 墙上时间用acoral_clock_ns量，它直接从硬件自由运行的计数器换算，不受ticks停没停的影响 */
+
+#if CFG_TICKLESS
+static const unsigned int tickless_delays[] = {50, 500, 2000}; ///<延时，毫秒
+
+static void tickless_test_thread(void *args)
+{
+    acoral_tickless_stat_t before, after;
+    unsigned int t0, t1, expect, slack, i, errors = 0;
+    unsigned long long c0, c1, wall;
+
+    /* 等系统里其它线程（比如shell的输出）安静下来 */
+    acoral_delay_self(100);
+    printf("tickless: delay(ms)\tticks\texpect\twall(ms)\tsleeps\tirqs saved\r\n");
+    for (i = 0; i < sizeof(tickless_delays) / sizeof(tickless_delays[0]); i++)
+    {
+        expect = time_to_ticks(tickless_delays[i]);
+        acoral_tickless_get_stat(&before);
+        t0 = acoral_get_ticks();
+        c0 = acoral_clock_ns();
+        acoral_delay_self(tickless_delays[i]);
+        c1 = acoral_clock_ns();
+        t1 = acoral_get_ticks();
+        acoral_tickless_get_stat(&after);
+        wall = ACORAL_NS_TO_MS(c1 - c0);
+        printf("tickless: %u\t%u\t%u\t%llu\t%u\t%u\r\n", tickless_delays[i], t1 - t0, expect, wall,
+               after.sleeps - before.sleeps, (after.ticks - before.ticks) - (after.sleeps - before.sleeps));
+        /* 延时从下一个tick边界开始算，醒来时正好多走了不到一个tick */
+        if (t1 - t0 < expect || t1 - t0 > expect + 1)
+            errors++;
+        /* 差两个tick以内，再按延时长短留1%，主机上的定时器信号本身就会一点点漂 */
+        slack = 2000 / CFG_TICKS_PER_SEC + tickless_delays[i] / 100;
+        if (wall + slack < tickless_delays[i] || wall > tickless_delays[i] + slack)
+            errors++;
+        /* 延时够长的话，绝大部分tick都应该是睡过去的 */
+        if (expect >= 10 && (after.ticks - before.ticks) - (after.sleeps - before.sleeps) < expect / 2)
+            errors++;
+    }
+    printf("tickless: %u errors\r\n", errors);
+}
+#endif
+
+/**
+ * @brief 停ticks测试：长延时期间tick照常前进，定时中断却少得多
+ *
+ */
+void test_tickless()
+{
+#if CFG_TICKLESS
+    acoral_create_thread_affinity("tickless_test", tickless_test_thread, NULL, 0, ACORAL_SCHED_POLICY_COMM, 10, ACORAL_HARD_PRIO, NULL, 0);
+#else
+    printf("tickless: CFG_TICKLESS is off\r\n");
+#endif
+}
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include "acoral.h"
+#include "user.h"
+
+/* 工作队列测试：
+ * 1. 同一个工作项还在队列上时再提交不会重复执行；
+ * 2. 延时提交按时执行，取消掉的不执行；
+ * 3. 中断服务函数里也能提交；
+ * 4. 连续提交很多个一次性的活，都能做完，打印平均每个活花多少周期 */
+
+#if CFG_WORKQ
+#define WORKQ_TEST_ITEMS 8
+#define WORKQ_TEST_DELAY 100    ///<延时提交的毫秒数
+#define WORKQ_TEST_JOBS 5000    ///<吞吐测试提交的活数
+#define WORKQ_TEST_VECTOR 5     ///<中断提交测试用的软件中断向量
+
+static acoral_work_t workq_test_items[WORKQ_TEST_ITEMS];
+static volatile unsigned int workq_test_runs[WORKQ_TEST_ITEMS];
+static volatile unsigned int workq_test_ticks[WORKQ_TEST_ITEMS];
+static volatile unsigned int workq_test_jobs;
+
+static void workq_test_fn(void *args)
+{
+    int i = (int)(long)args;
+    workq_test_runs[i]++;
+    workq_test_ticks[i] = acoral_get_ticks();
+}
+
+static void workq_test_job(void *args)
+{
+    workq_test_jobs++;
+}
+
+#ifdef HAL_INTR_RAISE
+static void workq_test_isr(int vector)
+{
+    acoral_workq_submit(ACORAL_WORKQ_HIGH, workq_test_job, NULL);
+}
+#endif
+
+static void workq_test_thread(void *args)
+{
+    unsigned int errors = 0, t0, i;
+    unsigned long long c0, c1;
+#ifdef HAL_INTR_RAISE
+    acoral_workq_stat_t before, after;
+#endif
+
+    /* 1. 测试线程比低档工作线程高，提交的活要等测试线程让出CPU才会做 */
+    for (i = 0; i < WORKQ_TEST_ITEMS; i++)
+        acoral_work_init(&workq_test_items[i], workq_test_fn, (void *)(long)i, ACORAL_WORKQ_LOW);
+    for (i = 0; i < WORKQ_TEST_ITEMS; i++)
+    {
+        /* 多核下工作线程可能在别的核上，拿着内核大锁提交两次，中间它取不走 */
+        acoral_enter_critical();
+        if (acoral_work_submit(&workq_test_items[i]) != 0)
+            errors++;
+        if (acoral_work_submit(&workq_test_items[i]) != -1)
+            errors++;
+        acoral_exit_critical();
+    }
+    acoral_delay_self(20);
+    for (i = 0; i < WORKQ_TEST_ITEMS; i++)
+        if (workq_test_runs[i] != 1)
+            errors++;
+    printf("workq: coalesce done, %u errors\r\n", errors);
+
+    /* 2. 延时提交一半，另一半提交后取消 */
+    t0 = acoral_get_ticks();
+    for (i = 0; i < WORKQ_TEST_ITEMS; i++)
+        acoral_work_submit_delayed(&workq_test_items[i], WORKQ_TEST_DELAY * (1 + i % 2));
+    for (i = 1; i < WORKQ_TEST_ITEMS; i += 2)
+        if (acoral_work_cancel(&workq_test_items[i]) != 0)
+            errors++;
+    acoral_delay_self(WORKQ_TEST_DELAY * 3);
+    for (i = 0; i < WORKQ_TEST_ITEMS; i++)
+    {
+        if (i % 2)
+        {
+            if (workq_test_runs[i] != 1)
+                errors++;
+        }
+        else if (workq_test_runs[i] != 2 || workq_test_ticks[i] - t0 < (unsigned int)time_to_ticks(WORKQ_TEST_DELAY)
+                 || workq_test_ticks[i] - t0 > (unsigned int)time_to_ticks(WORKQ_TEST_DELAY) + 2)
+            errors++;
+    }
+    printf("workq: delayed done, %u errors\r\n", errors);
+
+    /* 3. 中断里提交到高档。多核下工作线程可能在别的核上，来不及做的话内部池会用完，提交失败的也要记上 */
+#ifdef HAL_INTR_RAISE
+    workq_test_jobs = 0;
+    acoral_workq_get_stat(ACORAL_WORKQ_HIGH, &before);
+    acoral_intr_attach(WORKQ_TEST_VECTOR, workq_test_isr);
+    acoral_intr_unmask(WORKQ_TEST_VECTOR);
+    for (i = 0; i < 100; i++)
+        HAL_INTR_RAISE(WORKQ_TEST_VECTOR);
+    acoral_delay_self(20);
+    acoral_intr_mask(WORKQ_TEST_VECTOR);
+    acoral_intr_detach(WORKQ_TEST_VECTOR);
+    acoral_workq_get_stat(ACORAL_WORKQ_HIGH, &after);
+    if (workq_test_jobs + (after.pool_fails - before.pool_fails) != 100)
+        errors++;
+    printf("workq: isr submit %u done, %u pool full, %u errors\r\n", workq_test_jobs, after.pool_fails - before.pool_fails, errors);
+#endif
+
+    /* 4. 高档工作线程比测试线程高，单核上一提交就被做掉，内部池不会用完 */
+    workq_test_jobs = 0;
+    c0 = HAL_GET_CYCLES();
+    for (i = 0; i < WORKQ_TEST_JOBS; i++)
+        if (acoral_workq_submit(ACORAL_WORKQ_HIGH, workq_test_job, NULL) != 0)
+            errors++;
+    c1 = HAL_GET_CYCLES();
+    acoral_delay_self(20);
+    if (workq_test_jobs != WORKQ_TEST_JOBS)
+        errors++;
+    printf("workq: %u jobs, %llu cycles/job\r\n", workq_test_jobs, (c1 - c0) / WORKQ_TEST_JOBS);
+    printf("workq: %u errors\r\n", errors);
+}
+#endif
+
+/**
+ * @brief 工作队列测试：重复提交合并、延时提交和取消、中断里提交、连续提交的吞吐
+ *
+ */
+void test_workq()
+{
+#if CFG_WORKQ
+    acoral_create_thread_affinity("workq_test", workq_test_thread, NULL, 0, ACORAL_SCHED_POLICY_COMM, 10, ACORAL_HARD_PRIO, NULL, 0);
+#else
+    printf("workq: CFG_WORKQ is off\r\n");
+#endif
+}
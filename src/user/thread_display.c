@@ -18,7 +18,7 @@ void display_thread_new(int argc,char **argv){
     
     printf("\t\tSystem Thread Information\r\n");
 	printf("----------------------------------------------------------------\r\n");
-	printf("Name\t\tid\t\tType\t\tState\t\tPrio\r\n");
+	printf("Name\t\tid\t\tType\t\tState\t\tPrio\t\tCPU\r\n");
 	HAL_ENTER_CRITICAL();
 
 	for (list = head->next; list != head; list = list->next)
@@ -37,6 +37,9 @@ void display_thread_new(int argc,char **argv){
 			        case ACORAL_SCHED_POLICY_PERIOD:
 				        printf("Period\t\t");
 				        break;
+			        case ACORAL_SCHED_POLICY_EDF:
+				        printf("EDF\t\t");
+				        break;
 			        default:
 				        break;
 		        }
@@ -56,6 +59,7 @@ void display_thread_new(int argc,char **argv){
 				    printf("Error\t\t");
 		
 		        printf("%d\t\t",thread->prio);
+		        printf("%d\t\t",thread->cpu);
 		        printf("\r\n");
             }
         }
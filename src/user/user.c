@@ -8,5 +8,20 @@ void user_main(){
     // test_iris();
     // test_yolo2();
     test_dag();
+    // bench_rdyqueue();
+    // test_smp();
+    // bench_balance();
+    // test_edf();
+    // test_rta();
+    // bench_slice();
+    // test_tickless();
+    // bench_fpu();
+    // bench_kernel();
+    // test_workq();
+    // test_apptimer();
+    // test_hrtimer();
+    // test_clock();
+    // test_msgq();
+    // test_msg();
 
 }
\ No newline at end of file
@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""Convert the output of the aCoral shell command "trace dump" into Chrome/Perfetto JSON.
+
+Usage:
+    python3 trace2json.py dump.txt > trace.json
+    python3 trace2json.py < dump.txt > trace.json
+
+Open the result in chrome://tracing or https://ui.perfetto.dev. Each core gets
+one track with the running thread and instant events (wakeup/block/timer/ipc),
+plus one track for interrupts. Flow arrows link each wakeup to the switch that
+finally ran the thread. Wakeup-to-run latency stats are printed on stderr.
+
+Dump lines (other lines, such as the shell prompt, are ignored):
+    H <cpus> <cycles per us>
+    T <thread id> <name>
+    L <cpu> <records lost to overwrite>
+    E <cpu> <cycles> <type> <thread id> <arg>
+"""
+
+import json
+import sys
+
+VEC_NAMES = {-1: "tick", -2: "ipi", -3: "hrtimer"}
+
+
+def parse(lines):
+    cpus, cycles_per_us, names, lost, events = 1, 0, {}, {}, []
+    for line in lines:
+        f = line.strip().split()
+        if not f:
+            continue
+        if f[0] == "H" and len(f) == 3:
+            cpus, cycles_per_us = int(f[1]), int(f[2])
+        elif f[0] == "T" and len(f) >= 3:
+            names[int(f[1])] = " ".join(f[2:])
+        elif f[0] == "L" and len(f) == 3:
+            lost[int(f[1])] = int(f[2])
+        elif f[0] == "E" and len(f) == 6:
+            events.append((int(f[1]), int(f[2]), f[3], int(f[4]), int(f[5])))
+    return cpus, cycles_per_us, names, lost, events
+
+
+def main():
+    src = open(sys.argv[1]) if len(sys.argv) > 1 else sys.stdin
+    cpus, cycles_per_us, names, lost, events = parse(src)
+    if not events:
+        sys.exit("no trace events found")
+    if cycles_per_us == 0:
+        print("warning: unknown clock rate, timestamps are in cycles", file=sys.stderr)
+        cycles_per_us = 1
+    for cpu, n in lost.items():
+        print("warning: cpu%d lost %d old records" % (cpu, n), file=sys.stderr)
+
+    t0 = min(e[1] for e in events)
+
+    def ts(cycles):
+        return (cycles - t0) / cycles_per_us
+
+    def name(tid):
+        return names.get(tid, "thread %d" % tid)
+
+    out = [{"ph": "M", "pid": 0, "name": "process_name", "args": {"name": "aCoral"}}]
+    for cpu in range(cpus):
+        out.append({"ph": "M", "pid": 0, "tid": cpu, "name": "thread_name", "args": {"name": "cpu%d" % cpu}})
+        out.append({"ph": "M", "pid": 0, "tid": 1000 + cpu, "name": "thread_name", "args": {"name": "cpu%d irq" % cpu}})
+
+    running = {}     # cpu -> (thread id, start cycles)
+    first = {}       # cpu -> first event cycles
+    last = {}        # cpu -> last event cycles
+    irq_depth = {}   # cpu -> open irq slices
+    woken = {}       # thread id -> (wakeup cycles, flow id)
+    latencies = []
+    flow = 0
+
+    for cpu, cycles, kind, tid, arg in sorted(events, key=lambda e: e[1]):
+        first.setdefault(cpu, cycles)
+        last[cpu] = cycles
+        if kind == "switch":
+            prev = running.get(cpu, (arg, first[cpu]))
+            out.append({"ph": "X", "pid": 0, "tid": cpu, "name": name(prev[0]), "ts": ts(prev[1]),
+                        "dur": ts(cycles) - ts(prev[1]), "args": {"id": prev[0]}})
+            running[cpu] = (tid, cycles)
+            if tid in woken:
+                wake, fid = woken.pop(tid)
+                latencies.append((cycles - wake) / cycles_per_us)
+                out.append({"ph": "f", "bp": "e", "pid": 0, "tid": cpu, "name": "wakeup", "cat": "sched",
+                            "id": fid, "ts": ts(cycles)})
+        elif kind in ("irq_enter", "irq_exit"):
+            depth = irq_depth.get(cpu, 0)
+            if kind == "irq_enter":
+                irq_depth[cpu] = depth + 1
+                out.append({"ph": "B", "pid": 0, "tid": 1000 + cpu, "name": VEC_NAMES.get(arg, "irq %d" % arg),
+                            "ts": ts(cycles), "args": {"interrupted": name(tid)}})
+            elif depth > 0:
+                irq_depth[cpu] = depth - 1
+                out.append({"ph": "E", "pid": 0, "tid": 1000 + cpu, "ts": ts(cycles)})
+        else:
+            args = {"thread": name(tid), "arg": arg}
+            out.append({"ph": "i", "s": "t", "pid": 0, "tid": cpu, "name": "%s %s" % (kind, name(tid)),
+                        "cat": kind, "ts": ts(cycles), "args": args})
+            if kind == "wakeup":
+                flow += 1
+                woken[tid] = (cycles, flow)
+                out.append({"ph": "s", "pid": 0, "tid": cpu, "name": "wakeup", "cat": "sched",
+                            "id": flow, "ts": ts(cycles)})
+
+    for cpu, (tid, start) in running.items():
+        out.append({"ph": "X", "pid": 0, "tid": cpu, "name": name(tid), "ts": ts(start),
+                    "dur": ts(last[cpu]) - ts(start), "args": {"id": tid}})
+    for cpu, depth in irq_depth.items():
+        for _ in range(depth):
+            out.append({"ph": "E", "pid": 0, "tid": 1000 + cpu, "ts": ts(last[cpu])})
+
+    json.dump({"traceEvents": out, "displayTimeUnit": "ns"}, sys.stdout)
+    if latencies:
+        latencies.sort()
+        n = len(latencies)
+        print("wakeup->run latency (us): n=%d min=%.2f avg=%.2f p99=%.2f max=%.2f" %
+              (n, latencies[0], sum(latencies) / n, latencies[min(n - 1, (n * 99 + 99) // 100 - 1)], latencies[-1]),
+              file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()